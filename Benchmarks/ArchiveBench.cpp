@@ -0,0 +1,534 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Standalone harness measuring the archive hot paths used by the app: the
+// UnRAR DLL API (RARProcessFile -> Unpack::DoUnpack) and minizip
+// (unzReadCurrentFile). Build with "make -f makefile.unix bench" from the
+// UnRAR directory, then run "./archivebench [--corpus DIR] > results.json".
+// Each area of modes has its own file, and the ZIP, RAR, TAR and page generators
+// they share are in BenchCorpus.cpp:
+// - BenchDecoding.cpp: unzip.c and UnRAR per case, from --stats to --io-calls
+// - BenchLibrary.cpp: directory cache, page manifest, natural sort, import and cover
+// - BenchArchiveReader.cpp: ArchiveReader engine, read-ahead, handle cache and CBT
+// - BenchWriters.cpp: ZIP stream, parallel deflate, zstd and salvage
+// The generated corpus has stored and deflated CBZ, a stored CBR and a CBZ of
+// 10,000 small entries for the lookups by name. With --large-entry, a CBZ with
+// an entry over 4 GiB ahead of the pages is added so the ZIP64 fields and end
+// records are read too (it takes as much disk space and a while to write).
+// With --startup, each case also times a fresh process (this tool re-executed
+// with --first-listing) until it has read the first entry of the archive,
+// which includes any static initialization done by the libraries.
+//
+// Each case runs in a forked child so the reported peak RSS belongs to that
+// decoder alone. Cases are sorted by name and numbers use fixed formatting so
+// two runs can be diffed directly.
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "ArchiveBench.h"
+
+#include "unzip.h"
+
+#define kBenchVersion 1
+#define kDefaultIterations 3
+#define kDefaultPageCount 24
+#define kDefaultReadBufferSize 4096  // Typical unzReadCurrentFile() loop
+
+// Startup
+
+// Runs in the re-executed process: returns 0 once the first entry is listed
+static int _ListFirstEntry(const char* format, const char* path, const char* password) {
+  if (!strcmp(format, "zip")) {
+    unzFile file = unzOpen64(path);
+    if (file == NULL) {
+      return 1;
+    }
+    char name[1024];
+    unz_file_info64 info;
+    int error = unzGoToFirstFile(file);
+    if (error == UNZ_OK) {
+      error = unzGetCurrentFileInfo64(file, &info, name, sizeof(name), NULL, 0, NULL, 0);
+    }
+    unzClose(file);
+    return error == UNZ_OK ? 0 : 1;
+  }
+  struct RAROpenArchiveDataEx archiveData;
+  memset(&archiveData, 0, sizeof(archiveData));
+  archiveData.ArcName = (char*)path;
+  archiveData.OpenMode = RAR_OM_LIST;
+  HANDLE handle = RAROpenArchiveEx(&archiveData);
+  if ((handle == NULL) || (archiveData.OpenResult != 0)) {
+    return 1;
+  }
+  if (password) {
+    RARSetPassword(handle, (char*)password);
+  }
+  struct RARHeaderDataEx headerData;
+  memset(&headerData, 0, sizeof(headerData));
+  int error = RARReadHeaderEx(handle, &headerData);
+  RARCloseArchive(handle);
+  return error == 0 ? 0 : 1;
+}
+
+static CaseStatus _TimeStartupCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  const char* format = benchCase->format == kArchiveFormat_ZIP ? "zip" : "rar";
+  for (int i = 0; i < options->iterations; ++i) {
+    double start = BenchNow();
+    pid_t pid = fork();
+    if (pid == 0) {
+      execlp(options->tool, options->tool, "--first-listing", format, benchCase->path.c_str(), options->password, (char*)NULL);
+      _exit(127);
+    }
+    int status = 0;
+    if ((pid < 0) || (waitpid(pid, &status, 0) < 0)) {
+      return kCaseStatus_Crashed;
+    }
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+      return kCaseStatus_OpenFailed;
+    }
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->startupSeconds)) {
+      result->startupSeconds = seconds;
+    }
+  }
+  return kCaseStatus_OK;
+}
+
+static void _RunCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  memset(result, 0, sizeof(*result));
+  strcpy(result->method, "unknown");
+  result->ttfb = -1.0;
+  result->volumes = 1;
+
+  int fds[2];
+  if (pipe(fds) < 0) {
+    result->status = kCaseStatus_Crashed;
+    return;
+  }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    if (benchCase->format == kArchiveFormat_ZIP) {
+      result->status = BenchRunZipCase(benchCase, options, result);
+      if ((result->status == kCaseStatus_OK) && options->probe) {
+        result->status = BenchProbeZipCase(benchCase, options, result);
+      }
+    } else {
+      result->status = BenchRunRarCase(benchCase, options, result);
+      if ((result->status == kCaseStatus_OK) && options->probe) {
+        result->status = BenchProbeRarCase(benchCase, options, result);
+      }
+    }
+    if ((result->status == kCaseStatus_OK) && options->list) {
+      if (benchCase->format == kArchiveFormat_ZIP) {
+        result->status = BenchListZipCase(benchCase, options, result);
+      } else {
+        result->status = BenchListRarCase(benchCase, options, result);
+      }
+    }
+    if ((result->status == kCaseStatus_OK) && options->locate && (benchCase->format == kArchiveFormat_ZIP)) {
+      result->status = BenchLocateZipCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->mmap && (benchCase->format == kArchiveFormat_ZIP)) {
+      result->status = BenchCompareZipIOCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->pageOpen && (benchCase->format == kArchiveFormat_ZIP)) {
+      result->status = BenchOpenZipPagesCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->inflate && (benchCase->format == kArchiveFormat_ZIP)) {
+      result->status = BenchInflateZipCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->parallel && (benchCase->format == kArchiveFormat_ZIP)) {
+      result->status = BenchParallelZipCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->ioCalls && (benchCase->format == kArchiveFormat_ZIP)) {
+      result->status = BenchCountZipIOCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->directoryCache) {
+      result->status = BenchDirectoryCacheCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->zipStream && (benchCase->format == kArchiveFormat_ZIP)) {
+      result->status = BenchZipStreamCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->archiveReader) {
+      result->status = BenchArchiveReaderCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->pageManifest) {
+      result->status = BenchPageManifestCase(benchCase, options, result);
+    }
+    if ((result->status == kCaseStatus_OK) && options->startup) {
+      result->status = _TimeStartupCase(benchCase, options, result);
+    }
+    ssize_t written = write(fds[1], result, sizeof(*result));
+    _exit(written == sizeof(*result) ? 0 : 1);
+  }
+  close(fds[1]);
+  ssize_t length = pid > 0 ? read(fds[0], result, sizeof(*result)) : -1;
+  close(fds[0]);
+
+  int status = 0;
+  struct rusage usage;
+  memset(&usage, 0, sizeof(usage));
+  if ((pid < 0) || (wait4(pid, &status, 0, &usage) < 0) || (length != sizeof(*result)) || !WIFEXITED(status)) {
+    result->status = kCaseStatus_Crashed;
+  }
+#ifdef __APPLE__
+  result->peakRSS = usage.ru_maxrss / 1024;  // Bytes on Darwin
+#else
+  result->peakRSS = usage.ru_maxrss;
+#endif
+}
+
+// Output
+
+static void _PrintJSONString(const std::string& string) {
+  putchar('"');
+  for (size_t i = 0; i < string.size(); ++i) {
+    unsigned char c = string[i];
+    if ((c == '"') || (c == '\\')) {
+      printf("\\%c", c);
+    } else if (c < 0x20) {
+      printf("\\u%04x", c);
+    } else {
+      putchar(c);
+    }
+  }
+  putchar('"');
+}
+
+static const char* _StatusName(int status) {
+  switch (status) {
+    case kCaseStatus_OK: return "ok";
+    case kCaseStatus_OpenFailed: return "open-failed";
+    case kCaseStatus_DecodeFailed: return "decode-failed";
+    case kCaseStatus_CRCFailed: return "crc-failed";
+    case kCaseStatus_Crashed: return "crashed";
+  }
+  return "unknown";
+}
+
+static void _PrintStats(const struct RARStats* stats) {
+  static const char* filterNames[RAR_FILTER_TYPES] = {"vm", "e8", "e8e9", "itanium", "rgb", "audio", "delta", "upcase"};
+  printf(", \"stats\": {\"packed_read\": %llu, \"unpacked_written\": %llu, \"read_calls\": %u, \"write_calls\": %u",
+         stats->PackedRead, stats->UnpackedWritten, stats->ReadCalls, stats->WriteCalls);
+  printf(", \"table_reads\": %u, \"lz_bytes\": %llu, \"ppm_bytes\": %llu, \"crc_bytes\": %llu",
+         stats->TableReads, stats->LZBytes, stats->PPMBytes, stats->CRCBytes);
+  printf(", \"filters\": {");
+  for (int i = 0; i < RAR_FILTER_TYPES; ++i) {
+    printf("%s\"%s\": {\"calls\": %u, \"bytes\": %llu}", i ? ", " : "", filterNames[i], stats->FilterCalls[i], stats->FilterBytes[i]);
+  }
+  printf("}");
+  if (stats->Timing != RAR_TIMING_NONE) {
+    printf(", \"time_unit\": \"%s\", \"read_time\": %llu, \"unpack_time\": %llu, \"filter_time\": %llu, \"write_time\": %llu, \"crc_time\": %llu",
+           stats->Timing == RAR_TIMING_TICKS ? "ticks" : "ns", stats->ReadTime, stats->UnpackTime, stats->FilterTime, stats->WriteTime, stats->CRCTime);
+  }
+  printf("}");
+}
+
+static void _PrintResult(const BenchCase* benchCase, const BenchOptions* options, const BenchResult* result, bool last) {
+  double megabytes = (double)result->unpackedBytes / (1024.0 * 1024.0);
+  printf("    {\"name\": ");
+  _PrintJSONString(benchCase->name);
+  printf(", \"format\": \"%s\"", benchCase->format == kArchiveFormat_ZIP ? "zip" : "rar");
+  const char* path = "unzReadCurrentFile";
+  if (benchCase->format == kArchiveFormat_RAR) {
+    path = strcmp(result->method, "rar-m0") ? "Unpack::DoUnpack" : "CmdExtract::UnstoreFile";
+  }
+  printf(", \"path\": \"%s\"", path);
+  printf(", \"method\": ");
+  _PrintJSONString(result->method);
+  printf(", \"solid\": %s, \"encrypted\": %s, \"volumes\": %i",
+         result->solid ? "true" : "false", result->encrypted ? "true" : "false", result->volumes);
+  printf(", \"entries\": %lli, \"packed_bytes\": %lli, \"unpacked_bytes\": %lli",
+         result->entries, result->packedBytes, result->unpackedBytes);
+  printf(", \"seconds\": %.6f, \"mb_per_s\": %.2f, \"ttfb_us\": %.1f, \"peak_rss_kb\": %li",
+         result->seconds, result->seconds > 0.0 ? megabytes / result->seconds : 0.0,
+         result->ttfb >= 0.0 ? result->ttfb * 1e6 : 0.0, result->peakRSS);
+  if (options->probe) {
+    printf(", \"probe_seconds\": %.6f, \"probe_speedup\": %.2f, \"probed_entries\": %lli",
+           result->probeSeconds, result->probeSeconds > 0.0 ? result->seconds / result->probeSeconds : 0.0, result->probedEntries);
+  }
+  if (options->list) {
+    printf(", \"list_open_bytes\": %lli, \"list_seconds\": %.6f", result->listOpenBytes, result->listSeconds);
+    if (benchCase->format == kArchiveFormat_ZIP) {
+      printf(", \"list_open_each_seconds\": %.6f, \"list_bulk_seconds\": %.6f, \"list_bulk_bytes\": %lli",
+             result->listOpenEachSeconds, result->listBulkSeconds, result->listBulkBytes);
+    }
+  }
+  if (options->locate && (benchCase->format == kArchiveFormat_ZIP)) {
+    printf(", \"locate_us\": %.3f, \"locate_fast_us\": %.3f, \"locate_speedup\": %.1f", result->locateSeconds * 1e6, result->locateFastSeconds * 1e6,
+           result->locateFastSeconds > 0.0 ? result->locateSeconds / result->locateFastSeconds : 0.0);
+  }
+  if (options->mmap && (benchCase->format == kArchiveFormat_ZIP)) {
+    printf(", \"io_stdio_seconds\": %.6f, \"io_mmap_seconds\": %.6f, \"io_mmap_speedup\": %.2f", result->ioStdioSeconds, result->ioMmapSeconds,
+           result->ioMmapSeconds > 0.0 ? result->ioStdioSeconds / result->ioMmapSeconds : 0.0);
+  }
+  if (options->pageOpen && (benchCase->format == kArchiveFormat_ZIP)) {
+    printf(", \"page_open_copy_us\": %.3f, \"page_open_mapped_us\": %.3f, \"page_open_mapped_crc_us\": %.3f, \"mapped_pages\": %lli",
+           result->pageOpenCopySeconds * 1e6, result->pageOpenMappedSeconds * 1e6, result->pageOpenMappedCRCSeconds * 1e6, result->mappedPages);
+  }
+  if (options->inflate && (benchCase->format == kArchiveFormat_ZIP)) {
+    printf(", \"inflate_stream_mb_per_s\": %.2f, \"inflate_buffer_mb_per_s\": %.2f",
+           result->inflateStreamSeconds > 0.0 ? megabytes / result->inflateStreamSeconds : 0.0,
+           result->inflateBufferSeconds > 0.0 ? megabytes / result->inflateBufferSeconds : 0.0);
+  }
+  if (options->parallel && (benchCase->format == kArchiveFormat_ZIP)) {
+    printf(", \"parallel_threads\": %i, \"parallel_serial_seconds\": %.6f, \"parallel_seconds\": %.6f, \"parallel_speedup\": %.2f",
+           result->parallelThreads, result->parallelSerialSeconds, result->parallelSeconds,
+           result->parallelSeconds > 0.0 ? result->parallelSerialSeconds / result->parallelSeconds : 0.0);
+  }
+  if (options->ioCalls && (benchCase->format == kArchiveFormat_ZIP)) {
+    printf(", \"io_open_calls\": %lli, \"io_open_reads\": %lli, \"io_open_bytes\": %lli, \"io_list_calls\": %lli, \"io_entry_calls\": %lli",
+           result->ioOpenCalls, result->ioOpenReads, result->ioOpenBytes, result->ioListCalls, result->ioEntryCalls);
+  }
+  if (options->directoryCache) {
+    printf(", \"directory_parse_us\": %.1f, \"directory_cache_us\": %.1f, \"directory_cache_speedup\": %.2f, \"directory_cache_bytes\": %lli, \"directory_cache_rejected\": %i",
+           result->directoryParseSeconds * 1000000.0, result->directoryCacheSeconds * 1000000.0,
+           result->directoryCacheSeconds > 0.0 ? result->directoryParseSeconds / result->directoryCacheSeconds : 0.0,
+           result->directoryCacheBytes, result->directoryCacheRejected);
+  }
+  if (options->zipStream && (benchCase->format == kArchiveFormat_ZIP)) {
+    printf(", \"zip_stream_raw_ms\": %.3f, \"zip_stream_deflate_ms\": %.3f, \"zip_stream_bytes\": %lli, \"zip_stream_sink_calls\": %lli, \"zip_stream_heap_bytes\": %lli",
+           result->zipStreamRawSeconds * 1000.0, result->zipStreamDeflateSeconds * 1000.0, result->zipStreamBytes, result->zipStreamSinkCalls,
+           result->zipStreamHeapBytes);
+  }
+  if (options->archiveReader) {
+    printf(", \"archive_reader_open_us\": %.1f, \"archive_reader_read_ms\": %.3f, \"archive_reader_concurrent_ms\": %.3f, \"archive_reader_threads\": %i, \"archive_reader_speedup\": %.2f, \"archive_reader_verified\": %lli",
+           result->archiveReaderOpenSeconds * 1e6, result->archiveReaderReadSeconds * 1000.0, result->archiveReaderConcurrentSeconds * 1000.0,
+           result->archiveReaderThreads, result->archiveReaderConcurrentSeconds > 0.0 ? result->archiveReaderReadSeconds / result->archiveReaderConcurrentSeconds : 0.0,
+           result->archiveReaderVerified);
+  }
+  if (options->pageManifest) {
+    printf(", \"first_page_cold_us\": %.1f, \"first_page_manifest_us\": %.1f, \"first_page_speedup\": %.2f, \"manifest_write_ms\": %.3f, \"manifest_bytes\": %lli, \"manifest_probed_pages\": %lli",
+           result->firstPageColdSeconds * 1e6, result->firstPageManifestSeconds * 1e6,
+           result->firstPageManifestSeconds > 0.0 ? result->firstPageColdSeconds / result->firstPageManifestSeconds : 0.0,
+           result->manifestWriteSeconds * 1000.0, result->manifestBytes, result->manifestProbedPages);
+  }
+  if (options->startup) {
+    printf(", \"startup_us\": %.1f", result->startupSeconds * 1e6);
+  }
+  if (result->hasStats) {
+    _PrintStats(&result->stats);
+  }
+  printf(", \"status\": \"%s\"}%s\n", _StatusName(result->status), last ? "" : ",");
+}
+
+static bool _CompareCases(const BenchCase& a, const BenchCase& b) {
+  return a.name < b.name;
+}
+
+static void _PrintUsage(const char* tool) {
+  fprintf(stderr, "Usage: %s [--corpus DIR]... [--password PASSWORD] [--iterations N] [--pages N] [--page-size BYTES]\n"
+                  "          [--buffer-size BYTES] [--work-dir DIR] [--no-generate] [--keep] [--stats] [--probe] [--startup] [--list] [--locate] [--mmap] [--page-open] [--inflate] [--parallel] [--io-calls]\n"
+                  "          [--directory-cache] [--zip-stream] [--archive-reader] [--page-manifest] [--large-entry] [--deflate MB] [--natural-sort N] [--import N] [--zstd MB] [--salvage MB] [--read-ahead MB]\n"
+                  "          [--handle-cache N] [--cover N] [--cbt MB]\n", tool);
+}
+
+int main(int argc, char* argv[]) {
+  if ((argc >= 4) && !strcmp(argv[1], "--first-listing")) {
+    return _ListFirstEntry(argv[2], argv[3], argc > 4 ? argv[4] : NULL);
+  }
+
+  BenchOptions options;
+  options.iterations = kDefaultIterations;
+  options.pageCount = kDefaultPageCount;
+  options.pageSize = kDefaultPageSize;
+  options.readBufferSize = kDefaultReadBufferSize;
+  options.password = NULL;
+  options.generate = true;
+  options.keep = false;
+  options.stats = false;
+  options.probe = false;
+  options.startup = false;
+  options.list = false;
+  options.locate = false;
+  options.mmap = false;
+  options.pageOpen = false;
+  options.inflate = false;
+  options.parallel = false;
+  options.ioCalls = false;
+  options.directoryCache = false;
+  options.zipStream = false;
+  options.archiveReader = false;
+  options.pageManifest = false;
+  options.largeEntry = false;
+  options.deflateMegabytes = 0;
+  options.naturalSortCount = 0;
+  options.importCount = 0;
+  options.zstdMegabytes = 0;
+  options.salvageMegabytes = 0;
+  options.readAheadMegabytes = 0;
+  options.handleCacheCount = 0;
+  options.coverCount = 0;
+  options.cbtMegabytes = 0;
+  options.tool = argv[0];
+  const char* tmp = getenv("TMPDIR");
+  char directory[1024];
+  snprintf(directory, sizeof(directory), "%s/archivebench-%i", tmp && *tmp ? tmp : "/tmp", (int)getpid());
+  options.workDirectory = directory;
+
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!strcmp(arg, "--no-generate")) {
+      options.generate = false;
+    } else if (!strcmp(arg, "--keep")) {
+      options.keep = true;
+    } else if (!strcmp(arg, "--stats")) {
+      options.stats = true;
+    } else if (!strcmp(arg, "--probe")) {
+      options.probe = true;
+    } else if (!strcmp(arg, "--startup")) {
+      options.startup = true;
+    } else if (!strcmp(arg, "--list")) {
+      options.list = true;
+    } else if (!strcmp(arg, "--locate")) {
+      options.locate = true;
+    } else if (!strcmp(arg, "--mmap")) {
+      options.mmap = true;
+    } else if (!strcmp(arg, "--page-open")) {
+      options.pageOpen = true;
+    } else if (!strcmp(arg, "--inflate")) {
+      options.inflate = true;
+    } else if (!strcmp(arg, "--parallel")) {
+      options.parallel = true;
+    } else if (!strcmp(arg, "--io-calls")) {
+      options.ioCalls = true;
+    } else if (!strcmp(arg, "--directory-cache")) {
+      options.directoryCache = true;
+    } else if (!strcmp(arg, "--zip-stream")) {
+      options.zipStream = true;
+    } else if (!strcmp(arg, "--archive-reader")) {
+      options.archiveReader = true;
+    } else if (!strcmp(arg, "--page-manifest")) {
+      options.pageManifest = true;
+    } else if (!strcmp(arg, "--large-entry")) {
+      options.largeEntry = true;
+    } else if (value && !strcmp(arg, "--corpus")) {
+      options.corpusDirectories.push_back(value);
+      ++i;
+    } else if (value && !strcmp(arg, "--password")) {
+      options.password = value;
+      ++i;
+    } else if (value && !strcmp(arg, "--iterations")) {
+      options.iterations = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--pages")) {
+      options.pageCount = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--page-size")) {
+      options.pageSize = std::max(atol(value), 64L);
+      ++i;
+    } else if (value && !strcmp(arg, "--buffer-size")) {
+      options.readBufferSize = std::max(atol(value), 1L);
+      ++i;
+    } else if (value && !strcmp(arg, "--deflate")) {
+      options.deflateMegabytes = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--natural-sort")) {
+      options.naturalSortCount = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--import")) {
+      options.importCount = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--zstd")) {
+      options.zstdMegabytes = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--salvage")) {
+      options.salvageMegabytes = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--read-ahead")) {
+      options.readAheadMegabytes = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--handle-cache")) {
+      options.handleCacheCount = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--cover")) {
+      options.coverCount = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--cbt")) {
+      options.cbtMegabytes = std::max(atoi(value), 1);
+      ++i;
+    } else if (value && !strcmp(arg, "--work-dir")) {
+      options.workDirectory = value;
+      ++i;
+    } else {
+      _PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<BenchCase> cases;
+  if (options.generate && !BenchGenerateCorpus(&options, &cases)) {
+    return 1;
+  }
+  for (size_t i = 0; i < options.corpusDirectories.size(); ++i) {
+    BenchLoadCorpus(options.corpusDirectories[i], &cases);
+  }
+  std::sort(cases.begin(), cases.end(), _CompareCases);
+
+  int failures = 0;
+  printf("{\n  \"benchmark\": \"archivebench\",\n  \"version\": %i,\n", kBenchVersion);
+  printf("  \"iterations\": %i,\n  \"read_buffer_size\": %lu,\n  \"cases\": [\n", options.iterations, (unsigned long)options.readBufferSize);
+  for (size_t i = 0; i < cases.size(); ++i) {
+    BenchResult result;
+    _RunCase(&cases[i], &options, &result);
+    _PrintResult(&cases[i], &options, &result, i + 1 == cases.size());
+    if (result.status != kCaseStatus_OK) {
+      failures += 1;
+    }
+  }
+  printf("  ]");
+  if (options.deflateMegabytes) {
+    failures += BenchRunDeflateWriter(&options);
+  }
+  if (options.naturalSortCount) {
+    failures += BenchRunNaturalSort(&options);
+  }
+  if (options.importCount) {
+    failures += BenchRunImport(&options);
+  }
+  if (options.zstdMegabytes) {
+    failures += BenchRunZstd(&options);
+  }
+  if (options.salvageMegabytes) {
+    failures += BenchRunSalvage(&options);
+  }
+  if (options.readAheadMegabytes) {
+    failures += BenchRunReadAhead(&options);
+  }
+  if (options.handleCacheCount) {
+    failures += BenchRunHandleCache(&options);
+  }
+  if (options.coverCount) {
+    failures += BenchRunCover(&options);
+  }
+  if (options.cbtMegabytes) {
+    failures += BenchRunCbt(&options);
+  }
+  printf("\n}\n");
+
+  if (options.generate && !options.keep) {
+    BenchRemoveCorpus(&options);
+  }
+  return failures ? 2 : 0;
+}
@@ -0,0 +1,206 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Shared by the modes of archivebench: the corpus generators are in
+// BenchCorpus.cpp and each area of modes has its own file, see ArchiveBench.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#ifndef _UNIX
+#define _UNIX
+#endif
+#include "dll.hpp"
+
+#define kDefaultPageSize (512 * 1024)
+#define kMaxParallelThreads 8
+#define kParallelStressPasses 4
+#define kMaxBufferedEntrySize (256 * 1024 * 1024)  // Threads skip larger entries instead of each holding a copy
+#define kTarBlockSize 512
+
+
+typedef enum {
+  kArchiveFormat_ZIP = 0,
+  kArchiveFormat_RAR
+} ArchiveFormat;
+
+typedef enum {
+  kCaseStatus_OK = 0,
+  kCaseStatus_OpenFailed,
+  kCaseStatus_DecodeFailed,
+  kCaseStatus_CRCFailed,
+  kCaseStatus_Crashed
+} CaseStatus;
+
+struct BenchOptions {
+  int iterations;
+  int pageCount;
+  size_t pageSize;
+  size_t readBufferSize;
+  const char* password;
+  std::vector<std::string> corpusDirectories;
+  std::string workDirectory;
+  bool generate;
+  bool keep;
+  bool stats;
+  bool probe;
+  bool startup;
+  bool list;
+  bool locate;
+  bool mmap;
+  bool pageOpen;
+  bool inflate;
+  bool parallel;
+  bool ioCalls;
+  bool directoryCache;
+  bool zipStream;
+  bool archiveReader;
+  bool pageManifest;
+  bool largeEntry;
+  int deflateMegabytes;  // 0 to skip the writer benchmark
+  int naturalSortCount;  // 0 to skip the natural sort benchmark
+  int importCount;  // 0 to skip the library import benchmark
+  int zstdMegabytes;  // 0 to skip the zstd versus deflate benchmark
+  int salvageMegabytes;  // 0 to skip the truncated archive benchmark
+  int readAheadMegabytes;  // 0 to skip the page turn benchmark
+  int handleCacheCount;  // 0 to skip the repeated open benchmark
+  int coverCount;  // 0 to skip the cover selection benchmark
+  int cbtMegabytes;  // 0 to skip the TAR versus ZIP benchmark
+  const char* tool;
+};
+
+struct BenchCase {
+  std::string name;
+  std::string path;
+  ArchiveFormat format;
+};
+
+// Plain-old-data so it can be sent back from the child through a pipe
+struct BenchResult {
+  int status;
+  char method[32];
+  int solid;
+  int encrypted;
+  int volumes;
+  long long entries;
+  long long packedBytes;
+  long long unpackedBytes;
+  double seconds;  // Best of all iterations
+  double ttfb;  // Best time from archive open to first decompressed byte
+  long peakRSS;  // In KB
+  double probeSeconds;  // Best of all iterations
+  long long probedEntries;  // Entries whose dimensions were found
+  double startupSeconds;  // Best time from fork to first listed entry in a fresh process
+  long long listOpenBytes;  // Heap in use by a list-only handle right after opening
+  double listSeconds;  // Best time to open and list all entries
+  double listOpenEachSeconds;  // Same calling unzOpenCurrentFile() on every entry
+  double listBulkSeconds;  // Same with unzGetEntryList()
+  long long listBulkBytes;  // Heap used by the unzGetEntryList() result
+  double locateSeconds;  // Best average time per unzLocateFile() lookup
+  double locateFastSeconds;  // Best average time per unzLocateFileFast() lookup
+  double ioStdioSeconds;  // Best time to open, list and extract one entry with fill_fopen64_filefunc()
+  double ioMmapSeconds;  // Same with fill_mmap_filefunc64()
+  double pageOpenCopySeconds;  // Best average time to read an entry into a buffer
+  double pageOpenMappedSeconds;  // Same using unzGetCurrentFileMappedData() whenever possible
+  double pageOpenMappedCRCSeconds;  // Same also checking the CRC
+  long long mappedPages;  // Entries returned by unzGetCurrentFileMappedData()
+  double inflateStreamSeconds;  // Best time to decompress all entries with unzReadCurrentFile()
+  double inflateBufferSeconds;  // Same with unzExtractCurrentFileToBuffer()
+  int parallelThreads;
+  double parallelSerialSeconds;  // Best time to extract all entries with unzReaderExtractEntry() on one thread
+  double parallelSeconds;  // Same with parallelThreads threads
+  long long ioOpenCalls;  // ioapi reads, seeks and tells made by unzOpen2_64()
+  long long ioOpenReads;
+  long long ioOpenBytes;
+  long long ioListCalls;  // Same for listing every entry with unzGoToNextFile() and unzGetCurrentFileInfo64()
+  long long ioEntryCalls;  // Same for unzOpenCurrentFile() and unzCloseCurrentFile() on the first entry
+  double directoryParseSeconds;  // Best time to list the archive and sort its pages
+  double directoryCacheSeconds;  // Best time to get the same from the directory cache
+  long long directoryCacheBytes;
+  int directoryCacheRejected;  // Stale, corrupted and truncated caches rejected out of 3
+  double zipStreamRawSeconds;  // Best time to stream a copy of the archive passing the entries through
+  double zipStreamDeflateSeconds;  // Same recompressing the entries
+  long long zipStreamBytes;  // Size of the streamed copy
+  long long zipStreamSinkCalls;
+  long long zipStreamHeapBytes;  // Heap held by the stream once all entries are written
+  double archiveReaderOpenSeconds;  // Best time to detect the format, open the archive and index its entries
+  double archiveReaderReadSeconds;  // Best time to read every entry into memory on one thread
+  double archiveReaderConcurrentSeconds;  // Same with archiveReaderThreads threads sharing the reader
+  int archiveReaderThreads;
+  long long archiveReaderVerified;  // Entries read identically by every access path
+  double firstPageColdSeconds;  // Best time to open the archive, list and sort its pages then read the first one
+  double firstPageManifestSeconds;  // Same from the page manifest
+  double manifestWriteSeconds;  // Best time to parse the archive, probe every page and save the manifest like at import
+  long long manifestBytes;
+  long long manifestProbedPages;  // Pages with dimensions in the manifest
+  int hasStats;
+  struct RARStats stats;
+};
+
+// BenchCorpus.cpp
+double BenchNow();
+bool BenchHasSuffix(const std::string& string, const char* suffix);
+long long BenchHeapBytesInUse();  // Returns 0 where the allocator cannot be queried
+void BenchGeneratePage(unsigned char* buffer, size_t size, unsigned int seed, int width, int height);  // Like a baseline JPEG
+void BenchGenerateBitmapPage(unsigned char* buffer, size_t size, unsigned int seed);  // Like a 24 bits BMP
+bool BenchWriteZipCorpus(const char* path, int method, int pageCount, size_t pageSize, bool bitmaps);
+FILE* BenchOpenStoredRar(const char* path);
+void BenchWriteStoredRarEntry(FILE* file, const char* name, const unsigned char* bytes, size_t size, bool encrypted);  // Only flagged as such, the bytes are stored as is
+bool BenchCloseStoredRar(FILE* file);
+bool BenchGenerateCorpus(const BenchOptions* options, std::vector<BenchCase>* cases);
+void BenchRemoveCorpus(const BenchOptions* options);
+void BenchLoadCorpus(const std::string& directory, std::vector<BenchCase>* cases);
+void BenchWriteTarHeader(FILE* file, const char* name, const char* prefix, unsigned long long size, char type);
+void BenchWriteTarData(FILE* file, const void* bytes, size_t size);
+void BenchWriteTarEntry(FILE* file, const char* name, const void* bytes, size_t size, bool pax);
+bool BenchCloseTar(FILE* file);
+bool BenchWriteTarCorpus(const char* path, int pageCount, size_t pageSize);
+
+// BenchDecoding.cpp
+CaseStatus BenchRunZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchRunRarCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchProbeZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchProbeRarCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchListZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchListRarCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchLocateZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchCompareZipIOCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchOpenZipPagesCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchInflateZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchParallelZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchCountZipIOCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+
+// BenchLibrary.cpp
+CaseStatus BenchDirectoryCacheCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+CaseStatus BenchPageManifestCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+int BenchRunNaturalSort(const BenchOptions* options);  // Runs print their results and return the number of failures
+int BenchRunImport(const BenchOptions* options);
+int BenchRunCover(const BenchOptions* options);
+
+// BenchArchiveReader.cpp
+CaseStatus BenchArchiveReaderCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+int BenchRunReadAhead(const BenchOptions* options);
+int BenchRunHandleCache(const BenchOptions* options);
+int BenchRunCbt(const BenchOptions* options);
+
+// BenchWriters.cpp
+CaseStatus BenchZipStreamCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result);
+int BenchRunDeflateWriter(const BenchOptions* options);
+int BenchRunZstd(const BenchOptions* options);
+int BenchRunSalvage(const BenchOptions* options);
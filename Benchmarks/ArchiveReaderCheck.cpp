@@ -0,0 +1,388 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Checks of the ArchiveReader C API against small ZIP, RAR and TAR archives
+// written with the generators of BenchCorpus.cpp: damaged and truncated TAR
+// headers, pre-POSIX TAR headers, PAX size overrides, encrypted RAR entries,
+// duplicate names, buffers too small for the entry and back covers which must
+// not be picked as the cover. Build and run with "make -f makefile.unix check"
+// from UnRAR-3.9.10, every failed check is printed and the exit status is
+// non-zero if any failed.
+
+#include <sys/types.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "ArchiveBench.h"
+
+#include "zip.h"
+
+#include "ArchiveReader.h"
+
+#define kCanary 0xA5
+
+#define CHECK(__CONDITION__) \
+  do { \
+    if (!(__CONDITION__)) { \
+      fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__, __LINE__, #__CONDITION__); \
+      _failures += 1; \
+    } \
+  } while (0)
+
+static int _failures = 0;
+static std::string _directory;
+
+static void _FillBytes(unsigned char* bytes, size_t size, unsigned int seed) {
+  for (size_t i = 0; i < size; ++i) {
+    bytes[i] = (unsigned char)((i * 31 + seed * 7) >> 2);
+  }
+}
+
+static bool _PatchFile(const char* path, long offset, char byte) {
+  FILE* file = fopen(path, "r+b");
+  if (file == NULL) {
+    return false;
+  }
+  bool success = (fseek(file, offset, SEEK_SET) == 0) && (fputc(byte, file) != EOF);
+  return (fclose(file) == 0) && success;
+}
+
+// Also updates the checksum so only the field itself is damaged
+static bool _PatchTarHeader(const char* path, long offset, size_t field, char byte) {
+  unsigned char header[kTarBlockSize];
+  FILE* file = fopen(path, "r+b");
+  if (file == NULL) {
+    return false;
+  }
+  bool success = (fseek(file, offset, SEEK_SET) == 0) && (fread(header, 1, sizeof(header), file) == sizeof(header));
+  if (success) {
+    header[field] = byte;
+    memset(&header[148], ' ', 8);
+    unsigned int sum = 0;
+    for (size_t i = 0; i < sizeof(header); ++i) {
+      sum += header[i];
+    }
+    snprintf((char*)&header[148], 8, "%06o", sum);
+    success = (fseek(file, offset, SEEK_SET) == 0) && (fwrite(header, 1, sizeof(header), file) == sizeof(header));
+  }
+  return (fclose(file) == 0) && success;
+}
+
+// Looks up the entry by name then reads it into a buffer one byte short, which must fail without writing past it, and one of the exact size
+static void _CheckEntry(const ArchiveReader* reader, const char* name, const unsigned char* bytes, size_t size) {
+  long index = ArchiveReaderFindEntry(reader, name);
+  CHECK(index >= 0);
+  if (index < 0) {
+    fprintf(stderr, "  missing entry \"%s\"\n", name);
+    return;
+  }
+  const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, index);
+  CHECK(!entry->isDirectory && !entry->isEncrypted && (entry->size == size));
+  std::vector<unsigned char> buffer(size + 1, kCanary);
+  CHECK(!ArchiveReaderReadEntry(reader, index, &buffer[0], size - 1));
+  CHECK((buffer[size - 1] == kCanary) && (buffer[size] == kCanary));
+  CHECK(ArchiveReaderReadEntry(reader, index, &buffer[0], size) && !memcmp(&buffer[0], bytes, size) && (buffer[size] == kCanary));
+}
+
+// ZIP
+
+static bool _WriteZipEntry(zipFile file, const char* name, const unsigned char* bytes, size_t size, int method) {
+  return (zipOpenNewFileInZip64(file, name, NULL, NULL, 0, NULL, 0, NULL, method, method ? Z_DEFAULT_COMPRESSION : 0, 0) == ZIP_OK) &&
+         (zipWriteInFileInZip(file, bytes, (unsigned int)size) == ZIP_OK) &&
+         (zipCloseFileInZip(file) == ZIP_OK);
+}
+
+static void _CheckZip() {
+  std::string path = _directory + "/check.cbz";
+  unsigned char page1[1000];
+  unsigned char page2[3000];
+  unsigned char page3[500];
+  _FillBytes(page1, sizeof(page1), 1);
+  _FillBytes(page2, sizeof(page2), 2);
+  _FillBytes(page3, sizeof(page3), 3);
+  zipFile file = zipOpen64(path.c_str(), APPEND_STATUS_CREATE);
+  CHECK(file != NULL);
+  if (file == NULL) {
+    return;
+  }
+  bool written = _WriteZipEntry(file, "Comic/Page 1.jpg", page1, sizeof(page1), 0) &&
+                 _WriteZipEntry(file, "Comic/Page 1.jpg", page3, sizeof(page3), Z_DEFLATED) &&
+                 _WriteZipEntry(file, "Comic/Page 2.jpg", page2, sizeof(page2), Z_DEFLATED);
+  CHECK((zipClose(file, NULL) == ZIP_OK) && written);
+
+  ArchiveReader* reader = ArchiveReaderOpen(path.c_str());
+  CHECK(reader != NULL);
+  if (reader) {
+    CHECK(ArchiveReaderGetFormat(reader) == kArchiveReaderFormat_ZIP);
+    CHECK(ArchiveReaderGetEntryCount(reader) == 3);
+    CHECK(ArchiveReaderFindEntry(reader, "Comic/Page 1.jpg") == 0);  // First one wins
+    CHECK(ArchiveReaderFindEntry(reader, "Comic/Page 3.jpg") == -1);
+    CHECK(ArchiveReaderFindEntry(reader, NULL) == -1);
+    _CheckEntry(reader, "Comic/Page 1.jpg", page1, sizeof(page1));
+    _CheckEntry(reader, "Comic/Page 2.jpg", page2, sizeof(page2));
+    ArchiveReaderClose(reader);
+  }
+  unlink(path.c_str());
+}
+
+// Cover
+
+// Returns the name of the cover picked among pages with these names
+static std::string _FindCoverName(const char* const* names, size_t count) {
+  std::string path = _directory + "/cover.cbz";
+  unsigned char page[100];
+  _FillBytes(page, sizeof(page), 1);
+  zipFile file = zipOpen64(path.c_str(), APPEND_STATUS_CREATE);
+  bool written = file != NULL;
+  for (size_t i = 0; written && (i < count); ++i) {
+    written = _WriteZipEntry(file, names[i], page, sizeof(page), 0);
+  }
+  written = file && (zipClose(file, NULL) == ZIP_OK) && written;
+  ArchiveReader* reader = written ? ArchiveReaderOpen(path.c_str()) : NULL;
+  std::string name;
+  if (reader) {
+    long cover = ArchiveReaderFindCover(reader);
+    name = cover >= 0 ? ArchiveReaderGetEntry(reader, cover)->name : "";
+    ArchiveReaderClose(reader);
+  }
+  unlink(path.c_str());
+  return name;
+}
+
+static void _CheckCover() {
+  static const char* pages[] = {"Comic/Page 002.jpg", "Comic/Page 001.jpg", "Comic/Discover.jpg"};
+  CHECK(_FindCoverName(pages, 3) == "Comic/Discover.jpg");  // Not a cover, "d" < "p"
+  static const char* front[] = {"Comic/Page 001.jpg", "Comic/00 - cover a.png", "Comic/Cover.jpg"};
+  CHECK(_FindCoverName(front, 3) == "Comic/00 - cover a.png");
+  static const char* back[] = {"Comic/Back Cover.jpg", "Comic/Page 002.jpg", "Comic/Page 001.jpg"};
+  CHECK(_FindCoverName(back, 3) == "Comic/Page 001.jpg");
+  static const char* backs[] = {"Comic/back_cover.png", "Comic/99 - cover (back).jpg", "Comic/Rear Cover.jpg", "Comic/01.jpg"};
+  CHECK(_FindCoverName(backs, 4) == "Comic/01.jpg");
+  static const char* both[] = {"Comic/Back Cover.jpg", "Comic/01.jpg", "Comic/Front Cover.jpg"};
+  CHECK(_FindCoverName(both, 3) == "Comic/Front Cover.jpg");
+  static const char* only[] = {"Comic/Back Cover.jpg"};
+  CHECK(_FindCoverName(only, 1) == "Comic/Back Cover.jpg");  // Still better than no cover at all
+}
+
+// RAR
+
+static void _CheckRar() {
+  std::string path = _directory + "/check.cbr";
+  unsigned char page1[1000];
+  unsigned char page2[3000];
+  unsigned char page3[500];
+  _FillBytes(page1, sizeof(page1), 1);
+  _FillBytes(page2, sizeof(page2), 2);
+  _FillBytes(page3, sizeof(page3), 3);
+  FILE* file = BenchOpenStoredRar(path.c_str());
+  CHECK(file != NULL);
+  if (file == NULL) {
+    return;
+  }
+  BenchWriteStoredRarEntry(file, "Comic/Page 1.jpg", page1, sizeof(page1), false);
+  BenchWriteStoredRarEntry(file, "Comic/Secret.jpg", page2, sizeof(page2), true);
+  BenchWriteStoredRarEntry(file, "Comic/Page 1.jpg", page3, sizeof(page3), false);
+  BenchWriteStoredRarEntry(file, "Comic/Page 2.jpg", page2, sizeof(page2), false);
+  CHECK(BenchCloseStoredRar(file));
+
+  ArchiveReader* reader = ArchiveReaderOpen(path.c_str());
+  CHECK(reader != NULL);
+  if (reader) {
+    CHECK(ArchiveReaderGetFormat(reader) == kArchiveReaderFormat_RAR);
+    CHECK(ArchiveReaderGetEntryCount(reader) == 4);
+    CHECK(ArchiveReaderFindEntry(reader, "Comic/Page 1.jpg") == 0);  // First one wins
+    _CheckEntry(reader, "Comic/Page 1.jpg", page1, sizeof(page1));
+    _CheckEntry(reader, "Comic/Page 2.jpg", page2, sizeof(page2));  // After the encrypted entry
+
+    long index = ArchiveReaderFindEntry(reader, "Comic/Secret.jpg");
+    CHECK(index == 1);
+    if (index >= 0) {
+      std::vector<unsigned char> buffer(sizeof(page2));
+      size_t length = 0;
+      CHECK(ArchiveReaderGetEntry(reader, index)->isEncrypted);
+      CHECK(!ArchiveReaderReadEntry(reader, index, &buffer[0], buffer.size()));
+      CHECK(!ArchiveReaderReadEntryPrefix(reader, index, &buffer[0], buffer.size(), &length));
+      CHECK(!ArchiveReaderExtractEntryToFile(reader, index, (_directory + "/secret.jpg").c_str()));
+      CHECK(access((_directory + "/secret.jpg").c_str(), F_OK) < 0);  // Not left behind partially written
+    }
+    ArchiveReaderClose(reader);
+  }
+  unlink(path.c_str());
+}
+
+// TAR
+
+// Overrides the size of the next entry like for files over the 8 GiB of the header field
+static void _WritePaxSize(FILE* file, unsigned long long size) {
+  char record[64];
+  int length = snprintf(NULL, 0, " size=%llu\n", size) + 2;  // Plus the 2 digits of the record length itself
+  snprintf(record, sizeof(record), "%i size=%llu\n", length, size);
+  BenchWriteTarHeader(file, "PaxHeaders/entry", NULL, strlen(record), 'x');
+  BenchWriteTarData(file, record, strlen(record));
+}
+
+static void _CheckTar() {
+  std::string path = _directory + "/check.cbt";
+  unsigned char page1[1000];
+  unsigned char page2[3000];
+  unsigned char page3[500];
+  _FillBytes(page1, sizeof(page1), 1);
+  _FillBytes(page2, sizeof(page2), 2);
+  _FillBytes(page3, sizeof(page3), 3);
+  FILE* file = fopen(path.c_str(), "wb");
+  CHECK(file != NULL);
+  if (file == NULL) {
+    return;
+  }
+  BenchWriteTarEntry(file, "Comic/Page 1.jpg", page1, sizeof(page1), false);
+  BenchWriteTarHeader(file, "Comic/Extras/", NULL, 0, '0');  // Pre-POSIX directory
+  _WritePaxSize(file, sizeof(page2));
+  BenchWriteTarHeader(file, "Comic/Page 2.jpg", NULL, 0, '0');
+  BenchWriteTarData(file, page2, sizeof(page2));
+  BenchWriteTarEntry(file, "Comic/Page 1.jpg", page3, sizeof(page3), false);
+  BenchWriteTarEntry(file, "Comic/Page 3.jpg", page3, sizeof(page3), false);  // Found only if the PAX size was used to skip the previous data
+  CHECK(BenchCloseTar(file));
+
+  ArchiveReader* reader = ArchiveReaderOpen(path.c_str());
+  CHECK(reader != NULL);
+  if (reader) {
+    CHECK(ArchiveReaderGetFormat(reader) == kArchiveReaderFormat_TAR);
+    CHECK(ArchiveReaderGetEntryCount(reader) == 5);
+    CHECK(ArchiveReaderFindEntry(reader, "Comic/Page 1.jpg") == 0);  // First one wins
+    CHECK(ArchiveReaderFindEntry(reader, "Comic/Extras/") == 1);
+    CHECK(ArchiveReaderGetEntry(reader, 1)->isDirectory);
+    _CheckEntry(reader, "Comic/Page 1.jpg", page1, sizeof(page1));
+    _CheckEntry(reader, "Comic/Page 2.jpg", page2, sizeof(page2));
+    _CheckEntry(reader, "Comic/Page 3.jpg", page3, sizeof(page3));
+    ArchiveReaderClose(reader);
+  }
+  unlink(path.c_str());
+}
+
+// Same headers without the "ustar" magic and version, the directory stored as a regular file with a trailing slash
+static void _CheckPrePosixTar() {
+  std::string path = _directory + "/v7.cbt";
+  unsigned char page[1000];
+  _FillBytes(page, sizeof(page), 1);
+  FILE* file = fopen(path.c_str(), "wb");
+  CHECK(file != NULL);
+  if (file == NULL) {
+    return;
+  }
+  BenchWriteTarHeader(file, "Comic/", NULL, 0, '0');
+  BenchWriteTarEntry(file, "Comic/Page 1.jpg", page, sizeof(page), false);
+  bool written = BenchCloseTar(file);
+  for (size_t i = 257; i < 265; ++i) {
+    written = written && _PatchTarHeader(path.c_str(), 0, i, 0) && _PatchTarHeader(path.c_str(), kTarBlockSize, i, 0);
+  }
+  CHECK(written);
+
+  CHECK(ArchiveReaderDetectFormat(path.c_str()) == kArchiveReaderFormat_TAR);
+  ArchiveReader* reader = ArchiveReaderOpen(path.c_str());
+  CHECK(reader != NULL);
+  if (reader) {
+    CHECK(ArchiveReaderGetEntryCount(reader) == 2);
+    CHECK((ArchiveReaderFindEntry(reader, "Comic/") == 0) && ArchiveReaderGetEntry(reader, 0)->isDirectory);
+    _CheckEntry(reader, "Comic/Page 1.jpg", page, sizeof(page));
+    ArchiveReaderClose(reader);
+  }
+  unlink(path.c_str());
+}
+
+// Entries of 1000 and 500 bytes: headers at 0 and 1536, data of the second one ending at 2548 then end blocks from 2560 to 3584
+static bool _WriteDamagedTarBase(const char* path, unsigned long long secondSize) {
+  unsigned char page[1000];
+  _FillBytes(page, sizeof(page), 1);
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  BenchWriteTarEntry(file, "Comic/Page 1.jpg", page, sizeof(page), false);
+  BenchWriteTarHeader(file, "Comic/Page 2.jpg", NULL, secondSize, '0');
+  BenchWriteTarData(file, page, 500);
+  return BenchCloseTar(file);
+}
+
+static long _OpenEntryCount(const char* path) {
+  ArchiveReader* reader = ArchiveReaderOpen(path);
+  if (reader == NULL) {
+    return -1;
+  }
+  long count = (long)ArchiveReaderGetEntryCount(reader);
+  unsigned char buffer[1000];
+  if ((count > 0) && !ArchiveReaderReadEntry(reader, 0, buffer, sizeof(buffer))) {
+    count = -1;
+  }
+  ArchiveReaderClose(reader);
+  return count;
+}
+
+static void _CheckDamagedTar() {
+  std::string path = _directory + "/damaged.cbt";
+  const char* cPath = path.c_str();
+
+  CHECK(_WriteDamagedTarBase(cPath, 500) && (_OpenEntryCount(cPath) == 2));
+
+  CHECK(_WriteDamagedTarBase(cPath, 500) && _PatchFile(cPath, 0, 'X'));  // Checksum of the first header
+  CHECK(ArchiveReaderDetectFormat(cPath) == kArchiveReaderFormat_Unknown);
+  CHECK(_OpenEntryCount(cPath) == -1);
+
+  CHECK(_WriteDamagedTarBase(cPath, 500) && _PatchFile(cPath, 1536, 'X'));  // Checksum of the second header
+  CHECK(ArchiveReaderDetectFormat(cPath) == kArchiveReaderFormat_TAR);
+  CHECK(_OpenEntryCount(cPath) == -1);
+
+  CHECK(_WriteDamagedTarBase(cPath, 500) && _PatchTarHeader(cPath, 1536, 124 + 4, '9'));  // Size field not octal
+  CHECK(_OpenEntryCount(cPath) == -1);
+
+  CHECK(_WriteDamagedTarBase(cPath, 1ULL << 32));  // Size past the end of the archive
+  CHECK(_OpenEntryCount(cPath) == -1);
+
+  CHECK(_WriteDamagedTarBase(cPath, 500) && (truncate(cPath, 1536 + 512 + 100) == 0));  // In the data of the second entry
+  CHECK(_OpenEntryCount(cPath) == -1);
+
+  CHECK(_WriteDamagedTarBase(cPath, 500) && (truncate(cPath, 1536 + 200) == 0));  // In the second header, lists the complete entries like an interrupted download
+  CHECK(_OpenEntryCount(cPath) == 1);
+
+  CHECK(_WriteDamagedTarBase(cPath, 500) && (truncate(cPath, 2560) == 0));  // Missing end blocks
+  CHECK(_OpenEntryCount(cPath) == 2);
+
+  unlink(cPath);
+}
+
+int main() {
+  const char* tmp = getenv("TMPDIR");
+  char directory[1024];
+  snprintf(directory, sizeof(directory), "%s/archivecheck-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+  if (mkdtemp(directory) == NULL) {
+    fprintf(stderr, "Failed creating \"%s\": %s\n", directory, strerror(errno));
+    return 1;
+  }
+  _directory = directory;
+
+  _CheckZip();
+  _CheckCover();
+  _CheckRar();
+  _CheckTar();
+  _CheckPrePosixTar();
+  _CheckDamagedTar();
+
+  rmdir(directory);
+  if (_failures) {
+    fprintf(stderr, "%i check(s) failed\n", _failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
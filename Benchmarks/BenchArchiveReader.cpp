@@ -0,0 +1,543 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// With --archive-reader, each case is also opened once through the ArchiveReader
+// engine behind MiniZip and UnRAR, which must detect its format from the
+// signature, and every entry is checked to read the same bytes into memory,
+// through a sink, as a prefix, in place and by name lookup. Then all entries
+// are read on one thread versus several threads sharing the reader, after a
+// stress pass where every thread reads all of them. Entries over
+// kMaxBufferedEntrySize (like the --large-entry one) are only checked through
+// the sink, as a prefix and in place, and are not read by the threads.
+// With --read-ahead MB, a ZIP of MB megabytes of stored pages is dropped from
+// the page cache then read page by page forward and backward like the comic
+// viewer, with and without ArchiveReaderPrefetchEntries() hints for the next
+// pages in the reading direction, to compare the cold page turn latency.
+// With --handle-cache N, a ZIP and a RAR comic of kHandleCacheEntryCount pages
+// are each opened N times to read their first page, like the comic viewer, the
+// importer and the web server opening the same archive in turn, with
+// ArchiveReaderOpen() versus the shared ArchiveReaderCacheOpen(), then the
+// cache is checked to drop readers of modified, invalidated or oversized files.
+// With --cbt MB, the same MB megabytes of stored pages are written to a CBZ and
+// to a CBT (TAR) comic, then each is opened through ArchiveReaderOpen() and all
+// its pages are read into a buffer (the ZIP one checking CRCs) and in place with
+// ArchiveReaderGetEntryBytes() where mapped, and long names from GNU, PAX and ustar headers
+// are checked to be found.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "ArchiveBench.h"
+
+#include "zlib.h"
+
+#include "ArchiveReader.h"
+#include "ImageHeader.h"
+#include "DirectoryCache.h"
+
+// Archive reader
+
+// crc32() takes 32 bits lengths and mapped entries are passed whole
+static uLong _CRC32(uLong crc, const void* bytes, size_t length) {
+  const Bytef* next = (const Bytef*)bytes;
+  while (length) {
+    uInt chunk = (uInt)std::min(length, (size_t)1 << 30);
+    crc = crc32(crc, next, chunk);
+    next += chunk;
+    length -= chunk;
+  }
+  return crc;
+}
+
+static int _CRCSink(void* context, const void* bytes, size_t length) {
+  uLong* crc = (uLong*)context;
+  *crc = _CRC32(*crc, bytes, length);
+  return 0;
+}
+
+// Checks every way of reading the entry returns the same bytes
+static bool _VerifyArchiveReaderEntry(const ArchiveReader* reader, size_t index, std::vector<char>* buffer) {
+  const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, index);
+  bool buffered = entry->size <= kMaxBufferedEntrySize;
+  if (buffered) {
+    buffer->resize((size_t)entry->size + 1);
+    if (!ArchiveReaderReadEntry(reader, index, &(*buffer)[0], (size_t)entry->size) ||
+        (_CRC32(crc32(0, Z_NULL, 0), &(*buffer)[0], (size_t)entry->size) != entry->crc)) {
+      return false;
+    }
+  }
+  uLong crc = crc32(0, Z_NULL, 0);
+  if (!ArchiveReaderReadEntryToSink(reader, index, _CRCSink, &crc) || (crc != entry->crc)) {
+    return false;
+  }
+  std::vector<char> prefix(kImageHeaderProbeSize);
+  size_t length = 0;
+  if (!ArchiveReaderReadEntryPrefix(reader, index, &prefix[0], prefix.size(), &length) ||
+      (length != std::min((size_t)entry->size, prefix.size())) || (buffered && memcmp(&prefix[0], &(*buffer)[0], length))) {
+    return false;
+  }
+  const void* bytes = ArchiveReaderGetEntryBytes(reader, index, &length);
+  if (bytes && (length != entry->size)) {
+    return false;
+  }
+  if (bytes && (buffered ? memcmp(bytes, &(*buffer)[0], length) != 0 : _CRC32(crc32(0, Z_NULL, 0), bytes, length) != entry->crc)) {
+    return false;
+  }
+  long found = ArchiveReaderFindEntry(reader, entry->name);
+  return (found >= 0) && !strcmp(ArchiveReaderGetEntry(reader, found)->name, entry->name);  // Duplicate names resolve to the first one
+}
+
+struct ArchiveReaderThreadContext {
+  const ArchiveReader* reader;
+  int passes;  // Every thread reads all entries this many times if > 0
+  int threadIndex;
+  std::atomic<size_t>* next;  // Otherwise threads share the entries
+  bool failed;
+};
+
+static void* _ArchiveReaderThread(void* arg) {
+  ArchiveReaderThreadContext* context = (ArchiveReaderThreadContext*)arg;
+  std::vector<char> buffer;
+  size_t count = ArchiveReaderGetEntryCount(context->reader);
+  for (size_t i = 0; !context->failed && count; ++i) {
+    size_t index;
+    if (context->passes > 0) {
+      if (i == count * context->passes) {
+        break;
+      }
+      index = (i + context->threadIndex * 7) % count;  // Start each thread at a different entry
+    } else {
+      index = (*context->next)++;
+      if (index >= count) {
+        break;
+      }
+    }
+    const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(context->reader, index);
+    if (entry->isDirectory || (entry->size > kMaxBufferedEntrySize)) {
+      continue;
+    }
+    buffer.resize((size_t)entry->size + 1);
+    context->failed = !ArchiveReaderReadEntry(context->reader, index, &buffer[0], (size_t)entry->size);
+  }
+  return NULL;
+}
+
+static bool _RunArchiveReaderThreads(const ArchiveReader* reader, int threadCount, int passes) {
+  std::vector<pthread_t> threads(threadCount);
+  std::vector<ArchiveReaderThreadContext> contexts(threadCount);
+  std::atomic<size_t> next(0);
+  bool success = true;
+  int started = 0;
+  for (; started < threadCount; ++started) {
+    ArchiveReaderThreadContext* context = &contexts[started];
+    context->reader = reader;
+    context->passes = passes;
+    context->threadIndex = started;
+    context->next = &next;
+    context->failed = false;
+    if (pthread_create(&threads[started], NULL, _ArchiveReaderThread, context)) {
+      success = false;
+      break;
+    }
+  }
+  for (int i = 0; i < started; ++i) {
+    pthread_join(threads[i], NULL);
+    if (contexts[i].failed) {
+      success = false;
+    }
+  }
+  return success;
+}
+
+CaseStatus BenchArchiveReaderCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  ArchiveReaderFormat format = benchCase->format == kArchiveFormat_ZIP ? kArchiveReaderFormat_ZIP : kArchiveReaderFormat_RAR;
+  if (ArchiveReaderDetectFormat(benchCase->path.c_str()) != format) {
+    return kCaseStatus_OpenFailed;
+  }
+  for (int i = 0; i < options->iterations; ++i) {
+    double start = BenchNow();
+    ArchiveReader* reader = ArchiveReaderOpen(benchCase->path.c_str());
+    double seconds = BenchNow() - start;
+    if (reader == NULL) {
+      return kCaseStatus_OpenFailed;
+    }
+    ArchiveReaderClose(reader);
+    if ((i == 0) || (seconds < result->archiveReaderOpenSeconds)) {
+      result->archiveReaderOpenSeconds = seconds;
+    }
+  }
+
+  ArchiveReader* reader = ArchiveReaderOpen(benchCase->path.c_str());
+  if ((reader == NULL) || (ArchiveReaderGetFormat(reader) != format)) {
+    if (reader) {
+      ArchiveReaderClose(reader);
+    }
+    return kCaseStatus_OpenFailed;
+  }
+  CaseStatus status = kCaseStatus_OK;
+  std::vector<char> buffer;
+  for (size_t i = 0; i < ArchiveReaderGetEntryCount(reader); ++i) {
+    const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, i);
+    if (entry->isDirectory || entry->isEncrypted) {
+      continue;
+    }
+    if (!_VerifyArchiveReaderEntry(reader, i, &buffer)) {
+      status = kCaseStatus_CRCFailed;
+      break;
+    }
+    result->archiveReaderVerified += 1;
+  }
+
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  result->archiveReaderThreads = (int)std::min(std::max(processors, 2L), (long)kMaxParallelThreads);
+  if ((status == kCaseStatus_OK) && !_RunArchiveReaderThreads(reader, result->archiveReaderThreads, kParallelStressPasses)) {
+    status = kCaseStatus_DecodeFailed;
+  }
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    double start = BenchNow();
+    bool success = _RunArchiveReaderThreads(reader, 1, 0);
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->archiveReaderReadSeconds)) {
+      result->archiveReaderReadSeconds = seconds;
+    }
+    if (success) {
+      start = BenchNow();
+      success = _RunArchiveReaderThreads(reader, result->archiveReaderThreads, 0);
+      seconds = BenchNow() - start;
+      if ((i == 0) || (seconds < result->archiveReaderConcurrentSeconds)) {
+        result->archiveReaderConcurrentSeconds = seconds;
+      }
+    }
+    if (!success) {
+      status = kCaseStatus_DecodeFailed;
+    }
+  }
+  ArchiveReaderClose(reader);
+  return status;
+}
+
+// Read-ahead
+
+#define kReadAheadPageCount 3  // Same as ComicViewController
+#define kReadAheadThinkTime 20  // Milliseconds spent on each page, readers take seconds
+
+struct PageTurnResult {
+  double meanMilliseconds;
+  double maxMilliseconds;
+};
+
+// Drops the archive from the page cache so every page starts cold, returns false where not supported
+static bool _EvictFile(const char* path) {
+#if defined(POSIX_FADV_DONTNEED)
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool success = (fdatasync(fd) == 0) && (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0);
+  close(fd);
+  return success;
+#else
+  return false;
+#endif
+}
+
+// Turns the pages forward or backward like ComicViewController, optionally hinting the next ones in that direction
+static bool _TurnPages(const char* path, bool backward, bool readAhead, PageTurnResult* result) {
+  ArchiveReader* reader = ArchiveReaderOpen(path);
+  if (reader == NULL) {
+    return false;
+  }
+  std::vector<size_t> pages;
+  for (size_t i = 0; i < ArchiveReaderGetEntryCount(reader); ++i) {
+    if (!ArchiveReaderGetEntry(reader, i)->isDirectory) {
+      pages.push_back(i);  // Written in reading order
+    }
+  }
+  if (backward) {
+    std::reverse(pages.begin(), pages.end());
+  }
+  std::vector<char> buffer;
+  bool success = true;
+  double total = 0.0;
+  result->maxMilliseconds = 0.0;
+  for (size_t i = 0; success && (i < pages.size()); ++i) {
+    const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, pages[i]);
+    buffer.resize((size_t)entry->size + 1);
+    double start = BenchNow();
+    success = ArchiveReaderReadEntry(reader, pages[i], &buffer[0], (size_t)entry->size);
+    double milliseconds = (BenchNow() - start) * 1000.0;
+    total += milliseconds;
+    result->maxMilliseconds = std::max(result->maxMilliseconds, milliseconds);
+    if (readAhead) {
+      ArchiveReaderPrefetchEntries(reader, &pages[i + 1], std::min(pages.size() - i - 1, (size_t)kReadAheadPageCount));
+    }
+    usleep(kReadAheadThinkTime * 1000);
+  }
+  result->meanMilliseconds = pages.size() ? total / pages.size() : 0.0;
+  ArchiveReaderClose(reader);
+  return success;
+}
+
+// Returns the number of failed runs
+int BenchRunReadAhead(const BenchOptions* options) {
+  std::string path = options->workDirectory + "-read-ahead.zip";
+  int pageCount = (int)std::max((long long)options->readAheadMegabytes * 1024 * 1024 / (long long)options->pageSize, 2LL);
+  bool written = BenchWriteZipCorpus(path.c_str(), 0, pageCount, options->pageSize, false);  // Stored JPEGs like most CBZs
+  int failures = 0;
+  printf(",\n  \"read_ahead\": {\"pages\": %i, \"page_size\": %lu, \"think_ms\": %i, \"runs\": [\n", pageCount, (unsigned long)options->pageSize, kReadAheadThinkTime);
+  for (int i = 0; i < 4; ++i) {
+    bool backward = i >= 2;
+    bool readAhead = i % 2;
+    PageTurnResult best = {0.0, 0.0};
+    bool success = written;
+    for (int j = 0; success && (j < options->iterations); ++j) {
+      PageTurnResult result;
+      success = _EvictFile(path.c_str()) && _TurnPages(path.c_str(), backward, readAhead, &result);
+      if (success && ((j == 0) || (result.meanMilliseconds < best.meanMilliseconds))) {
+        best = result;
+      }
+    }
+    if (!success) {
+      failures += 1;
+    }
+    printf("    {\"direction\": \"%s\", \"read_ahead\": %s, \"mean_page_ms\": %.3f, \"max_page_ms\": %.3f, \"status\": \"%s\"}%s\n", backward ? "backward" : "forward",
+           readAhead ? "true" : "false", best.meanMilliseconds, best.maxMilliseconds, success ? "ok" : "failed", i < 3 ? "," : "");
+  }
+  printf("  ]}");
+  unlink(path.c_str());
+  return failures;
+}
+
+// Handle cache
+
+#define kHandleCacheEntryCount 1000
+#define kHandleCachePageSize 1024  // Small so the opening dominates
+
+static bool _WriteHandleCacheCorpus(const char* path, bool rar, int pageCount) {
+  if (!rar) {
+    return BenchWriteZipCorpus(path, 0, pageCount, kHandleCachePageSize, false);
+  }
+  FILE* file = BenchOpenStoredRar(path);
+  if (file == NULL) {
+    return false;
+  }
+  unsigned char buffer[kHandleCachePageSize];
+  for (int i = 0; i < pageCount; ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "Comic/Page %04i.jpg", i + 1);
+    BenchGeneratePage(buffer, sizeof(buffer), i + 1, 1600, 2400);
+    BenchWriteStoredRarEntry(file, name, buffer, sizeof(buffer), false);
+  }
+  return BenchCloseStoredRar(file);
+}
+
+// Opens the archive and reads its first page, returns the number of entries or -1 on failure
+static long _OpenFirstPage(const char* path, bool cached) {
+  ArchiveReader* reader = cached ? ArchiveReaderCacheOpen(path) : ArchiveReaderOpen(path);
+  if (reader == NULL) {
+    return -1;
+  }
+  long count = (long)ArchiveReaderGetEntryCount(reader);
+  char buffer[kHandleCachePageSize];
+  if ((count == 0) || !ArchiveReaderReadEntry(reader, 0, buffer, sizeof(buffer))) {
+    count = -1;
+  }
+  ArchiveReaderClose(reader);
+  return count;
+}
+
+// Returns true if the cache drops the reader of a rewritten file, of a file in an invalidated directory and past its budget
+static bool _CheckHandleCache(const std::string& directory, const std::string& zipPath, const std::string& rarPath) {
+  DirectoryCacheKey key;
+  if ((_OpenFirstPage(zipPath.c_str(), true) != kHandleCacheEntryCount) || !_WriteHandleCacheCorpus(zipPath.c_str(), false, kHandleCacheEntryCount / 2) ||
+      (_OpenFirstPage(zipPath.c_str(), true) != kHandleCacheEntryCount / 2)) {
+    return false;
+  }
+  if ((_OpenFirstPage(rarPath.c_str(), true) != kHandleCacheEntryCount) || !DirectoryCacheGetKey(rarPath.c_str(), &key)) {
+    return false;
+  }
+  ArchiveReader* reader = ArchiveReaderCacheLookup(rarPath.c_str(), &key);
+  if (reader == NULL) {
+    return false;
+  }
+  ArchiveReaderClose(reader);
+  ArchiveReaderCacheInvalidate(directory.c_str());
+  reader = ArchiveReaderCacheLookup(rarPath.c_str(), &key);
+  if (reader) {
+    ArchiveReaderClose(reader);
+    return false;
+  }
+  ArchiveReaderCacheSetBudget(1024, 16);  // Smaller than any of the archives
+  bool success = (_OpenFirstPage(rarPath.c_str(), true) == kHandleCacheEntryCount) && ((reader = ArchiveReaderCacheLookup(rarPath.c_str(), &key)) == NULL);
+  if (reader) {
+    ArchiveReaderClose(reader);
+  }
+  ArchiveReaderCacheSetBudget(4 * 1024 * 1024, 16);
+  return success;
+}
+
+// Returns the number of failed runs
+int BenchRunHandleCache(const BenchOptions* options) {
+  std::string directory = options->workDirectory + "-handle-cache";
+  std::string paths[2] = {directory + "/comic.cbz", directory + "/comic.cbr"};
+  bool written = ((mkdir(directory.c_str(), 0755) == 0) || (errno == EEXIST)) &&
+                 _WriteHandleCacheCorpus(paths[0].c_str(), false, kHandleCacheEntryCount) && _WriteHandleCacheCorpus(paths[1].c_str(), true, kHandleCacheEntryCount);
+  int failures = 0;
+  printf(",\n  \"handle_cache\": {\"opens\": %i, \"entries\": %i, \"runs\": [\n", options->handleCacheCount, kHandleCacheEntryCount);
+  for (int i = 0; i < 4; ++i) {
+    bool rar = i >= 2;
+    bool cached = i % 2;
+    double best = 0.0;
+    bool success = written;
+    for (int j = 0; success && (j < options->iterations); ++j) {
+      ArchiveReaderCacheInvalidate(NULL);  // The first open of every iteration is always cold
+      double start = BenchNow();
+      for (int k = 0; success && (k < options->handleCacheCount); ++k) {
+        success = _OpenFirstPage(paths[rar].c_str(), cached) == kHandleCacheEntryCount;
+      }
+      double seconds = BenchNow() - start;
+      if ((j == 0) || (seconds < best)) {
+        best = seconds;
+      }
+    }
+    if (!success) {
+      failures += 1;
+    }
+    printf("    {\"format\": \"%s\", \"cached\": %s, \"open_ms\": %.4f, \"status\": \"%s\"}%s\n", rar ? "rar" : "zip", cached ? "true" : "false",
+           success ? best * 1000.0 / options->handleCacheCount : 0.0, success ? "ok" : "failed", i < 3 ? "," : "");
+  }
+  bool checked = written && _CheckHandleCache(directory, paths[0], paths[1]);
+  if (!checked) {
+    failures += 1;
+  }
+  printf("  ], \"invalidation\": \"%s\"}", checked ? "ok" : "failed");
+  ArchiveReaderCacheInvalidate(NULL);
+  unlink(paths[0].c_str());
+  unlink(paths[1].c_str());
+  rmdir(directory.c_str());
+  return failures;
+}
+
+// CBT
+
+// Reads every entry either into a buffer or in place if possible like -dataForFile:, returns a checksum of the page bytes or 0 on failure
+static unsigned long _ReadTarOrZipPages(const ArchiveReader* reader, bool inPlace, std::vector<unsigned char>* buffer) {
+  unsigned long checksum = 1;
+  size_t count = ArchiveReaderGetEntryCount(reader);
+  for (size_t i = 0; i < count; ++i) {
+    size_t length = (size_t)ArchiveReaderGetEntry(reader, i)->size;
+    const unsigned char* bytes = inPlace ? (const unsigned char*)ArchiveReaderGetEntryBytes(reader, i, &length) : NULL;
+    if (bytes == NULL) {
+      buffer->resize(length + 1);
+      bytes = ArchiveReaderReadEntry(reader, i, &(*buffer)[0], buffer->size()) ? &(*buffer)[0] : NULL;
+    }
+    if (bytes == NULL) {
+      return 0;
+    }
+    for (size_t j = 0; j < length; j += 4096) {  // Touch every memory page like a decoder would
+      checksum += bytes[j];
+    }
+    checksum += length;
+  }
+  return checksum;
+}
+
+// Returns true if names from GNU "L" entries, PAX records and the ustar prefix are all found with their data
+static bool _CheckTarLongNames(const char* path) {
+  std::string directory(120, 'd');
+  std::string names[3] = {directory + "/GNU Page 001.jpg", directory + "/PAX Page 002.jpg", "Prefix/Page 003.jpg"};
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  BenchWriteTarHeader(file, "./Comic/", NULL, 0, '5');
+  BenchWriteTarEntry(file, names[0].c_str(), names[0].data(), names[0].size(), false);
+  BenchWriteTarEntry(file, names[1].c_str(), names[1].data(), names[1].size(), true);
+  BenchWriteTarHeader(file, "Page 003.jpg", "Prefix", names[2].size(), '0');
+  BenchWriteTarData(file, names[2].data(), names[2].size());
+  if (!BenchCloseTar(file) || (ArchiveReaderDetectFormat(path) != kArchiveReaderFormat_TAR)) {
+    return false;
+  }
+  ArchiveReader* reader = ArchiveReaderOpen(path);
+  bool success = reader && (ArchiveReaderGetEntryCount(reader) == 4) && ArchiveReaderGetEntry(reader, 0)->isDirectory &&
+                 !strcmp(ArchiveReaderGetEntry(reader, 0)->name, "Comic/");
+  for (int i = 0; success && (i < 3); ++i) {
+    long index = ArchiveReaderFindEntry(reader, names[i].c_str());
+    std::vector<char> buffer(names[i].size() + 1);
+    success = (index >= 0) && ArchiveReaderReadEntry(reader, index, &buffer[0], buffer.size()) && !memcmp(&buffer[0], names[i].data(), names[i].size());
+  }
+  if (reader) {
+    ArchiveReaderClose(reader);
+  }
+  unlink(path);
+  return success;
+}
+
+// Returns the number of failed runs
+int BenchRunCbt(const BenchOptions* options) {
+  std::string paths[2] = {options->workDirectory + "-cbt.cbz", options->workDirectory + "-cbt.cbt"};
+  int count = (int)std::max((long long)options->cbtMegabytes * 1024 * 1024 / (long long)options->pageSize, 1LL);
+  bool written = BenchWriteZipCorpus(paths[0].c_str(), 0, count, options->pageSize, false) && BenchWriteTarCorpus(paths[1].c_str(), count, options->pageSize);
+  int failures = 0;
+  unsigned long expected = 0;
+  std::vector<unsigned char> buffer;
+  printf(",\n  \"cbt\": {\"pages\": %i, \"runs\": [\n", count);
+  for (int i = 0; i < 2; ++i) {
+    double times[3] = {0.0, 0.0, 0.0};  // Open, read into a buffer and read in place
+    bool success = written;
+    struct stat info;
+    long long bytes = success && (stat(paths[i].c_str(), &info) == 0) ? info.st_size : 0;
+    for (int j = 0; success && (j < options->iterations); ++j) {
+      double start = BenchNow();
+      ArchiveReader* reader = ArchiveReaderOpen(paths[i].c_str());
+      double seconds[3] = {BenchNow() - start, 0.0, 0.0};
+      success = reader && (ArchiveReaderGetFormat(reader) == (i ? kArchiveReaderFormat_TAR : kArchiveReaderFormat_ZIP)) && (ArchiveReaderGetEntryCount(reader) == (size_t)count);
+      for (int k = 0; success && (k < 2); ++k) {
+        start = BenchNow();
+        unsigned long checksum = _ReadTarOrZipPages(reader, k == 1, &buffer);
+        seconds[k + 1] = BenchNow() - start;
+        if (expected == 0) {
+          expected = checksum;
+        }
+        success = checksum && (checksum == expected);
+      }
+      if (reader) {
+        ArchiveReaderClose(reader);
+      }
+      for (int k = 0; k < 3; ++k) {
+        times[k] = (j == 0) || (seconds[k] < times[k]) ? seconds[k] : times[k];
+      }
+    }
+    if (!success) {
+      failures += 1;
+    }
+    printf("    {\"format\": \"%s\", \"bytes\": %lli, \"open_ms\": %.4f, \"read_ms\": %.3f, \"in_place_ms\": %.3f, \"status\": \"%s\"}%s\n", i ? "cbt" : "cbz", bytes,
+           times[0] * 1000.0, times[1] * 1000.0, times[2] * 1000.0, success ? "ok" : "failed", i < 1 ? "," : "");
+    unlink(paths[i].c_str());
+  }
+  bool named = _CheckTarLongNames(paths[1].c_str());
+  if (!named) {
+    failures += 1;
+  }
+  printf("  ], \"long_names\": \"%s\"}", named ? "ok" : "failed");
+  return failures;
+}
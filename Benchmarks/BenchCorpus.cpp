@@ -0,0 +1,425 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <algorithm>
+
+#include "ArchiveBench.h"
+
+#include "zip.h"
+
+#define kSmallEntryCount 10000
+#define kSmallEntrySize 1024
+#define kLargeEntrySize (4096ULL * 1024 * 1024 + 1024 * 1024)  // Just over what the 32 bits fields can hold
+#define kLargeEntryChunkSize (1024 * 1024)
+
+double BenchNow() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+bool BenchHasSuffix(const std::string& string, const char* suffix) {
+  size_t length = strlen(suffix);
+  return (string.size() >= length) && !strcasecmp(string.c_str() + string.size() - length, suffix);
+}
+
+// Returns 0 where the allocator cannot be queried
+long long BenchHeapBytesInUse() {
+#if defined(__APPLE__)
+  malloc_statistics_t statistics;
+  malloc_zone_statistics(NULL, &statistics);
+  return statistics.size_in_use;
+#elif defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;  // Large blocks like the unpack window are mmap()ed
+#else
+  return 0;
+#endif
+}
+
+// Subsequent volumes of a multi-volume set are opened by UnRAR itself
+static bool _IsSecondaryVolume(const std::string& path) {
+  size_t part = path.rfind(".part");
+  if ((part != std::string::npos) && BenchHasSuffix(path, ".rar")) {
+    return atoi(path.c_str() + part + 5) > 1;
+  }
+  size_t length = path.size();
+  return (length > 4) && (path[length - 4] == '.') && ((path[length - 3] == 'r') || (path[length - 3] == 'R')) &&
+         isdigit(path[length - 2]) && isdigit(path[length - 1]);
+}
+
+// Corpus generation
+
+static void _WriteLE32(unsigned char* bytes, unsigned int value) {
+  bytes[0] = value & 0xFF;
+  bytes[1] = (value >> 8) & 0xFF;
+  bytes[2] = (value >> 16) & 0xFF;
+  bytes[3] = value >> 24;
+}
+
+// Pages are shaped like baseline JPEGs (SOI, APP0, SOF0, scan data, EOI) with
+// scan data that deflate can only shave a few percent off, like real comics
+void BenchGeneratePage(unsigned char* buffer, size_t size, unsigned int seed, int width, int height) {
+  static const unsigned char header[] = {
+    0xFF, 0xD8,  // SOI
+    0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x48, 0x00, 0x48, 0x00, 0x00,  // APP0
+    0xFF, 0xC0, 0x00, 0x11, 0x08, 0x00, 0x00, 0x00, 0x00, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01  // SOF0
+  };
+  memcpy(buffer, header, sizeof(header));
+  buffer[25] = height >> 8;
+  buffer[26] = height & 0xFF;
+  buffer[27] = width >> 8;
+  buffer[28] = width & 0xFF;
+  unsigned int state = seed | 1;
+  unsigned char last = 0;
+  for (size_t i = sizeof(header); i < size - 2; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    if (state & 7) {
+      last = state >> 24;
+    }
+    buffer[i] = last;
+  }
+  buffer[size - 2] = 0xFF;
+  buffer[size - 1] = 0xD9;  // EOI
+}
+
+// Pages are shaped like 24 bits BMPs of flat colored panels with some noise,
+// which deflate compresses well like scanned line art saved as PNG or BMP
+void BenchGenerateBitmapPage(unsigned char* buffer, size_t size, unsigned int seed) {
+  int width = 1600;
+  size_t rowBytes = (width * 3 + 3) & ~3;
+  int height = (int)((size - 54) / rowBytes);
+  memset(buffer, 0, size);
+  buffer[0] = 'B';
+  buffer[1] = 'M';
+  _WriteLE32(&buffer[2], (unsigned int)size);
+  _WriteLE32(&buffer[10], 54);
+  _WriteLE32(&buffer[14], 40);
+  _WriteLE32(&buffer[18], width);
+  _WriteLE32(&buffer[22], height);
+  buffer[26] = 1;  // Planes
+  buffer[28] = 24;  // Bits per pixel
+  unsigned int state = seed | 1;
+  for (int y = 0; y < height; ++y) {
+    unsigned char* row = &buffer[54 + y * rowBytes];
+    for (int x = 0; x < width; ++x) {
+      unsigned int color = ((x / 160) * 7 + (y / 240) * 13 + seed) * 0x9E3779B1;
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      if ((state & 15) == 0) {
+        color ^= state;
+      }
+      row[x * 3 + 0] = color >> 8;
+      row[x * 3 + 1] = color >> 16;
+      row[x * 3 + 2] = color >> 24;
+    }
+  }
+}
+
+bool BenchWriteZipCorpus(const char* path, int method, int pageCount, size_t pageSize, bool bitmaps) {
+  zipFile file = zipOpen64(path, APPEND_STATUS_CREATE);
+  if (file == NULL) {
+    return false;
+  }
+  bool success = true;
+  unsigned char* buffer = (unsigned char*)malloc(pageSize);
+  for (int i = 0; success && (i < pageCount); ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "Comic/Page %03i.%s", i + 1, bitmaps ? "bmp" : "jpg");
+    zip_fileinfo info;
+    memset(&info, 0, sizeof(info));
+    info.tmz_date.tm_year = 2011;
+    info.tmz_date.tm_mday = 1;
+    if (bitmaps) {
+      BenchGenerateBitmapPage(buffer, pageSize, i + 1);
+    } else {
+      BenchGeneratePage(buffer, pageSize, i + 1, 1600, 2400);
+    }
+    success = (zipOpenNewFileInZip64(file, name, &info, NULL, 0, NULL, 0, NULL, method, method ? Z_DEFAULT_COMPRESSION : 0, 0) == ZIP_OK) &&
+              (zipWriteInFileInZip(file, buffer, (unsigned int)pageSize) == ZIP_OK) &&
+              (zipCloseFileInZip(file) == ZIP_OK);
+  }
+  free(buffer);
+  return (zipClose(file, NULL) == ZIP_OK) && success;
+}
+
+static void _WriteRarBlock(FILE* file, unsigned char* header, size_t size) {
+  header[5] = size & 0xFF;
+  header[6] = size >> 8;
+  unsigned int crc = crc32(0, header + 2, (uInt)(size - 2)) & 0xFFFF;
+  header[0] = crc & 0xFF;
+  header[1] = crc >> 8;
+  fwrite(header, 1, size, file);
+}
+
+FILE* BenchOpenStoredRar(const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file) {
+    static const unsigned char marker[] = {0x52, 0x61, 0x72, 0x21, 0x1A, 0x07, 0x00};
+    fwrite(marker, 1, sizeof(marker), file);
+    unsigned char mainHeader[13] = {0, 0, 0x73, 0x00, 0x00};
+    _WriteRarBlock(file, mainHeader, sizeof(mainHeader));
+  }
+  return file;
+}
+
+void BenchWriteStoredRarEntry(FILE* file, const char* name, const unsigned char* bytes, size_t size, bool encrypted) {
+  size_t length = std::min(strlen(name), (size_t)1024);
+  std::vector<unsigned char> header(32 + length);
+  header[2] = 0x74;  // FILE_HEAD
+  header[3] = encrypted ? 0x04 : 0x00;  // LHD_PASSWORD
+  header[4] = 0x80;  // LONG_BLOCK
+  _WriteLE32(&header[7], (unsigned int)size);  // PACK_SIZE
+  _WriteLE32(&header[11], (unsigned int)size);  // UNP_SIZE
+  header[15] = 3;  // HOST_OS = Unix
+  _WriteLE32(&header[16], (unsigned int)crc32(0, bytes, (uInt)size));
+  _WriteLE32(&header[20], (31 << 25) | (1 << 21) | (1 << 16));  // 2011-01-01 in DOS format
+  header[24] = 29;  // UNP_VER
+  header[25] = 0x30;  // METHOD = store
+  header[26] = length & 0xFF;
+  header[27] = length >> 8;
+  _WriteLE32(&header[28], 0100644);
+  memcpy(&header[32], name, length);
+  _WriteRarBlock(file, &header[0], header.size());
+  fwrite(bytes, 1, size, file);
+}
+
+bool BenchCloseStoredRar(FILE* file) {
+  unsigned char endHeader[7] = {0, 0, 0x7B, 0x00, 0x40};
+  _WriteRarBlock(file, endHeader, sizeof(endHeader));
+  return fclose(file) == 0;
+}
+
+// No RAR compressor is available so only the stored method (0x30) can be
+// synthesized; LZ, PPMd, filtered, solid, encrypted and multi-volume archives
+// must come from --corpus
+static bool _WriteStoredRarCorpus(const char* path, const BenchOptions* options) {
+  FILE* file = BenchOpenStoredRar(path);
+  if (file == NULL) {
+    return false;
+  }
+  unsigned char* buffer = (unsigned char*)malloc(options->pageSize);
+  for (int i = 0; i < options->pageCount; ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "Comic/Page %03i.jpg", i + 1);
+    BenchGeneratePage(buffer, options->pageSize, i + 1, 1600, 2400);
+    BenchWriteStoredRarEntry(file, name, buffer, options->pageSize, false);
+  }
+  free(buffer);
+  return BenchCloseStoredRar(file);
+}
+
+// A stored entry over 4 GiB ahead of the pages so its sizes, the local header
+// offsets of the pages and the central directory all need the ZIP64 records
+static bool _WriteLargeEntryZipCorpus(const char* path, const BenchOptions* options) {
+  zipFile file = zipOpen64(path, APPEND_STATUS_CREATE);
+  if (file == NULL) {
+    return false;
+  }
+  zip_fileinfo info;
+  memset(&info, 0, sizeof(info));
+  info.tmz_date.tm_year = 2011;
+  info.tmz_date.tm_mday = 1;
+  unsigned char* chunk = (unsigned char*)malloc(kLargeEntryChunkSize);
+  BenchGeneratePage(chunk, kLargeEntryChunkSize, 0, 1600, 2400);
+  bool success = zipOpenNewFileInZip64(file, "Comic/Extras.bin", &info, NULL, 0, NULL, 0, NULL, 0, 0, 1) == ZIP_OK;
+  for (unsigned long long offset = 0; success && (offset < kLargeEntrySize); offset += kLargeEntryChunkSize) {
+    success = zipWriteInFileInZip(file, chunk, (unsigned int)std::min<unsigned long long>(kLargeEntrySize - offset, kLargeEntryChunkSize)) == ZIP_OK;
+  }
+  success = success && (zipCloseFileInZip(file) == ZIP_OK);
+  free(chunk);
+  unsigned char* buffer = (unsigned char*)malloc(options->pageSize);
+  for (int i = 0; success && (i < options->pageCount); ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "Comic/Page %03i.jpg", i + 1);
+    BenchGeneratePage(buffer, options->pageSize, i + 1, 1600, 2400);
+    success = (zipOpenNewFileInZip64(file, name, &info, NULL, 0, NULL, 0, NULL, 0, 0, 1) == ZIP_OK) &&
+              (zipWriteInFileInZip(file, buffer, (unsigned int)options->pageSize) == ZIP_OK) &&
+              (zipCloseFileInZip(file) == ZIP_OK);
+  }
+  free(buffer);
+  return (zipClose(file, NULL) == ZIP_OK) && success;
+}
+
+bool BenchGenerateCorpus(const BenchOptions* options, std::vector<BenchCase>* cases) {
+  if ((mkdir(options->workDirectory.c_str(), 0755) < 0) && (errno != EEXIST)) {
+    fprintf(stderr, "Failed creating \"%s\": %s\n", options->workDirectory.c_str(), strerror(errno));
+    return false;
+  }
+  BenchCase zipStored = {"generated/cbz-stored", options->workDirectory + "/stored.cbz", kArchiveFormat_ZIP};
+  BenchCase zipDeflate = {"generated/cbz-deflate", options->workDirectory + "/deflate.cbz", kArchiveFormat_ZIP};
+  BenchCase rarStored = {"generated/cbr-stored", options->workDirectory + "/stored.cbr", kArchiveFormat_RAR};
+  BenchCase zipEntries = {"generated/cbz-10k-entries", options->workDirectory + "/entries.cbz", kArchiveFormat_ZIP};
+  if (!BenchWriteZipCorpus(zipStored.path.c_str(), 0, options->pageCount, options->pageSize, false) ||
+      !BenchWriteZipCorpus(zipDeflate.path.c_str(), Z_DEFLATED, options->pageCount, options->pageSize, false) ||
+      !_WriteStoredRarCorpus(rarStored.path.c_str(), options) ||
+      !BenchWriteZipCorpus(zipEntries.path.c_str(), 0, kSmallEntryCount, kSmallEntrySize, false)) {
+    fprintf(stderr, "Failed generating corpus in \"%s\"\n", options->workDirectory.c_str());
+    return false;
+  }
+  cases->push_back(zipStored);
+  cases->push_back(zipDeflate);
+  cases->push_back(rarStored);
+  cases->push_back(zipEntries);
+  if (options->largeEntry) {
+    BenchCase zipLarge = {"generated/cbz-zip64-large-entry", options->workDirectory + "/large.cbz", kArchiveFormat_ZIP};
+    if (!_WriteLargeEntryZipCorpus(zipLarge.path.c_str(), options)) {
+      fprintf(stderr, "Failed generating corpus in \"%s\"\n", options->workDirectory.c_str());
+      return false;
+    }
+    cases->push_back(zipLarge);
+  }
+  if (options->inflate) {
+    BenchCase zipBitmaps = {"generated/cbz-deflate-bitmaps", options->workDirectory + "/bitmaps.cbz", kArchiveFormat_ZIP};
+    if (!BenchWriteZipCorpus(zipBitmaps.path.c_str(), Z_DEFLATED, options->pageCount, options->pageSize, true)) {
+      fprintf(stderr, "Failed generating corpus in \"%s\"\n", options->workDirectory.c_str());
+      return false;
+    }
+    cases->push_back(zipBitmaps);
+  }
+  return true;
+}
+
+void BenchRemoveCorpus(const BenchOptions* options) {
+  unlink((options->workDirectory + "/stored.cbz").c_str());
+  unlink((options->workDirectory + "/deflate.cbz").c_str());
+  unlink((options->workDirectory + "/stored.cbr").c_str());
+  unlink((options->workDirectory + "/entries.cbz").c_str());
+  unlink((options->workDirectory + "/bitmaps.cbz").c_str());
+  unlink((options->workDirectory + "/large.cbz").c_str());
+  rmdir(options->workDirectory.c_str());
+}
+
+void BenchLoadCorpus(const std::string& directory, std::vector<BenchCase>* cases) {
+  DIR* dir = opendir(directory.c_str());
+  if (dir == NULL) {
+    fprintf(stderr, "Failed opening corpus \"%s\": %s\n", directory.c_str(), strerror(errno));
+    return;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dir))) {
+    BenchCase benchCase;
+    benchCase.path = directory + "/" + entry->d_name;
+    if (BenchHasSuffix(benchCase.path, ".cbz") || BenchHasSuffix(benchCase.path, ".zip")) {
+      benchCase.format = kArchiveFormat_ZIP;
+    } else if ((BenchHasSuffix(benchCase.path, ".cbr") || BenchHasSuffix(benchCase.path, ".rar")) && !_IsSecondaryVolume(benchCase.path)) {
+      benchCase.format = kArchiveFormat_RAR;
+    } else {
+      continue;
+    }
+    benchCase.name = std::string("corpus/") + entry->d_name;
+    cases->push_back(benchCase);
+  }
+  closedir(dir);
+}
+
+// TAR generation
+
+// A ustar header, with only the fields read by TarArchiveReader
+void BenchWriteTarHeader(FILE* file, const char* name, const char* prefix, unsigned long long size, char type) {
+  unsigned char header[kTarBlockSize];
+  memset(header, 0, sizeof(header));
+  strncpy((char*)&header[0], name, 100);
+  snprintf((char*)&header[100], 8, "%07o", 0644);
+  snprintf((char*)&header[108], 8, "%07o", 0);
+  snprintf((char*)&header[116], 8, "%07o", 0);
+  snprintf((char*)&header[124], 12, "%011llo", size);
+  snprintf((char*)&header[136], 12, "%011o", 1293840000);
+  header[156] = type;
+  memcpy(&header[257], "ustar\0" "00", 8);
+  if (prefix) {
+    strncpy((char*)&header[345], prefix, 155);
+  }
+  memset(&header[148], ' ', 8);
+  unsigned int sum = 0;
+  for (size_t i = 0; i < sizeof(header); ++i) {
+    sum += header[i];
+  }
+  snprintf((char*)&header[148], 8, "%06o", sum);
+  fwrite(header, 1, sizeof(header), file);
+}
+
+void BenchWriteTarData(FILE* file, const void* bytes, size_t size) {
+  static const unsigned char padding[kTarBlockSize] = {0};
+  fwrite(bytes, 1, size, file);
+  fwrite(padding, 1, (kTarBlockSize - size % kTarBlockSize) % kTarBlockSize, file);
+}
+
+// Names longer than the header field go in a GNU "L" entry or a PAX "path" record before the entry itself
+void BenchWriteTarEntry(FILE* file, const char* name, const void* bytes, size_t size, bool pax) {
+  size_t length = strlen(name);
+  if (length >= 100) {
+    if (pax) {
+      char record[1024];
+      int count = (int)length + 7;  // " path=" and the newline, plus the digits of the record length itself
+      for (int digits = 1; digits < 5; ++digits) {
+        if (snprintf(NULL, 0, "%i", count + digits) == digits) {
+          count += digits;
+          break;
+        }
+      }
+      snprintf(record, sizeof(record), "%i path=%s\n", count, name);
+      BenchWriteTarHeader(file, "PaxHeaders/entry", NULL, strlen(record), 'x');
+      BenchWriteTarData(file, record, strlen(record));
+    } else {
+      BenchWriteTarHeader(file, "././@LongLink", NULL, length + 1, 'L');
+      BenchWriteTarData(file, name, length + 1);
+    }
+  }
+  BenchWriteTarHeader(file, name, NULL, size, '0');
+  BenchWriteTarData(file, bytes, size);
+}
+
+bool BenchCloseTar(FILE* file) {
+  static const unsigned char end[2 * kTarBlockSize] = {0};
+  fwrite(end, 1, sizeof(end), file);
+  bool success = !ferror(file);
+  return (fclose(file) == 0) && success;
+}
+
+// Same pages and names as BenchWriteZipCorpus() with stored entries
+bool BenchWriteTarCorpus(const char* path, int pageCount, size_t pageSize) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  unsigned char* buffer = (unsigned char*)malloc(pageSize);
+  for (int i = 0; i < pageCount; ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "Comic/Page %03i.jpg", i + 1);
+    BenchGeneratePage(buffer, pageSize, i + 1, 1600, 2400);
+    BenchWriteTarEntry(file, name, buffer, pageSize, false);
+  }
+  free(buffer);
+  return BenchCloseTar(file);
+}
@@ -0,0 +1,887 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// With --stats, RAR cases also dump the RARGetStatistics() counters of their
+// last iteration; rebuild with CPPFLAGS=-DRAR_STAT_TIMING (after "make clean")
+// to get per-stage times, adding -DRAR_STAT_RDTSC for CPU ticks on x86.
+// With --probe, each case also times reading the dimensions of every page
+// from its first kImageHeaderProbeSize bytes (RARProcessFilePrefix and
+// unzReadCurrentFilePrefix) to compare against full extraction.
+// With --list, each case also reports the heap bytes held by a list-only open
+// handle (RAR_OM_LIST or unzOpen64) and the best time to list every entry.
+// ZIP cases also compare opening every entry to read its name, like MiniZip
+// used to do, with a single unzGetEntryList() call and its heap usage.
+// With --locate, ZIP cases also time looking up entries by name with
+// unzLocateFile and unzLocateFileFast.
+// With --mmap, ZIP cases also time opening the archive, listing it and fully
+// extracting its middle entry through the stdio and the mmap ioapi backends.
+// With --page-open, ZIP cases also time getting the bytes of each entry
+// into memory, reading them into a buffer versus unzGetCurrentFileMappedData
+// (with and without CRC check), which only applies to stored entries.
+// With --inflate, ZIP cases also compare the decompression speed of
+// unzReadCurrentFile into a preallocated buffer with
+// unzExtractCurrentFileToBuffer, and a deflated archive of BMP pages is added
+// to the generated corpus.
+// With --parallel, ZIP cases are also extracted through a shared unzReader,
+// first by several threads each extracting every entry as a stress test, then
+// by one thread versus several threads splitting the entries (all but the
+// entries over kMaxBufferedEntrySize). Rebuild with
+// CFLAGS=-DMMAP_MAX_FILE_SIZE=0 to use pread() instead of the mapping, and
+// with CFLAGS/CXXFLAGS/LDFLAGS=-fsanitize=thread to check for races.
+// With --io-calls, ZIP cases also count the ioapi reads, seeks and tells made
+// by unzOpen, by listing every entry with unzGoToNextFile and by opening the
+// first entry, which each cost a round trip on network file systems.
+
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "ArchiveBench.h"
+
+#include "unzip.h"
+#include "iommap.h"
+#include "unzreader.h"
+
+#include "ImageHeader.h"
+
+#define kMaxLocateScanLookups 256  // unzLocateFile is O(n) so only a sample of entries is looked up
+
+// Decoding
+
+CaseStatus BenchRunZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  unsigned char* buffer = (unsigned char*)malloc(options->readBufferSize);
+  CaseStatus status = kCaseStatus_OK;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    double ttfb = -1.0;
+    long long entries = 0;
+    long long packedBytes = 0;
+    long long unpackedBytes = 0;
+    double start = BenchNow();
+    unzFile file = unzOpen64(benchCase->path.c_str());
+    if (file == NULL) {
+      status = kCaseStatus_OpenFailed;
+      break;
+    }
+    int error = unzGoToFirstFile(file);
+    while (error == UNZ_OK) {
+      char name[1024];
+      unz_file_info64 info;
+      if (unzGetCurrentFileInfo64(file, &info, name, sizeof(name), NULL, 0, NULL, 0) != UNZ_OK) {
+        status = kCaseStatus_DecodeFailed;
+        break;
+      }
+      if (name[0] && (name[strlen(name) - 1] != '/') && (name[strlen(name) - 1] != '\\')) {
+        if (entries == 0) {
+          snprintf(result->method, sizeof(result->method), "%s",
+                   info.compression_method == 0 ? "stored" : info.compression_method == Z_DEFLATED ? "deflate" : "other");
+        }
+        if (info.flag & 1) {
+          result->encrypted = 1;
+        }
+        if (unzOpenCurrentFile(file) != UNZ_OK) {
+          status = kCaseStatus_DecodeFailed;
+          break;
+        }
+        int length;
+        while ((length = unzReadCurrentFile(file, buffer, (unsigned int)options->readBufferSize)) > 0) {
+          if (ttfb < 0.0) {
+            ttfb = BenchNow() - start;
+          }
+          unpackedBytes += length;
+        }
+        int closeError = unzCloseCurrentFile(file);
+        if (length < 0) {
+          status = kCaseStatus_DecodeFailed;
+          break;
+        }
+        if (closeError == UNZ_CRCERROR) {
+          status = kCaseStatus_CRCFailed;
+          break;
+        }
+        entries += 1;
+        packedBytes += info.compressed_size;
+      }
+      error = unzGoToNextFile(file);
+    }
+    unzClose(file);
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->seconds)) {
+      result->seconds = seconds;
+    }
+    if ((ttfb >= 0.0) && ((result->ttfb < 0.0) || (ttfb < result->ttfb))) {
+      result->ttfb = ttfb;
+    }
+    result->entries = entries;
+    result->packedBytes = packedBytes;
+    result->unpackedBytes = unpackedBytes;
+  }
+  free(buffer);
+  return status;
+}
+
+struct RarCallbackContext {
+  double start;
+  double ttfb;
+  long long unpackedBytes;
+  int volumes;
+};
+
+static int CALLBACK _RarCallback(UINT msg, LPARAM userData, LPARAM p1, LPARAM p2) {
+  RarCallbackContext* context = (RarCallbackContext*)userData;
+  switch (msg) {
+
+    case UCM_PROCESSDATA:
+      if (context->ttfb < 0.0) {
+        context->ttfb = BenchNow() - context->start;
+      }
+      context->unpackedBytes += p2;
+      return 1;
+
+    case UCM_CHANGEVOLUME:
+      if (p2 == RAR_VOL_NOTIFY) {
+        context->volumes += 1;
+        return 1;
+      }
+      return -1;
+
+    case UCM_NEEDPASSWORD:
+      return -1;
+
+  }
+  return 0;
+}
+
+CaseStatus BenchRunRarCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  CaseStatus status = kCaseStatus_OK;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    RarCallbackContext context = {BenchNow(), -1.0, 0, 1};
+    long long entries = 0;
+    long long packedBytes = 0;
+    struct RAROpenArchiveDataEx archiveData;
+    memset(&archiveData, 0, sizeof(archiveData));
+    archiveData.ArcName = (char*)benchCase->path.c_str();
+    archiveData.OpenMode = RAR_OM_EXTRACT;
+    HANDLE handle = RAROpenArchiveEx(&archiveData);
+    if ((handle == NULL) || (archiveData.OpenResult != 0)) {
+      status = kCaseStatus_OpenFailed;
+      break;
+    }
+    result->solid = (archiveData.Flags & 0x0008) != 0;
+    RARSetCallback(handle, _RarCallback, (LPARAM)&context);
+    if (options->password) {
+      RARSetPassword(handle, (char*)options->password);
+    }
+    struct RARHeaderDataEx headerData;
+    memset(&headerData, 0, sizeof(headerData));
+    int error;
+    while ((error = RARReadHeaderEx(handle, &headerData)) == 0) {
+      bool isDirectory = (headerData.Flags & 0x00E0) == 0x00E0;
+      if (!isDirectory && (entries == 0)) {
+        snprintf(result->method, sizeof(result->method), "rar-m%u", headerData.Method - 0x30);
+      }
+      if (headerData.Flags & 0x0004) {
+        result->encrypted = 1;
+      }
+      error = RARProcessFile(handle, isDirectory ? RAR_SKIP : RAR_TEST, NULL, NULL);
+      if (error) {
+        break;
+      }
+      if (!isDirectory) {
+        entries += 1;
+        packedBytes += ((long long)headerData.PackSizeHigh << 32) | headerData.PackSize;
+      }
+    }
+    if (options->stats && (RARGetStatistics(handle, &result->stats) == 0)) {
+      result->hasStats = 1;
+    }
+    RARCloseArchive(handle);
+    if (error != ERAR_END_ARCHIVE) {
+      status = error == ERAR_BAD_DATA ? kCaseStatus_CRCFailed : kCaseStatus_DecodeFailed;
+    }
+    double seconds = BenchNow() - context.start;
+    if ((i == 0) || (seconds < result->seconds)) {
+      result->seconds = seconds;
+    }
+    if ((context.ttfb >= 0.0) && ((result->ttfb < 0.0) || (context.ttfb < result->ttfb))) {
+      result->ttfb = context.ttfb;
+    }
+    result->entries = entries;
+    result->packedBytes = packedBytes;
+    result->unpackedBytes = context.unpackedBytes;
+    result->volumes = context.volumes;
+  }
+  return status;
+}
+
+CaseStatus BenchProbeZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  unsigned char* buffer = (unsigned char*)malloc(kImageHeaderProbeSize);
+  CaseStatus status = kCaseStatus_OK;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    long long found = 0;
+    double start = BenchNow();
+    unzFile file = unzOpen64(benchCase->path.c_str());
+    if (file == NULL) {
+      status = kCaseStatus_OpenFailed;
+      break;
+    }
+    int error = unzGoToFirstFile(file);
+    while (error == UNZ_OK) {
+      char name[1024];
+      unz_file_info64 info;
+      if (unzGetCurrentFileInfo64(file, &info, name, sizeof(name), NULL, 0, NULL, 0) != UNZ_OK) {
+        status = kCaseStatus_DecodeFailed;
+        break;
+      }
+      if (name[0] && (name[strlen(name) - 1] != '/') && (name[strlen(name) - 1] != '\\')) {
+        int size = unzReadCurrentFilePrefix(file, buffer, kImageHeaderProbeSize);
+        unsigned int width;
+        unsigned int height;
+        if (size < 0) {
+          status = kCaseStatus_DecodeFailed;
+          break;
+        }
+        if (GetImageDimensionsFromHeader(buffer, size, &width, &height)) {
+          found += 1;
+        }
+      }
+      error = unzGoToNextFile(file);
+    }
+    unzClose(file);
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->probeSeconds)) {
+      result->probeSeconds = seconds;
+    }
+    result->probedEntries = found;
+  }
+  free(buffer);
+  return status;
+}
+
+CaseStatus BenchProbeRarCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  unsigned char* buffer = (unsigned char*)malloc(kImageHeaderProbeSize);
+  CaseStatus status = kCaseStatus_OK;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    long long found = 0;
+    double start = BenchNow();
+    struct RAROpenArchiveDataEx archiveData;
+    memset(&archiveData, 0, sizeof(archiveData));
+    archiveData.ArcName = (char*)benchCase->path.c_str();
+    archiveData.OpenMode = RAR_OM_EXTRACT;
+    HANDLE handle = RAROpenArchiveEx(&archiveData);
+    if ((handle == NULL) || (archiveData.OpenResult != 0)) {
+      status = kCaseStatus_OpenFailed;
+      break;
+    }
+    if (options->password) {
+      RARSetPassword(handle, (char*)options->password);
+    }
+    struct RARHeaderDataEx headerData;
+    memset(&headerData, 0, sizeof(headerData));
+    int error;
+    while ((error = RARReadHeaderEx(handle, &headerData)) == 0) {
+      if ((headerData.Flags & 0x00E0) == 0x00E0) {
+        error = RARProcessFile(handle, RAR_SKIP, NULL, NULL);
+      } else {
+        unsigned int size = 0;
+        unsigned int width;
+        unsigned int height;
+        error = RARProcessFilePrefix(handle, buffer, kImageHeaderProbeSize, &size);
+        if ((error == 0) && GetImageDimensionsFromHeader(buffer, size, &width, &height)) {
+          found += 1;
+        }
+      }
+      if (error) {
+        break;
+      }
+    }
+    RARCloseArchive(handle);
+    if (error != ERAR_END_ARCHIVE) {
+      status = kCaseStatus_DecodeFailed;
+    }
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->probeSeconds)) {
+      result->probeSeconds = seconds;
+    }
+    result->probedEntries = found;
+  }
+  free(buffer);
+  return status;
+}
+
+// Listing
+
+CaseStatus BenchListZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  for (int i = 0; i < options->iterations; ++i) {
+    double start = BenchNow();
+    long long heap = BenchHeapBytesInUse();
+    unzFile file = unzOpen64(benchCase->path.c_str());
+    if (file == NULL) {
+      return kCaseStatus_OpenFailed;
+    }
+    result->listOpenBytes = BenchHeapBytesInUse() - heap;
+    int error = unzGoToFirstFile(file);
+    while (error == UNZ_OK) {
+      char name[1024];
+      unz_file_info64 info;
+      error = unzGetCurrentFileInfo64(file, &info, name, sizeof(name), NULL, 0, NULL, 0);
+      if (error == UNZ_OK) {
+        error = unzGoToNextFile(file);
+      }
+    }
+    unzClose(file);
+    if (error != UNZ_END_OF_LIST_OF_FILE) {
+      return kCaseStatus_DecodeFailed;
+    }
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->listSeconds)) {
+      result->listSeconds = seconds;
+    }
+
+    start = BenchNow();
+    file = unzOpen64(benchCase->path.c_str());
+    if (file == NULL) {
+      return kCaseStatus_OpenFailed;
+    }
+    error = unzGoToFirstFile(file);
+    while (error == UNZ_OK) {
+      char name[256];
+      unz_file_info64 info;
+      error = unzOpenCurrentFile(file);
+      if (error == UNZ_OK) {
+        error = unzGetCurrentFileInfo64(file, &info, name, sizeof(name), NULL, 0, NULL, 0);
+        unzCloseCurrentFile(file);
+      }
+      if (error == UNZ_OK) {
+        error = unzGoToNextFile(file);
+      }
+    }
+    unzClose(file);
+    if (error != UNZ_END_OF_LIST_OF_FILE) {
+      return kCaseStatus_DecodeFailed;
+    }
+    seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->listOpenEachSeconds)) {
+      result->listOpenEachSeconds = seconds;
+    }
+
+    start = BenchNow();
+    file = unzOpen64(benchCase->path.c_str());
+    if (file == NULL) {
+      return kCaseStatus_OpenFailed;
+    }
+    unz_entry_list list;
+    heap = BenchHeapBytesInUse();
+    error = unzGetEntryList(file, &list);
+    result->listBulkBytes = BenchHeapBytesInUse() - heap;
+    unzFreeEntryList(&list);
+    unzClose(file);
+    if (error != UNZ_OK) {
+      return kCaseStatus_DecodeFailed;
+    }
+    seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->listBulkSeconds)) {
+      result->listBulkSeconds = seconds;
+    }
+  }
+  return kCaseStatus_OK;
+}
+
+CaseStatus BenchListRarCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  for (int i = 0; i < options->iterations; ++i) {
+    double start = BenchNow();
+    long long heap = BenchHeapBytesInUse();
+    struct RAROpenArchiveDataEx archiveData;
+    memset(&archiveData, 0, sizeof(archiveData));
+    archiveData.ArcName = (char*)benchCase->path.c_str();
+    archiveData.OpenMode = RAR_OM_LIST;
+    HANDLE handle = RAROpenArchiveEx(&archiveData);
+    if ((handle == NULL) || (archiveData.OpenResult != 0)) {
+      return kCaseStatus_OpenFailed;
+    }
+    result->listOpenBytes = BenchHeapBytesInUse() - heap;
+    if (options->password) {
+      RARSetPassword(handle, (char*)options->password);
+    }
+    struct RARHeaderDataEx headerData;
+    memset(&headerData, 0, sizeof(headerData));
+    int error;
+    while ((error = RARReadHeaderEx(handle, &headerData)) == 0) {
+      if ((error = RARProcessFile(handle, RAR_SKIP, NULL, NULL))) {
+        break;
+      }
+    }
+    RARCloseArchive(handle);
+    if (error != ERAR_END_ARCHIVE) {
+      return kCaseStatus_DecodeFailed;
+    }
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->listSeconds)) {
+      result->listSeconds = seconds;
+    }
+  }
+  return kCaseStatus_OK;
+}
+
+// Lookups
+
+CaseStatus BenchLocateZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  unzFile file = unzOpen64(benchCase->path.c_str());
+  if (file == NULL) {
+    return kCaseStatus_OpenFailed;
+  }
+  std::vector<std::string> names;
+  int error = unzGoToFirstFile(file);
+  while (error == UNZ_OK) {
+    char name[256];  // UNZ_MAXFILENAMEINZIP is private to unzip.c
+    error = unzGetCurrentFileInfo64(file, NULL, name, sizeof(name), NULL, 0, NULL, 0);
+    if (error == UNZ_OK) {
+      names.push_back(name);
+      error = unzGoToNextFile(file);
+    }
+  }
+  CaseStatus status = (error == UNZ_END_OF_LIST_OF_FILE) && !names.empty() ? kCaseStatus_OK : kCaseStatus_DecodeFailed;
+  size_t step = std::max(names.size() / kMaxLocateScanLookups, (size_t)1);
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    double start = BenchNow();
+    size_t count = 0;
+    for (size_t j = 0; j < names.size(); j += step, ++count) {
+      if (unzLocateFile(file, names[j].c_str(), 1) != UNZ_OK) {
+        status = kCaseStatus_DecodeFailed;
+        break;
+      }
+    }
+    double seconds = (BenchNow() - start) / count;
+    if ((i == 0) || (seconds < result->locateSeconds)) {
+      result->locateSeconds = seconds;
+    }
+
+    start = BenchNow();
+    for (size_t j = 0; j < names.size(); ++j) {
+      if (unzLocateFileFast(file, names[j].c_str(), 1) != UNZ_OK) {
+        status = kCaseStatus_DecodeFailed;
+        break;
+      }
+    }
+    seconds = (BenchNow() - start) / names.size();
+    if ((i == 0) || (seconds < result->locateFastSeconds)) {
+      result->locateFastSeconds = seconds;
+    }
+  }
+  unzClose(file);
+  return status;
+}
+
+// IO backends
+
+// Opens the archive, lists it and reads its middle entry to the end
+static bool _OpenListExtractZip(const char* path, zlib_filefunc64_def* functions, size_t bufferSize) {
+  unzFile file = unzOpen2_64(path, functions);
+  if (file == NULL) {
+    return false;
+  }
+  unz_entry_list list;
+  int error = unzGetEntryList(file, &list);
+  if (error == UNZ_OK) {
+    if (list.number_entry) {
+      error = unzGoToFilePos64(file, &list.entries[list.number_entry / 2].file_pos);
+    }
+    if ((error == UNZ_OK) && list.number_entry) {
+      error = unzOpenCurrentFile(file);
+      if (error == UNZ_OK) {
+        std::vector<char> buffer(bufferSize);
+        int result;
+        while ((result = unzReadCurrentFile(file, &buffer[0], (unsigned)bufferSize)) > 0) {
+          ;
+        }
+        error = unzCloseCurrentFile(file);  // Checks the CRC
+        if (result < 0) {
+          error = result;
+        }
+      }
+    }
+    unzFreeEntryList(&list);
+  }
+  unzClose(file);
+  return error == UNZ_OK;
+}
+
+CaseStatus BenchCompareZipIOCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  zlib_filefunc64_def stdioFunctions;
+  fill_fopen64_filefunc(&stdioFunctions);
+  zlib_filefunc64_def mmapFunctions;
+  fill_mmap_filefunc64(&mmapFunctions);
+  for (int i = 0; i < options->iterations; ++i) {
+    double start = BenchNow();
+    if (!_OpenListExtractZip(benchCase->path.c_str(), &stdioFunctions, options->readBufferSize)) {
+      return kCaseStatus_DecodeFailed;
+    }
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->ioStdioSeconds)) {
+      result->ioStdioSeconds = seconds;
+    }
+
+    start = BenchNow();
+    if (!_OpenListExtractZip(benchCase->path.c_str(), &mmapFunctions, options->readBufferSize)) {
+      return kCaseStatus_DecodeFailed;
+    }
+    seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->ioMmapSeconds)) {
+      result->ioMmapSeconds = seconds;
+    }
+  }
+  return kCaseStatus_OK;
+}
+
+// Page open latency
+
+// Reads the current entry into a buffer of its size like -[MiniZip dataForFile:] does for compressed entries
+static bool _CopyCurrentEntry(unzFile file, std::vector<char>* buffer) {
+  unz_file_info64 info;
+  if ((unzGetCurrentFileInfo64(file, &info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) || (unzOpenCurrentFile(file) != UNZ_OK)) {
+    return false;
+  }
+  buffer->resize(info.uncompressed_size + 1);
+  size_t offset = 0;
+  int result;
+  while ((result = unzReadCurrentFile(file, &(*buffer)[offset], (unsigned)std::min(buffer->size() - offset, (size_t)1 << 30))) > 0) {  // Returns an int
+    offset += result;
+  }
+  return (unzCloseCurrentFile(file) == UNZ_OK) && (result == 0) && (offset == info.uncompressed_size);
+}
+
+CaseStatus BenchOpenZipPagesCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  zlib_filefunc64_def functions;
+  fill_mmap_filefunc64(&functions);
+  unzFile file = unzOpen2_64(benchCase->path.c_str(), &functions);
+  if (file == NULL) {
+    return kCaseStatus_OpenFailed;
+  }
+  unz_entry_list list;
+  if (unzGetEntryList(file, &list) != UNZ_OK) {
+    unzClose(file);
+    return kCaseStatus_DecodeFailed;
+  }
+  CaseStatus status = list.number_entry ? kCaseStatus_OK : kCaseStatus_DecodeFailed;
+  std::vector<char> buffer;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    double start = BenchNow();
+    for (ZPOS64_T j = 0; j < list.number_entry; ++j) {
+      if ((unzGoToFilePos64(file, &list.entries[j].file_pos) != UNZ_OK) || !_CopyCurrentEntry(file, &buffer)) {
+        status = kCaseStatus_DecodeFailed;
+        break;
+      }
+    }
+    double seconds = (BenchNow() - start) / list.number_entry;
+    if ((i == 0) || (seconds < result->pageOpenCopySeconds)) {
+      result->pageOpenCopySeconds = seconds;
+    }
+
+    for (int checkCRC = 0; (status == kCaseStatus_OK) && (checkCRC <= 1); ++checkCRC) {
+      long long mapped = 0;
+      start = BenchNow();
+      for (ZPOS64_T j = 0; j < list.number_entry; ++j) {
+        const void* bytes;
+        ZPOS64_T length;
+        int error = unzGoToFilePos64(file, &list.entries[j].file_pos);
+        if (error == UNZ_OK) {
+          error = unzGetCurrentFileMappedData(file, &bytes, &length, checkCRC);
+        }
+        if (error == UNZ_OK) {
+          mapped += 1;
+        } else if ((error != UNZ_NOTMAPPABLE) || !_CopyCurrentEntry(file, &buffer)) {
+          status = error == UNZ_CRCERROR ? kCaseStatus_CRCFailed : kCaseStatus_DecodeFailed;
+          break;
+        }
+      }
+      seconds = (BenchNow() - start) / list.number_entry;
+      double* best = checkCRC ? &result->pageOpenMappedCRCSeconds : &result->pageOpenMappedSeconds;
+      if ((i == 0) || (seconds < *best)) {
+        *best = seconds;
+      }
+      result->mappedPages = mapped;
+    }
+  }
+  unzFreeEntryList(&list);
+  unzClose(file);
+  return status;
+}
+
+// Whole buffer decompression
+
+CaseStatus BenchInflateZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  zlib_filefunc64_def functions;
+  fill_mmap_filefunc64(&functions);
+  unzFile file = unzOpen2_64(benchCase->path.c_str(), &functions);
+  if (file == NULL) {
+    return kCaseStatus_OpenFailed;
+  }
+  unz_entry_list list;
+  if (unzGetEntryList(file, &list) != UNZ_OK) {
+    unzClose(file);
+    return kCaseStatus_DecodeFailed;
+  }
+  CaseStatus status = kCaseStatus_OK;
+  std::vector<char> buffer;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    double start = BenchNow();
+    for (ZPOS64_T j = 0; j < list.number_entry; ++j) {
+      buffer.resize(list.entries[j].uncompressed_size + 1);
+      if ((unzGoToFilePos64(file, &list.entries[j].file_pos) != UNZ_OK) || (unzOpenCurrentFile(file) != UNZ_OK)) {
+        status = kCaseStatus_DecodeFailed;
+        break;
+      }
+      size_t offset = 0;
+      int length;
+      while ((length = unzReadCurrentFile(file, &buffer[offset], (unsigned)std::min(options->readBufferSize, buffer.size() - offset))) > 0) {
+        offset += length;
+      }
+      int error = unzCloseCurrentFile(file);
+      if ((length < 0) || (error != UNZ_OK)) {
+        status = error == UNZ_CRCERROR ? kCaseStatus_CRCFailed : kCaseStatus_DecodeFailed;
+        break;
+      }
+    }
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->inflateStreamSeconds)) {
+      result->inflateStreamSeconds = seconds;
+    }
+
+    start = BenchNow();
+    for (ZPOS64_T j = 0; (status == kCaseStatus_OK) && (j < list.number_entry); ++j) {
+      buffer.resize(list.entries[j].uncompressed_size + 1);
+      int error = unzGoToFilePos64(file, &list.entries[j].file_pos);
+      if (error == UNZ_OK) {
+        error = unzExtractCurrentFileToBuffer(file, &buffer[0], buffer.size());
+      }
+      if (error != UNZ_OK) {
+        status = error == UNZ_CRCERROR ? kCaseStatus_CRCFailed : kCaseStatus_DecodeFailed;
+      }
+    }
+    seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->inflateBufferSeconds)) {
+      result->inflateBufferSeconds = seconds;
+    }
+  }
+  unzFreeEntryList(&list);
+  unzClose(file);
+  return status;
+}
+
+// Concurrent extraction
+
+struct ParallelContext {
+  unzReader reader;
+  const unz_entry_list* list;
+  int passes;  // Every thread extracts all entries this many times if > 0
+  int threadIndex;
+  std::atomic<ZPOS64_T>* next;  // Otherwise threads share the entries
+  int error;
+};
+
+static void* _ParallelThread(void* arg) {
+  ParallelContext* context = (ParallelContext*)arg;
+  std::vector<char> buffer;
+  ZPOS64_T count = context->list->number_entry;
+  for (ZPOS64_T i = 0; context->error == UNZ_OK; ++i) {
+    ZPOS64_T index;
+    if (context->passes > 0) {
+      if (i == count * context->passes) {
+        break;
+      }
+      index = (i + context->threadIndex * 7) % count;  // Start each thread at a different entry
+    } else {
+      index = (*context->next)++;
+      if (index >= count) {
+        break;
+      }
+    }
+    const unz_entry* entry = &context->list->entries[index];
+    if (entry->uncompressed_size > kMaxBufferedEntrySize) {
+      continue;
+    }
+    buffer.resize(entry->uncompressed_size + 1);
+    context->error = unzReaderExtractEntry(context->reader, entry, &buffer[0], buffer.size());
+  }
+  return NULL;
+}
+
+static int _RunParallelThreads(unzReader reader, int threadCount, int passes) {
+  std::vector<pthread_t> threads(threadCount);
+  std::vector<ParallelContext> contexts(threadCount);
+  std::atomic<ZPOS64_T> next(0);
+  int error = UNZ_OK;
+  int started = 0;
+  for (; started < threadCount; ++started) {
+    ParallelContext* context = &contexts[started];
+    context->reader = reader;
+    context->list = unzReaderGetEntryList(reader);
+    context->passes = passes;
+    context->threadIndex = started;
+    context->next = &next;
+    context->error = UNZ_OK;
+    if (pthread_create(&threads[started], NULL, _ParallelThread, context)) {
+      error = UNZ_INTERNALERROR;
+      break;
+    }
+  }
+  for (int i = 0; i < started; ++i) {
+    pthread_join(threads[i], NULL);
+    if (contexts[i].error != UNZ_OK) {
+      error = contexts[i].error;
+    }
+  }
+  return error;
+}
+
+CaseStatus BenchParallelZipCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  unzReader reader = unzReaderOpen(benchCase->path.c_str());
+  if (reader == NULL) {
+    return kCaseStatus_OpenFailed;
+  }
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  result->parallelThreads = (int)std::min(std::max(processors, 2L), (long)kMaxParallelThreads);
+
+  // Stress first: all threads extract every entry concurrently
+  int error = _RunParallelThreads(reader, result->parallelThreads, kParallelStressPasses);
+  for (int i = 0; (error == UNZ_OK) && (i < options->iterations); ++i) {
+    double start = BenchNow();
+    error = _RunParallelThreads(reader, 1, 0);
+    double seconds = BenchNow() - start;
+    if ((i == 0) || (seconds < result->parallelSerialSeconds)) {
+      result->parallelSerialSeconds = seconds;
+    }
+
+    if (error == UNZ_OK) {
+      start = BenchNow();
+      error = _RunParallelThreads(reader, result->parallelThreads, 0);
+      seconds = BenchNow() - start;
+      if ((i == 0) || (seconds < result->parallelSeconds)) {
+        result->parallelSeconds = seconds;
+      }
+    }
+  }
+  unzReaderClose(reader);
+  if (error == UNZ_CRCERROR) {
+    return kCaseStatus_CRCFailed;
+  }
+  return error == UNZ_OK ? kCaseStatus_OK : kCaseStatus_DecodeFailed;
+}
+
+// IO call counts
+
+// Forwards to the stdio backend, counting calls like a network file system would see them
+struct IOCounters {
+  zlib_filefunc64_def functions;
+  long long reads;
+  long long seeks;
+  long long tells;
+  long long readBytes;
+};
+
+static uLong ZCALLBACK _CountingRead(voidpf opaque, voidpf stream, void* buf, uLong size) {
+  IOCounters* counters = (IOCounters*)opaque;
+  counters->reads += 1;
+  uLong read = counters->functions.zread_file(counters->functions.opaque, stream, buf, size);
+  counters->readBytes += read;
+  return read;
+}
+
+static ZPOS64_T ZCALLBACK _CountingTell(voidpf opaque, voidpf stream) {
+  IOCounters* counters = (IOCounters*)opaque;
+  counters->tells += 1;
+  return counters->functions.ztell64_file(counters->functions.opaque, stream);
+}
+
+static long ZCALLBACK _CountingSeek(voidpf opaque, voidpf stream, ZPOS64_T offset, int origin) {
+  IOCounters* counters = (IOCounters*)opaque;
+  counters->seeks += 1;
+  return counters->functions.zseek64_file(counters->functions.opaque, stream, offset, origin);
+}
+
+static voidpf ZCALLBACK _CountingOpen(voidpf opaque, const void* filename, int mode) {
+  IOCounters* counters = (IOCounters*)opaque;
+  return counters->functions.zopen64_file(counters->functions.opaque, filename, mode);
+}
+
+static uLong ZCALLBACK _CountingWrite(voidpf opaque, voidpf stream, const void* buf, uLong size) {
+  IOCounters* counters = (IOCounters*)opaque;
+  return counters->functions.zwrite_file(counters->functions.opaque, stream, buf, size);
+}
+
+static int ZCALLBACK _CountingClose(voidpf opaque, voidpf stream) {
+  IOCounters* counters = (IOCounters*)opaque;
+  return counters->functions.zclose_file(counters->functions.opaque, stream);
+}
+
+static int ZCALLBACK _CountingError(voidpf opaque, voidpf stream) {
+  IOCounters* counters = (IOCounters*)opaque;
+  return counters->functions.zerror_file(counters->functions.opaque, stream);
+}
+
+static long long _IOCalls(const IOCounters* counters) {
+  return counters->reads + counters->seeks + counters->tells;
+}
+
+CaseStatus BenchCountZipIOCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  IOCounters counters;
+  memset(&counters, 0, sizeof(counters));
+  fill_fopen64_filefunc(&counters.functions);
+  zlib_filefunc64_def functions;
+  fill_fopen64_filefunc(&functions);
+  functions.zopen64_file = _CountingOpen;
+  functions.zread_file = _CountingRead;
+  functions.zwrite_file = _CountingWrite;
+  functions.ztell64_file = _CountingTell;
+  functions.zseek64_file = _CountingSeek;
+  functions.zclose_file = _CountingClose;
+  functions.zerror_file = _CountingError;
+  functions.opaque = &counters;
+
+  unzFile file = unzOpen2_64(benchCase->path.c_str(), &functions);
+  if (file == NULL) {
+    return kCaseStatus_OpenFailed;
+  }
+  result->ioOpenCalls = _IOCalls(&counters);
+  result->ioOpenReads = counters.reads;
+  result->ioOpenBytes = counters.readBytes;
+
+  // Listing like MiniZip used to do, then opening the first entry
+  long long calls = _IOCalls(&counters);
+  int error = unzGoToFirstFile(file);
+  while (error == UNZ_OK) {
+    char name[256];
+    error = unzGetCurrentFileInfo64(file, NULL, name, sizeof(name), NULL, 0, NULL, 0);
+    if (error == UNZ_OK) {
+      error = unzGoToNextFile(file);
+    }
+  }
+  result->ioListCalls = _IOCalls(&counters) - calls;
+  if (error == UNZ_END_OF_LIST_OF_FILE) {
+    calls = _IOCalls(&counters);
+    error = unzGoToFirstFile(file);
+    if (error == UNZ_OK) {
+      error = unzOpenCurrentFile(file);
+    }
+    if (error == UNZ_OK) {
+      error = unzCloseCurrentFile(file);
+    }
+    result->ioEntryCalls = _IOCalls(&counters) - calls;
+  }
+  unzClose(file);
+  return error == UNZ_OK ? kCaseStatus_OK : kCaseStatus_DecodeFailed;
+}
@@ -0,0 +1,977 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// With --directory-cache, each case also compares parsing the directory and
+// sorting the pages with reading them from a DirectoryCache file (and for ZIP
+// opening an unzReader from the cached entries), then checks that stale,
+// corrupted and truncated caches are rejected and deleted.
+// With --page-manifest, each case also compares the time to first page when
+// opening the comic from scratch (list, filter and sort the pages then read
+// the first one and its dimensions) with opening it from the DirectoryCache
+// page manifest saved at import, which is also timed with the probing of the
+// format and dimensions of every page.
+// With --natural-sort N, N comic-like file names are also sorted with a
+// natural compare function evaluated at every comparison, like sorting with
+// -localizedStandardCompare:, versus generating their SortKey.h keys once and
+// comparing them with memcmp(), and both orders are checked to match.
+// With --import N, a library of N small comics alternating ZIP and RAR, each
+// with a ComicInfo.xml, is also imported like LibraryUpdater once reading the
+// page manifest, cover and ComicInfo.xml in separate passes (and the cover again
+// for the thumbnail of every collection of 10 comics) versus reading them all in
+// a single ArchiveReaderReadEntries() pass, and both must find the same data.
+// With --cover N, the cover of a ZIP of N pages is also selected by listing
+// every name into strings compared with a natural compare function, like
+// -localizedStandardCompare: against the best so far, versus the single pass
+// over SortKey.h keys of ArchiveReaderFindCover() and versus reading it from
+// the DirectoryCache page manifest (parsing included, as opening from it does),
+// then cover naming conventions are checked.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "ArchiveBench.h"
+
+#include "zip.h"
+#include "unzip.h"
+#include "unzreader.h"
+
+#include "ArchiveReader.h"
+#include "ImageHeader.h"
+#include "DirectoryCache.h"
+#include "SortKey.h"
+
+#define kImportPageCount 16
+#define kImportPageSize (32 * 1024)
+#define kImportCollectionSize 10
+
+// Directory cache
+
+// Parses the directory like opening a comic without cache and fills contents
+// with every file sorted by name like RetrieveComicPages()
+static unzReader _ParseDirectory(const BenchCase* benchCase, DirectoryCacheContents* contents, std::vector<std::string>* pages) {
+  std::vector<std::pair<std::string, unsigned long> > names;
+  unzReader reader = NULL;
+  memset(contents, 0, sizeof(*contents));
+  if (benchCase->format == kArchiveFormat_ZIP) {
+    reader = unzReaderOpen(benchCase->path.c_str());
+    if (reader == NULL) {
+      return NULL;
+    }
+    contents->format = kDirectoryCacheFormat_ZIP;
+    contents->list = *unzReaderGetEntryList(reader);
+    for (unsigned long i = 0; i < contents->list.number_entry; ++i) {
+      const char* name = contents->list.names + contents->list.entries[i].name_offset;
+      if (!BenchHasSuffix(name, "/")) {
+        names.push_back(std::make_pair(std::string(name), i));
+      }
+    }
+  } else {
+    struct RAROpenArchiveData archiveData;
+    memset(&archiveData, 0, sizeof(archiveData));
+    archiveData.ArcName = (char*)benchCase->path.c_str();
+    archiveData.OpenMode = RAR_OM_LIST;
+    HANDLE handle = RAROpenArchive(&archiveData);
+    if (handle == NULL) {
+      return NULL;
+    }
+    struct RARHeaderData headerData;
+    memset(&headerData, 0, sizeof(headerData));
+    while ((RARReadHeader(handle, &headerData) == 0) && (RARProcessFile(handle, RAR_SKIP, NULL, NULL) == 0)) {
+      if ((headerData.Flags & 0x00E0) != 0x00E0) {
+        names.push_back(std::make_pair(std::string(headerData.FileName), (unsigned long)names.size()));
+      }
+    }
+    RARCloseArchive(handle);
+
+    // Names only, sharing a single allocation like in UnRAR.m
+    size_t namesSize = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+      namesSize += names[i].first.size() + 1;
+    }
+    contents->format = kDirectoryCacheFormat_RAR;
+    contents->list.entries = (unz_entry*)calloc(1, names.size() * sizeof(unz_entry) + namesSize + 1);
+    contents->list.names = (char*)(contents->list.entries + names.size());
+    size_t offset = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+      unz_entry* entry = &contents->list.entries[contents->list.number_entry++];
+      entry->name_offset = offset;
+      entry->size_filename = names[i].first.size();
+      memcpy(contents->list.names + offset, names[i].first.c_str(), entry->size_filename + 1);
+      offset += entry->size_filename + 1;
+    }
+  }
+  std::vector<const char*> strings(names.size() + 1);
+  std::vector<size_t> order(names.size() + 1);
+  for (size_t i = 0; i < names.size(); ++i) {
+    strings[i] = names[i].first.c_str();
+  }
+  if (!SortKeySortNames(&strings[0], names.size(), &order[0])) {
+    abort();
+  }
+  contents->pages = (DirectoryCachePage*)calloc(names.size() + 1, sizeof(DirectoryCachePage));
+  for (size_t i = 0; i < names.size(); ++i) {
+    contents->pages[contents->pageCount++].entry = names[order[i]].second;
+    pages->push_back(names[order[i]].first);
+  }
+  return reader;
+}
+
+static void _FreeParsedDirectory(const BenchCase* benchCase, unzReader reader, DirectoryCacheContents* contents) {
+  if (benchCase->format == kArchiveFormat_ZIP) {
+    free(contents->pages);  // The entry list belongs to the reader
+    memset(contents, 0, sizeof(*contents));
+    unzReaderClose(reader);
+  } else {
+    DirectoryCacheFreeContents(contents);
+  }
+}
+
+// Rewrites a valid cache, damages it and checks it is rejected then deleted
+static bool _CheckRejectedCache(const char* cachePath, const DirectoryCacheKey* key, const DirectoryCacheContents* contents, int damage) {
+  DirectoryCacheKey writeKey = *key;
+  if (damage == 0) {
+    writeKey.modificationTime += 1;  // Archive modified since the cache was written
+  }
+  if (!DirectoryCacheWrite(cachePath, &writeKey, contents)) {
+    return false;
+  }
+  struct stat info;
+  if (stat(cachePath, &info) < 0) {
+    return false;
+  }
+  if (damage == 1) {
+    FILE* file = fopen(cachePath, "r+b");
+    if (file == NULL) {
+      return false;
+    }
+    fseek(file, info.st_size / 2, SEEK_SET);
+    int c = fgetc(file);
+    fseek(file, info.st_size / 2, SEEK_SET);
+    fputc(c ^ 0x20, file);
+    fclose(file);
+  } else if ((damage == 2) && (truncate(cachePath, info.st_size - 1) < 0)) {
+    return false;
+  }
+  DirectoryCacheContents unused;
+  return !DirectoryCacheRead(cachePath, key, &unused) && (access(cachePath, F_OK) < 0);
+}
+
+CaseStatus BenchDirectoryCacheCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  char directory[] = "/tmp/archivebench-XXXXXX";
+  DirectoryCacheKey key;
+  if ((mkdtemp(directory) == NULL) || !DirectoryCacheGetKey(benchCase->path.c_str(), &key)) {
+    return kCaseStatus_OpenFailed;
+  }
+  char name[64];
+  DirectoryCacheGetFileName(&key, name, sizeof(name));
+  std::string cachePath = std::string(directory) + "/" + name;
+
+  CaseStatus status = kCaseStatus_OK;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    DirectoryCacheContents contents;
+    std::vector<std::string> pages;
+    double start = BenchNow();
+    unzReader reader = _ParseDirectory(benchCase, &contents, &pages);
+    if ((reader == NULL) && (benchCase->format == kArchiveFormat_ZIP)) {
+      status = kCaseStatus_OpenFailed;
+      break;
+    }
+    double parseSeconds = BenchNow() - start;
+    if (i == 0) {
+      if (!DirectoryCacheWrite(cachePath.c_str(), &key, &contents)) {
+        _FreeParsedDirectory(benchCase, reader, &contents);
+        status = kCaseStatus_DecodeFailed;
+        break;
+      }
+      struct stat info;
+      result->directoryCacheBytes = stat(cachePath.c_str(), &info) == 0 ? info.st_size : 0;
+    }
+    _FreeParsedDirectory(benchCase, reader, &contents);
+
+    // Cached open: identity check, cache read and for ZIP the concurrent reader without central directory
+    start = BenchNow();
+    DirectoryCacheKey currentKey;
+    if (!DirectoryCacheGetKey(benchCase->path.c_str(), &currentKey) || !DirectoryCacheRead(cachePath.c_str(), &currentKey, &contents)) {
+      status = kCaseStatus_DecodeFailed;
+      break;
+    }
+    reader = NULL;
+    if (benchCase->format == kArchiveFormat_ZIP) {
+      reader = unzReaderOpenWithEntryList(benchCase->path.c_str(), &contents.list);
+    }
+    double cacheSeconds = BenchNow() - start;
+    bool valid = (reader != NULL) || (benchCase->format != kArchiveFormat_ZIP);
+    valid = valid && (contents.pageCount == pages.size());
+    for (unsigned long j = 0; valid && (j < contents.pageCount); ++j) {
+      valid = pages[j] == contents.list.names + contents.list.entries[contents.pages[j].entry].name_offset;
+    }
+    if (reader) {
+      unzReaderClose(reader);
+    }
+    DirectoryCacheFreeContents(&contents);
+    if (!valid) {
+      status = kCaseStatus_DecodeFailed;
+      break;
+    }
+
+    if ((i == 0) || (parseSeconds < result->directoryParseSeconds)) {
+      result->directoryParseSeconds = parseSeconds;
+    }
+    if ((i == 0) || (cacheSeconds < result->directoryCacheSeconds)) {
+      result->directoryCacheSeconds = cacheSeconds;
+    }
+  }
+
+  // Stale, corrupted and truncated caches
+  if (status == kCaseStatus_OK) {
+    DirectoryCacheContents contents;
+    std::vector<std::string> pages;
+    unzReader reader = _ParseDirectory(benchCase, &contents, &pages);
+    for (int damage = 0; damage < 3; ++damage) {
+      if (_CheckRejectedCache(cachePath.c_str(), &key, &contents, damage)) {
+        result->directoryCacheRejected += 1;
+      }
+    }
+    _FreeParsedDirectory(benchCase, reader, &contents);
+    if (result->directoryCacheRejected != 3) {
+      status = kCaseStatus_DecodeFailed;
+    }
+  }
+  unlink(cachePath.c_str());
+  rmdir(directory);
+  return status;
+}
+
+// Page manifest
+
+static bool _IsImageName(const char* name) {
+  std::string string(name);
+  const char* slash = strrchr(name, '/');
+  if ((slash ? slash[1] : name[0]) == '.') {
+    return false;
+  }
+  return BenchHasSuffix(string, ".jpg") || BenchHasSuffix(string, ".jpeg") || BenchHasSuffix(string, ".png") || BenchHasSuffix(string, ".gif") || BenchHasSuffix(string, ".webp");
+}
+
+// Without manifest: open and list the archive, filter and sort the pages like RetrieveComicPages() then read the first one
+static bool _OpenFirstPage(const char* path, std::vector<char>* buffer, unsigned int* width, unsigned int* height) {
+  ArchiveReader* reader = ArchiveReaderOpen(path);
+  if (reader == NULL) {
+    return false;
+  }
+  std::vector<const char*> names;
+  std::vector<size_t> indexes;
+  for (size_t i = 0; i < ArchiveReaderGetEntryCount(reader); ++i) {
+    const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, i);
+    if (!entry->isDirectory && _IsImageName(entry->name)) {
+      names.push_back(entry->name);
+      indexes.push_back(i);
+    }
+  }
+  std::vector<size_t> order(names.size() + 1);
+  bool success = !names.empty() && SortKeySortNames(&names[0], names.size(), &order[0]);
+  if (success) {
+    size_t index = indexes[order[0]];
+    buffer->resize((size_t)ArchiveReaderGetEntry(reader, index)->size + 1);
+    success = ArchiveReaderReadEntry(reader, index, &(*buffer)[0], buffer->size() - 1) &&
+              GetImageDimensionsFromHeader(&(*buffer)[0], buffer->size() - 1, width, height);
+  }
+  ArchiveReaderClose(reader);
+  return success;
+}
+
+// From the manifest: ZIP readers are recreated from the cached entries and RAR ones still list the archive like UnRAR.m
+static bool _OpenFirstPageFromManifest(const BenchCase* benchCase, const char* cachePath, std::vector<char>* buffer, unsigned int* width, unsigned int* height) {
+  DirectoryCacheKey key;
+  DirectoryCacheContents contents;
+  if (!DirectoryCacheGetKey(benchCase->path.c_str(), &key) || !DirectoryCacheRead(cachePath, &key, &contents)) {
+    return false;
+  }
+  bool success = false;
+  if (contents.pageCount) {
+    const DirectoryCachePage* page = &contents.pages[0];
+    ArchiveReader* reader;
+    long index;
+    if (benchCase->format == kArchiveFormat_ZIP) {
+      reader = ArchiveReaderOpenZIPWithEntryList(benchCase->path.c_str(), &contents.list);
+      index = page->entry;
+    } else {
+      reader = ArchiveReaderOpen(benchCase->path.c_str());
+      index = reader ? ArchiveReaderFindEntry(reader, contents.list.names + contents.list.entries[page->entry].name_offset) : -1;
+    }
+    if (reader && (index >= 0)) {
+      buffer->resize((size_t)ArchiveReaderGetEntry(reader, index)->size + 1);
+      success = ArchiveReaderReadEntry(reader, index, &(*buffer)[0], buffer->size() - 1);
+      *width = page->width;
+      *height = page->height;
+    }
+    if (reader) {
+      ArchiveReaderClose(reader);
+    }
+  }
+  DirectoryCacheFreeContents(&contents);
+  return success;
+}
+
+struct ManifestProbe {
+  DirectoryCachePage* pages;
+  const std::vector<long>* pageForEntry;
+};
+
+static void _ProbeManifestPage(void* context, size_t index, const void* bytes, size_t length) {
+  ManifestProbe* probe = (ManifestProbe*)context;
+  DirectoryCachePage* page = &probe->pages[(*probe->pageForEntry)[index]];
+  ImageHeaderFormat format;
+  if (!GetImageInfoFromHeader(bytes, length, &format, &page->width, &page->height)) {
+    page->width = 0;
+    page->height = 0;
+  }
+  page->imageFormat = format;
+}
+
+// Like importPages:readingFiles: in MiniZip.m and UnRAR.m but with a separate probing pass
+static bool _WriteManifest(const BenchCase* benchCase, const char* cachePath, const DirectoryCacheKey* key, long long* probedPages) {
+  DirectoryCacheContents contents;
+  std::vector<std::string> pages;
+  unzReader zipReader = _ParseDirectory(benchCase, &contents, &pages);
+  if ((zipReader == NULL) && (benchCase->format == kArchiveFormat_ZIP)) {
+    return false;
+  }
+  unsigned long count = 0;
+  for (unsigned long i = 0; i < contents.pageCount; ++i) {
+    if (_IsImageName(pages[i].c_str())) {
+      contents.pages[count] = contents.pages[i];
+      pages[count++] = pages[i];
+    }
+  }
+  contents.pageCount = count;
+  pages.resize(count);
+  bool success = false;
+  ArchiveReader* reader = ArchiveReaderOpen(benchCase->path.c_str());
+  if (reader) {
+    std::vector<long> pageForEntry(ArchiveReaderGetEntryCount(reader) + 1, -1);
+    std::vector<unsigned char> selection(pageForEntry.size(), 0);
+    for (size_t i = 0; i < pages.size(); ++i) {
+      long index = ArchiveReaderFindEntry(reader, pages[i].c_str());
+      if (index >= 0) {
+        pageForEntry[index] = i;
+        selection[index] = 1;
+      }
+    }
+    ManifestProbe probe = {contents.pages, &pageForEntry};
+    std::vector<char> buffer(kImageHeaderProbeSize);
+    success = ArchiveReaderReadEntryPrefixes(reader, (const bool*)&selection[0], &buffer[0], buffer.size(), _ProbeManifestPage, &probe) &&
+              DirectoryCacheWrite(cachePath, key, &contents);
+    ArchiveReaderClose(reader);
+  }
+  *probedPages = 0;
+  for (unsigned long i = 0; i < contents.pageCount; ++i) {
+    if (contents.pages[i].width && contents.pages[i].height) {
+      *probedPages += 1;
+    }
+  }
+  _FreeParsedDirectory(benchCase, zipReader, &contents);
+  return success;
+}
+
+CaseStatus BenchPageManifestCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  char directory[] = "/tmp/archivebench-XXXXXX";
+  DirectoryCacheKey key;
+  if ((mkdtemp(directory) == NULL) || !DirectoryCacheGetKey(benchCase->path.c_str(), &key)) {
+    return kCaseStatus_OpenFailed;
+  }
+  char name[64];
+  DirectoryCacheGetFileName(&key, name, sizeof(name));
+  std::string cachePath = std::string(directory) + "/" + name;
+
+  CaseStatus status = kCaseStatus_OK;
+  std::vector<char> buffer;
+  for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    double start = BenchNow();
+    if (!_OpenFirstPage(benchCase->path.c_str(), &buffer, &width, &height)) {
+      status = kCaseStatus_DecodeFailed;
+      break;
+    }
+    double coldSeconds = BenchNow() - start;
+
+    start = BenchNow();
+    if (!_WriteManifest(benchCase, cachePath.c_str(), &key, &result->manifestProbedPages)) {
+      status = kCaseStatus_DecodeFailed;
+      break;
+    }
+    double writeSeconds = BenchNow() - start;
+
+    unsigned int manifestWidth = 0;
+    unsigned int manifestHeight = 0;
+    start = BenchNow();
+    if (!_OpenFirstPageFromManifest(benchCase, cachePath.c_str(), &buffer, &manifestWidth, &manifestHeight)) {
+      status = kCaseStatus_DecodeFailed;
+      break;
+    }
+    double manifestSeconds = BenchNow() - start;
+    if ((manifestWidth != width) || (manifestHeight != height)) {
+      status = kCaseStatus_DecodeFailed;
+      break;
+    }
+
+    if ((i == 0) || (coldSeconds < result->firstPageColdSeconds)) {
+      result->firstPageColdSeconds = coldSeconds;
+    }
+    if ((i == 0) || (writeSeconds < result->manifestWriteSeconds)) {
+      result->manifestWriteSeconds = writeSeconds;
+    }
+    if ((i == 0) || (manifestSeconds < result->firstPageManifestSeconds)) {
+      result->firstPageManifestSeconds = manifestSeconds;
+    }
+  }
+  struct stat info;
+  result->manifestBytes = stat(cachePath.c_str(), &info) == 0 ? info.st_size : 0;
+  unlink(cachePath.c_str());
+  rmdir(directory);
+  return status;
+}
+
+// Natural sort
+
+// Mixes padded and unpadded numbers, case and collisions on the prefixes like a real library
+static void _GenerateSortNames(int count, std::vector<std::string>* names) {
+  static const char* series[] = {"Spider-Man", "spider-man", "The Walking Dead", "Saga", "X-Men", "Y The Last Man", "Batman", "batman Beyond"};
+  unsigned int seed = 1;
+  for (int i = 0; i < count; ++i) {
+    seed = seed * 1103515245 + 12345;
+    unsigned int value = seed >> 8;
+    char name[128];
+    const char* title = series[value % (sizeof(series) / sizeof(series[0]))];
+    switch ((value >> 4) % 4) {
+      case 0: snprintf(name, sizeof(name), "%s %i.cbz", title, i); break;
+      case 1: snprintf(name, sizeof(name), "%s %03i.cbz", title, i % 1000); break;
+      case 2: snprintf(name, sizeof(name), "%s Vol. %i - Issue %i (%i).cbr", title, (value >> 6) % 12 + 1, i, 1990 + (value >> 10) % 30); break;
+      default: snprintf(name, sizeof(name), "%s v%i #%i.cbz", title, (value >> 6) % 12 + 1, i / 7); break;
+    }
+    names->push_back(name);
+  }
+}
+
+// Same order as comparing the SortKeyGenerate() keys but for ASCII only and recomputed at every call
+static int _NaturalCompare(const char* a, const char* b) {
+  const char* start1 = a;
+  const char* start2 = b;
+  while (*a && *b) {
+    if (isdigit((unsigned char)*a) && isdigit((unsigned char)*b)) {
+      const char* end1;
+      const char* end2;
+      while ((a[0] == '0') && isdigit((unsigned char)a[1])) ++a;  // Keeps a single zero
+      while ((b[0] == '0') && isdigit((unsigned char)b[1])) ++b;
+      for (end1 = a; isdigit((unsigned char)*end1); ++end1);
+      for (end2 = b; isdigit((unsigned char)*end2); ++end2);
+      if (end1 - a != end2 - b) {
+        return end1 - a < end2 - b ? -1 : 1;
+      }
+      int result = memcmp(a, b, end1 - a);
+      if (result) {
+        return result;
+      }
+      a = end1;
+      b = end2;
+    } else {
+      int c1 = isdigit((unsigned char)*a) ? '0' : tolower((unsigned char)*a);
+      int c2 = isdigit((unsigned char)*b) ? '0' : tolower((unsigned char)*b);
+      if (c1 != c2) {
+        return c1 - c2;
+      }
+      ++a;
+      ++b;
+    }
+  }
+  if (*a || *b) {
+    return *a ? 1 : -1;
+  }
+  return strcmp(start1, start2);
+}
+
+static bool _NaturalLess(const std::string& a, const std::string& b) {
+  return _NaturalCompare(a.c_str(), b.c_str()) < 0;
+}
+
+// Returns the number of failed runs
+int BenchRunNaturalSort(const BenchOptions* options) {
+  std::vector<std::string> names;
+  _GenerateSortNames(options->naturalSortCount, &names);
+  std::vector<const char*> strings(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    strings[i] = names[i].c_str();
+  }
+  std::vector<std::string> sorted;
+  std::vector<size_t> order(names.size());
+  std::vector<unsigned char> key(1024);
+  double compareSeconds = 0.0;
+  double generateSeconds = 0.0;
+  double keySeconds = 0.0;
+  long long keyBytes = 0;
+  bool success = true;
+  for (int i = 0; success && (i < options->iterations); ++i) {
+    sorted = names;
+    double start = BenchNow();
+    std::sort(sorted.begin(), sorted.end(), _NaturalLess);
+    double seconds = BenchNow() - start;
+    compareSeconds = (i == 0) || (seconds < compareSeconds) ? seconds : compareSeconds;
+
+    keyBytes = 0;
+    start = BenchNow();
+    for (size_t j = 0; j < names.size(); ++j) {
+      keyBytes += SortKeyGenerate(strings[j], &key[0], key.size());
+    }
+    seconds = BenchNow() - start;
+    generateSeconds = (i == 0) || (seconds < generateSeconds) ? seconds : generateSeconds;
+
+    start = BenchNow();
+    success = SortKeySortNames(&strings[0], names.size(), &order[0]);
+    seconds = BenchNow() - start;
+    keySeconds = (i == 0) || (seconds < keySeconds) ? seconds : keySeconds;
+  }
+  for (size_t i = 0; success && (i < names.size()); ++i) {
+    success = names[order[i]] == sorted[i];
+  }
+  printf(",\n  \"natural_sort\": {\"names\": %lu, \"compare_sort_ms\": %.3f, \"key_generation_ms\": %.3f, \"key_sort_ms\": %.3f, \"key_bytes\": %lli, \"speedup\": %.2f, \"status\": \"%s\"}",
+         (unsigned long)names.size(), compareSeconds * 1000.0, generateSeconds * 1000.0, keySeconds * 1000.0, keyBytes,
+         keySeconds > 0.0 ? compareSeconds / keySeconds : 0.0, success ? "ok" : "failed");
+  return success ? 0 : 1;
+}
+
+// Library import
+
+// A small comic in the first format or the other, with its ComicInfo.xml last like tagging tools append it
+static bool _WriteImportComic(const char* path, bool rar, int number) {
+  char info[512];
+  int infoLength = snprintf(info, sizeof(info), "<?xml version=\"1.0\"?>\n<ComicInfo>\n  <Series>Saga</Series>\n  <Volume>%i</Volume>\n"
+                                                "  <Number>%i</Number>\n  <PageCount>%i</PageCount>\n</ComicInfo>\n",
+                            number / 100 + 1, number, kImportPageCount);
+  std::vector<unsigned char> buffer(kImportPageSize);
+  bool success = true;
+  if (rar) {
+    FILE* file = BenchOpenStoredRar(path);
+    if (file == NULL) {
+      return false;
+    }
+    for (int i = 0; i < kImportPageCount; ++i) {
+      char name[64];
+      snprintf(name, sizeof(name), "Page %i.jpg", i + 1);
+      BenchGeneratePage(&buffer[0], buffer.size(), number * kImportPageCount + i, 1600, 2400);
+      BenchWriteStoredRarEntry(file, name, &buffer[0], buffer.size(), false);
+    }
+    BenchWriteStoredRarEntry(file, "ComicInfo.xml", (const unsigned char*)info, infoLength, false);
+    return BenchCloseStoredRar(file);
+  }
+  zipFile file = zipOpen64(path, APPEND_STATUS_CREATE);
+  if (file == NULL) {
+    return false;
+  }
+  for (int i = 0; success && (i <= kImportPageCount); ++i) {
+    char name[64];
+    const void* bytes = &buffer[0];
+    unsigned int size = (unsigned int)buffer.size();
+    if (i < kImportPageCount) {
+      snprintf(name, sizeof(name), "Page %i.jpg", i + 1);
+      BenchGeneratePage(&buffer[0], buffer.size(), number * kImportPageCount + i, 1600, 2400);
+    } else {
+      snprintf(name, sizeof(name), "ComicInfo.xml");
+      bytes = info;
+      size = infoLength;
+    }
+    success = (zipOpenNewFileInZip64(file, name, NULL, NULL, 0, NULL, 0, NULL, 0, 0, 0) == ZIP_OK) &&
+              (zipWriteInFileInZip(file, bytes, size) == ZIP_OK) &&
+              (zipCloseFileInZip(file) == ZIP_OK);
+  }
+  return (zipClose(file, NULL) == ZIP_OK) && success;
+}
+
+// What the import keeps from a comic, which both ways must find identical
+struct ImportResult {
+  std::vector<char> cover;
+  std::vector<char> info;
+  std::vector<DirectoryCachePage> pages;
+};
+
+struct ImportContext {
+  ImportResult* result;
+  const std::vector<long>* pageForEntry;
+  long cover;
+  long info;
+};
+
+static void _ImportEntry(void* context, size_t index, const void* bytes, size_t length) {
+  ImportContext* import = (ImportContext*)context;
+  long page = (*import->pageForEntry)[index];
+  if (page >= 0) {
+    DirectoryCachePage* item = &import->result->pages[page];
+    ImageHeaderFormat format;
+    if (!GetImageInfoFromHeader(bytes, length, &format, &item->width, &item->height)) {
+      item->width = 0;
+      item->height = 0;
+    }
+    item->imageFormat = format;
+  }
+  if ((long)index == import->cover) {
+    import->result->cover.assign((const char*)bytes, (const char*)bytes + length);
+  } else if ((long)index == import->info) {
+    import->result->info.assign((const char*)bytes, (const char*)bytes + length);
+  }
+}
+
+// Lists the archive and sorts its pages like _ImportComicArchive() in Library.m
+static bool _ListImportPages(ArchiveReader* reader, std::vector<size_t>* pages, long* info) {
+  std::vector<const char*> names;
+  std::vector<size_t> indexes;
+  *info = -1;
+  for (size_t i = 0; i < ArchiveReaderGetEntryCount(reader); ++i) {
+    const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, i);
+    if (entry->isDirectory) {
+      continue;
+    }
+    if (_IsImageName(entry->name)) {
+      names.push_back(entry->name);
+      indexes.push_back(i);
+    } else if (!strcasecmp(entry->name, "ComicInfo.xml")) {
+      *info = i;
+    }
+  }
+  std::vector<size_t> order(names.size() + 1);
+  if (names.empty() || !SortKeySortNames(&names[0], names.size(), &order[0])) {
+    return false;
+  }
+  pages->resize(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    (*pages)[i] = indexes[order[i]];
+  }
+  return true;
+}
+
+static bool _WriteImportManifest(ArchiveReader* reader, const std::vector<size_t>& pages, ImportResult* result, const char* cachePath, const DirectoryCacheKey* key) {
+  DirectoryCacheContents contents;
+  memset(&contents, 0, sizeof(contents));
+  std::vector<unz_entry> entries;
+  std::string names;
+  if (ArchiveReaderGetFormat(reader) == kArchiveReaderFormat_ZIP) {
+    contents.format = kDirectoryCacheFormat_ZIP;
+    contents.list = *ArchiveReaderGetZIPEntryList(reader);
+  } else {
+    contents.format = kDirectoryCacheFormat_RAR;
+    entries.resize(pages.size());
+    for (size_t i = 0; i < pages.size(); ++i) {
+      entries[i].name_offset = names.size();
+      entries[i].size_filename = strlen(ArchiveReaderGetEntry(reader, pages[i])->name);
+      names.append(ArchiveReaderGetEntry(reader, pages[i])->name);
+      names.push_back(0);
+      result->pages[i].entry = i;
+    }
+    contents.list.entries = &entries[0];
+    contents.list.number_entry = entries.size();
+    contents.list.names = &names[0];
+  }
+  contents.pageCount = result->pages.size();
+  contents.pages = &result->pages[0];
+  return DirectoryCacheWrite(cachePath, key, &contents);
+}
+
+// Before: the page manifest is written with its own probing pass, then the cover and ComicInfo.xml are each read
+// through the reader (which for RAR scans the archive again up to them) and the first comic of every collection
+// is opened again from its manifest to read the cover a second time for the collection thumbnail
+static bool _ImportComicMultiPass(const char* path, const char* cachePath, bool collectionCover, ImportResult* result) {
+  DirectoryCacheKey key;
+  ArchiveReader* reader = ArchiveReaderOpen(path);
+  if ((reader == NULL) || !DirectoryCacheGetKey(path, &key)) {
+    return false;
+  }
+  std::vector<size_t> pages;
+  long info;
+  bool success = _ListImportPages(reader, &pages, &info);
+  if (success) {
+    std::vector<long> pageForEntry(ArchiveReaderGetEntryCount(reader) + 1, -1);
+    std::vector<unsigned char> selection(pageForEntry.size(), 0);
+    result->pages.assign(pages.size(), DirectoryCachePage());
+    for (size_t i = 0; i < pages.size(); ++i) {
+      pageForEntry[pages[i]] = i;
+      selection[pages[i]] = 1;
+      result->pages[i].entry = pages[i];
+    }
+    ImportContext context = {result, &pageForEntry, -1, -1};
+    std::vector<char> buffer(kImageHeaderProbeSize);
+    success = ArchiveReaderReadEntryPrefixes(reader, (const bool*)&selection[0], &buffer[0], buffer.size(), _ImportEntry, &context) &&
+              _WriteImportManifest(reader, pages, result, cachePath, &key);
+  }
+  for (int i = 0; success && (i < 2); ++i) {
+    long index = i ? info : (long)pages[0];
+    if (index >= 0) {
+      std::vector<char>* data = i ? &result->info : &result->cover;
+      data->resize((size_t)ArchiveReaderGetEntry(reader, index)->size + 1);
+      success = ArchiveReaderReadEntry(reader, index, &(*data)[0], data->size() - 1);
+      data->resize(data->size() - 1);
+    }
+  }
+  ArchiveReaderClose(reader);
+  if (success && collectionCover) {
+    std::vector<char> buffer;
+    unsigned int width;
+    unsigned int height;
+    BenchCase benchCase = {"", path, result->pages.size() && (ArchiveReaderDetectFormat(path) == kArchiveReaderFormat_RAR) ? kArchiveFormat_RAR : kArchiveFormat_ZIP};
+    success = _OpenFirstPageFromManifest(&benchCase, cachePath, &buffer, &width, &height) && (buffer.size() - 1 == result->cover.size());
+  }
+  return success;
+}
+
+// After: a single ArchiveReaderReadEntries() pass reads the cover and ComicInfo.xml entirely and the header of the
+// other pages, and the collection thumbnail reuses the cover
+static bool _ImportComicSinglePass(const char* path, const char* cachePath, ImportResult* result) {
+  DirectoryCacheKey key;
+  ArchiveReader* reader = ArchiveReaderOpen(path);
+  if ((reader == NULL) || !DirectoryCacheGetKey(path, &key)) {
+    return false;
+  }
+  std::vector<size_t> pages;
+  long info;
+  bool success = _ListImportPages(reader, &pages, &info);
+  if (success) {
+    size_t count = ArchiveReaderGetEntryCount(reader);
+    std::vector<long> pageForEntry(count + 1, -1);
+    std::vector<size_t> limits(count + 1, 0);
+    result->pages.assign(pages.size(), DirectoryCachePage());
+    for (size_t i = 0; i < pages.size(); ++i) {
+      pageForEntry[pages[i]] = i;
+      limits[pages[i]] = i ? kImageHeaderProbeSize : SIZE_MAX;
+      result->pages[i].entry = pages[i];
+    }
+    if (info >= 0) {
+      limits[info] = SIZE_MAX;
+    }
+    ImportContext context = {result, &pageForEntry, (long)pages[0], info};
+    success = ArchiveReaderReadEntries(reader, &limits[0], _ImportEntry, &context) &&
+              _WriteImportManifest(reader, pages, result, cachePath, &key);
+  }
+  ArchiveReaderClose(reader);
+  return success;
+}
+
+static bool _SameImportResults(const ImportResult& a, const ImportResult& b) {
+  if ((a.cover != b.cover) || (a.info != b.info) || (a.pages.size() != b.pages.size())) {
+    return false;
+  }
+  for (size_t i = 0; i < a.pages.size(); ++i) {
+    if ((a.pages[i].width != b.pages[i].width) || (a.pages[i].height != b.pages[i].height) || (a.pages[i].imageFormat != b.pages[i].imageFormat)) {
+      return false;
+    }
+  }
+  return !a.cover.empty() && !a.info.empty();
+}
+
+// Returns the number of failed runs
+int BenchRunImport(const BenchOptions* options) {
+  std::string directory = options->workDirectory + "/library";
+  std::string cacheDirectory = options->workDirectory + "/directories";
+  if (((mkdir(options->workDirectory.c_str(), 0755) < 0) && (errno != EEXIST)) ||
+      ((mkdir(directory.c_str(), 0755) < 0) && (errno != EEXIST)) ||
+      ((mkdir(cacheDirectory.c_str(), 0755) < 0) && (errno != EEXIST))) {
+    fprintf(stderr, "Failed creating \"%s\": %s\n", directory.c_str(), strerror(errno));
+    return 1;
+  }
+  std::vector<std::string> paths;
+  std::vector<std::string> cachePaths;
+  bool success = true;
+  for (int i = 0; success && (i < options->importCount); ++i) {
+    char name[64];
+    snprintf(name, sizeof(name), "/Saga %i.%s", i + 1, i % 2 ? "cbr" : "cbz");
+    paths.push_back(directory + name);
+    success = _WriteImportComic(paths.back().c_str(), i % 2, i + 1);
+    DirectoryCacheKey key;
+    if (success && DirectoryCacheGetKey(paths.back().c_str(), &key)) {
+      DirectoryCacheGetFileName(&key, name, sizeof(name));
+      cachePaths.push_back(cacheDirectory + "/" + name);
+    } else {
+      success = false;
+    }
+  }
+  double multiSeconds = 0.0;
+  double singleSeconds = 0.0;
+  for (int i = 0; success && (i < options->iterations); ++i) {
+    std::vector<ImportResult> multiResults(paths.size());
+    double start = BenchNow();
+    for (size_t j = 0; success && (j < paths.size()); ++j) {
+      success = _ImportComicMultiPass(paths[j].c_str(), cachePaths[j].c_str(), j % kImportCollectionSize == 0, &multiResults[j]);
+    }
+    double seconds = BenchNow() - start;
+    multiSeconds = (i == 0) || (seconds < multiSeconds) ? seconds : multiSeconds;
+
+    for (size_t j = 0; j < cachePaths.size(); ++j) {
+      unlink(cachePaths[j].c_str());
+    }
+    start = BenchNow();
+    for (size_t j = 0; success && (j < paths.size()); ++j) {
+      ImportResult result;
+      success = _ImportComicSinglePass(paths[j].c_str(), cachePaths[j].c_str(), &result) && _SameImportResults(result, multiResults[j]);
+    }
+    seconds = BenchNow() - start;
+    singleSeconds = (i == 0) || (seconds < singleSeconds) ? seconds : singleSeconds;
+    for (size_t j = 0; j < cachePaths.size(); ++j) {
+      unlink(cachePaths[j].c_str());
+    }
+  }
+  printf(",\n  \"import\": {\"comics\": %i, \"pages_per_comic\": %i, \"multi_pass_s\": %.3f, \"single_pass_s\": %.3f, \"multi_pass_comics_per_s\": %.1f, \"single_pass_comics_per_s\": %.1f, \"speedup\": %.2f, \"status\": \"%s\"}",
+         options->importCount, kImportPageCount, multiSeconds, singleSeconds, multiSeconds > 0.0 ? paths.size() / multiSeconds : 0.0,
+         singleSeconds > 0.0 ? paths.size() / singleSeconds : 0.0, singleSeconds > 0.0 ? multiSeconds / singleSeconds : 0.0, success ? "ok" : "failed");
+  for (size_t i = 0; i < paths.size(); ++i) {
+    unlink(paths[i].c_str());
+  }
+  rmdir(directory.c_str());
+  rmdir(cacheDirectory.c_str());
+  return success ? 0 : 1;
+}
+
+// Cover
+
+#define kCoverPageSize 256  // Small so the selection dominates
+
+// Before: every entry name becomes a string and each page is compared with the best one so far
+static long _FindCoverWithNaturalCompare(const ArchiveReader* reader) {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < ArchiveReaderGetEntryCount(reader); ++i) {
+    names.push_back(ArchiveReaderGetEntry(reader, i)->name);
+  }
+  long best = -1;
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (!BenchHasSuffix(names[i], "/") && _IsImageName(names[i].c_str()) && ((best < 0) || (_NaturalCompare(names[i].c_str(), names[best].c_str()) < 0))) {
+      best = (long)i;
+    }
+  }
+  return best;
+}
+
+// Same manifest as importPages:readingFiles: in MiniZip.m with the pages in natural order
+static bool _WriteCoverManifest(const ArchiveReader* reader, const char* cachePath, const DirectoryCacheKey* key) {
+  std::vector<const char*> names;
+  std::vector<size_t> indexes;
+  for (size_t i = 0; i < ArchiveReaderGetEntryCount(reader); ++i) {
+    const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, i);
+    if (!entry->isDirectory && _IsImageName(entry->name)) {
+      names.push_back(entry->name);
+      indexes.push_back(i);
+    }
+  }
+  std::vector<size_t> order(names.size() + 1);
+  std::vector<DirectoryCachePage> pages(names.size() + 1);
+  if (!SortKeySortNames(names.empty() ? NULL : &names[0], names.size(), &order[0])) {
+    return false;
+  }
+  DirectoryCacheContents contents;
+  memset(&contents, 0, sizeof(contents));
+  contents.format = kDirectoryCacheFormat_ZIP;
+  contents.list = *ArchiveReaderGetZIPEntryList(reader);
+  contents.pages = &pages[0];
+  long cover = ArchiveReaderFindCover(reader);
+  for (size_t i = 0; i < names.size(); ++i) {
+    pages[i].entry = indexes[order[i]];
+    if ((long)pages[i].entry == cover) {
+      contents.coverPage = i;
+    }
+  }
+  contents.pageCount = names.size();
+  return DirectoryCacheWrite(cachePath, key, &contents);
+}
+
+// After opening from the manifest: returns the cover entry index without looking at the other pages
+static long _FindCoverInManifest(const char* cachePath, const DirectoryCacheKey* key) {
+  DirectoryCacheContents contents;
+  if (!DirectoryCacheRead(cachePath, key, &contents)) {
+    return -1;
+  }
+  long cover = contents.pageCount ? (long)contents.pages[contents.coverPage].entry : -1;
+  DirectoryCacheFreeContents(&contents);
+  return cover;
+}
+
+// Returns true if names containing "cover" win over the page order and invisible or non-image files are skipped
+static bool _CheckCoverNames(const char* path) {
+  static const char* names[] = {"Comic/Page 001.jpg", "Comic/000.jpg", ".hidden/cover.jpg", "Comic/cover.txt", "Comic/Discover.jpg", "Comic/Extras/Batman - Cover B.png", "Comic/Extras/Cover A.jpg"};
+  zipFile file = zipOpen64(path, APPEND_STATUS_CREATE);
+  if (file == NULL) {
+    return false;
+  }
+  bool success = true;
+  unsigned char buffer[kCoverPageSize];
+  for (size_t i = 0; success && (i < sizeof(names) / sizeof(names[0])); ++i) {
+    BenchGeneratePage(buffer, sizeof(buffer), (unsigned int)i + 1, 1600, 2400);
+    success = (zipOpenNewFileInZip64(file, names[i], NULL, NULL, 0, NULL, 0, NULL, 0, 0, 0) == ZIP_OK) &&
+              (zipWriteInFileInZip(file, buffer, sizeof(buffer)) == ZIP_OK) && (zipCloseFileInZip(file) == ZIP_OK);
+  }
+  success = (zipClose(file, NULL) == ZIP_OK) && success;
+  ArchiveReader* reader = success ? ArchiveReaderOpen(path) : NULL;
+  if (reader == NULL) {
+    return false;
+  }
+  long cover = ArchiveReaderFindCover(reader);
+  success = (cover >= 0) && !strcmp(ArchiveReaderGetEntry(reader, cover)->name, "Comic/Extras/Batman - Cover B.png");  // "b" < "c" once case is ignored
+  ArchiveReaderClose(reader);
+  return success;
+}
+
+// Returns the number of failed runs
+int BenchRunCover(const BenchOptions* options) {
+  std::string path = options->workDirectory + "-cover.zip";
+  std::string cachePath = options->workDirectory + "-cover.dir";
+  DirectoryCacheKey key;
+  bool written = BenchWriteZipCorpus(path.c_str(), 0, options->coverCount, kCoverPageSize, false) && DirectoryCacheGetKey(path.c_str(), &key);
+  ArchiveReader* reader = written ? ArchiveReaderOpen(path.c_str()) : NULL;
+  written = reader && _WriteCoverManifest(reader, cachePath.c_str(), &key);
+  int failures = 0;
+  long expected = reader ? _FindCoverWithNaturalCompare(reader) : -1;
+  printf(",\n  \"cover\": {\"pages\": %i, \"runs\": [\n", options->coverCount);
+  for (int i = 0; i < 3; ++i) {
+    static const char* methods[] = {"natural_compare", "sort_keys", "manifest_read"};
+    double best = 0.0;
+    bool success = written && (expected >= 0);
+    for (int j = 0; success && (j < options->iterations); ++j) {
+      double start = BenchNow();
+      long cover = i == 0 ? _FindCoverWithNaturalCompare(reader) : i == 1 ? ArchiveReaderFindCover(reader) : _FindCoverInManifest(cachePath.c_str(), &key);
+      double seconds = BenchNow() - start;
+      success = cover == expected;
+      if ((j == 0) || (seconds < best)) {
+        best = seconds;
+      }
+    }
+    if (!success) {
+      failures += 1;
+    }
+    printf("    {\"method\": \"%s\", \"ms\": %.4f, \"status\": \"%s\"}%s\n", methods[i], best * 1000.0, success ? "ok" : "failed", i < 2 ? "," : "");
+  }
+  if (reader) {
+    ArchiveReaderClose(reader);
+  }
+  unlink(path.c_str());
+  bool named = _CheckCoverNames(path.c_str());
+  if (!named) {
+    failures += 1;
+  }
+  printf("  ], \"naming\": \"%s\"}", named ? "ok" : "failed");
+  unlink(path.c_str());
+  unlink(cachePath.c_str());
+  return failures;
+}
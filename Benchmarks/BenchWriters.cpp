@@ -0,0 +1,633 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// With --zip-stream, ZIP cases are also copied through a zipStream writing to
+// a pipe-like sink, once passing the compressed entries through and once
+// recompressing them, and each copy is read back with unzip.c.
+// With --deflate MB, a comic-like input set of MB megabytes is also written
+// to a ZIP with zipWriteInFileInZip and with zipWriteEntriesParallel on 1 to
+// 8 threads (or the number of processors), and each archive is read back
+// with unzReadCurrentFile and compared with the input.
+// With --zstd MB, the --deflate input set is also written once deflated and once
+// as zstd (method 93) entries, and both archives are decoded with the streaming
+// unzReadCurrentFile and the in-memory unzReaderExtractEntry paths to compare
+// their speed and compression ratio, after checking they read back the input.
+// With --salvage MB, ZIPs of MB megabytes of stored pages written by zip.c and
+// by zipStream are cut in their last page like an interrupted upload, then the
+// time to make them readable with unzRepair (rewriting the archive) is compared
+// with unzReaderOpenSalvage (scanning the local headers in place), and every
+// salvaged entry is read back with its CRC checked.
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "ArchiveBench.h"
+
+#include "zip.h"
+#include "unzip.h"
+#include "unzreader.h"
+#include "zipdeflate.h"
+#include "zipstream.h"
+#include "mztools.h"
+
+// Streaming writer
+
+struct ZipStreamSink {
+  int fd;
+  long long calls;
+  long long bytes;
+};
+
+static int ZCALLBACK _ZipStreamWrite(voidpf opaque, const void* buf, uLong size) {
+  ZipStreamSink* sink = (ZipStreamSink*)opaque;
+  const char* bytes = (const char*)buf;
+  sink->calls += 1;
+  sink->bytes += size;
+  while (size > 0) {
+    ssize_t count = write(sink->fd, bytes, size);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    bytes += count;
+    size -= count;
+  }
+  return 0;
+}
+
+// Streams every entry of the archive to the sink, either passing the compressed data through or inflating then deflating it again
+static bool _StreamZipCopy(const char* path, ZipStreamSink* sink, bool recompress, long long* heapBytes) {
+  unzFile source = unzOpen64(path);
+  if (source == NULL) {
+    return false;
+  }
+  std::vector<char> buffer(kDefaultPageSize);
+  long long heapStart = BenchHeapBytesInUse();
+  zipStream stream = zipStreamOpen(_ZipStreamWrite, sink);
+  bool success = (stream != NULL) && (unzGoToFirstFile(source) == UNZ_OK);
+  while (success) {
+    char name[256];
+    unz_file_info64 info;
+    int method;
+    int level;
+    success = unzGetCurrentFileInfo64(source, &info, name, sizeof(name), NULL, 0, NULL, 0) == UNZ_OK;
+    bool raw = !recompress || (info.uncompressed_size >= 0xffffffff);  // Entries of unknown size must stay under 4 GiB
+    success = success && (unzOpenCurrentFile2(source, &method, &level, raw ? 1 : 0) == UNZ_OK);
+    if (!success) {
+      break;
+    }
+    zip_fileinfo fileInfo;
+    memset(&fileInfo, 0, sizeof(fileInfo));
+    fileInfo.dosDate = info.dosDate;
+    if (!raw) {
+      success = zipStreamOpenNewFile(stream, name, &fileInfo, Z_DEFLATED, Z_DEFAULT_COMPRESSION) == ZIP_OK;
+    } else {
+      success = zipStreamOpenNewFileRaw(stream, name, &fileInfo, method, level, info.crc, info.compressed_size, info.uncompressed_size) == ZIP_OK;
+    }
+    while (success) {
+      int count = unzReadCurrentFile(source, &buffer[0], (unsigned int)buffer.size());
+      if (count <= 0) {
+        success = count == 0;
+        break;
+      }
+      success = zipStreamWriteInFile(stream, &buffer[0], count) == ZIP_OK;
+    }
+    success = (unzCloseCurrentFile(source) == UNZ_OK) && success;
+    success = success && (zipStreamCloseFile(stream) == ZIP_OK);
+    if (success) {
+      int error = unzGoToNextFile(source);
+      if (error == UNZ_END_OF_LIST_OF_FILE) {
+        break;
+      }
+      success = error == UNZ_OK;
+    }
+  }
+  if (heapBytes) {
+    *heapBytes = BenchHeapBytesInUse() - heapStart;
+  }
+  if (stream) {
+    success = (zipStreamClose(stream, NULL) == ZIP_OK) && success;
+  }
+  unzClose(source);
+  return success;
+}
+
+// Reads every entry of the streamed archive with unzip.c and compares its name, size and CRC with the source
+static bool _VerifyZipStreamCopy(const char* sourcePath, const char* path) {
+  unzFile source = unzOpen64(sourcePath);
+  unzFile file = unzOpen64(path);
+  bool success = (source != NULL) && (file != NULL);
+  unz_global_info64 sourceInfo;
+  unz_global_info64 info;
+  success = success && (unzGetGlobalInfo64(source, &sourceInfo) == UNZ_OK) && (unzGetGlobalInfo64(file, &info) == UNZ_OK) &&
+            (sourceInfo.number_entry == info.number_entry) && (unzGoToFirstFile(source) == UNZ_OK) && (unzGoToFirstFile(file) == UNZ_OK);
+  std::vector<char> buffer(kDefaultPageSize);
+  for (ZPOS64_T i = 0; success && (i < info.number_entry); ++i) {
+    char sourceName[256];
+    char name[256];
+    unz_file_info64 sourceFileInfo;
+    unz_file_info64 fileInfo;
+    success = (unzGetCurrentFileInfo64(source, &sourceFileInfo, sourceName, sizeof(sourceName), NULL, 0, NULL, 0) == UNZ_OK) &&
+              (unzGetCurrentFileInfo64(file, &fileInfo, name, sizeof(name), NULL, 0, NULL, 0) == UNZ_OK) && !strcmp(sourceName, name) &&
+              (sourceFileInfo.crc == fileInfo.crc) && (sourceFileInfo.uncompressed_size == fileInfo.uncompressed_size) &&
+              (unzOpenCurrentFile(file) == UNZ_OK);
+    ZPOS64_T total = 0;
+    while (success) {
+      int count = unzReadCurrentFile(file, &buffer[0], (unsigned int)buffer.size());
+      if (count <= 0) {
+        success = count == 0;
+        break;
+      }
+      total += count;
+    }
+    if (success) {
+      success = (unzCloseCurrentFile(file) == UNZ_OK) && (total == fileInfo.uncompressed_size);  // Also checks the CRC
+    }
+    if (success && (i + 1 < info.number_entry)) {
+      success = (unzGoToNextFile(source) == UNZ_OK) && (unzGoToNextFile(file) == UNZ_OK);
+    }
+  }
+  if (file) {
+    unzClose(file);
+  }
+  if (source) {
+    unzClose(source);
+  }
+  return success;
+}
+
+CaseStatus BenchZipStreamCase(const BenchCase* benchCase, const BenchOptions* options, BenchResult* result) {
+  char path[] = "/tmp/archivebench-XXXXXX";
+  ZipStreamSink sink;
+  sink.fd = mkstemp(path);
+  if (sink.fd < 0) {
+    return kCaseStatus_OpenFailed;
+  }
+  CaseStatus status = kCaseStatus_OK;
+  for (int recompress = 0; (status == kCaseStatus_OK) && (recompress < 2); ++recompress) {
+    for (int i = 0; (status == kCaseStatus_OK) && (i < options->iterations); ++i) {
+      if ((ftruncate(sink.fd, 0) < 0) || (lseek(sink.fd, 0, SEEK_SET) < 0)) {
+        status = kCaseStatus_OpenFailed;
+        break;
+      }
+      sink.calls = 0;
+      sink.bytes = 0;
+      long long heapBytes = 0;
+      double start = BenchNow();
+      bool success = _StreamZipCopy(benchCase->path.c_str(), &sink, recompress, &heapBytes);
+      double seconds = BenchNow() - start;
+      if (!success) {
+        status = kCaseStatus_DecodeFailed;
+      } else if ((i == 0) && !_VerifyZipStreamCopy(benchCase->path.c_str(), path)) {
+        status = kCaseStatus_CRCFailed;
+      }
+      double* best = recompress ? &result->zipStreamDeflateSeconds : &result->zipStreamRawSeconds;
+      if ((i == 0) || (seconds < *best)) {
+        *best = seconds;
+      }
+      if (!recompress) {
+        result->zipStreamBytes = sink.bytes;
+        result->zipStreamSinkCalls = sink.calls;
+        result->zipStreamHeapBytes = std::max(result->zipStreamHeapBytes, heapBytes);
+      }
+    }
+  }
+  close(sink.fd);
+  unlink(path);
+  return status;
+}
+
+// Parallel deflate
+
+#define kDeflateScanSize (8 * 1024 * 1024)
+#define kDeflatePagesPerScan 8
+
+struct DeflateInput {
+  std::vector<std::vector<unsigned char> > buffers;
+  std::vector<std::string> names;
+  std::vector<zip_deflate_entry> entries;
+  zip_fileinfo info;
+  long long bytes;
+};
+
+// Comic-like input set of mostly incompressible JPEG pages and large compressible
+// BMP scans, cycling through a few distinct buffers to keep memory bounded
+static void _GenerateDeflateInput(const BenchOptions* options, int megabytes, DeflateInput* input) {
+  input->buffers.resize(4 + 2 * kDeflatePagesPerScan);
+  for (size_t i = 0; i < input->buffers.size(); ++i) {
+    std::vector<unsigned char>& buffer = input->buffers[i];
+    if (i < 4) {
+      buffer.resize(kDeflateScanSize);
+      BenchGenerateBitmapPage(&buffer[0], buffer.size(), (unsigned int)i + 1);
+    } else {
+      buffer.resize(options->pageSize);
+      BenchGeneratePage(&buffer[0], buffer.size(), (unsigned int)i + 1, 1600, 2400);
+    }
+  }
+  memset(&input->info, 0, sizeof(input->info));
+  input->info.tmz_date.tm_year = 2011;
+  input->info.tmz_date.tm_mday = 1;
+  input->bytes = 0;
+  long long target = (long long)megabytes * 1024 * 1024;
+  for (int i = 0; input->bytes < target; ++i) {
+    char name[64];
+    const std::vector<unsigned char>* buffer;
+    if (i % (kDeflatePagesPerScan + 1) == 0) {
+      snprintf(name, sizeof(name), "Scans/Scan %04i.bmp", i / (kDeflatePagesPerScan + 1) + 1);
+      buffer = &input->buffers[(i / (kDeflatePagesPerScan + 1)) % 4];
+    } else {
+      snprintf(name, sizeof(name), "Comic/Page %04i.jpg", i + 1);
+      buffer = &input->buffers[4 + i % (2 * kDeflatePagesPerScan)];
+    }
+    input->names.push_back(name);
+    zip_deflate_entry entry;
+    entry.zipfi = &input->info;
+    entry.buf = &(*buffer)[0];
+    entry.len = buffer->size();
+    entry.method = Z_DEFLATED;
+    input->entries.push_back(entry);
+    input->bytes += entry.len;
+  }
+  for (size_t i = 0; i < input->entries.size(); ++i) {
+    input->entries[i].filename = input->names[i].c_str();  // Names don't move anymore
+  }
+}
+
+// Threads is 0 for the regular zipWriteInFileInZip() path
+static bool _WriteDeflateArchive(const char* path, const DeflateInput* input, int threads) {
+  zipFile file = zipOpen64(path, APPEND_STATUS_CREATE);
+  if (file == NULL) {
+    return false;
+  }
+  int error = ZIP_OK;
+  if (threads > 0) {
+    error = zipWriteEntriesParallel(file, &input->entries[0], input->entries.size(), Z_DEFAULT_COMPRESSION, threads);
+  } else {
+    for (size_t i = 0; (error == ZIP_OK) && (i < input->entries.size()); ++i) {
+      const zip_deflate_entry* entry = &input->entries[i];
+      error = zipOpenNewFileInZip64(file, entry->filename, entry->zipfi, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION, 0);
+      if (error == ZIP_OK) {
+        error = zipWriteInFileInZip(file, entry->buf, (unsigned int)entry->len);
+      }
+      if (error == ZIP_OK) {
+        error = zipCloseFileInZip(file);
+      }
+    }
+  }
+  return (zipClose(file, NULL) == ZIP_OK) && (error == ZIP_OK);
+}
+
+// Reads the archive back with the streaming unzip.c path the app uses
+static bool _VerifyDeflateArchive(const char* path, const DeflateInput* input) {
+  unzFile file = unzOpen64(path);
+  if (file == NULL) {
+    return false;
+  }
+  std::vector<unsigned char> buffer(kDeflateScanSize + 1);
+  bool success = unzGoToFirstFile(file) == UNZ_OK;
+  size_t index = 0;
+  for (; success && (index < input->entries.size()); ++index) {
+    const zip_deflate_entry* entry = &input->entries[index];
+    char name[256];
+    unz_file_info64 info;
+    success = (unzGetCurrentFileInfo64(file, &info, name, sizeof(name), NULL, 0, NULL, 0) == UNZ_OK) && !strcmp(name, entry->filename) &&
+              (info.uncompressed_size == entry->len) && (unzOpenCurrentFile(file) == UNZ_OK);
+    if (success) {
+      int length = unzReadCurrentFile(file, &buffer[0], (unsigned int)buffer.size());
+      success = (length == (int)entry->len) && !memcmp(&buffer[0], entry->buf, length);
+      success = (unzCloseCurrentFile(file) == UNZ_OK) && success;  // Also checks the CRC
+    }
+    if (success && (index + 1 < input->entries.size())) {
+      success = unzGoToNextFile(file) == UNZ_OK;
+    }
+  }
+  success = success && (unzGoToNextFile(file) == UNZ_END_OF_LIST_OF_FILE);
+  unzClose(file);
+  return success;
+}
+
+// Returns the number of failed runs
+int BenchRunDeflateWriter(const BenchOptions* options) {
+  DeflateInput input;
+  _GenerateDeflateInput(options, options->deflateMegabytes, &input);
+  char path[] = "/tmp/archivebench-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd >= 0) {
+    close(fd);
+  }
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  std::vector<int> threads;
+  threads.push_back(0);
+  for (int count = 1; count <= std::max((long)kMaxParallelThreads, processors); count *= 2) {
+    threads.push_back(count);
+  }
+  printf(",\n  \"deflate_writer\": {\"input_bytes\": %lli, \"entries\": %lu, \"processors\": %li, \"runs\": [\n", input.bytes, (unsigned long)input.entries.size(), processors);
+  double serialSeconds = 0.0;
+  int failures = 0;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    double best = 0.0;
+    bool success = fd >= 0;
+    for (int j = 0; success && (j < options->iterations); ++j) {
+      double start = BenchNow();
+      success = _WriteDeflateArchive(path, &input, threads[i]);
+      double seconds = BenchNow() - start;
+      if ((j == 0) || (seconds < best)) {
+        best = seconds;
+      }
+    }
+    struct stat info;
+    long long outputBytes = success && (stat(path, &info) == 0) ? info.st_size : 0;
+    success = success && _VerifyDeflateArchive(path, &input);
+    if (i == 0) {
+      serialSeconds = best;
+    }
+    if (!success) {
+      failures += 1;
+    }
+    printf("    {\"writer\": \"%s\", \"threads\": %i, \"seconds\": %.3f, \"mb_per_s\": %.1f, \"speedup\": %.2f, \"output_bytes\": %lli, \"status\": \"%s\"}%s\n",
+           threads[i] ? "zipWriteEntriesParallel" : "zipWriteInFileInZip", std::max(threads[i], 1), best,
+           best > 0.0 ? (double)input.bytes / (1024.0 * 1024.0) / best : 0.0, best > 0.0 ? serialSeconds / best : 0.0,
+           outputBytes, success ? "ok" : "failed", i + 1 < threads.size() ? "," : "");
+  }
+  printf("  ]}");
+  unlink(path);
+  return failures;
+}
+
+// Zstd versus deflate
+
+static bool _WriteArchiveWithMethod(const char* path, const DeflateInput* input, int method) {
+  zipFile file = zipOpen64(path, APPEND_STATUS_CREATE);
+  if (file == NULL) {
+    return false;
+  }
+  int error = ZIP_OK;
+  for (size_t i = 0; (error == ZIP_OK) && (i < input->entries.size()); ++i) {
+    const zip_deflate_entry* entry = &input->entries[i];
+    error = zipOpenNewFileInZip64(file, entry->filename, entry->zipfi, NULL, 0, NULL, 0, NULL, method, Z_DEFAULT_COMPRESSION, 0);
+    if (error == ZIP_OK) {
+      error = zipWriteInFileInZip(file, entry->buf, (unsigned int)entry->len);
+    }
+    if (error == ZIP_OK) {
+      error = zipCloseFileInZip(file);
+    }
+  }
+  return (zipClose(file, NULL) == ZIP_OK) && (error == ZIP_OK);
+}
+
+// Decodes every entry with unzReadCurrentFile like the page views
+static bool _DecodeArchiveStreaming(const char* path, unsigned char* buffer, size_t size) {
+  unzFile file = unzOpen64(path);
+  if (file == NULL) {
+    return false;
+  }
+  int error = unzGoToFirstFile(file);
+  while (error == UNZ_OK) {
+    error = unzOpenCurrentFile(file);
+    if (error == UNZ_OK) {
+      while ((error = unzReadCurrentFile(file, buffer, (unsigned int)size)) > 0)
+        ;
+      int closeError = unzCloseCurrentFile(file);  // Checks the CRC
+      error = error == UNZ_OK ? closeError : error;
+    }
+    if (error == UNZ_OK) {
+      error = unzGoToNextFile(file);
+    }
+  }
+  unzClose(file);
+  return error == UNZ_END_OF_LIST_OF_FILE;
+}
+
+// Decodes every entry in one call with unzReaderExtractEntry like ArchiveReader
+static bool _DecodeArchiveInMemory(const char* path, unsigned char* buffer, size_t size) {
+  unzReader reader = unzReaderOpen(path);
+  if (reader == NULL) {
+    return false;
+  }
+  const unz_entry_list* list = unzReaderGetEntryList(reader);
+  bool success = true;
+  for (ZPOS64_T i = 0; success && (i < list->number_entry); ++i) {
+    success = unzReaderExtractEntry(reader, &list->entries[i], buffer, size) == UNZ_OK;
+  }
+  unzReaderClose(reader);
+  return success;
+}
+
+// Returns the number of failed methods
+int BenchRunZstd(const BenchOptions* options) {
+  DeflateInput input;
+  _GenerateDeflateInput(options, options->zstdMegabytes, &input);
+  char path[] = "/tmp/archivebench-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd >= 0) {
+    close(fd);
+  }
+  std::vector<unsigned char> buffer(kDeflateScanSize);
+  const int methods[] = {Z_DEFLATED, Z_ZSTD};
+  double deflateSeconds[2] = {0.0, 0.0};
+  int failures = 0;
+  printf(",\n  \"zstd\": {\"input_bytes\": %lli, \"entries\": %lu, \"methods\": [\n", input.bytes, (unsigned long)input.entries.size());
+  for (int i = 0; i < 2; ++i) {
+    double start = BenchNow();
+    bool success = (fd >= 0) && _WriteArchiveWithMethod(path, &input, methods[i]);
+    double writeSeconds = BenchNow() - start;
+    struct stat info;
+    long long outputBytes = success && (stat(path, &info) == 0) ? info.st_size : 0;
+    success = success && _VerifyDeflateArchive(path, &input);
+    double seconds[2] = {0.0, 0.0};
+    for (int j = 0; success && (j < options->iterations); ++j) {
+      for (int k = 0; success && (k < 2); ++k) {
+        start = BenchNow();
+        success = k ? _DecodeArchiveInMemory(path, &buffer[0], buffer.size()) : _DecodeArchiveStreaming(path, &buffer[0], buffer.size());
+        double elapsed = BenchNow() - start;
+        seconds[k] = (j == 0) || (elapsed < seconds[k]) ? elapsed : seconds[k];
+      }
+    }
+    if (i == 0) {
+      deflateSeconds[0] = seconds[0];
+      deflateSeconds[1] = seconds[1];
+    }
+    if (!success) {
+      failures += 1;
+    }
+    double megabytes = (double)input.bytes / (1024.0 * 1024.0);
+    printf("    {\"method\": \"%s\", \"output_bytes\": %lli, \"ratio\": %.3f, \"write_s\": %.3f, \"stream_decode_s\": %.3f, \"stream_mb_per_s\": %.1f, \"stream_speedup\": %.2f,"
+           " \"memory_decode_s\": %.3f, \"memory_mb_per_s\": %.1f, \"memory_speedup\": %.2f, \"status\": \"%s\"}%s\n",
+           i ? "zstd" : "deflate", outputBytes, input.bytes > 0 ? (double)outputBytes / input.bytes : 0.0, writeSeconds,
+           seconds[0], seconds[0] > 0.0 ? megabytes / seconds[0] : 0.0, seconds[0] > 0.0 ? deflateSeconds[0] / seconds[0] : 0.0,
+           seconds[1], seconds[1] > 0.0 ? megabytes / seconds[1] : 0.0, seconds[1] > 0.0 ? deflateSeconds[1] / seconds[1] : 0.0,
+           success ? "ok" : "failed", i == 0 ? "," : "");
+  }
+  printf("  ]}");
+  unlink(path);
+  return failures;
+}
+
+// Salvage
+
+#define kSalvagePageBuffers 8
+
+// Writes MB megabytes of stored JPEG pages like most CBZs, with zip.c (sizes in the local
+// headers) or with zipStream (sizes in data descriptors like CollectionArchive), then cuts
+// the file in the middle of the last page as an interrupted upload would, or only removes
+// the central directory (zip.c only)
+static bool _WriteTruncatedZip(const char* path, const BenchOptions* options, bool descriptors, bool cutInPage, int* completeEntries) {
+  std::vector<std::vector<unsigned char> > pages(kSalvagePageBuffers);
+  for (size_t i = 0; i < pages.size(); ++i) {
+    pages[i].resize(options->pageSize);
+    BenchGeneratePage(&pages[i][0], pages[i].size(), (unsigned int)i + 1, 1600, 2400);
+  }
+  int count = (int)std::max((long long)options->salvageMegabytes * 1024 * 1024 / (long long)options->pageSize, 2LL);
+  zip_fileinfo info;
+  memset(&info, 0, sizeof(info));
+  info.tmz_date.tm_year = 2011;
+  info.tmz_date.tm_mday = 1;
+  bool success = true;
+  if (descriptors) {
+    ZipStreamSink sink = {open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644), 0, 0};
+    zipStream stream = sink.fd >= 0 ? zipStreamOpen(_ZipStreamWrite, &sink) : NULL;
+    success = stream != NULL;
+    for (int i = 0; success && (i < count); ++i) {
+      char name[64];
+      snprintf(name, sizeof(name), "Comic/Page %04i.jpg", i + 1);
+      const std::vector<unsigned char>& page = pages[i % pages.size()];
+      success = (zipStreamOpenNewFile(stream, name, &info, 0, 0) == ZIP_OK) && (zipStreamWriteInFile(stream, &page[0], (unsigned int)page.size()) == ZIP_OK) &&
+                (zipStreamCloseFile(stream) == ZIP_OK);
+    }
+    if (stream) {
+      success = (zipStreamClose(stream, NULL) == ZIP_OK) && success;
+    }
+    if (sink.fd >= 0) {
+      close(sink.fd);
+    }
+  } else {
+    zipFile file = zipOpen64(path, APPEND_STATUS_CREATE);
+    success = file != NULL;
+    for (int i = 0; success && (i < count); ++i) {
+      char name[64];
+      snprintf(name, sizeof(name), "Comic/Page %04i.jpg", i + 1);
+      const std::vector<unsigned char>& page = pages[i % pages.size()];
+      success = (zipOpenNewFileInZip64(file, name, &info, NULL, 0, NULL, 0, NULL, 0, 0, 0) == ZIP_OK) &&
+                (zipWriteInFileInZip(file, &page[0], (unsigned int)page.size()) == ZIP_OK) && (zipCloseFileInZip(file) == ZIP_OK);
+    }
+    if (file) {
+      success = (zipClose(file, NULL) == ZIP_OK) && success;
+    }
+  }
+  unzFile file = success ? unzOpen64(path) : NULL;
+  unz_entry_list list;
+  success = (file != NULL) && (unzGetEntryList(file, &list) == UNZ_OK);
+  if (success) {
+    const unz_entry* last = &list.entries[list.number_entry - 1];
+    ZPOS64_T length = cutInPage ? last->offset_curfile + options->pageSize / 2 : last->offset_curfile + 30 + last->size_filename + last->compressed_size;
+    success = truncate(path, length) == 0;
+    unzFreeEntryList(&list);
+  }
+  if (file) {
+    unzClose(file);
+  }
+  *completeEntries = cutInPage ? count - 1 : count;
+  return success;
+}
+
+// Reads every salvaged entry with its CRC check
+static bool _VerifySalvagedZip(const char* path, int completeEntries) {
+  unzReader reader = unzReaderOpenSalvage(path);
+  if (reader == NULL) {
+    return false;
+  }
+  const unz_entry_list* list = unzReaderGetEntryList(reader);
+  bool success = list->number_entry == (ZPOS64_T)completeEntries;
+  std::vector<unsigned char> buffer;
+  for (ZPOS64_T i = 0; success && (i < list->number_entry); ++i) {
+    buffer.resize((size_t)list->entries[i].uncompressed_size + 1);
+    success = unzReaderExtractEntry(reader, &list->entries[i], &buffer[0], buffer.size()) == UNZ_OK;
+  }
+  unzReaderClose(reader);
+  return success;
+}
+
+// Returns the number of failed archives
+int BenchRunSalvage(const BenchOptions* options) {
+  std::string path = options->workDirectory + "-salvage.zip";
+  std::string repairedPath = options->workDirectory + "-repaired.zip";
+  std::string directoryPath = options->workDirectory + "-repaired.cd";
+  int failures = 0;
+  printf(",\n  \"salvage\": [\n");
+  for (int i = 0; i < 3; ++i) {
+    int completeEntries = 0;
+    bool success = _WriteTruncatedZip(path.c_str(), options, i == 2, i > 0, &completeEntries);
+    struct stat info;
+    long long inputBytes = success && (stat(path.c_str(), &info) == 0) ? info.st_size : 0;
+
+    // unzRepair() cannot size entries with data descriptors and gives up on a truncated entry
+    double repairSeconds = 0.0;
+    long long repairedEntries = -1;
+    bool repaired = true;
+    for (int j = 0; success && repaired && (i < 2) && (j < options->iterations); ++j) {
+      double start = BenchNow();
+      uLong recovered = 0;
+      uLong bytes = 0;
+      repaired = unzRepair(path.c_str(), repairedPath.c_str(), directoryPath.c_str(), &recovered, &bytes) == Z_OK;
+      unzFile file = repaired ? unzOpen64(repairedPath.c_str()) : NULL;
+      unz_entry_list list;
+      repaired = (file != NULL) && (unzGetEntryList(file, &list) == UNZ_OK);
+      if (repaired) {
+        repairedEntries = (long long)list.number_entry;
+        unzFreeEntryList(&list);
+      }
+      if (file) {
+        unzClose(file);
+      }
+      double seconds = BenchNow() - start;
+      repairSeconds = (j == 0) || (seconds < repairSeconds) ? seconds : repairSeconds;
+      unlink(repairedPath.c_str());
+      unlink(directoryPath.c_str());
+    }
+
+    double salvageSeconds = 0.0;
+    long long salvagedEntries = -1;
+    for (int j = 0; success && (j < options->iterations); ++j) {
+      double start = BenchNow();
+      unzReader reader = unzReaderOpenSalvage(path.c_str());
+      success = reader != NULL;
+      if (success) {
+        salvagedEntries = (long long)unzReaderGetEntryList(reader)->number_entry;
+        unzReaderClose(reader);
+      }
+      double seconds = BenchNow() - start;
+      salvageSeconds = (j == 0) || (seconds < salvageSeconds) ? seconds : salvageSeconds;
+    }
+    success = success && (salvagedEntries == completeEntries) && ((i > 0) || (repairedEntries == completeEntries)) && _VerifySalvagedZip(path.c_str(), completeEntries);
+    if (!success) {
+      failures += 1;
+    }
+    printf("    {\"writer\": \"%s\", \"cut\": \"%s\", \"input_bytes\": %lli, \"complete_entries\": %i, \"repair_entries\": %lli, \"repair_s\": %.3f,"
+           " \"salvage_entries\": %lli, \"salvage_s\": %.4f, \"speedup\": %.1f, \"status\": \"%s\"}%s\n",
+           i == 2 ? "zipStream" : "zip.c", i ? "last_page" : "central_directory", inputBytes, completeEntries, repairedEntries, repairSeconds,
+           salvagedEntries, salvageSeconds, (repairedEntries >= 0) && (salvageSeconds > 0.0) ? repairSeconds / salvageSeconds : 0.0,
+           success ? "ok" : "failed", i < 2 ? "," : "");
+    unlink(path.c_str());
+  }
+  printf("  ]");
+  return failures;
+}
@@ -0,0 +1,272 @@
+/* zipdeflate.c -- Parallel deflate for .zip files
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "zipdeflate.h"
+
+#define DICTIONARY_SIZE (32*1024)
+#define BLOCKS_PER_THREAD 4
+
+typedef struct
+{
+    const Bytef* in;
+    uInt in_len;
+    uInt dict_len;              /* bytes before in used as dictionary */
+    int method;
+    int level;
+    int last;                   /* finish the deflate stream of the entry */
+    Bytef* out;                 /* compressed block, NULL for stored entries */
+    uLong out_len;
+    uLong crc;                  /* of the uncompressed block */
+    int err;
+    int done;
+} zip64_deflate_block;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* signaled when a block is done or written */
+    zip64_deflate_block* blocks;
+    ZPOS64_T number_block;
+    ZPOS64_T next;              /* first block not taken by a thread */
+    ZPOS64_T written;           /* first block not written by the caller */
+    ZPOS64_T window;            /* blocks allowed ahead of written */
+    int stop;
+} zip64_deflate_pool;
+
+static ZPOS64_T zip64deflate_BlockCount (const zip_deflate_entry* entry)
+{
+    if (entry->len==0)
+        return 1;  /* still has a (empty) deflate stream */
+    return (entry->len + ZIP_DEFLATE_BLOCKSIZE - 1) / ZIP_DEFLATE_BLOCKSIZE;
+}
+
+static void zip64deflate_Compress (zip64_deflate_block* block)
+{
+    z_stream stream;
+    uLong size;
+    int flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+    int err;
+
+    block->crc = crc32(0L,block->in,block->in_len);
+    if (block->method!=Z_DEFLATED)
+        return;
+
+    memset(&stream,0,sizeof(z_stream));
+    err = deflateInit2(&stream,block->level,Z_DEFLATED,-MAX_WBITS,8,Z_DEFAULT_STRATEGY);
+    if ((err==Z_OK) && (block->dict_len>0))
+        err = deflateSetDictionary(&stream,block->in - block->dict_len,block->dict_len);
+    if (err!=Z_OK)
+    {
+        block->err = ZIP_INTERNALERROR;
+        return;
+    }
+
+    size = deflateBound(&stream,block->in_len) + 16;  /* room for the sync flush marker */
+    block->out = (Bytef*)malloc(size);
+    stream.next_in = (Bytef*)block->in;
+    stream.avail_in = block->in_len;
+    while (block->out!=NULL)
+    {
+        Bytef* out;
+        stream.next_out = block->out + stream.total_out;
+        stream.avail_out = (uInt)(size - stream.total_out);
+        err = deflate(&stream,flush);
+        if ((flush==Z_FINISH) ? (err==Z_STREAM_END) : ((err==Z_OK) && (stream.avail_out!=0)))
+            break;
+        if ((err!=Z_OK) && (err!=Z_BUF_ERROR))
+        {
+            block->err = ZIP_INTERNALERROR;
+            break;
+        }
+        size *= 2;
+        out = (Bytef*)realloc(block->out,size);
+        if (out==NULL)
+            free(block->out);
+        block->out = out;
+    }
+    if ((block->out==NULL) && (block->err==ZIP_OK))
+        block->err = ZIP_INTERNALERROR;
+    block->out_len = stream.total_out;
+    deflateEnd(&stream);
+}
+
+static void* zip64deflate_Thread (void* arg)
+{
+    zip64_deflate_pool* pool = (zip64_deflate_pool*)arg;
+    for (;;)
+    {
+        zip64_deflate_block* block;
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->stop && (pool->next<pool->number_block) && (pool->next>=pool->written+pool->window))
+            pthread_cond_wait(&pool->cond,&pool->mutex);
+        if (pool->stop || (pool->next>=pool->number_block))
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        block = &pool->blocks[pool->next++];
+        pthread_mutex_unlock(&pool->mutex);
+
+        zip64deflate_Compress(block);
+
+        pthread_mutex_lock(&pool->mutex);
+        block->done = 1;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return NULL;
+}
+
+/* Wait for a block to be compressed or compress it if there are no threads */
+static void zip64deflate_WaitBlock (zip64_deflate_pool* pool, int started, zip64_deflate_block* block)
+{
+    if (started==0)
+    {
+        zip64deflate_Compress(block);
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    while (!block->done)
+        pthread_cond_wait(&pool->cond,&pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void zip64deflate_ReleaseBlock (zip64_deflate_pool* pool, int started, zip64_deflate_block* block)
+{
+    free(block->out);
+    block->out = NULL;
+    if (started==0)
+        return;
+    pthread_mutex_lock(&pool->mutex);
+    pool->written++;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static int zip64deflate_WriteBlock (zipFile file, const zip64_deflate_block* block)
+{
+    const Bytef* data = block->out!=NULL ? block->out : block->in;
+    uLong len = block->out!=NULL ? block->out_len : block->in_len;
+    if (block->err!=ZIP_OK)
+        return block->err;
+    while (len>0)
+    {
+        unsigned int count = len>0x40000000 ? 0x40000000 : (unsigned int)len;
+        int err = zipWriteInFileInZip(file,data,count);
+        if (err!=ZIP_OK)
+            return err;
+        data += count;
+        len -= count;
+    }
+    return ZIP_OK;
+}
+
+extern int ZEXPORT zipWriteEntriesParallel (zipFile file, const zip_deflate_entry* entries, ZPOS64_T number_entry, int level, int threads)
+{
+    zip64_deflate_pool pool;
+    pthread_t* thread_ids = NULL;
+    int started = 0;
+    int err = ZIP_OK;
+    ZPOS64_T i, j, b;
+
+    if ((file==NULL) || ((entries==NULL) && (number_entry>0)))
+        return ZIP_PARAMERROR;
+    if (threads<=0)
+    {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = processors>0 ? (int)processors : 1;
+    }
+
+    memset(&pool,0,sizeof(zip64_deflate_pool));
+    for (i=0;i<number_entry;i++)
+        pool.number_block += zip64deflate_BlockCount(&entries[i]);
+    if (pool.number_block==0)
+        return ZIP_OK;
+    pool.blocks = (zip64_deflate_block*)calloc((size_t)pool.number_block,sizeof(zip64_deflate_block));
+    if (pool.blocks==NULL)
+        return ZIP_INTERNALERROR;
+    for (i=0,b=0;i<number_entry;i++)
+    {
+        const zip_deflate_entry* entry = &entries[i];
+        ZPOS64_T count = zip64deflate_BlockCount(entry);
+        for (j=0;j<count;j++,b++)
+        {
+            zip64_deflate_block* block = &pool.blocks[b];
+            ZPOS64_T offset = j * ZIP_DEFLATE_BLOCKSIZE;
+            block->in = (const Bytef*)entry->buf + offset;
+            block->in_len = (uInt)(j+1<count ? ZIP_DEFLATE_BLOCKSIZE : entry->len - offset);
+            block->dict_len = (uInt)(offset<DICTIONARY_SIZE ? offset : DICTIONARY_SIZE);
+            block->method = entry->method;
+            block->level = level;
+            block->last = (j+1==count);
+        }
+    }
+
+    if ((threads>1) && (pool.number_block>1))
+    {
+        if ((ZPOS64_T)threads>pool.number_block)
+            threads = (int)pool.number_block;
+        pool.window = (ZPOS64_T)threads * BLOCKS_PER_THREAD;
+        pthread_mutex_init(&pool.mutex,NULL);
+        pthread_cond_init(&pool.cond,NULL);
+        thread_ids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+        for (;(thread_ids!=NULL) && (started<threads);started++)
+            if (pthread_create(&thread_ids[started],NULL,zip64deflate_Thread,&pool)!=0)
+                break;
+        if (started==0)
+        {
+            pthread_cond_destroy(&pool.cond);
+            pthread_mutex_destroy(&pool.mutex);
+        }
+    }
+
+    /* Write the entries in order as their blocks get compressed */
+    for (i=0,b=0;(err==ZIP_OK) && (i<number_entry);i++)
+    {
+        const zip_deflate_entry* entry = &entries[i];
+        ZPOS64_T count = zip64deflate_BlockCount(entry);
+        uLong crc = 0;
+        err = zipOpenNewFileInZip2_64(file,entry->filename,entry->zipfi,NULL,0,NULL,0,NULL,
+                                      entry->method,level,1,entry->len>=0xffffffff);
+        for (j=0;j<count;j++,b++)
+        {
+            zip64_deflate_block* block = &pool.blocks[b];
+            zip64deflate_WaitBlock(&pool,started,block);
+            if (err==ZIP_OK)
+                err = zip64deflate_WriteBlock(file,block);
+            crc = crc32_combine(crc,block->crc,block->in_len);
+            zip64deflate_ReleaseBlock(&pool,started,block);
+        }
+        if (err==ZIP_OK)
+            err = zipCloseFileInZipRaw64(file,entry->len,crc);
+    }
+
+    if (started>0)
+    {
+        int t;
+        pthread_mutex_lock(&pool.mutex);
+        pool.stop = 1;
+        pthread_cond_broadcast(&pool.cond);
+        pthread_mutex_unlock(&pool.mutex);
+        for (t=0;t<started;t++)
+            pthread_join(thread_ids[t],NULL);
+        pthread_cond_destroy(&pool.cond);
+        pthread_mutex_destroy(&pool.mutex);
+    }
+    free(thread_ids);
+    for (b=0;b<pool.number_block;b++)
+        free(pool.blocks[b].out);  /* left over after an error */
+    free(pool.blocks);
+    return err;
+}
@@ -0,0 +1,66 @@
+/* zipdeflate.h -- Parallel deflate for .zip files
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+         zipWriteInFileInZip compresses an entry on the calling thread
+         only. zipWriteEntriesParallel takes entries whose data are
+         already in memory, splits them into blocks of
+         ZIP_DEFLATE_BLOCKSIZE bytes and compresses all the blocks of all
+         the entries on a pool of threads, the way pigz does: each block is
+         an independent deflate stream primed with the last 32 KB of the
+         previous block as dictionary and ending on a byte boundary, so the
+         blocks of an entry concatenate into a single standard deflate
+         stream. The archive is still written in order by the calling
+         thread through the regular zip.c raw mode.
+
+         Only the benchmarks use it: the app exports pages that are
+         already compressed images and stores them as they are.
+*/
+
+#ifndef _zipdeflate_H
+#define _zipdeflate_H
+
+#include "zip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ZIP_DEFLATE_BLOCKSIZE
+#define ZIP_DEFLATE_BLOCKSIZE (128*1024)
+#endif
+
+typedef struct
+{
+    const char* filename;
+    const zip_fileinfo* zipfi;  /* may be NULL */
+    const void* buf;
+    ZPOS64_T len;
+    int method;                 /* Z_DEFLATED or 0 to store */
+} zip_deflate_entry;
+
+extern int ZEXPORT zipWriteEntriesParallel OF((zipFile file,
+                      const zip_deflate_entry* entries,
+                      ZPOS64_T number_entry,
+                      int level,
+                      int threads));
+/*
+  Add entries to the zipfile like zipOpenNewFileInZip64, zipWriteInFileInZip
+    and zipCloseFileInZip would, compressing them with threads threads
+    (the number of processors if threads <= 0, the calling thread only
+    if threads == 1). No file may be opened in the zipfile.
+  The output is a regular zipfile readable by unzip.c, but deflated entries
+    are a few bytes larger than with zipWriteInFileInZip.
+  At most 4 blocks per thread are waiting to be written at any time.
+  return ZIP_OK if all the entries were added
+  return <0 with error code if there is an error
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
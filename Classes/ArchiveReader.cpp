@@ -0,0 +1,1235 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ArchiveReader.h"
+#include "DirectoryCache.h"
+#include "SortKey.h"
+#include "iommap.h"
+#include "unzreader.h"
+#include "raros.hpp"
+#include "dll.hpp"
+
+#define kSignatureSize 7
+
+#define kRARFlag_Encrypted 0x0004
+#define kRARFlag_DirectoryMask 0x00E0
+#define kRARArchiveFlag_EncryptedHeaders 0x0080
+
+#define kCacheDefaultMaxMemory (4 * 1024 * 1024)
+#define kCacheDefaultMaxReaders 16
+
+struct ArchiveReader {
+  ArchiveReader() : retainCount(1), memoryUsage(0) {}
+  virtual ~ArchiveReader() {}
+  virtual long FindEntry(const char* name) const = 0;
+  virtual bool ReadEntryToSink(size_t index, ArchiveReaderSink sink, void* context) const = 0;
+  virtual bool ReadEntryPrefix(size_t index, void* buffer, size_t size, size_t* length) const = 0;
+  virtual bool ReadEntry(size_t index, void* buffer, size_t size) const;
+  virtual const void* GetEntryBytes(size_t index, size_t* length) const { return NULL; }
+  virtual bool ExtractEntries(const bool* selection, const char* directory) const;
+  virtual bool ReadEntryPrefixes(const bool* selection, void* buffer, size_t size, ArchiveReaderPrefixHandler handler, void* context) const;
+  virtual bool ReadEntries(const size_t* limits, ArchiveReaderPrefixHandler handler, void* context) const;
+  virtual void PrefetchEntries(const size_t* indexes, size_t count) const {}
+
+  ArchiveReaderFormat format;
+  std::vector<ArchiveReaderEntry> entries;
+  std::atomic<int> retainCount;
+  size_t memoryUsage;  // Approximate heap size of the entries for the cache budget, mapped file pages are not counted
+
+ protected:
+  void AddEntry(const char* name, const ArchiveReaderEntry& entry);
+  void FinishEntries();  // Must be called once all entries are added
+
+ private:
+  std::string _names;  // Only stable once complete
+  std::vector<size_t> _nameOffsets;
+};
+
+void ArchiveReader::AddEntry(const char* name, const ArchiveReaderEntry& entry) {
+  entries.push_back(entry);
+  _nameOffsets.push_back(_names.size());
+  _names.append(name);
+  _names.push_back(0);
+}
+
+void ArchiveReader::FinishEntries() {
+  for (size_t i = 0; i < entries.size(); ++i) {
+    entries[i].name = _names.c_str() + _nameOffsets[i];
+  }
+  std::vector<size_t>().swap(_nameOffsets);
+  memoryUsage = entries.capacity() * sizeof(ArchiveReaderEntry) + _names.capacity();
+}
+
+// Also rejects entries of an unexpected size so a damaged archive cannot overflow the buffer
+struct BufferSinkContext {
+  char* buffer;
+  size_t size;
+  size_t length;
+};
+
+static int _BufferSink(void* context, const void* bytes, size_t length) {
+  BufferSinkContext* buffer = (BufferSinkContext*)context;
+  if (length > buffer->size - buffer->length) {
+    return -1;
+  }
+  memcpy(buffer->buffer + buffer->length, bytes, length);
+  buffer->length += length;
+  return 0;
+}
+
+bool ArchiveReader::ReadEntry(size_t index, void* buffer, size_t size) const {
+  BufferSinkContext context = {(char*)buffer, size, 0};
+  return ReadEntryToSink(index, _BufferSink, &context) && (context.length == entries[index].size);
+}
+
+static int _FileSink(void* context, const void* bytes, size_t length) {
+  return fwrite(bytes, 1, length, (FILE*)context) == length ? 0 : -1;
+}
+
+static bool _ExtractEntryToFile(const ArchiveReader* reader, size_t index, const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  bool success = reader->ReadEntryToSink(index, _FileSink, file);
+  if (fclose(file) != 0) {
+    success = false;
+  }
+  if (!success) {
+    unlink(path);
+  }
+  return success;
+}
+
+// Some archives do not contain the directories alone before their files
+static bool _CreateDirectories(const std::string& path) {
+  for (size_t i = 1; i <= path.size(); ++i) {
+    if ((i == path.size()) || (path[i] == '/')) {
+      if ((mkdir(path.substr(0, i).c_str(), 0755) < 0) && (errno != EEXIST)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool ArchiveReader::ExtractEntries(const bool* selection, const char* directory) const {
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (selection && !selection[i]) {
+      continue;
+    }
+    std::string path = std::string(directory) + "/" + entries[i].name;
+    if (entries[i].isDirectory) {
+      if (!_CreateDirectories(path)) {
+        return false;
+      }
+    } else if (!_CreateDirectories(path.substr(0, path.rfind('/'))) || !_ExtractEntryToFile(this, i, path.c_str())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ArchiveReader::ReadEntryPrefixes(const bool* selection, void* buffer, size_t size, ArchiveReaderPrefixHandler handler, void* context) const {
+  for (size_t i = 0; i < entries.size(); ++i) {
+    size_t length;
+    if ((selection == NULL || selection[i]) && !entries[i].isDirectory && ReadEntryPrefix(i, buffer, size, &length)) {
+      handler(context, i, buffer, length);
+    }
+  }
+  return true;
+}
+
+bool ArchiveReader::ReadEntries(const size_t* limits, ArchiveReaderPrefixHandler handler, void* context) const {
+  std::vector<char> buffer(1);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if ((limits[i] == 0) || entries[i].isDirectory) {
+      continue;
+    }
+    size_t length = 0;
+    bool success;
+    if (limits[i] >= entries[i].size) {
+      length = (size_t)entries[i].size;
+      buffer.resize(length + 1);
+      success = ReadEntry(i, &buffer[0], length);
+    } else {
+      buffer.resize(limits[i]);
+      success = ReadEntryPrefix(i, &buffer[0], limits[i], &length);
+    }
+    if (success) {
+      handler(context, i, &buffer[0], length);
+    }
+  }
+  return true;
+}
+
+// ZIP archives are read at explicit offsets through an unzReader
+
+class ZipArchiveReader : public ArchiveReader {
+ public:
+  explicit ZipArchiveReader(unzReader reader);
+  virtual ~ZipArchiveReader();
+  virtual long FindEntry(const char* name) const;
+  virtual bool ReadEntryToSink(size_t index, ArchiveReaderSink sink, void* context) const;
+  virtual bool ReadEntryPrefix(size_t index, void* buffer, size_t size, size_t* length) const;
+  virtual bool ReadEntry(size_t index, void* buffer, size_t size) const;
+  virtual const void* GetEntryBytes(size_t index, size_t* length) const;
+  virtual void PrefetchEntries(const size_t* indexes, size_t count) const;
+
+  const unz_entry_list* list;
+
+ private:
+  unzReader _reader;
+};
+
+ZipArchiveReader::ZipArchiveReader(unzReader reader) {
+  format = kArchiveReaderFormat_ZIP;
+  _reader = reader;
+  list = unzReaderGetEntryList(reader);
+  entries.reserve((size_t)list->number_entry);
+  size_t namesSize = 0;
+  std::string name;
+  for (ZPOS64_T i = 0; i < list->number_entry; ++i) {
+    const unz_entry* zipEntry = &list->entries[i];
+    name.assign(list->names + zipEntry->name_offset, zipEntry->size_filename);
+    namesSize += name.size() + 1;
+    for (size_t j = 0; j < name.size(); ++j) {
+      if (name[j] == '\\') {
+        name[j] = '/';
+      }
+    }
+    ArchiveReaderEntry entry;
+    entry.size = zipEntry->uncompressed_size;
+    entry.packedSize = zipEntry->compressed_size;
+    entry.crc = zipEntry->crc;
+    entry.isDirectory = !name.empty() && (name[name.size() - 1] == '/');
+    entry.isEncrypted = zipEntry->flag & 1;
+    AddEntry(name.c_str(), entry);
+  }
+  FinishEntries();
+  memoryUsage += (size_t)list->number_entry * (sizeof(unz_entry) + sizeof(void*)) + namesSize;  // Entry list and name hash of the unzReader
+}
+
+ZipArchiveReader::~ZipArchiveReader() {
+  unzReaderClose(_reader);
+}
+
+long ZipArchiveReader::FindEntry(const char* name) const {
+  const unz_entry* entry = unzReaderLocateEntry(_reader, name);
+  return entry ? (long)(entry - list->entries) : -1;
+}
+
+struct ZipSinkContext {
+  ArchiveReaderSink sink;
+  void* context;
+};
+
+static int ZCALLBACK _ZipSink(voidpf opaque, const void* buf, uLong size) {
+  ZipSinkContext* context = (ZipSinkContext*)opaque;
+  return context->sink(context->context, buf, size);
+}
+
+bool ZipArchiveReader::ReadEntryToSink(size_t index, ArchiveReaderSink sink, void* context) const {
+  ZipSinkContext zipContext = {sink, context};
+  return unzReaderReadEntry(_reader, &list->entries[index], _ZipSink, &zipContext, list->entries[index].uncompressed_size) == UNZ_OK;
+}
+
+bool ZipArchiveReader::ReadEntryPrefix(size_t index, void* buffer, size_t size, size_t* length) const {
+  BufferSinkContext context = {(char*)buffer, size, 0};
+  ZipSinkContext zipContext = {_BufferSink, &context};
+  if (unzReaderReadEntry(_reader, &list->entries[index], _ZipSink, &zipContext, size) != UNZ_OK) {
+    return false;
+  }
+  *length = context.length;
+  return true;
+}
+
+// Single inflate call straight into the buffer
+bool ZipArchiveReader::ReadEntry(size_t index, void* buffer, size_t size) const {
+  return unzReaderExtractEntry(_reader, &list->entries[index], buffer, size) == UNZ_OK;
+}
+
+const void* ZipArchiveReader::GetEntryBytes(size_t index, size_t* length) const {
+  const void* bytes;
+  ZPOS64_T size;
+  if ((unzReaderGetEntryData(_reader, &list->entries[index], &bytes, &size) != UNZ_OK) || ((size_t)size != size)) {
+    return NULL;
+  }
+  *length = (size_t)size;
+  return bytes;
+}
+
+void ZipArchiveReader::PrefetchEntries(const size_t* indexes, size_t count) const {
+  for (size_t i = 0; i < count; ++i) {
+    unzReaderPrefetchEntry(_reader, &list->entries[indexes[i]]);
+  }
+}
+
+// http://www.rarlab.com/rar_add.htm
+// http://goahomepage.free.fr/article/2000_09_17_unrar_dll/UnRARDLL.html
+//
+// RAR archives can only be read sequentially: the entries are listed once when
+// opening and every read scans the archive again up to its entry with a handle
+// of its own. UnRAR keeps its error state in globals so reads are serialized.
+
+static std::mutex _rarMutex;
+
+class RarArchiveReader : public ArchiveReader {
+ public:
+  static RarArchiveReader* Open(const char* path);
+  virtual long FindEntry(const char* name) const;
+  virtual bool ReadEntryToSink(size_t index, ArchiveReaderSink sink, void* context) const;
+  virtual bool ReadEntryPrefix(size_t index, void* buffer, size_t size, size_t* length) const;
+  virtual bool ExtractEntries(const bool* selection, const char* directory) const;
+  virtual bool ReadEntryPrefixes(const bool* selection, void* buffer, size_t size, ArchiveReaderPrefixHandler handler, void* context) const;
+  virtual bool ReadEntries(const size_t* limits, ArchiveReaderPrefixHandler handler, void* context) const;
+
+ private:
+  HANDLE _OpenHandle(unsigned int mode) const;
+  HANDLE _OpenHandleAtEntry(size_t index) const;
+
+  std::string _path;
+  std::unordered_map<std::string, size_t> _indexes;
+};
+
+HANDLE RarArchiveReader::_OpenHandle(unsigned int mode) const {
+  struct RAROpenArchiveDataEx archiveData;
+  memset(&archiveData, 0, sizeof(archiveData));
+  archiveData.ArcName = (char*)_path.c_str();
+  archiveData.OpenMode = mode;
+  HANDLE handle = RAROpenArchiveEx(&archiveData);
+  if (handle && ((archiveData.OpenResult != 0) || (archiveData.Flags & kRARArchiveFlag_EncryptedHeaders))) {
+    RARCloseArchive(handle);
+    handle = NULL;
+  }
+  return handle;
+}
+
+RarArchiveReader* RarArchiveReader::Open(const char* path) {
+  RarArchiveReader* reader = new RarArchiveReader();
+  reader->format = kArchiveReaderFormat_RAR;
+  reader->_path = path;
+  std::lock_guard<std::mutex> lock(_rarMutex);
+  HANDLE handle = reader->_OpenHandle(RAR_OM_LIST);
+  if (handle == NULL) {
+    delete reader;
+    return NULL;
+  }
+  struct RARHeaderDataEx headerData;
+  memset(&headerData, 0, sizeof(headerData));
+  size_t namesSize = 0;
+  int result;
+  while ((result = RARReadHeaderEx(handle, &headerData)) == 0) {
+    ArchiveReaderEntry entry;
+    entry.size = ((unsigned long long)headerData.UnpSizeHigh << 32) | headerData.UnpSize;
+    entry.packedSize = ((unsigned long long)headerData.PackSizeHigh << 32) | headerData.PackSize;
+    entry.crc = headerData.FileCRC;
+    entry.isDirectory = (headerData.Flags & kRARFlag_DirectoryMask) == kRARFlag_DirectoryMask;
+    entry.isEncrypted = headerData.Flags & kRARFlag_Encrypted;
+    reader->_indexes.insert(std::make_pair(std::string(headerData.FileName), reader->entries.size()));  // First one wins like with unzip
+    reader->AddEntry(headerData.FileName, entry);
+    namesSize += strlen(headerData.FileName) + 1;
+    result = RARProcessFile(handle, RAR_SKIP, NULL, NULL);
+    if (result != 0) {
+      break;
+    }
+  }
+  RARCloseArchive(handle);
+  if (result != ERAR_END_ARCHIVE) {
+    delete reader;
+    return NULL;
+  }
+  reader->FinishEntries();
+  reader->memoryUsage += reader->_indexes.size() * (sizeof(std::pair<const std::string, size_t>) + 2 * sizeof(void*)) + namesSize;  // Nodes and buckets of the index
+  return reader;
+}
+
+long RarArchiveReader::FindEntry(const char* name) const {
+  std::unordered_map<std::string, size_t>::const_iterator iterator = _indexes.find(name);
+  return iterator != _indexes.end() ? (long)iterator->second : -1;
+}
+
+// Must be called with the lock held, returns a handle whose next operation applies to the entry
+HANDLE RarArchiveReader::_OpenHandleAtEntry(size_t index) const {
+  if (entries[index].isEncrypted) {
+    return NULL;
+  }
+  HANDLE handle = _OpenHandle(RAR_OM_EXTRACT);
+  if (handle == NULL) {
+    return NULL;
+  }
+  struct RARHeaderDataEx headerData;
+  memset(&headerData, 0, sizeof(headerData));
+  for (size_t i = 0; i <= index; ++i) {
+    if (RARReadHeaderEx(handle, &headerData) != 0) {
+      break;
+    }
+    if (i == index) {
+      if (strcmp(headerData.FileName, entries[index].name) == 0) {
+        return handle;
+      }
+      break;  // Archive was modified
+    }
+    if (RARProcessFile(handle, RAR_SKIP, NULL, NULL) != 0) {  // Solid archives are decoded up to the entry
+      break;
+    }
+  }
+  RARCloseArchive(handle);
+  return NULL;
+}
+
+struct RarSinkContext {
+  ArchiveReaderSink sink;
+  void* context;
+};
+
+static int CALLBACK _RarCallback(UINT msg, LPARAM userData, LPARAM p1, LPARAM p2) {
+  RarSinkContext* context = (RarSinkContext*)userData;
+  switch (msg) {
+
+    case UCM_PROCESSDATA:
+      return context->sink(context->context, (const void*)p1, (size_t)p2) == 0 ? 1 : -1;
+
+    case UCM_CHANGEVOLUME:
+      return p2 == RAR_VOL_NOTIFY ? 1 : -1;
+
+    case UCM_NEEDPASSWORD:
+      return -1;
+
+  }
+  return 0;
+}
+
+bool RarArchiveReader::ReadEntryToSink(size_t index, ArchiveReaderSink sink, void* context) const {
+  std::lock_guard<std::mutex> lock(_rarMutex);
+  HANDLE handle = _OpenHandleAtEntry(index);
+  if (handle == NULL) {
+    return false;
+  }
+  RarSinkContext rarContext = {sink, context};
+  RARSetCallback(handle, _RarCallback, (LPARAM)&rarContext);
+  int result = RARProcessFile(handle, RAR_TEST, NULL, NULL);  // Checks the CRC
+  RARCloseArchive(handle);
+  return result == 0;
+}
+
+bool RarArchiveReader::ReadEntryPrefix(size_t index, void* buffer, size_t size, size_t* length) const {
+  std::lock_guard<std::mutex> lock(_rarMutex);
+  HANDLE handle = _OpenHandleAtEntry(index);
+  if (handle == NULL) {
+    return false;
+  }
+  unsigned int dataSize = 0;
+  int result = RARProcessFilePrefix(handle, (unsigned char*)buffer, (unsigned int)size, &dataSize);
+  RARCloseArchive(handle);
+  *length = dataSize;
+  return result == 0;
+}
+
+// UnRAR creates the intermediary directories itself
+bool RarArchiveReader::ExtractEntries(const bool* selection, const char* directory) const {
+  std::lock_guard<std::mutex> lock(_rarMutex);
+  HANDLE handle = _OpenHandle(RAR_OM_EXTRACT);
+  if (handle == NULL) {
+    return false;
+  }
+  struct RARHeaderDataEx headerData;
+  memset(&headerData, 0, sizeof(headerData));
+  int result;
+  for (size_t i = 0; (result = RARReadHeaderEx(handle, &headerData)) == 0; ++i) {
+    bool extract = (i < entries.size()) && !entries[i].isDirectory && (selection == NULL || selection[i]);
+    result = RARProcessFile(handle, extract ? RAR_EXTRACT : RAR_SKIP, (char*)directory, NULL);
+    if (result != 0) {
+      break;
+    }
+  }
+  RARCloseArchive(handle);
+  return result == ERAR_END_ARCHIVE;
+}
+
+// Same single pass so solid archives are only decoded once
+bool RarArchiveReader::ReadEntryPrefixes(const bool* selection, void* buffer, size_t size, ArchiveReaderPrefixHandler handler, void* context) const {
+  std::lock_guard<std::mutex> lock(_rarMutex);
+  HANDLE handle = _OpenHandle(RAR_OM_EXTRACT);
+  if (handle == NULL) {
+    return false;
+  }
+  struct RARHeaderDataEx headerData;
+  memset(&headerData, 0, sizeof(headerData));
+  int result;
+  for (size_t i = 0; (result = RARReadHeaderEx(handle, &headerData)) == 0; ++i) {
+    if ((i < entries.size()) && !entries[i].isDirectory && !entries[i].isEncrypted && (selection == NULL || selection[i])) {
+      unsigned int dataSize = 0;
+      result = RARProcessFilePrefix(handle, (unsigned char*)buffer, (unsigned int)size, &dataSize);
+      if (result == 0) {
+        handler(context, i, buffer, dataSize);
+      }
+    } else {
+      result = RARProcessFile(handle, RAR_SKIP, NULL, NULL);
+    }
+    if (result != 0) {
+      break;
+    }
+  }
+  RARCloseArchive(handle);
+  return result == ERAR_END_ARCHIVE;
+}
+
+// Also a single pass, whole entries going through the callback and prefixes through RARProcessFilePrefix()
+bool RarArchiveReader::ReadEntries(const size_t* limits, ArchiveReaderPrefixHandler handler, void* context) const {
+  std::lock_guard<std::mutex> lock(_rarMutex);
+  HANDLE handle = _OpenHandle(RAR_OM_EXTRACT);
+  if (handle == NULL) {
+    return false;
+  }
+  std::vector<char> buffer(1);
+  BufferSinkContext bufferContext;
+  RarSinkContext rarContext = {_BufferSink, &bufferContext};
+  struct RARHeaderDataEx headerData;
+  memset(&headerData, 0, sizeof(headerData));
+  int result;
+  for (size_t i = 0; (result = RARReadHeaderEx(handle, &headerData)) == 0; ++i) {
+    if ((i < entries.size()) && (limits[i] > 0) && !entries[i].isDirectory && !entries[i].isEncrypted) {
+      if (limits[i] >= entries[i].size) {
+        buffer.resize((size_t)entries[i].size + 1);
+        bufferContext.buffer = &buffer[0];
+        bufferContext.size = (size_t)entries[i].size;
+        bufferContext.length = 0;
+        RARSetCallback(handle, _RarCallback, (LPARAM)&rarContext);
+        result = RARProcessFile(handle, RAR_TEST, NULL, NULL);  // Checks the CRC
+        RARSetCallback(handle, NULL, 0);
+        if ((result == 0) && (bufferContext.length == entries[i].size)) {
+          handler(context, i, &buffer[0], bufferContext.length);
+        }
+      } else {
+        buffer.resize(limits[i]);
+        unsigned int dataSize = 0;
+        result = RARProcessFilePrefix(handle, (unsigned char*)&buffer[0], (unsigned int)limits[i], &dataSize);
+        if (result == 0) {
+          handler(context, i, &buffer[0], dataSize);
+        }
+      }
+    } else {
+      result = RARProcessFile(handle, RAR_SKIP, NULL, NULL);
+    }
+    if (result != 0) {
+      break;
+    }
+  }
+  RARCloseArchive(handle);
+  return result == ERAR_END_ARCHIVE;
+}
+
+// http://pubs.opengroup.org/onlinepubs/9699919799/utilities/pax.html#tag_20_92_13_06
+// https://www.gnu.org/software/tar/manual/html_node/Standard.html
+//
+// TAR archives are not compressed so the entries are served straight from the
+// mapped file once the 512 bytes headers have been indexed in a single pass,
+// with names longer than 100 characters from GNU "L" entries or PAX "path"
+// records. There is no CRC of the data, only a checksum of every header.
+
+#define kTarBlockSize 512
+#define kTarReadChunkSize (64 * 1024)
+
+class TarArchiveReader : public ArchiveReader {
+ public:
+  static TarArchiveReader* Open(const char* path, const unz_entry_list* list);  // Scans the headers if there is no list
+  virtual ~TarArchiveReader();
+  virtual long FindEntry(const char* name) const;
+  virtual bool ReadEntryToSink(size_t index, ArchiveReaderSink sink, void* context) const;
+  virtual bool ReadEntryPrefix(size_t index, void* buffer, size_t size, size_t* length) const;
+  virtual bool ReadEntry(size_t index, void* buffer, size_t size) const;
+  virtual const void* GetEntryBytes(size_t index, size_t* length) const;
+  virtual void PrefetchEntries(const size_t* indexes, size_t count) const;
+
+  unz_entry_list list;  // With the data offsets, so it can be saved in a DirectoryCache like for ZIP
+
+ private:
+  TarArchiveReader();
+  bool _Read(unsigned long long offset, void* buffer, size_t size) const;
+  bool _Scan();
+  void _AddEntry(const std::string& name, unsigned long long offset, unsigned long long size, bool isDirectory);
+  void _FinishList();
+
+  int _fd;  // Only while scanning if the file is mapped
+  const unsigned char* _bytes;
+  unsigned long long _size;
+  std::vector<unz_entry> _listEntries;
+  std::string _listNames;
+  std::unordered_map<std::string, size_t> _indexes;
+};
+
+// Numeric fields are octal, or big-endian binary with the high bit set for GNU large values
+static bool _ParseTarNumber(const unsigned char* field, size_t length, unsigned long long* value) {
+  *value = 0;
+  if (field[0] & 0x80) {
+    for (size_t i = 1; i < length; ++i) {
+      if (*value >> 56) {
+        return false;
+      }
+      *value = (*value << 8) | field[i];
+    }
+    return !(field[0] & 0x7F);
+  }
+  size_t i = 0;
+  while ((i < length) && (field[i] == ' ')) {
+    ++i;
+  }
+  for (; (i < length) && (field[i] >= '0') && (field[i] <= '7'); ++i) {
+    *value = (*value << 3) | (field[i] - '0');
+  }
+  return (i == length) || (field[i] == 0) || (field[i] == ' ');
+}
+
+static bool _IsTarHeader(const unsigned char* header) {
+  unsigned long long checksum;
+  if (!_ParseTarNumber(&header[148], 8, &checksum)) {
+    return false;
+  }
+  unsigned long long sum = 0;
+  for (size_t i = 0; i < kTarBlockSize; ++i) {
+    sum += (i >= 148) && (i < 156) ? ' ' : header[i];
+  }
+  return sum == checksum;
+}
+
+// Records are "<length> <key>=<value>\n" where the length includes the whole record
+static void _ParsePaxRecords(const char* bytes, size_t length, std::string* path, unsigned long long* size) {
+  size_t offset = 0;
+  while (offset < length) {
+    char* end;
+    unsigned long record = strtoul(bytes + offset, &end, 10);
+    if ((end == bytes + offset) || (*end != ' ') || (record == 0) || (record > length - offset)) {
+      break;
+    }
+    const char* key = end + 1;
+    const char* recordEnd = bytes + offset + record - 1;  // The newline
+    const char* equal = (const char*)memchr(key, '=', recordEnd - key);
+    if (equal) {
+      if ((equal - key == 4) && !memcmp(key, "path", 4)) {
+        path->assign(equal + 1, recordEnd - equal - 1);
+      } else if ((equal - key == 4) && !memcmp(key, "size", 4)) {
+        *size = strtoull(equal + 1, NULL, 10);
+      }
+    }
+    offset += record;
+  }
+}
+
+TarArchiveReader::TarArchiveReader() {
+  format = kArchiveReaderFormat_TAR;
+  memset(&list, 0, sizeof(list));
+  _fd = -1;
+  _bytes = NULL;
+  _size = 0;
+}
+
+TarArchiveReader::~TarArchiveReader() {
+  if (_bytes) {
+    munmap((void*)_bytes, (size_t)_size);
+  }
+  if (_fd >= 0) {
+    close(_fd);
+  }
+}
+
+TarArchiveReader* TarArchiveReader::Open(const char* path, const unz_entry_list* list) {
+  TarArchiveReader* reader = new TarArchiveReader();
+  struct stat info;
+  reader->_fd = open(path, O_RDONLY);
+  if ((reader->_fd < 0) || (fstat(reader->_fd, &info) != 0)) {
+    delete reader;
+    return NULL;
+  }
+  reader->_size = info.st_size;
+  if ((reader->_size > 0) && ((ZPOS64_T)reader->_size <= MMAP_MAX_FILE_SIZE)) {
+    void* base = mmap(NULL, (size_t)reader->_size, PROT_READ, MAP_PRIVATE, reader->_fd, 0);
+    if (base != MAP_FAILED) {
+      reader->_bytes = (const unsigned char*)base;
+    }
+  }
+  bool success = true;
+  if (list) {
+    for (ZPOS64_T i = 0; success && (i < list->number_entry); ++i) {
+      const unz_entry* entry = &list->entries[i];
+      std::string name(list->names + entry->name_offset, entry->size_filename);
+      success = (entry->offset_curfile <= reader->_size) && (entry->uncompressed_size <= reader->_size - entry->offset_curfile);
+      reader->_AddEntry(name, entry->offset_curfile, entry->uncompressed_size, !name.empty() && (name[name.size() - 1] == '/'));
+    }
+  } else {
+    success = reader->_Scan();
+  }
+  if (!success) {
+    delete reader;
+    return NULL;
+  }
+  if (reader->_bytes) {
+    close(reader->_fd);  // The mapping stays valid
+    reader->_fd = -1;
+  }
+  reader->_FinishList();
+  return reader;
+}
+
+bool TarArchiveReader::_Read(unsigned long long offset, void* buffer, size_t size) const {
+  if ((offset > _size) || (size > _size - offset)) {
+    return false;
+  }
+  if (_fd < 0) {
+    memcpy(buffer, _bytes + offset, size);
+    return true;
+  }
+  for (size_t length = 0; length < size;) {
+    ssize_t count = pread(_fd, (char*)buffer + length, size - length, (off_t)(offset + length));
+    if (count <= 0) {
+      if ((count < 0) && (errno == EINTR)) {
+        continue;
+      }
+      return false;
+    }
+    length += count;
+  }
+  return true;
+}
+
+// Stops at the end of archive marker or the end of the file, but a damaged header or truncated entry fails the whole archive
+// Headers are read from the file even if it is mapped as touching one memory page per entry costs more than the system calls
+bool TarArchiveReader::_Scan() {
+  unsigned char header[kTarBlockSize];
+  std::vector<char> extension;
+  std::string longName;
+  std::string paxPath;
+  unsigned long long paxSize = ULLONG_MAX;
+  unsigned long long offset = 0;
+  while (offset + kTarBlockSize <= _size) {
+    if (!_Read(offset, header, kTarBlockSize)) {
+      return false;
+    }
+    if (header[0] == 0) {
+      break;  // End of archive
+    }
+    unsigned long long size;
+    if (!_IsTarHeader(header) || !_ParseTarNumber(&header[124], 12, &size)) {
+      return false;
+    }
+    char type = header[156];
+    if ((type == 'x') || (type == 'L')) {
+      if (size > 1024 * 1024) {
+        return false;
+      }
+      extension.resize((size_t)size + 1);
+      if (!_Read(offset + kTarBlockSize, &extension[0], (size_t)size)) {
+        return false;
+      }
+      extension[(size_t)size] = 0;
+      if (type == 'x') {
+        _ParsePaxRecords(&extension[0], (size_t)size, &paxPath, &paxSize);
+      } else {
+        longName = &extension[0];  // Up to the terminating zero
+      }
+    } else {
+      if (paxSize != ULLONG_MAX) {
+        size = paxSize;
+      }
+      if ((type == '0') || (type == 0) || (type == '7') || (type == '5')) {
+        std::string name;
+        if (!paxPath.empty()) {
+          name = paxPath;
+        } else if (!longName.empty()) {
+          name = longName;
+        } else {
+          name.assign((const char*)&header[0], strnlen((const char*)&header[0], 100));
+          if (!memcmp(&header[257], "ustar\0", 6) && header[345]) {  // Not the GNU format which uses this space for other fields
+            name = std::string((const char*)&header[345], strnlen((const char*)&header[345], 155)) + "/" + name;
+          }
+        }
+        while (!name.compare(0, 2, "./")) {
+          name.erase(0, 2);
+        }
+        if (type == '5') {
+          if (!name.empty() && (name[name.size() - 1] != '/')) {
+            name.push_back('/');
+          }
+          size = 0;  // Only meaningful for GNU dumpdir entries
+        }
+        if (size > _size - (offset + kTarBlockSize)) {
+          return false;  // Truncated
+        }
+        if (!name.empty()) {
+          _AddEntry(name, offset + kTarBlockSize, size, name[name.size() - 1] == '/');  // Pre-POSIX archives store directories as regular files with a trailing slash
+        }
+      }
+      longName.clear();
+      paxPath.clear();
+      paxSize = ULLONG_MAX;
+    }
+    if (size > _size) {
+      return false;
+    }
+    offset += kTarBlockSize + (size + kTarBlockSize - 1) / kTarBlockSize * kTarBlockSize;
+  }
+  return true;
+}
+
+void TarArchiveReader::_AddEntry(const std::string& name, unsigned long long offset, unsigned long long size, bool isDirectory) {
+  ArchiveReaderEntry entry;
+  entry.size = size;
+  entry.packedSize = size;
+  entry.crc = 0;
+  entry.isDirectory = isDirectory;
+  entry.isEncrypted = false;
+  _indexes.insert(std::make_pair(name, entries.size()));  // First one wins like with unzip
+  AddEntry(name.c_str(), entry);
+  unz_entry item;
+  memset(&item, 0, sizeof(item));
+  item.name_offset = _listNames.size();
+  item.size_filename = name.size();
+  item.compressed_size = size;
+  item.uncompressed_size = size;
+  item.offset_curfile = offset;
+  item.file_pos.num_of_file = _listEntries.size();
+  _listEntries.push_back(item);
+  _listNames.append(name);
+  _listNames.push_back(0);
+}
+
+void TarArchiveReader::_FinishList() {
+  FinishEntries();
+  list.number_entry = _listEntries.size();
+  list.entries = _listEntries.empty() ? NULL : &_listEntries[0];
+  list.names = (char*)_listNames.c_str();
+  memoryUsage += _listEntries.capacity() * sizeof(unz_entry) + _listNames.capacity() +
+                 _indexes.size() * (sizeof(std::pair<const std::string, size_t>) + 2 * sizeof(void*));  // Entry list and name index
+}
+
+long TarArchiveReader::FindEntry(const char* name) const {
+  std::unordered_map<std::string, size_t>::const_iterator iterator = _indexes.find(name);
+  return iterator != _indexes.end() ? (long)iterator->second : -1;
+}
+
+// A single call with the mapped bytes, otherwise chunks read from the file
+bool TarArchiveReader::ReadEntryToSink(size_t index, ArchiveReaderSink sink, void* context) const {
+  unsigned long long offset = list.entries[index].offset_curfile;
+  unsigned long long size = list.entries[index].uncompressed_size;
+  if (_bytes) {
+    return (size_t)size == size ? sink(context, _bytes + offset, (size_t)size) == 0 : false;
+  }
+  std::vector<char> buffer((size_t)std::min(size, (unsigned long long)kTarReadChunkSize) + 1);
+  while (size > 0) {
+    size_t length = (size_t)std::min(size, (unsigned long long)kTarReadChunkSize);
+    if (!_Read(offset, &buffer[0], length) || (sink(context, &buffer[0], length) != 0)) {
+      return false;
+    }
+    offset += length;
+    size -= length;
+  }
+  return true;
+}
+
+bool TarArchiveReader::ReadEntryPrefix(size_t index, void* buffer, size_t size, size_t* length) const {
+  size_t count = (size_t)std::min((unsigned long long)size, list.entries[index].uncompressed_size);
+  if (!_Read(list.entries[index].offset_curfile, buffer, count)) {
+    return false;
+  }
+  *length = count;
+  return true;
+}
+
+bool TarArchiveReader::ReadEntry(size_t index, void* buffer, size_t size) const {
+  return _Read(list.entries[index].offset_curfile, buffer, (size_t)entries[index].size);
+}
+
+const void* TarArchiveReader::GetEntryBytes(size_t index, size_t* length) const {
+  if ((_bytes == NULL) || ((size_t)list.entries[index].uncompressed_size != list.entries[index].uncompressed_size)) {
+    return NULL;
+  }
+  *length = (size_t)list.entries[index].uncompressed_size;
+  return _bytes + list.entries[index].offset_curfile;
+}
+
+void TarArchiveReader::PrefetchEntries(const size_t* indexes, size_t count) const {
+  for (size_t i = 0; i < count; ++i) {
+    const unz_entry* entry = &list.entries[indexes[i]];
+    if (entry->uncompressed_size == 0) {
+      continue;
+    }
+    if (_bytes) {
+      uintptr_t page = (uintptr_t)getpagesize();
+      uintptr_t start = (uintptr_t)(_bytes + entry->offset_curfile) & ~(page - 1);
+      madvise((void*)start, (size_t)((uintptr_t)(_bytes + entry->offset_curfile + entry->uncompressed_size) - start), MADV_WILLNEED);
+    } else {
+#if defined(F_RDADVISE)
+      struct radvisory advisory;
+      advisory.ra_offset = (off_t)entry->offset_curfile;
+      advisory.ra_count = entry->uncompressed_size > INT_MAX ? INT_MAX : (int)entry->uncompressed_size;
+      fcntl(_fd, F_RDADVISE, &advisory);
+#elif defined(POSIX_FADV_WILLNEED)
+      posix_fadvise(_fd, (off_t)entry->offset_curfile, (off_t)entry->uncompressed_size, POSIX_FADV_WILLNEED);
+#endif
+    }
+  }
+}
+
+// Interface
+
+// TAR has no signature at the start of the file, only a first header with a valid checksum and a name
+ArchiveReaderFormat ArchiveReaderDetectFormat(const char* path) {
+  unsigned char signature[kTarBlockSize];
+  ssize_t length = -1;
+  int fd = open(path, O_RDONLY);
+  if (fd >= 0) {
+    length = read(fd, signature, sizeof(signature));
+    close(fd);
+  }
+  if ((length >= 4) && (signature[0] == 'P') && (signature[1] == 'K') &&
+      (((signature[2] == 3) && (signature[3] == 4)) || ((signature[2] == 5) && (signature[3] == 6)) || ((signature[2] == 7) && (signature[3] == 8)))) {
+    return kArchiveReaderFormat_ZIP;  // Local header, empty archive or spanning marker
+  }
+  if ((length >= kSignatureSize) && !memcmp(signature, "Rar!\x1A\x07\x00", kSignatureSize)) {
+    return kArchiveReaderFormat_RAR;
+  }
+  if ((length == kTarBlockSize) && (signature[0] != 0) && _IsTarHeader(signature)) {
+    return kArchiveReaderFormat_TAR;  // With or without the magic of pre-POSIX archives, the checksum must still match
+  }
+  return kArchiveReaderFormat_Unknown;
+}
+
+static ArchiveReader* _OpenZIP(const char* path) {
+  unzReader reader = unzReaderOpen(path);
+  return reader ? new ZipArchiveReader(reader) : NULL;
+}
+
+// Files without a known signature like self-extracting archives are tried as both formats
+ArchiveReader* ArchiveReaderOpen(const char* path) {
+  switch (ArchiveReaderDetectFormat(path)) {
+
+    case kArchiveReaderFormat_ZIP:
+      return _OpenZIP(path);
+
+    case kArchiveReaderFormat_RAR:
+      return RarArchiveReader::Open(path);
+
+    case kArchiveReaderFormat_TAR:
+      return TarArchiveReader::Open(path, NULL);
+
+    case kArchiveReaderFormat_Unknown:
+      break;
+
+  }
+  ArchiveReader* reader = _OpenZIP(path);
+  return reader ? reader : RarArchiveReader::Open(path);
+}
+
+ArchiveReader* ArchiveReaderOpenZIPWithEntryList(const char* path, const unz_entry_list* list) {
+  unzReader reader = unzReaderOpenWithEntryList(path, list);
+  return reader ? new ZipArchiveReader(reader) : NULL;
+}
+
+ArchiveReader* ArchiveReaderOpenZIPSalvage(const char* path) {
+  unzReader reader = unzReaderOpenSalvage(path);
+  return reader ? new ZipArchiveReader(reader) : NULL;
+}
+
+ArchiveReader* ArchiveReaderOpenZIPData(const void* bytes, size_t length) {
+  unzReader reader = unzReaderOpenMemory(bytes, length);
+  return reader ? new ZipArchiveReader(reader) : NULL;
+}
+
+ArchiveReader* ArchiveReaderOpenTARWithEntryList(const char* path, const unz_entry_list* list) {
+  return TarArchiveReader::Open(path, list);
+}
+
+ArchiveReader* ArchiveReaderRetain(ArchiveReader* reader) {
+  reader->retainCount.fetch_add(1, std::memory_order_relaxed);
+  return reader;
+}
+
+void ArchiveReaderClose(ArchiveReader* reader) {
+  if (reader->retainCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete reader;
+  }
+}
+
+ArchiveReaderFormat ArchiveReaderGetFormat(const ArchiveReader* reader) {
+  return reader->format;
+}
+
+size_t ArchiveReaderGetEntryCount(const ArchiveReader* reader) {
+  return reader->entries.size();
+}
+
+const ArchiveReaderEntry* ArchiveReaderGetEntry(const ArchiveReader* reader, size_t index) {
+  return index < reader->entries.size() ? &reader->entries[index] : NULL;
+}
+
+const unz_entry_list* ArchiveReaderGetZIPEntryList(const ArchiveReader* reader) {
+  return reader->format == kArchiveReaderFormat_ZIP ? static_cast<const ZipArchiveReader*>(reader)->list : NULL;
+}
+
+const unz_entry_list* ArchiveReaderGetTAREntryList(const ArchiveReader* reader) {
+  return reader->format == kArchiveReaderFormat_TAR ? &static_cast<const TarArchiveReader*>(reader)->list : NULL;
+}
+
+long ArchiveReaderFindEntry(const ArchiveReader* reader, const char* name) {
+  return name ? reader->FindEntry(name) : -1;
+}
+
+bool ArchiveReaderReadEntry(const ArchiveReader* reader, size_t index, void* buffer, size_t size) {
+  return (index < reader->entries.size()) && (size >= reader->entries[index].size) && reader->ReadEntry(index, buffer, size);
+}
+
+bool ArchiveReaderReadEntryToSink(const ArchiveReader* reader, size_t index, ArchiveReaderSink sink, void* context) {
+  return (index < reader->entries.size()) && reader->ReadEntryToSink(index, sink, context);
+}
+
+bool ArchiveReaderReadEntryPrefix(const ArchiveReader* reader, size_t index, void* buffer, size_t size, size_t* length) {
+  return (index < reader->entries.size()) && reader->ReadEntryPrefix(index, buffer, size, length);
+}
+
+const void* ArchiveReaderGetEntryBytes(const ArchiveReader* reader, size_t index, size_t* length) {
+  return index < reader->entries.size() ? reader->GetEntryBytes(index, length) : NULL;
+}
+
+bool ArchiveReaderExtractEntryToFile(const ArchiveReader* reader, size_t index, const char* path) {
+  return (index < reader->entries.size()) && !reader->entries[index].isDirectory && _ExtractEntryToFile(reader, index, path);
+}
+
+bool ArchiveReaderExtractEntries(const ArchiveReader* reader, const bool* selection, const char* directory) {
+  return reader->ExtractEntries(selection, directory);
+}
+
+bool ArchiveReaderReadEntryPrefixes(const ArchiveReader* reader, const bool* selection, void* buffer, size_t size, ArchiveReaderPrefixHandler handler, void* context) {
+  return reader->ReadEntryPrefixes(selection, buffer, size, handler, context);
+}
+
+void ArchiveReaderPrefetchEntries(const ArchiveReader* reader, const size_t* indexes, size_t count) {
+  reader->PrefetchEntries(indexes, count);
+}
+
+bool ArchiveReaderReadEntries(const ArchiveReader* reader, const size_t* limits, ArchiveReaderPrefixHandler handler, void* context) {
+  return reader->ReadEntries(limits, handler, context);
+}
+
+// Same pages as listing the visible files with IsImageFileExtensionSupported() in the app
+static bool _IsPageName(const char* name) {
+  const char* component = name;
+  while (true) {
+    if (component[0] == '.') {
+      return false;
+    }
+    const char* separator = strchr(component, '/');
+    if (separator == NULL) {
+      break;
+    }
+    component = separator + 1;
+  }
+  const char* extension = strrchr(component, '.');
+  return extension && (!strcasecmp(extension, ".jpg") || !strcasecmp(extension, ".jpeg") || !strcasecmp(extension, ".png") ||
+                       !strcasecmp(extension, ".gif") || !strcasecmp(extension, ".webp"));
+}
+
+static bool _HasWord(const char* base, const char* word, size_t length) {
+  for (const char* string = base; *string; ++string) {
+    if (!strncasecmp(string, word, length) && ((string == base) || !isalpha((unsigned char)string[-1])) && !isalpha((unsigned char)string[length])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// "cover" as a word of the file name like "Cover.jpg" or "00 - cover a.png" but not "discover.jpg" ranks first,
+// then the other pages, then back covers like "Back Cover.jpg" or "99 - cover (back).jpg" which must not be picked over page 1
+static int _CoverRank(const char* name) {
+  const char* base = strrchr(name, '/');
+  base = base ? base + 1 : name;
+  if (!_HasWord(base, "cover", 5)) {
+    return 1;
+  }
+  return _HasWord(base, "back", 4) || _HasWord(base, "rear", 4) ? 2 : 0;
+}
+
+// Single pass keeping only the key of the best page so far in reused buffers: natural order already puts pages
+// numbered "000" or "00a" first, so only names containing "cover" need to be ranked explicitly
+long ArchiveReaderFindCover(const ArchiveReader* reader) {
+  std::vector<unsigned char> key(256);
+  std::vector<unsigned char> bestKey;
+  bestKey.reserve(key.size());
+  int bestRank = 0;
+  long best = -1;
+  for (size_t i = 0; i < reader->entries.size(); ++i) {
+    const ArchiveReaderEntry& entry = reader->entries[i];
+    if (entry.isDirectory || !_IsPageName(entry.name)) {
+      continue;
+    }
+    int rank = _CoverRank(entry.name);
+    if ((best >= 0) && (rank > bestRank)) {
+      continue;
+    }
+    size_t length = SortKeyGenerate(entry.name, &key[0], key.size());
+    if (length > key.size()) {
+      key.resize(length);
+      SortKeyGenerate(entry.name, &key[0], length);
+    }
+    if ((best < 0) || (rank < bestRank) || (SortKeyCompare(&key[0], length, &bestKey[0], bestKey.size()) < 0)) {
+      bestKey.assign(key.begin(), key.begin() + length);
+      bestRank = rank;
+      best = (long)i;
+    }
+  }
+  return best;
+}
+
+// Readers are few enough for a list in most recently used order, each one
+// holding a reference released outside the lock as it may unmap the file
+
+struct CachedReader {
+  std::string path;
+  DirectoryCacheKey key;
+  ArchiveReader* reader;
+};
+
+static std::mutex _cacheMutex;
+static std::list<CachedReader> _cache;
+static size_t _cacheMemoryUsage = 0;
+static size_t _cacheMaxMemory = kCacheDefaultMaxMemory;
+static size_t _cacheMaxReaders = kCacheDefaultMaxReaders;
+
+static bool _IsSameKey(const DirectoryCacheKey* key1, const DirectoryCacheKey* key2) {
+  return (key1->device == key2->device) && (key1->inode == key2->inode) && (key1->size == key2->size) && (key1->modificationTime == key2->modificationTime);
+}
+
+// Must be called with the lock held
+static std::list<CachedReader>::iterator _RemoveCachedReader(std::list<CachedReader>::iterator iterator, std::vector<ArchiveReader*>* released) {
+  _cacheMemoryUsage -= iterator->reader->memoryUsage;
+  released->push_back(iterator->reader);
+  return _cache.erase(iterator);
+}
+
+// Must be called with the lock held
+static void _TrimCache(std::vector<ArchiveReader*>* released) {
+  while (!_cache.empty() && ((_cacheMemoryUsage > _cacheMaxMemory) || (_cache.size() > _cacheMaxReaders))) {
+    _RemoveCachedReader(--_cache.end(), released);
+  }
+}
+
+static void _CloseReaders(const std::vector<ArchiveReader*>& readers) {
+  for (size_t i = 0; i < readers.size(); ++i) {
+    ArchiveReaderClose(readers[i]);
+  }
+}
+
+ArchiveReader* ArchiveReaderCacheOpen(const char* path) {
+  DirectoryCacheKey key;
+  if (!DirectoryCacheGetKey(path, &key)) {
+    return NULL;
+  }
+  ArchiveReader* reader = ArchiveReaderCacheLookup(path, &key);
+  if (reader == NULL) {
+    reader = ArchiveReaderOpen(path);
+    if (reader) {
+      ArchiveReaderCacheInsert(path, &key, reader);
+    }
+  }
+  return reader;
+}
+
+ArchiveReader* ArchiveReaderCacheLookup(const char* path, const DirectoryCacheKey* key) {
+  ArchiveReader* reader = NULL;
+  std::vector<ArchiveReader*> released;
+  {
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    for (std::list<CachedReader>::iterator iterator = _cache.begin(); iterator != _cache.end(); ++iterator) {
+      if (iterator->path == path) {
+        if (_IsSameKey(&iterator->key, key)) {
+          reader = ArchiveReaderRetain(iterator->reader);
+          _cache.splice(_cache.begin(), _cache, iterator);
+        } else {
+          _RemoveCachedReader(iterator, &released);  // The file has changed since
+        }
+        break;
+      }
+    }
+  }
+  _CloseReaders(released);
+  return reader;
+}
+
+void ArchiveReaderCacheInsert(const char* path, const DirectoryCacheKey* key, ArchiveReader* reader) {
+  std::vector<ArchiveReader*> released;
+  {
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    for (std::list<CachedReader>::iterator iterator = _cache.begin(); iterator != _cache.end(); ++iterator) {
+      if (iterator->path == path) {
+        _RemoveCachedReader(iterator, &released);
+        break;
+      }
+    }
+    if (reader->memoryUsage <= _cacheMaxMemory) {
+      CachedReader item = {path, *key, ArchiveReaderRetain(reader)};
+      _cache.push_front(item);
+      _cacheMemoryUsage += reader->memoryUsage;
+      _TrimCache(&released);
+    }
+  }
+  _CloseReaders(released);
+}
+
+void ArchiveReaderCacheInvalidate(const char* path) {
+  size_t length = path ? strlen(path) : 0;
+  std::vector<ArchiveReader*> released;
+  {
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    std::list<CachedReader>::iterator iterator = _cache.begin();
+    while (iterator != _cache.end()) {
+      if ((path == NULL) || (!iterator->path.compare(0, length, path) && ((iterator->path.size() == length) || (iterator->path[length] == '/')))) {
+        iterator = _RemoveCachedReader(iterator, &released);
+      } else {
+        ++iterator;
+      }
+    }
+  }
+  _CloseReaders(released);
+}
+
+void ArchiveReaderCacheSetBudget(size_t maxMemory, size_t maxReaders) {
+  std::vector<ArchiveReader*> released;
+  {
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    _cacheMaxMemory = maxMemory;
+    _cacheMaxReaders = maxReaders;
+    _TrimCache(&released);
+  }
+  _CloseReaders(released);
+}
@@ -0,0 +1,86 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "unzip.h"
+
+typedef enum {
+  kArchiveReaderFormat_Unknown = 0,
+  kArchiveReaderFormat_ZIP,
+  kArchiveReaderFormat_RAR,
+  kArchiveReaderFormat_TAR
+} ArchiveReaderFormat;
+
+typedef struct ArchiveReaderEntry {
+  const char* name;  // As stored (UTF-8 or Latin-1 for ZIP and TAR, ASCII for RAR) with '/' as separator
+  unsigned long long size;
+  unsigned long long packedSize;
+  unsigned long crc;  // Always 0 for TAR which only checksums the headers
+  bool isDirectory;
+  bool isEncrypted;  // Cannot be read
+} ArchiveReaderEntry;
+
+// Opened once, after which the entries never change and every function can be called from any thread
+// Readers are reference counted so a single one can be shared, ArchiveReaderClose() releases a reference
+typedef struct ArchiveReader ArchiveReader;
+
+struct DirectoryCacheKey;  // See DirectoryCache.h
+
+typedef int (*ArchiveReaderSink)(void* context, const void* bytes, size_t length);  // Returns 0 to get the rest of the entry
+typedef void (*ArchiveReaderPrefixHandler)(void* context, size_t index, const void* bytes, size_t length);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Plain C interface to the C++ engine so it can be shared with non-Objective-C code like the benchmarks
+ArchiveReaderFormat ArchiveReaderDetectFormat(const char* path);  // Only reads the signature
+ArchiveReader* ArchiveReaderOpen(const char* path);  // Returns NULL if not a valid ZIP, RAR or TAR archive whatever the file extension
+ArchiveReader* ArchiveReaderOpenZIPWithEntryList(const char* path, const unz_entry_list* list);  // From a directory cache, see unzReaderOpenWithEntryList()
+ArchiveReader* ArchiveReaderOpenZIPSalvage(const char* path);  // Lists the complete entries from the local headers of a ZIP archive without central directory, like an interrupted upload
+ArchiveReader* ArchiveReaderOpenZIPData(const void* bytes, size_t length);  // Bytes must stay valid until the reader is closed
+ArchiveReader* ArchiveReaderOpenTARWithEntryList(const char* path, const unz_entry_list* list);  // From a directory cache, the offsets are the ones of the entry data
+ArchiveReader* ArchiveReaderRetain(ArchiveReader* reader);  // Returns the reader
+void ArchiveReaderClose(ArchiveReader* reader);  // Closes the reader once the last reference is released
+ArchiveReaderFormat ArchiveReaderGetFormat(const ArchiveReader* reader);
+size_t ArchiveReaderGetEntryCount(const ArchiveReader* reader);
+const ArchiveReaderEntry* ArchiveReaderGetEntry(const ArchiveReader* reader, size_t index);
+const unz_entry_list* ArchiveReaderGetZIPEntryList(const ArchiveReader* reader);  // Same indexes as the entries, NULL for RAR
+const unz_entry_list* ArchiveReaderGetTAREntryList(const ArchiveReader* reader);  // Same for TAR with uncompressed entries, NULL otherwise
+long ArchiveReaderFindEntry(const ArchiveReader* reader, const char* name);  // Returns -1 if not found
+bool ArchiveReaderReadEntry(const ArchiveReader* reader, size_t index, void* buffer, size_t size);  // Buffer must hold the whole entry, checks the CRC except for TAR
+bool ArchiveReaderReadEntryToSink(const ArchiveReader* reader, size_t index, ArchiveReaderSink sink, void* context);  // Checks the CRC except for TAR
+bool ArchiveReaderReadEntryPrefix(const ArchiveReader* reader, size_t index, void* buffer, size_t size, size_t* length);  // Decodes no more than needed
+const void* ArchiveReaderGetEntryBytes(const ArchiveReader* reader, size_t index, size_t* length);  // Only for stored ZIP entries and TAR entries of mapped files, NULL otherwise
+bool ArchiveReaderExtractEntryToFile(const ArchiveReader* reader, size_t index, const char* path);
+bool ArchiveReaderExtractEntries(const ArchiveReader* reader, const bool* selection, const char* directory);  // In a single pass, NULL selection for all entries
+bool ArchiveReaderReadEntryPrefixes(const ArchiveReader* reader, const bool* selection, void* buffer, size_t size, ArchiveReaderPrefixHandler handler, void* context);  // Same for ArchiveReaderReadEntryPrefix()
+void ArchiveReaderPrefetchEntries(const ArchiveReader* reader, const size_t* indexes, size_t count);  // Lets the storage fetch ZIP or TAR entries about to be read in the background, does nothing for RAR
+bool ArchiveReaderReadEntries(const ArchiveReader* reader, const size_t* limits, ArchiveReaderPrefixHandler handler, void* context);  // In a single pass, whole entries (CRC checked) if the limit covers their size, prefixes otherwise and skipped if 0
+long ArchiveReaderFindCover(const ArchiveReader* reader);  // Returns the visible image named like a cover or otherwise first in natural order, -1 if none
+
+// Process-wide cache of open readers so the comic reader, the importer and the web server opening the same archive in turn share the parsed entries
+// A reader is only reused while the file keeps the same identity and the least recently used ones are closed past the budget
+ArchiveReader* ArchiveReaderCacheOpen(const char* path);  // Same as ArchiveReaderOpen() but reuses the reader of an unchanged file, close with ArchiveReaderClose()
+ArchiveReader* ArchiveReaderCacheLookup(const char* path, const struct DirectoryCacheKey* key);  // Returns a new reference or NULL if not cached for this identity
+void ArchiveReaderCacheInsert(const char* path, const struct DirectoryCacheKey* key, ArchiveReader* reader);  // Key must be captured before opening, the caller keeps its reference
+void ArchiveReaderCacheInvalidate(const char* path);  // The archive or all archives in the directory at this path, NULL for all
+void ArchiveReaderCacheSetBudget(size_t maxMemory, size_t maxReaders);  // Defaults to 4 MiB of entries for 16 readers
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,41 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#import <Foundation/Foundation.h>
+
+// Generates a single CBZ from the comics in a directory while it is being read, so it can be sent
+// to a socket with constant memory and no temporary archive: pages of ZIP comics are passed through
+// without recompression and pages of RAR or TAR comics are stored, each comic going in its own folder
+@interface CollectionArchive : NSObject {
+@private
+  NSArray* _comics;
+  NSUInteger _comicIndex;
+  void* _zipStream;
+  NSMutableData* _output;
+  void* _buffer;
+  NSString* _prefix;
+  void* _unzFile;
+  BOOL _inEntry;
+  id _archive;  // UnRAR or TarArchive
+  NSArray* _pages;
+  NSUInteger _pageIndex;
+  NSData* _pageData;
+  NSUInteger _pageOffset;
+  BOOL _finished;
+  BOOL _failed;
+}
+- (id) initWithDirectoryPath:(NSString*)path;
+- (NSData*) readData:(NSError**)error;  // Returns empty data once the archive is complete or nil on error
+@end
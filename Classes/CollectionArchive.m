@@ -0,0 +1,226 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#import "CollectionArchive.h"
+#import "ImageDecompression.h"
+#import "Library.h"
+#import "MiniZip.h"
+#import "TarArchive.h"
+#import "UnRAR.h"
+#import "unzip.h"
+#import "zipstream.h"
+
+#define kBufferSize (64 * 1024)  // Also the minimum size returned by -readData:
+
+static int ZCALLBACK _WriteOutput(voidpf opaque, const void* buf, uLong size) {
+  [(NSMutableData*)opaque appendBytes:buf length:size];
+  return 0;
+}
+
+@implementation CollectionArchive
+
+- (id) initWithDirectoryPath:(NSString*)path {
+  if ((self = [super init])) {
+    NSMutableArray* comics = [NSMutableArray array];
+    for (NSString* file in SortFileNames([[NSFileManager defaultManager] contentsOfDirectoryAtPath:path error:NULL])) {
+      NSString* extension = [[file pathExtension] lowercaseString];
+      if (![file hasPrefix:@"."] && ([extension isEqualToString:@"zip"] || [extension isEqualToString:@"cbz"] ||
+                                     [extension isEqualToString:@"rar"] || [extension isEqualToString:@"cbr"] ||
+                                     [extension isEqualToString:@"tar"] || [extension isEqualToString:@"cbt"])) {
+        [comics addObject:[path stringByAppendingPathComponent:file]];
+      }
+    }
+    _comics = [comics copy];
+    _output = [[NSMutableData alloc] initWithCapacity:(2 * kBufferSize)];
+    _buffer = malloc(kBufferSize);
+    _zipStream = zipStreamOpen(_WriteOutput, _output);
+    if (_zipStream == NULL) {
+      [self release];
+      return nil;
+    }
+  }
+  return self;
+}
+
+- (void) _closeComic {
+  if (_unzFile) {
+    if (_inEntry) {
+      unzCloseCurrentFile(_unzFile);
+    }
+    unzClose(_unzFile);
+    _unzFile = NULL;
+  }
+  _inEntry = NO;
+  [_pageData release];
+  _pageData = nil;
+  [_archive release];
+  _archive = nil;
+  [_pages release];
+  _pages = nil;
+  [_prefix release];
+  _prefix = nil;
+}
+
+- (void) dealloc {
+  [self _closeComic];
+  if (_zipStream) {
+    zipStreamClose(_zipStream, NULL);  // Discards the output
+  }
+  free(_buffer);
+  [_output release];
+  [_comics release];
+
+  [super dealloc];
+}
+
+- (const char*) _entryNameForPage:(NSString*)page {
+  return [[_prefix stringByAppendingPathComponent:page] UTF8String];
+}
+
+- (void) _goToNextZipEntry {
+  if (unzGoToNextFile(_unzFile) != UNZ_OK) {
+    [self _closeComic];
+  }
+}
+
+- (BOOL) _stepZip {
+  int result;
+  if (_inEntry) {
+    result = unzReadCurrentFile(_unzFile, _buffer, kBufferSize);
+    if (result > 0) {
+      result = zipStreamWriteInFile(_zipStream, _buffer, result);
+    } else if (result == 0) {
+      _inEntry = NO;
+      result = unzCloseCurrentFile(_unzFile);
+      if (result == UNZ_OK) {
+        result = zipStreamCloseFile(_zipStream);
+        [self _goToNextZipEntry];
+      }
+    }
+  } else {
+    char filename[1024];
+    unz_file_info64 info;
+    result = unzGetCurrentFileInfo64(_unzFile, &info, filename, sizeof(filename), NULL, 0, NULL, 0);
+    if (result == UNZ_OK) {
+      NSString* page = PathFromArchiveFileName(filename);
+      if (page && !(info.flag & 1) && ![[page lastPathComponent] hasPrefix:@"."] && IsImageFileExtensionSupported([page pathExtension])) {
+        int method;
+        int level;
+        result = unzOpenCurrentFile2(_unzFile, &method, &level, 1);  // Raw so the compressed data pass through
+        if (result == UNZ_OK) {
+          _inEntry = YES;
+          zip_fileinfo fileInfo;
+          bzero(&fileInfo, sizeof(fileInfo));
+          fileInfo.dosDate = info.dosDate;
+          result = zipStreamOpenNewFileRaw(_zipStream, [self _entryNameForPage:page], &fileInfo, method, level,
+                                           info.crc, info.compressed_size, info.uncompressed_size);
+        }
+      } else {
+        [self _goToNextZipEntry];
+      }
+    }
+  }
+  if (result < 0) {
+    XLOG_ERROR(@"Failed streaming ZIP entry (%i)", result);
+    return NO;
+  }
+  return YES;
+}
+
+// RAR pages are decompressed one at a time in memory and TAR pages are read in place
+- (BOOL) _stepPages {
+  if (_pageData == nil) {
+    if (_pageIndex == _pages.count) {
+      [self _closeComic];
+      return YES;
+    }
+    NSString* page = [_pages objectAtIndex:_pageIndex++];
+    _pageData = [[_archive dataForFile:page] retain];
+    _pageOffset = 0;
+    if (_pageData == nil) {
+      XLOG_ERROR(@"Failed extracting page \"%@\"", page);
+      return NO;
+    }
+    return zipStreamOpenNewFile(_zipStream, [self _entryNameForPage:page], NULL, 0, 0) == ZIP_OK;  // Images are already compressed
+  }
+  NSUInteger count = MIN(_pageData.length - _pageOffset, kBufferSize);
+  if (count > 0) {
+    int result = zipStreamWriteInFile(_zipStream, (const char*)_pageData.bytes + _pageOffset, (unsigned)count);
+    _pageOffset += count;
+    return result == ZIP_OK;
+  }
+  [_pageData release];
+  _pageData = nil;
+  return zipStreamCloseFile(_zipStream) == ZIP_OK;
+}
+
+- (BOOL) _step {
+  if (_unzFile) {
+    return [self _stepZip];
+  }
+  if (_archive) {
+    return [self _stepPages];
+  }
+  if (_comicIndex == _comics.count) {
+    int result = zipStreamClose(_zipStream, NULL);
+    _zipStream = NULL;
+    _finished = YES;
+    return result == ZIP_OK;
+  }
+
+  NSString* path = [_comics objectAtIndex:_comicIndex++];
+  NSString* extension = [[path pathExtension] lowercaseString];
+  _prefix = [[[path lastPathComponent] stringByDeletingPathExtension] copy];
+  if ([extension isEqualToString:@"zip"] || [extension isEqualToString:@"cbz"]) {
+    _unzFile = unzOpen64([path fileSystemRepresentation]);
+    if (_unzFile && (unzGoToFirstFile(_unzFile) != UNZ_OK)) {
+      [self _closeComic];
+    }
+  } else {
+    if ([extension isEqualToString:@"tar"] || [extension isEqualToString:@"cbt"]) {
+      _archive = [[TarArchive alloc] initWithArchiveAtPath:path];
+    } else {
+      _archive = [[UnRAR alloc] initWithArchiveAtPath:path];
+    }
+    _pages = [RetrieveComicPages(_archive) retain];
+    _pageIndex = 0;
+  }
+  if ((_unzFile == NULL) && (_archive == nil)) {
+    XLOG_WARNING(@"Skipping comic \"%@\" that cannot be opened", path);
+    [self _closeComic];
+  }
+  return YES;
+}
+
+- (NSData*) readData:(NSError**)error {
+  NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+  while (!_failed && !_finished && (_output.length < kBufferSize)) {
+    if (![self _step]) {
+      _failed = YES;
+    }
+  }
+  [pool release];
+  if (_failed) {
+    if (error) {
+      *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EIO userInfo:nil];
+    }
+    return nil;
+  }
+  NSData* data = [NSData dataWithData:_output];
+  [_output setLength:0];
+  return data;
+}
+
+@end
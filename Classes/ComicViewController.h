@@ -20,7 +20,8 @@
 typedef enum {
   kComicType_PDF,
   kComicType_ZIP,
-  kComicType_RAR
+  kComicType_RAR,
+  kComicType_TAR
 } ComicType;
 
 @interface ComicViewController : UIViewController <UINavigationBarDelegate, DocumentViewDelegate, NavigationControlDelegate> {
@@ -33,6 +34,8 @@ typedef enum {
   NSString* _path;
   ComicType _type;
   id _contents;
+  NSArray* _pages;
+  NSUInteger _readAheadIndex;
   DocumentView* _documentView;
   UILabel* _pageLabel;
 }
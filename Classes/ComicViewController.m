@@ -22,6 +22,7 @@
 #import "ComicViewController.h"
 #import "ZoomView.h"
 #import "MiniZip.h"
+#import "TarArchive.h"
 #import "UnRAR.h"
 #import "ImageDecompression.h"
 
@@ -29,6 +30,7 @@
 #define kLeftZoneRatio 0.2
 #define kRightZoneRatio 0.8
 #define kDoubleTapZoomRatio 1.5
+#define kReadAheadPageCount 3
 
 @interface ComicDocumentView : DocumentView
 @end
@@ -36,8 +38,10 @@
 @interface ComicPageView : ZoomView {
 @private
   NSString* _file;
+  CGSize _imageSize;
 }
 @property(nonatomic, copy) NSString* file;
+@property(nonatomic) CGSize imageSize;  // From the page manifest, zero if unknown
 - (id) initWithTapTarget:(id)target action:(SEL)action;
 - (void) displayImage:(UIImage*)anImage;
 @end
@@ -64,7 +68,7 @@
 
 @implementation ComicPageView
 
-@synthesize file=_file;
+@synthesize file=_file, imageSize=_imageSize;
 
 - (id) initWithTapTarget:(id)target action:(SEL)action {
   if ((self = [super init])) {
@@ -82,11 +86,18 @@
   return self;
 }
 
+// Without an image, shows a placeholder with the geometry the decoded page will have if known so the layout doesn't change
 - (void) displayImage:(UIImage*)anImage {
   if (anImage) {
     UIImageView* imageView = [[UIImageView alloc] initWithImage:anImage];
     [self setDisplayView:imageView];
     [imageView release];
+  } else if ((_imageSize.width > 0.0) && (_imageSize.height > 0.0)) {
+    CGFloat maxPageSize = kMaxPageSize * [[UIScreen mainScreen] scale];
+    CGFloat scale = MIN(MIN(maxPageSize / _imageSize.width, maxPageSize / _imageSize.height), 1.0);  // Same as CreateCGImageFromFileData()
+    UIView* placeholderView = [[UIView alloc] initWithFrame:CGRectMake(0, 0, roundf(_imageSize.width * scale), roundf(_imageSize.height * scale))];
+    [self setDisplayView:placeholderView];
+    [placeholderView release];
   } else {
     [self setDisplayView:nil];
   }
@@ -124,12 +135,12 @@
           _contents = [[NSNumber alloc] initWithInteger:CGPDFDocumentGetNumberOfPages(document)];
           CGPDFDocumentRelease(document);
         }
-      } else if (![extension caseInsensitiveCompare:@"zip"] || ![extension caseInsensitiveCompare:@"cbz"] || ![extension caseInsensitiveCompare:@"rar"] || ![extension caseInsensitiveCompare:@"cbr"]) {
-        _type = kComicType_ZIP;
-        _contents = [[MiniZip alloc] initWithArchiveAtPath:_path];
-        if (_contents == nil) {
+      } else if (![extension caseInsensitiveCompare:@"zip"] || ![extension caseInsensitiveCompare:@"cbz"] || ![extension caseInsensitiveCompare:@"rar"] || ![extension caseInsensitiveCompare:@"cbr"] || ![extension caseInsensitiveCompare:@"tar"] || ![extension caseInsensitiveCompare:@"cbt"]) {
+        _contents = CreateComicArchive(_path, YES);
+        if ([_contents isKindOfClass:[UnRAR class]]) {
           _type = kComicType_RAR;
-          _contents = [[UnRAR alloc] initWithArchiveAtPath:_path];
+        } else {
+          _type = [_contents isKindOfClass:[TarArchive class]] ? kComicType_TAR : kComicType_ZIP;
         }
       }
     }
@@ -146,6 +157,7 @@
       case kComicType_PDF: type = @"PDF"; break;
       case kComicType_ZIP: type = @"ZIP"; break;
       case kComicType_RAR: type = @"RAR"; break;
+      case kComicType_TAR: type = @"TAR"; break;
     }
     [[AppDelegate sharedDelegate] logEvent:@"comic.read" withParameterName:@"type" value:type];
   }
@@ -162,6 +174,7 @@
   
   [_pageLabel release];
   [_documentView release];
+  [_pages release];
   [_contents release];
   [_path release];
   [_comic release];
@@ -201,15 +214,10 @@
       CGPDFDocumentRelease(document);
     }
   } else {
-    NSString* temp = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
-    if ([_contents extractFile:[(ComicPageView*)view file] toPath:temp]) {
-      NSData* data = [[NSData alloc] initWithContentsOfFile:temp];
-      if (data) {
-        NSString* extension = [[(ComicPageView*)view file] pathExtension];
-        imageRef = CreateCGImageFromFileData(data, extension, CGSizeMake(maxPageSize, maxPageSize), NO);
-        [data release];
-      }
-      [[NSFileManager defaultManager] removeItemAtPath:temp error:NULL];
+    NSData* data = [_contents dataForFile:[(ComicPageView*)view file]];
+    if (data) {
+      NSString* extension = [[(ComicPageView*)view file] pathExtension];
+      imageRef = CreateCGImageFromFileData(data, extension, CGSizeMake(maxPageSize, maxPageSize), NO);
     }
   }
   if (imageRef) {
@@ -247,6 +255,20 @@
   }
 }
 
+// Pages follow each other in a ZIP or TAR so the next ones in the reading direction can be fetched from storage while the current one is read
+- (void) _readAheadFromPageIndex:(NSUInteger)index {
+  if (((_type != kComicType_ZIP) && (_type != kComicType_TAR)) || (_pages == nil)) {
+    return;
+  }
+  NSInteger step = index < _readAheadIndex ? -1 : 1;
+  _readAheadIndex = index;
+  NSMutableArray* files = [NSMutableArray arrayWithCapacity:kReadAheadPageCount];
+  for (NSInteger i = (NSInteger)index + step; (files.count < kReadAheadPageCount) && (i >= 0) && (i < (NSInteger)_pages.count); i += step) {
+    [files addObject:[_pages objectAtIndex:i]];
+  }
+  [(MiniZip*)_contents prefetchFiles:files];
+}
+
 - (void) viewDidLoad {
   [super viewDidLoad];
   
@@ -322,22 +344,30 @@
       [view release];
     }
   } else {
-    [_contents setSkipInvisibleFiles:YES];
     NSUInteger index = 0;
-    for (NSString* file in [[_contents retrieveFileList] sortedArrayUsingSelector:@selector(localizedStandardCompare:)]) {
-      if (IsImageFileExtensionSupported([file pathExtension])) {
-        ComicPageView* view = [[ComicPageView alloc] initWithTapTarget:self action:@selector(_tapAction:)];
-        view.tag = ++index;
-        view.file = file;
-        [array addObject:view];
-        [view release];
+    NSArray* pages = RetrieveComicPages(_contents);
+    [_pages release];
+    _pages = [pages retain];
+    NSDictionary* dimensions = [_contents cachedImageDimensions];  // Page manifest saved on import
+    for (NSString* file in pages) {
+      ComicPageView* view = [[ComicPageView alloc] initWithTapTarget:self action:@selector(_tapAction:)];
+      view.tag = ++index;
+      view.file = file;
+      NSValue* size = [dimensions objectForKey:file];
+      if (size) {
+        view.imageSize = [size CGSizeValue];
+        [view displayImage:nil];
       }
+      [array addObject:view];
+      [view release];
     }
   }
   [_documentView setPageViews:array initialPageIndex:MAX(_comic.status, 0)];
   _navigationControl.numberOfPages = array.count;
   _navigationControl.numberOfMarkers = MIN(array.count, 50);
   _navigationControl.currentPage = _documentView.selectedPageIndex;
+  _readAheadIndex = _documentView.selectedPageIndex;
+  [self _readAheadFromPageIndex:_documentView.selectedPageIndex];
   if (array.count == 0) {
     _navigationBar.hidden = NO;
     _navigationControl.hidden = NO;
@@ -365,6 +395,7 @@
   _navigationControl.currentPage = _documentView.selectedPageIndex;
   
   if (_documentView.pageViews) {
+    [self _readAheadFromPageIndex:_documentView.selectedPageIndex];
     [[AppDelegate sharedDelegate] logPageView];
   }
 }
@@ -0,0 +1,272 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "DirectoryCache.h"
+
+// All integers are little-endian, the CRC covers everything after the header
+#define kMagic "CFDC"
+#define kVersion 3  // Version 1 had no image information in the pages and version 2 no cover page
+#define kHeaderSize 72
+#define kEntrySize 64
+#define kPageSize 16
+#define kMaxFileSize (64 * 1024 * 1024)
+
+static unsigned int _ReadLE32(const unsigned char* bytes) {
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+static unsigned long long _ReadLE64(const unsigned char* bytes) {
+  return _ReadLE32(bytes) | ((unsigned long long)_ReadLE32(&bytes[4]) << 32);
+}
+
+static void _WriteLE32(unsigned char* bytes, unsigned int value) {
+  bytes[0] = value;
+  bytes[1] = value >> 8;
+  bytes[2] = value >> 16;
+  bytes[3] = value >> 24;
+}
+
+static void _WriteLE64(unsigned char* bytes, unsigned long long value) {
+  _WriteLE32(bytes, (unsigned int)value);
+  _WriteLE32(&bytes[4], (unsigned int)(value >> 32));
+}
+
+static void _WriteKey(unsigned char* bytes, const DirectoryCacheKey* key) {
+  _WriteLE64(&bytes[0], key->device);
+  _WriteLE64(&bytes[8], key->inode);
+  _WriteLE64(&bytes[16], key->size);
+  _WriteLE64(&bytes[24], key->modificationTime);
+}
+
+bool DirectoryCacheGetKey(const char* archivePath, DirectoryCacheKey* key) {
+  struct stat info;
+  if (stat(archivePath, &info) != 0) {
+    return false;
+  }
+  key->device = info.st_dev;
+  key->inode = info.st_ino;
+  key->size = info.st_size;
+#ifdef __APPLE__
+  key->modificationTime = (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+  key->modificationTime = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+void DirectoryCacheGetFileName(const DirectoryCacheKey* key, char* buffer, size_t size) {
+  snprintf(buffer, size, "%llx-%llx.dir", key->device, key->inode);
+}
+
+// Checks every offset against the actual sizes so a corrupted cache can never be trusted
+static bool _ParseContents(const unsigned char* bytes, size_t length, DirectoryCacheContents* contents) {
+  unsigned long long entryCount = _ReadLE32(&bytes[44]);
+  unsigned long long namesSize = _ReadLE32(&bytes[48]);
+  unsigned long long pageCount = _ReadLE32(&bytes[52]);
+  if (length != kHeaderSize + entryCount * kEntrySize + namesSize + pageCount * kPageSize) {
+    return false;
+  }
+  if (_ReadLE32(&bytes[64]) != crc32(0, &bytes[kHeaderSize], (uInt)(length - kHeaderSize))) {
+    return false;
+  }
+
+  const unsigned char* entry = &bytes[kHeaderSize];
+  const unsigned char* names = entry + entryCount * kEntrySize;
+  const unsigned char* page = names + namesSize;
+  memset(contents, 0, sizeof(DirectoryCacheContents));
+  contents->format = _ReadLE32(&bytes[40]);
+  contents->list.entries = malloc(entryCount * sizeof(unz_entry) + namesSize + 1);  // Same layout as unzGetEntryList()
+  contents->pages = malloc(pageCount * sizeof(DirectoryCachePage) + 1);
+  if ((contents->list.entries == NULL) || (contents->pages == NULL)) {
+    DirectoryCacheFreeContents(contents);
+    return false;
+  }
+  contents->list.names = (char*)(contents->list.entries + entryCount);
+  memcpy(contents->list.names, names, namesSize);
+  contents->list.number_entry = entryCount;
+  contents->list.byte_before_the_zipfile = _ReadLE64(&bytes[56]);
+  for (unsigned long long i = 0; i < entryCount; ++i, entry += kEntrySize) {
+    unz_entry* item = &contents->list.entries[i];
+    item->name_offset = _ReadLE32(&entry[0]);
+    item->size_filename = _ReadLE32(&entry[4]);
+    if ((item->name_offset >= namesSize) || (item->size_filename >= namesSize - item->name_offset) || names[item->name_offset + item->size_filename]) {
+      DirectoryCacheFreeContents(contents);
+      return false;
+    }
+    item->flag = _ReadLE32(&entry[8]);
+    item->compression_method = _ReadLE32(&entry[12]);
+    item->crc = _ReadLE32(&entry[16]);
+    item->dosDate = _ReadLE32(&entry[20]);
+    item->compressed_size = _ReadLE64(&entry[24]);
+    item->uncompressed_size = _ReadLE64(&entry[32]);
+    item->offset_curfile = _ReadLE64(&entry[40]);
+    item->file_pos.pos_in_zip_directory = _ReadLE64(&entry[48]);
+    item->file_pos.num_of_file = _ReadLE64(&entry[56]);
+  }
+  contents->pageCount = pageCount;
+  contents->coverPage = _ReadLE32(&bytes[68]);
+  if (contents->coverPage && (contents->coverPage >= pageCount)) {
+    DirectoryCacheFreeContents(contents);
+    return false;
+  }
+  for (unsigned long long i = 0; i < pageCount; ++i, page += kPageSize) {
+    DirectoryCachePage* item = &contents->pages[i];
+    item->entry = _ReadLE32(&page[0]);
+    item->imageFormat = _ReadLE32(&page[4]);
+    item->width = _ReadLE32(&page[8]);
+    item->height = _ReadLE32(&page[12]);
+    if (item->entry >= entryCount) {
+      DirectoryCacheFreeContents(contents);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DirectoryCacheRead(const char* cachePath, const DirectoryCacheKey* key, DirectoryCacheContents* contents) {
+  int fd = open(cachePath, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool success = false;
+  bool invalid = true;
+  struct stat info;
+  if ((fstat(fd, &info) == 0) && (info.st_size >= kHeaderSize) && (info.st_size <= kMaxFileSize)) {
+    size_t length = (size_t)info.st_size;
+    unsigned char* bytes = malloc(length);
+    size_t offset = 0;
+    while (bytes && (offset < length)) {
+      ssize_t count = read(fd, &bytes[offset], length - offset);
+      if (count > 0) {
+        offset += count;
+      } else if ((count == 0) || (errno != EINTR)) {
+        break;
+      }
+    }
+    if (offset == length) {
+      unsigned char expected[32];
+      _WriteKey(expected, key);
+      if (!memcmp(bytes, kMagic, 4) && (_ReadLE32(&bytes[4]) == kVersion) && !memcmp(&bytes[8], expected, sizeof(expected))) {
+        success = _ParseContents(bytes, length, contents);
+      }
+      invalid = !success;  // Corrupted, from another version or stale because the archive was modified
+    } else {
+      invalid = false;  // Let a later read try again
+    }
+    free(bytes);
+  }
+  close(fd);
+  if (invalid) {
+    unlink(cachePath);
+  }
+  return success;
+}
+
+bool DirectoryCacheWrite(const char* cachePath, const DirectoryCacheKey* key, const DirectoryCacheContents* contents) {
+  unsigned long long entryCount = contents->list.number_entry;
+  unsigned long long namesSize = 0;
+  for (unsigned long long i = 0; i < entryCount; ++i) {
+    const unz_entry* item = &contents->list.entries[i];
+    if (item->name_offset + item->size_filename + 1 > namesSize) {
+      namesSize = item->name_offset + item->size_filename + 1;
+    }
+  }
+  unsigned long long length = kHeaderSize + entryCount * kEntrySize + namesSize + contents->pageCount * kPageSize;
+  if ((entryCount > 0xFFFFFFFF) || (namesSize > 0xFFFFFFFF) || (length > kMaxFileSize)) {
+    return false;
+  }
+
+  unsigned char* bytes = calloc(1, length);
+  if (bytes == NULL) {
+    return false;
+  }
+  memcpy(bytes, kMagic, 4);
+  _WriteLE32(&bytes[4], kVersion);
+  _WriteKey(&bytes[8], key);
+  _WriteLE32(&bytes[40], contents->format);
+  _WriteLE32(&bytes[44], (unsigned int)entryCount);
+  _WriteLE32(&bytes[48], (unsigned int)namesSize);
+  _WriteLE32(&bytes[52], (unsigned int)contents->pageCount);
+  _WriteLE64(&bytes[56], contents->list.byte_before_the_zipfile);
+  _WriteLE32(&bytes[68], (unsigned int)contents->coverPage);
+  unsigned char* entry = &bytes[kHeaderSize];
+  for (unsigned long long i = 0; i < entryCount; ++i, entry += kEntrySize) {
+    const unz_entry* item = &contents->list.entries[i];
+    _WriteLE32(&entry[0], (unsigned int)item->name_offset);
+    _WriteLE32(&entry[4], (unsigned int)item->size_filename);
+    _WriteLE32(&entry[8], (unsigned int)item->flag);
+    _WriteLE32(&entry[12], (unsigned int)item->compression_method);
+    _WriteLE32(&entry[16], (unsigned int)item->crc);
+    _WriteLE32(&entry[20], (unsigned int)item->dosDate);
+    _WriteLE64(&entry[24], item->compressed_size);
+    _WriteLE64(&entry[32], item->uncompressed_size);
+    _WriteLE64(&entry[40], item->offset_curfile);
+    _WriteLE64(&entry[48], item->file_pos.pos_in_zip_directory);
+    _WriteLE64(&entry[56], item->file_pos.num_of_file);
+    memcpy(&bytes[kHeaderSize + entryCount * kEntrySize + item->name_offset], contents->list.names + item->name_offset, item->size_filename);
+  }
+  unsigned char* page = &bytes[kHeaderSize + entryCount * kEntrySize + namesSize];
+  for (unsigned long i = 0; i < contents->pageCount; ++i, page += kPageSize) {
+    const DirectoryCachePage* item = &contents->pages[i];
+    _WriteLE32(&page[0], (unsigned int)item->entry);
+    _WriteLE32(&page[4], (unsigned int)item->imageFormat);
+    _WriteLE32(&page[8], item->width);
+    _WriteLE32(&page[12], item->height);
+  }
+  _WriteLE32(&bytes[64], (unsigned int)crc32(0, &bytes[kHeaderSize], (uInt)(length - kHeaderSize)));
+
+  // Write to a unique temporary file then rename it so concurrent readers and writers never see a partial cache
+  bool success = false;
+  size_t size = strlen(cachePath) + 8;
+  char* temp = malloc(size);
+  if (temp) {
+    snprintf(temp, size, "%s.XXXXXX", cachePath);
+    int fd = mkstemp(temp);
+    if (fd >= 0) {
+      size_t offset = 0;
+      while (offset < length) {
+        ssize_t count = write(fd, &bytes[offset], (size_t)length - offset);
+        if (count > 0) {
+          offset += count;
+        } else if ((count == 0) || (errno != EINTR)) {
+          break;
+        }
+      }
+      if ((close(fd) == 0) && (offset == length) && (rename(temp, cachePath) == 0)) {
+        success = true;
+      } else {
+        unlink(temp);
+      }
+    }
+    free(temp);
+  }
+  free(bytes);
+  return success;
+}
+
+void DirectoryCacheFreeContents(DirectoryCacheContents* contents) {
+  free(contents->list.entries);
+  free(contents->pages);
+  memset(contents, 0, sizeof(DirectoryCacheContents));
+}
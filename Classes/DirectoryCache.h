@@ -0,0 +1,62 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "unzip.h"
+
+#define kDirectoryCacheFormat_ZIP 1
+#define kDirectoryCacheFormat_RAR 2
+#define kDirectoryCacheFormat_TAR 3
+
+// Identity of an archive file: a cache is only valid for the exact same file contents
+typedef struct DirectoryCacheKey {
+  unsigned long long device;
+  unsigned long long inode;
+  unsigned long long size;
+  long long modificationTime;  // Nanoseconds
+} DirectoryCacheKey;
+
+// Page manifest entry filled at import time so opening a comic needs neither listing nor probing the archive
+typedef struct DirectoryCachePage {
+  unsigned long entry;  // Index in list.entries
+  int imageFormat;  // ImageHeaderFormat from the first bytes of the page, 0 if not probed
+  unsigned int width;  // In pixels, 0 if unknown
+  unsigned int height;
+} DirectoryCachePage;
+
+typedef struct DirectoryCacheContents {
+  int format;
+  unz_entry_list list;  // All ZIP or TAR entries with their data offsets, or only the page names for RAR
+  unsigned long pageCount;
+  DirectoryCachePage* pages;  // In reading order
+  unsigned long coverPage;  // Index in pages of the image used as cover, see ArchiveReaderFindCover()
+} DirectoryCacheContents;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sidecar file per archive holding its entry list and page manifest, keyed by the identity of the archive
+bool DirectoryCacheGetKey(const char* archivePath, DirectoryCacheKey* key);
+void DirectoryCacheGetFileName(const DirectoryCacheKey* key, char* buffer, size_t size);  // Unique per device and inode
+bool DirectoryCacheRead(const char* cachePath, const DirectoryCacheKey* key, DirectoryCacheContents* contents);  // Deletes stale or corrupted caches
+bool DirectoryCacheWrite(const char* cachePath, const DirectoryCacheKey* key, const DirectoryCacheContents* contents);  // Atomically replaces any previous cache
+void DirectoryCacheFreeContents(DirectoryCacheContents* contents);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,134 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string.h>
+
+#include "ImageHeader.h"
+
+static unsigned int _ReadBE16(const unsigned char* bytes) {
+  return (bytes[0] << 8) | bytes[1];
+}
+
+static unsigned int _ReadBE32(const unsigned char* bytes) {
+  return ((unsigned int)bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+static unsigned int _ReadLE16(const unsigned char* bytes) {
+  return bytes[0] | (bytes[1] << 8);
+}
+
+static unsigned int _ReadLE24(const unsigned char* bytes) {
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+}
+
+// Walks the marker segments up to the first SOFn one
+static bool _GetJPEGDimensions(const unsigned char* bytes, size_t length, unsigned int* width, unsigned int* height) {
+  size_t offset = 2;
+  while (offset + 4 <= length) {
+    if (bytes[offset] != 0xFF) {
+      return false;
+    }
+    unsigned char marker = bytes[offset + 1];
+    if (marker == 0xFF) {  // Fill byte
+      offset += 1;
+      continue;
+    }
+    if ((marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD7))) {  // Standalone markers
+      offset += 2;
+      continue;
+    }
+    if ((marker == 0xD9) || (marker == 0xDA)) {  // EOI or SOS before any SOF
+      return false;
+    }
+    unsigned int segmentLength = _ReadBE16(&bytes[offset + 2]);
+    if (segmentLength < 2) {
+      return false;
+    }
+    if ((marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC)) {
+      if (offset + 9 > length) {
+        return false;
+      }
+      *height = _ReadBE16(&bytes[offset + 5]);
+      *width = _ReadBE16(&bytes[offset + 7]);
+      return true;
+    }
+    offset += 2 + segmentLength;
+  }
+  return false;
+}
+
+static bool _GetWebPDimensions(const unsigned char* bytes, size_t length, unsigned int* width, unsigned int* height) {
+  if (length < 30) {
+    return false;
+  }
+  const unsigned char* chunk = &bytes[12];
+  if (!memcmp(chunk, "VP8 ", 4)) {  // Lossy: 3 bytes frame tag then start code
+    if ((chunk[11] != 0x9D) || (chunk[12] != 0x01) || (chunk[13] != 0x2A)) {
+      return false;
+    }
+    *width = _ReadLE16(&chunk[14]) & 0x3FFF;
+    *height = _ReadLE16(&chunk[16]) & 0x3FFF;
+    return true;
+  }
+  if (!memcmp(chunk, "VP8L", 4)) {  // Lossless: 14 bits per dimension minus one
+    if (chunk[8] != 0x2F) {
+      return false;
+    }
+    unsigned int bits = chunk[9] | (chunk[10] << 8) | (chunk[11] << 16) | ((unsigned int)chunk[12] << 24);
+    *width = (bits & 0x3FFF) + 1;
+    *height = ((bits >> 14) & 0x3FFF) + 1;
+    return true;
+  }
+  if (!memcmp(chunk, "VP8X", 4)) {  // Extended: 24 bits per dimension minus one
+    *width = _ReadLE24(&chunk[12]) + 1;
+    *height = _ReadLE24(&chunk[15]) + 1;
+    return true;
+  }
+  return false;
+}
+
+bool GetImageInfoFromHeader(const void* data, size_t length, ImageHeaderFormat* format, unsigned int* width, unsigned int* height) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  if ((length >= 4) && (bytes[0] == 0xFF) && (bytes[1] == 0xD8)) {
+    *format = kImageHeaderFormat_JPEG;
+    return _GetJPEGDimensions(bytes, length, width, height);
+  }
+  if ((length >= 8) && !memcmp(bytes, "\x89PNG\r\n\x1A\n", 8)) {
+    *format = kImageHeaderFormat_PNG;
+    if ((length < 24) || memcmp(&bytes[12], "IHDR", 4)) {
+      return false;
+    }
+    *width = _ReadBE32(&bytes[16]);
+    *height = _ReadBE32(&bytes[20]);
+    return true;
+  }
+  if ((length >= 10) && (!memcmp(bytes, "GIF87a", 6) || !memcmp(bytes, "GIF89a", 6))) {
+    *format = kImageHeaderFormat_GIF;
+    *width = _ReadLE16(&bytes[6]);
+    *height = _ReadLE16(&bytes[8]);
+    return true;
+  }
+  if ((length >= 16) && !memcmp(bytes, "RIFF", 4) && !memcmp(&bytes[8], "WEBP", 4)) {
+    *format = kImageHeaderFormat_WebP;
+    return _GetWebPDimensions(bytes, length, width, height);
+  }
+  *format = kImageHeaderFormat_Unknown;
+  return false;
+}
+
+bool GetImageDimensionsFromHeader(const void* data, size_t length, unsigned int* width, unsigned int* height) {
+  ImageHeaderFormat format;
+  return GetImageInfoFromHeader(data, length, &format, width, height);
+}
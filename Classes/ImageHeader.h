@@ -0,0 +1,40 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Enough for the SOF marker of JPEGs carrying a full EXIF block
+#define kImageHeaderProbeSize (64 * 1024)
+
+typedef enum {
+  kImageHeaderFormat_Unknown = 0,
+  kImageHeaderFormat_JPEG,
+  kImageHeaderFormat_PNG,
+  kImageHeaderFormat_GIF,
+  kImageHeaderFormat_WebP
+} ImageHeaderFormat;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parses only the header bytes so pages can be laid out without being decoded
+bool GetImageDimensionsFromHeader(const void* bytes, size_t length, unsigned int* width, unsigned int* height);
+bool GetImageInfoFromHeader(const void* bytes, size_t length, ImageHeaderFormat* format, unsigned int* width, unsigned int* height);  // Format is set from the signature even if dimensions are not found
+
+#ifdef __cplusplus
+}
+#endif
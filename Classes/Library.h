@@ -38,6 +38,8 @@
 @interface Comic : DatabaseObject
 @property(nonatomic) DatabaseSQLRowID collection;  // May be 0
 @property(nonatomic, copy) NSString* name;
+@property(nonatomic, copy) NSString* title;  // From ComicInfo.xml if any
+@property(nonatomic, copy) NSData* sortKey;  // From SortKeyGenerate() on the title or otherwise the name, indexed
 #if __STORE_THUMBNAILS_IN_DATABASE__
 @property(nonatomic) DatabaseSQLRowID thumbnail;
 #else
@@ -49,6 +51,7 @@
 
 @interface Collection : DatabaseObject
 @property(nonatomic, copy) NSString* name;
+@property(nonatomic, copy) NSData* sortKey;  // From SortKeyGenerate() on the name, indexed
 #if __STORE_THUMBNAILS_IN_DATABASE__
 @property(nonatomic) DatabaseSQLRowID thumbnail;
 #else
@@ -67,6 +70,8 @@
 + (NSString*) libraryRootPath;
 + (NSString*) libraryApplicationDataPath;
 + (NSString*) libraryDatabasePath;
++ (NSString*) libraryDirectoryCachePath;  // Created on first call
++ (void) removeDirectoryCachesForPath:(NSString*)path;  // Archive or all archives in the directory, must be called before deleting them
 + (LibraryConnection*) mainConnection;  // For main thread only
 - (NSArray*) fetchAllComicsByName;
 - (NSArray*) fetchAllComicsByDate;
@@ -96,3 +101,17 @@
 + (LibraryUpdater*) sharedUpdater;
 - (void) update:(BOOL)force;  // Does nothing if already updating
 @end
+
+// Image files of a MiniZip, TarArchive or UnRAR archive in reading order, from its directory cache if valid or otherwise saved to it
+// (the library import saves the format and dimensions of each page along with them)
+NSArray* RetrieveComicPages(id archive);
+
+// File names in the order of -localizedStandardCompare: (approximately) by comparing precomputed SortKey.h keys
+NSArray* SortFileNames(NSArray* names);
+
+// Key for the "sortKey" property of comics and collections from their name
+NSData* SortKeyForName(NSString* name);
+
+// MiniZip, TarArchive or UnRAR archive picked from the file signature using the library directory cache, retained or nil if it cannot be opened
+// (the reader cache is only worth it for archives opened again soon like the comic being read, not for a single pass like the import)
+id CreateComicArchive(NSString* path, BOOL readerCache);
@@ -19,11 +19,16 @@
 #import "Library.h"
 #import "Defaults.h"
 #import "MiniZip.h"
+#import "TarArchive.h"
 #import "UnRAR.h"
+#import "ArchiveReader.h"
+#import "DirectoryCache.h"
+#import "SortKey.h"
 #import "Extensions_Foundation.h"
 #import "ImageDecompression.h"
 
 #define kInboxDirectoryName @"Inbox"
+#define kComicInfoFileName @"ComicInfo.xml"
 
 #define kComicCoverX 10
 #define kComicCoverY 8
@@ -49,13 +54,234 @@ typedef enum {
   kArchiveType_Unknown,
   kArchiveType_ZIP,
   kArchiveType_RAR,
+  kArchiveType_TAR,
   kArchiveType_PDF
 } ArchiveType;
 
+// Everything the import needs from a comic archive, see _ImportComicArchive()
+typedef struct {
+  NSString* cover;  // Named like a cover or otherwise the first page
+  NSData* coverData;
+  NSDictionary* info;  // Elements of ComicInfo.xml used by the library
+} ComicImport;
+
+// Collects the few ComicInfo.xml elements used by the library as they are parsed
+@interface ComicInfoParser : NSObject <NSXMLParserDelegate> {
+@private
+  NSMutableDictionary* _info;
+  NSMutableString* _text;
+  NSUInteger _depth;
+}
++ (NSDictionary*) infoFromData:(NSData*)data;
+@end
+
 @interface LibraryUpdater (Updating)
 - (id) _updateLibrary:(BOOL)force;
 @end
 
+static NSArray* _PagesFromFileList(NSArray* files) {
+  NSMutableArray* array = [NSMutableArray array];
+  for (NSString* file in SortFileNames(files)) {
+    if (IsImageFileExtensionSupported([file pathExtension])) {
+      [array addObject:file];
+    }
+  }
+  return array;
+}
+
+NSArray* RetrieveComicPages(id archive) {
+  NSArray* pages = [archive cachedPages];
+  if (pages == nil) {
+    [archive setSkipInvisibleFiles:YES];
+    pages = _PagesFromFileList([archive retrieveFileList]);
+    [archive writeDirectoryCacheWithPages:pages];
+  }
+  return pages;
+}
+
+// Reads the first time in a single pass over the archive the cover, the header of every page for the page manifest
+// and ComicInfo.xml if any, so the comic and collection thumbnails can then be generated without reading it again
+static BOOL _ImportComicArchive(NSString* path, ComicImport* import) {
+  id archive = CreateComicArchive(path, NO);
+  if (archive == nil) {
+    return NO;
+  }
+  NSString* cover = [archive cachedCover];  // Does not load the pages from the page manifest
+  NSData* infoData = nil;
+  if (cover) {
+    import->cover = [[cover retain] autorelease];  // Outlives the archive
+    import->coverData = [archive dataForFile:import->cover];
+    infoData = [archive dataForFile:kComicInfoFileName];
+  } else {
+    [archive setSkipInvisibleFiles:YES];
+    NSArray* files = [archive retrieveFileList];
+    NSArray* pages = _PagesFromFileList(files);
+    import->cover = pages.count ? [archive retrieveCover] : nil;
+    NSMutableArray* names = [NSMutableArray arrayWithCapacity:2];
+    if (import->cover) {
+      [names addObject:import->cover];
+    }
+    NSString* infoFile = nil;
+    for (NSString* file in files) {
+      if ([file caseInsensitiveCompare:kComicInfoFileName] == NSOrderedSame) {
+        infoFile = file;
+        [names addObject:infoFile];
+        break;
+      }
+    }
+    NSDictionary* contents = [archive importPages:pages readingFiles:names];
+    import->coverData = import->cover ? [contents objectForKey:import->cover] : nil;
+    infoData = infoFile ? [contents objectForKey:infoFile] : nil;
+  }
+  if (infoData) {
+    import->info = [ComicInfoParser infoFromData:infoData];
+  }
+  [archive release];
+  return YES;
+}
+
+// Like "Series v2 #7 - Title" so issues sort by number whatever the file names
+static NSString* _TitleFromComicInfo(NSDictionary* info) {
+  NSString* series = [info objectForKey:@"Series"];
+  if (series == nil) {
+    return nil;
+  }
+  NSMutableString* title = [NSMutableString stringWithString:series];
+  NSString* volume = [info objectForKey:@"Volume"];
+  if (volume) {
+    [title appendFormat:@" v%@", volume];
+  }
+  NSString* number = [info objectForKey:@"Number"];
+  if (number) {
+    [title appendFormat:@" #%@", number];
+  }
+  NSString* name = [info objectForKey:@"Title"];
+  if (name) {
+    [title appendFormat:@" - %@", name];
+  }
+  return title;
+}
+
+// Only reads ComicInfo.xml, for comics imported before version 3 which have no title yet
+static NSString* _TitleForComicAtPath(NSString* path) {
+  id archive = CreateComicArchive(path, NO);
+  if (archive == nil) {
+    return nil;
+  }
+  NSData* data = [archive dataForFile:kComicInfoFileName];
+  [archive release];
+  return data ? _TitleFromComicInfo([ComicInfoParser infoFromData:data]) : nil;
+}
+
+NSArray* SortFileNames(NSArray* names) {
+  NSUInteger count = names.count;
+  const char** strings = malloc(count * sizeof(const char*) + 1);
+  size_t* order = malloc(count * sizeof(size_t) + 1);
+  for (NSUInteger i = 0; i < count; ++i) {
+    strings[i] = [[names objectAtIndex:i] UTF8String];  // Autoreleased
+  }
+  NSMutableArray* array = nil;
+  if (SortKeySortNames(strings, count, order)) {
+    array = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; ++i) {
+      [array addObject:[names objectAtIndex:order[i]]];
+    }
+  } else {
+    XLOG_DEBUG_UNREACHABLE();
+  }
+  free(order);
+  free(strings);
+  return array ? array : [names sortedArrayUsingSelector:@selector(localizedStandardCompare:)];
+}
+
+NSData* SortKeyForName(NSString* name) {
+  const char* string = [name UTF8String];
+  size_t length = SortKeyGenerate(string, NULL, 0);
+  void* bytes = malloc(length);
+  SortKeyGenerate(string, bytes, length);
+  return [NSData dataWithBytesNoCopy:bytes length:length freeWhenDone:YES];
+}
+
+id CreateComicArchive(NSString* path, BOOL readerCache) {
+  NSString* directory = [LibraryConnection libraryDirectoryCachePath];
+  switch (ArchiveReaderDetectFormat([path fileSystemRepresentation])) {
+    
+    case kArchiveReaderFormat_ZIP:
+      return [[MiniZip alloc] initWithArchiveAtPath:path directoryCache:directory readerCache:readerCache];
+    
+    case kArchiveReaderFormat_RAR:
+      return [[UnRAR alloc] initWithArchiveAtPath:path directoryCache:directory readerCache:readerCache];
+    
+    case kArchiveReaderFormat_TAR:
+      return [[TarArchive alloc] initWithArchiveAtPath:path directoryCache:directory readerCache:readerCache];
+    
+    case kArchiveReaderFormat_Unknown:
+      break;
+    
+  }
+  id archive = [[MiniZip alloc] initWithArchiveAtPath:path directoryCache:directory readerCache:readerCache];  // Like self-extracting archives
+  if (archive == nil) {
+    archive = [[UnRAR alloc] initWithArchiveAtPath:path directoryCache:directory readerCache:readerCache];
+  }
+  return archive;
+}
+
+@implementation ComicInfoParser
+
++ (NSDictionary*) infoFromData:(NSData*)data {
+  ComicInfoParser* delegate = [[ComicInfoParser alloc] init];
+  NSXMLParser* parser = [[NSXMLParser alloc] initWithData:data];
+  parser.delegate = delegate;
+  NSDictionary* info = nil;
+  if ([parser parse]) {
+    info = [[delegate->_info retain] autorelease];
+  } else {
+    XLOG_WARNING(@"Failed parsing %@: %@", kComicInfoFileName, parser.parserError);
+  }
+  [parser release];
+  [delegate release];
+  return info;
+}
+
+- (id) init {
+  if ((self = [super init])) {
+    _info = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+- (void) dealloc {
+  [_info release];
+  [_text release];
+  
+  [super dealloc];
+}
+
+- (void) parser:(NSXMLParser*)parser didStartElement:(NSString*)elementName namespaceURI:(NSString*)namespaceURI qualifiedName:(NSString*)qName attributes:(NSDictionary*)attributeDict {
+  if ((++_depth == 2) && ([elementName isEqualToString:@"Series"] || [elementName isEqualToString:@"Volume"] ||
+                          [elementName isEqualToString:@"Number"] || [elementName isEqualToString:@"Title"])) {
+    [_text release];
+    _text = [[NSMutableString alloc] init];
+  }
+}
+
+- (void) parser:(NSXMLParser*)parser foundCharacters:(NSString*)string {
+  [_text appendString:string];
+}
+
+- (void) parser:(NSXMLParser*)parser didEndElement:(NSString*)elementName namespaceURI:(NSString*)namespaceURI qualifiedName:(NSString*)qName {
+  if ((_depth-- == 2) && _text) {
+    NSString* value = [_text stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    if (value.length) {
+      [_info setObject:value forKey:elementName];
+    }
+    [_text release];
+    _text = nil;
+  }
+}
+
+@end
+
 #if __STORE_THUMBNAILS_IN_DATABASE__
 
 @implementation Thumbnail
@@ -79,7 +305,7 @@ typedef enum {
 
 @implementation Comic
 
-@dynamic collection, name, thumbnail, time, status;
+@dynamic collection, name, title, sortKey, thumbnail, time, status;
 
 + (NSString*) sqlTableName {
   return @"comics";
@@ -100,7 +326,7 @@ typedef enum {
 
 @implementation Collection
 
-@dynamic name, thumbnail, time, status, scrolling;
+@dynamic name, sortKey, thumbnail, time, status, scrolling;
 @synthesize comics;
 
 + (NSString*) sqlTableName {
@@ -157,29 +383,89 @@ typedef enum {
   return path;
 }
 
++ (NSString*) libraryDirectoryCachePath {
+  static NSString* path = nil;
+  if (path == nil) {
+    NSString* directory = [[NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject] stringByAppendingPathComponent:@"Directories"];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    path = [directory copy];
+  }
+  return path;
+}
+
+// Tables created by older versions are missing columns: add them in place and let the updater fill them in
+// Each column is added separately as the statement fails if a previous migration already added it
+// Returns NO if the schema is still not the current one, in which case only a forced update can rebuild the library
+- (BOOL) _migrateDatabase {
+  XLOG_INFO(@"Migrating library database from version %i", (int)[[NSUserDefaults standardUserDefaults] integerForKey:kDefaultKey_LibraryVersion]);
+  [self executeRawSQLStatements:@"ALTER TABLE comics ADD COLUMN sortKey BLOB"];  // Version 2
+  [self executeRawSQLStatements:@"ALTER TABLE collections ADD COLUMN sortKey BLOB"];  // Version 2
+  [self executeRawSQLStatements:@"ALTER TABLE comics ADD COLUMN title TEXT"];  // Version 3
+  return [self executeRawSQLStatements:@"SELECT sortKey, title FROM comics LIMIT 0;\n"
+                                        "SELECT sortKey FROM collections LIMIT 0"];
+}
+
+// Sidecars are named after the device and inode of the archive so they can only be found while it still exists
+static NSString* _DirectoryCacheFileNameForPath(NSString* path) {
+  DirectoryCacheKey key;
+  if (!DirectoryCacheGetKey([path fileSystemRepresentation], &key)) {
+    return nil;
+  }
+  char name[64];
+  DirectoryCacheGetFileName(&key, name, sizeof(name));
+  return [NSString stringWithUTF8String:name];
+}
+
++ (void) removeDirectoryCachesForPath:(NSString*)path {
+  BOOL isDirectory = NO;
+  if ([[NSFileManager defaultManager] fileExistsAtPath:path isDirectory:&isDirectory] && isDirectory) {
+    for (NSString* file in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:path error:NULL]) {
+      [self removeDirectoryCachesForPath:[path stringByAppendingPathComponent:file]];
+    }
+  } else {
+    NSString* name = _DirectoryCacheFileNameForPath(path);
+    if (name) {
+      [[NSFileManager defaultManager] removeItemAtPath:[[self libraryDirectoryCachePath] stringByAppendingPathComponent:name] error:NULL];
+    }
+  }
+}
+
 + (LibraryConnection*) mainConnection {
   static LibraryConnection* connection = nil;
   if (connection == nil) {
     NSString* statements = @"CREATE TRIGGER IF NOT EXISTS update_collection_status_insert AFTER INSERT ON comics BEGIN UPDATE collections SET status=(SELECT (CASE WHEN MAX(status)>0 THEN 1 ELSE (CASE WHEN MIN(status) < 0 THEN -1 ELSE 0 END) END) FROM comics WHERE collection=new.collection) WHERE _id_=new.collection; END;\n"
                             "CREATE TRIGGER IF NOT EXISTS update_collection_status_update AFTER UPDATE OF status ON comics BEGIN UPDATE collections SET status=(SELECT (CASE WHEN MAX(status)>0 THEN 1 ELSE (CASE WHEN MIN(status) < 0 THEN -1 ELSE 0 END) END) FROM comics WHERE collection=new.collection) WHERE _id_=new.collection; END;\n"
-                            "CREATE TRIGGER IF NOT EXISTS update_collection_status_delete AFTER DELETE ON comics BEGIN UPDATE collections SET status=(SELECT (CASE WHEN MAX(status)>0 THEN 1 ELSE (CASE WHEN MIN(status) < 0 THEN -1 ELSE 0 END) END) FROM comics WHERE collection=old.collection) WHERE _id_=old.collection; END";
+                            "CREATE TRIGGER IF NOT EXISTS update_collection_status_delete AFTER DELETE ON comics BEGIN UPDATE collections SET status=(SELECT (CASE WHEN MAX(status)>0 THEN 1 ELSE (CASE WHEN MIN(status) < 0 THEN -1 ELSE 0 END) END) FROM comics WHERE collection=old.collection) WHERE _id_=old.collection; END;";
     if ([[NSFileManager defaultManager] createDirectoryAtPath:[self libraryApplicationDataPath]
                                   withIntermediateDirectories:YES
                                                    attributes:nil
                                                         error:NULL]) {
       if ([LibraryConnection initializeDatabaseAtPath:[self libraryDatabasePath] usingObjectClasses:nil extraSQLStatements:statements]) {
         connection = [[LibraryConnection alloc] initWithDatabaseAtPath:[self libraryDatabasePath]];
+        if ([[NSUserDefaults standardUserDefaults] integerForKey:kDefaultKey_LibraryVersion] < kLibraryVersion) {
+          if ([connection _migrateDatabase]) {
+            if ([[NSUserDefaults standardUserDefaults] integerForKey:kDefaultKey_LibraryVersion] < 3) {
+              [[NSUserDefaults standardUserDefaults] setBool:YES forKey:kDefaultKey_MissingTitles];  // Read by the next update
+            }
+            [[NSUserDefaults standardUserDefaults] setInteger:kLibraryVersion forKey:kDefaultKey_LibraryVersion];  // Rows are kept so no forced update is required
+          } else {
+            XLOG_ERROR(@"Failed migrating library database");
+          }
+        }
+        if (![connection executeRawSQLStatements:@"CREATE INDEX IF NOT EXISTS comics_sort_key ON comics (sortKey);\n"
+                                                  "CREATE INDEX IF NOT EXISTS comics_collection_sort_key ON comics (collection, sortKey);\n"
+                                                  "CREATE INDEX IF NOT EXISTS collections_sort_key ON collections (sortKey)"]) {
+          XLOG_ERROR(@"Failed creating library indexes");
+        }
       }
     }
   }
   return connection;
 }
 
+// SQLite compares BLOBs with memcmp() so the sort key indexes give the natural order directly
 - (NSArray*) fetchAllComicsByName {
-  NSArray* results = [self fetchObjectsOfClass:[Comic class] withSQLWhereClause:@"1 ORDER BY name ASC" limit:0];
-  return [results sortedArrayUsingComparator:^NSComparisonResult(Comic* comic1, Comic* comic2) {
-    return [comic1.name localizedStandardCompare:comic2.name];
-  }];
+  return [self fetchObjectsOfClass:[Comic class] withSQLWhereClause:@"1 ORDER BY sortKey ASC" limit:0];
 }
 
 - (NSArray*) fetchAllComicsByDate {
@@ -191,17 +477,11 @@ typedef enum {
 }
 
 - (NSArray*) fetchComicsInCollection:(Collection*)collection {
-  NSArray* results = [self fetchObjectsOfClass:[Comic class] withSQLWhereClause:[NSString stringWithFormat:@"collection=%i", collection.sqlRowID] limit:0];
-  return [results sortedArrayUsingComparator:^NSComparisonResult(Comic* comic1, Comic* comic2) {
-    return [comic1.name localizedStandardCompare:comic2.name];
-  }];
+  return [self fetchObjectsOfClass:[Comic class] withSQLWhereClause:[NSString stringWithFormat:@"collection=%i ORDER BY sortKey ASC", collection.sqlRowID] limit:0];
 }
 
 - (NSArray*) fetchAllCollectionsByName {
-  NSArray* results = [self fetchObjectsOfClass:[Collection class] withSQLWhereClause:@"1" limit:0];
-  return [results sortedArrayUsingComparator:^NSComparisonResult(Collection* collection1, Collection* collection2) {
-    return [collection1.name localizedStandardCompare:collection2.name];
-  }];
+  return [self fetchObjectsOfClass:[Collection class] withSQLWhereClause:@"1 ORDER BY sortKey ASC" limit:0];
 }
 
 - (BOOL) updateStatus:(int)status forComicsInCollection:(Collection*)collection {
@@ -430,9 +710,14 @@ typedef enum {
   return data;
 }
 
-- (CGImageRef) _copyCoverImageFromComicAtPath:(NSString*)path withArchiveType:(ArchiveType)type forSize:(CGSize)size {
-  size.width *= _screenScale;
-  size.height *= _screenScale;
+- (CGImageRef) _copyCoverImageFromImport:(const ComicImport*)import forSize:(CGSize)size {
+  if (import->coverData == nil) {
+    return NULL;
+  }
+  return CreateCGImageFromFileData(import->coverData, [import->cover pathExtension], CGSizeMake(size.width * _screenScale, size.height * _screenScale), YES);
+}
+
+- (CGImageRef) _copyCoverImageFromComicAtPath:(NSString*)path withArchiveType:(ArchiveType)type forSize:(CGSize)size import:(ComicImport*)import {
   CGImageRef imageRef = NULL;
   if (type == kArchiveType_PDF) {
     CGPDFDocumentRef document = CGPDFDocumentCreateWithURL((CFURLRef)[NSURL fileURLWithPath:path]);
@@ -440,37 +725,13 @@ typedef enum {
       if (CGPDFDocumentGetNumberOfPages(document) > 0) {
         CGPDFPageRef page = CGPDFDocumentGetPage(document, 1);
         if (page) {
-          imageRef = CreateCGImageFromPDFPage(page, size, YES);
+          imageRef = CreateCGImageFromPDFPage(page, CGSizeMake(size.width * _screenScale, size.height * _screenScale), YES);
         }
       }
       CGPDFDocumentRelease(document);
     }
-  } else {
-    id archive = [[MiniZip alloc] initWithArchiveAtPath:path];
-    if (archive == nil) {
-      archive = [[UnRAR alloc] initWithArchiveAtPath:path];
-    }
-    [archive setSkipInvisibleFiles:YES];
-    NSString* cover = nil;
-    for (NSString* file in [archive retrieveFileList]) {
-      if (IsImageFileExtensionSupported([file pathExtension])) {
-        if (!cover || ([file localizedStandardCompare:cover] == NSOrderedAscending)) {
-          cover = file;
-        }
-      }
-    }
-    if (cover) {
-      NSString* temp = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
-      if ([archive extractFile:cover toPath:temp]) {
-        NSData* data = [[NSData alloc] initWithContentsOfFile:temp];
-        if (data) {
-          imageRef = CreateCGImageFromFileData(data, [cover pathExtension], size, YES);
-          [data release];
-        }
-        [[NSFileManager defaultManager] removeItemAtPath:temp error:NULL];
-      }
-    }
-    [archive release];
+  } else if (_ImportComicArchive(path, import)) {
+    imageRef = [self _copyCoverImageFromImport:import forSize:size];
   }
   return imageRef;
 }
@@ -481,7 +742,9 @@ typedef enum {
                   collection:(Collection*)collection  // May be nil
                 zombieComics:(CFMutableDictionaryRef)zombieComics
                   connection:(LibraryConnection*)connection
-                       force:(BOOL)force {
+                       force:(BOOL)force
+               missingTitles:(BOOL)missingTitles
+                      import:(ComicImport*)import {  // Filled if the comic is processed
   NSString* name = [path lastPathComponent];  // TODO: Improve this
   
   // Check if this comic has already been processed
@@ -502,9 +765,20 @@ typedef enum {
   // If yes, update comic
   if (comic) {
     CFDictionaryRemoveValue(zombieComics, (void*)(long)comic.sqlRowID);
+    BOOL needsUpdate = NO;
     if ((comic.collection != collection.sqlRowID) || ![comic.name isEqualToString:name]) {
       comic.collection = collection.sqlRowID;
       comic.name = name;
+      needsUpdate = YES;
+    }
+    if (missingTitles && (comic.title == nil) && (type != kArchiveType_PDF)) {
+      comic.title = _TitleForComicAtPath(path);
+      if (comic.title) {
+        needsUpdate = YES;
+      }
+    }
+    if (needsUpdate) {
+      comic.sortKey = SortKeyForName(comic.title ? comic.title : name);
       [connection updateObject:comic];
       XLOG_VERBOSE(@"Updated comic \"%@\" (%i)", name, comic.sqlRowID);
     }
@@ -514,7 +788,7 @@ typedef enum {
     [[NSFileManager defaultManager] setExtendedAttributeData:_fakeData withName:kLibraryExtendedAttribute forFileAtPath:path];
     
     // Process comic
-    CGImageRef imageRef = [self _copyCoverImageFromComicAtPath:path withArchiveType:type forSize:CGSizeMake(kComicCoverWidth, kComicCoverHeight)];
+    CGImageRef imageRef = [self _copyCoverImageFromComicAtPath:path withArchiveType:type forSize:CGSizeMake(kComicCoverWidth, kComicCoverHeight) import:import];
     if (imageRef == NULL) {
       imageRef = CGImageRetain(_comicPlaceholderImageRef);
     }
@@ -536,6 +810,8 @@ typedef enum {
         comic = [[[Comic alloc] init] autorelease];
         comic.collection = collection.sqlRowID;
         comic.name = name;
+        comic.title = _TitleFromComicInfo(import->info);
+        comic.sortKey = SortKeyForName(comic.title ? comic.title : name);
 #if __STORE_THUMBNAILS_IN_DATABASE__
         comic.thumbnail = thumbnail.sqlRowID;
 #else
@@ -590,6 +866,12 @@ static void _ZombieComicsRemoveFunction(const void* key, const void* value, void
   }
 }
 
+static void _ZombieComicsCountFunction(const void* key, const void* value, void* context) {
+  if (!isnan([(Comic*)value time])) {
+    *(CFIndex*)context += 1;
+  }
+}
+
 static void _ZombieComicsMarkFunction(const void* key, const void* value, void* context) {
   if ([(Comic*)value collection] == (DatabaseSQLRowID)context) {
     [(Comic*)value setTime:NAN];
@@ -604,14 +886,24 @@ static void _ZombieComicsMarkFunction(const void* key, const void* value, void*
     return nil;
   }
   NSString* rootPath = [LibraryConnection libraryRootPath];
+  BOOL missingTitles = [[NSUserDefaults standardUserDefaults] boolForKey:kDefaultKey_MissingTitles];  // Unchanged collections must be scanned as well
   
   // Build list of all collections and comics currently in library as potential zombies
+  // Rows from a migrated database have no sort keys yet and may not be visited below if unchanged
   CFMutableDictionaryRef zombieCollections = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
   for (Collection* collection in [connection fetchAllObjectsOfClass:[Collection class]]) {
+    if (collection.sortKey == nil) {
+      collection.sortKey = SortKeyForName(collection.name);
+      [connection updateObject:collection];
+    }
     CFDictionarySetValue(zombieCollections, (void*)(long)collection.sqlRowID, collection);
   }
   CFMutableDictionaryRef zombieComics = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
   for (Comic* comic in [connection fetchAllObjectsOfClass:[Comic class]]) {
+    if (comic.sortKey == nil) {
+      comic.sortKey = SortKeyForName(comic.title ? comic.title : comic.name);
+      [connection updateObject:comic];
+    }
     CFDictionarySetValue(zombieComics, (void*)(long)comic.sqlRowID, comic);
   }
     
@@ -686,12 +978,13 @@ static void _ZombieComicsMarkFunction(const void* key, const void* value, void*
       // If yes, update collection
       if (collection) {
         CFDictionaryRemoveValue(zombieCollections, (void*)(long)collection.sqlRowID);
-        if (time != collection.time) {
+        if ((time != collection.time) || missingTitles) {
           needsUpdate = YES;
         } else {
           CFDictionaryApplyFunction(zombieComics, _ZombieComicsMarkFunction, (void*)(long)collection.sqlRowID);
           if (![collection.name isEqualToString:directory]) {
             collection.name = directory;
+            collection.sortKey = SortKeyForName(directory);
             [connection updateObject:collection];
             XLOG_VERBOSE(@"Renamed collection \"%@\" (%i)", directory, collection.sqlRowID);
             needsUpdate = YES;
@@ -702,6 +995,7 @@ static void _ZombieComicsMarkFunction(const void* key, const void* value, void*
       else if (directory.length) {
         collection = [[[Collection alloc] init] autorelease];
         collection.name = directory;
+        collection.sortKey = SortKeyForName(directory);
         // collection.time = time;
         if ([connection insertObject:collection]) {
           DatabaseSQLRowID rowID = collection.sqlRowID;
@@ -717,7 +1011,7 @@ static void _ZombieComicsMarkFunction(const void* key, const void* value, void*
       }
       // Handle special root collection
       else {
-        if (force || (time != [[NSUserDefaults standardUserDefaults] doubleForKey:kDefaultKey_RootTimestamp])) {
+        if (force || missingTitles || (time != [[NSUserDefaults standardUserDefaults] doubleForKey:kDefaultKey_RootTimestamp])) {
           needsUpdate = YES;
         } else {
           CFDictionaryApplyFunction(zombieComics, _ZombieComicsMarkFunction, (void*)0);
@@ -740,20 +1034,30 @@ static void _ZombieComicsMarkFunction(const void* key, const void* value, void*
             type = kArchiveType_ZIP;
           } else if (![extension caseInsensitiveCompare:@"rar"] || ![extension caseInsensitiveCompare:@"cbr"]) {
             type = kArchiveType_RAR;
+          } else if (![extension caseInsensitiveCompare:@"tar"] || ![extension caseInsensitiveCompare:@"cbt"]) {
+            type = kArchiveType_TAR;
           } else if (![extension caseInsensitiveCompare:@"pdf"]) {
             type = kArchiveType_PDF;
           }
           if (type != kArchiveType_Unknown) {
             NSString* path = [fullPath stringByAppendingPathComponent:file];
+            ComicImport import = {nil, nil, nil};
             [self _updateComicForPath:path
                                  type:type
                            collection:collection
                          zombieComics:zombieComics
                            connection:connection
-                                force:force];
+                                force:force
+                        missingTitles:missingTitles
+                               import:&import];
             if (collection && !imageRef) {
               XLOG_VERBOSE(@"Using comic \"%@\" to generate thumbnail for collection \"%@\"", file, directory);
-              imageRef = [self _copyCoverImageFromComicAtPath:path withArchiveType:type forSize:CGSizeMake(kCollectionCoverWidth, kCollectionCoverHeight)];
+              CGSize size = CGSizeMake(kCollectionCoverWidth, kCollectionCoverHeight);
+              if (import.coverData) {
+                imageRef = [self _copyCoverImageFromImport:&import forSize:size];  // Comic was just imported so reuse its cover
+              } else {
+                imageRef = [self _copyCoverImageFromComicAtPath:path withArchiveType:type forSize:size import:&import];
+              }
             }
           } else {
             XLOG_INFO(@"Ignoring unknown type comic \"%@\"", file);
@@ -798,6 +1102,7 @@ static void _ZombieComicsMarkFunction(const void* key, const void* value, void*
           collection.thumbnail = thumbnail;
 #endif
           collection.name = directory;
+          collection.sortKey = SortKeyForName(directory);
           collection.time = time;
           [connection updateObject:collection];
         } else {
@@ -821,9 +1126,39 @@ static void _ZombieComicsMarkFunction(const void* key, const void* value, void*
   }
   
   // Remove zombies
+  CFIndex removedComics = 0;
+  CFDictionaryApplyFunction(zombieComics, _ZombieComicsCountFunction, &removedComics);
   CFDictionaryApplyFunction(zombieCollections, _ZombieCollectionsRemoveFunction, connection);
   CFDictionaryApplyFunction(zombieComics, _ZombieComicsRemoveFunction, connection);
   
+  // Remove directory caches of zombie comics: their files are already gone so these are found by elimination
+  if (removedComics > 0) {
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+    NSMutableSet* names = [[NSMutableSet alloc] init];
+    for (NSString* directory in directories) {
+      NSString* fullPath = [rootPath stringByAppendingPathComponent:directory];
+      for (NSString* file in [directories objectForKey:directory]) {
+        NSString* name = _DirectoryCacheFileNameForPath([fullPath stringByAppendingPathComponent:file]);
+        if (name) {
+          [names addObject:name];
+        }
+      }
+    }
+    NSString* cachePath = [LibraryConnection libraryDirectoryCachePath];
+    for (NSString* name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:cachePath error:NULL]) {
+      if ([[name pathExtension] isEqualToString:@"dir"] && ![names containsObject:name]) {
+        [[NSFileManager defaultManager] removeItemAtPath:[cachePath stringByAppendingPathComponent:name] error:NULL];
+        XLOG_VERBOSE(@"Removed directory cache \"%@\"", name);
+      }
+    }
+    [names release];
+    [pool release];
+  }
+  
+  if (missingTitles) {
+    [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kDefaultKey_MissingTitles];
+  }
+  
   [directories release];
   CFRelease(zombieComics);
   CFRelease(zombieCollections);
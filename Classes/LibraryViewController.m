@@ -19,6 +19,7 @@
 #import "LibraryViewController.h"
 #import "ComicViewController.h"
 #import "AppDelegate.h"
+#import "ArchiveReader.h"
 #import "Defaults.h"
 #import "Extensions_Foundation.h"
 #import "Extensions_UIKit.h"
@@ -322,14 +323,20 @@ static void __DisplayQueueCallBack(void* info) {
   if (_selectedItem) {
     if ([_selectedItem isKindOfClass:[Comic class]]) {
       NSError* error = nil;
-      if ([[NSFileManager defaultManager] removeItemAtPath:[[LibraryConnection mainConnection] pathForComic:(Comic*)_selectedItem] error:&error]) {
+      NSString* path = [[LibraryConnection mainConnection] pathForComic:(Comic*)_selectedItem];
+      [LibraryConnection removeDirectoryCachesForPath:path];  // Cannot be found anymore once deleted
+      if ([[NSFileManager defaultManager] removeItemAtPath:path error:&error]) {
+        ArchiveReaderCacheInvalidate([path fileSystemRepresentation]);
         [(AppDelegate*)[AppDelegate sharedInstance] updateLibrary];
       } else {
         XLOG_ERROR(@"Failed deleting comic \"%@\": %@", [(Comic*)_selectedItem name], error);
       }
     } else {
       NSError* error = nil;
-      if ([[NSFileManager defaultManager] removeItemAtPath:[[LibraryConnection mainConnection] pathForCollection:(Collection*)_selectedItem] error:&error]) {
+      NSString* path = [[LibraryConnection mainConnection] pathForCollection:(Collection*)_selectedItem];
+      [LibraryConnection removeDirectoryCachesForPath:path];
+      if ([[NSFileManager defaultManager] removeItemAtPath:path error:&error]) {
+        ArchiveReaderCacheInvalidate([path fileSystemRepresentation]);
         [(AppDelegate*)[AppDelegate sharedInstance] updateLibrary];
       } else {
         XLOG_ERROR(@"Failed deleting comic \"%@\": %@", [(Collection*)_selectedItem name], error);
@@ -14,19 +14,50 @@
 
 #import <Foundation/Foundation.h>
 
+// Entry names are UTF-8 or Latin-1 for ZIP and TAR, ASCII for RAR
+NSString* PathFromArchiveFileName(const char* filename);
+
+// Front-end to the ArchiveReader engine: UnRAR and TarArchive only differ by the format of the readers they accept
 @interface MiniZip : NSObject {
 @private
-  void* _unzFile;
+  void* _reader;
+  NSString* _path;
+  BOOL _openFailed;
+  BOOL _readerCache;
+  void* _directoryKey;
+  NSString* _directoryCachePath;
+  void* _directoryContents;
+  NSString* _cachedCover;
+  NSArray* _cachedPages;
+  NSDictionary* _cachedDimensions;
   NSData* _data;
-  long _offset;
   BOOL _skipInvisible;
 }
 @property(nonatomic) BOOL skipInvisibleFiles;
+@property(nonatomic, readonly) NSArray* cachedPages;  // From a valid directory cache, nil otherwise
+@property(nonatomic, readonly) NSString* cachedCover;  // Same as -retrieveCover from a valid directory cache without loading the pages, nil otherwise
+@property(nonatomic, readonly) NSDictionary* cachedImageDimensions;  // Same as -retrieveImageDimensions for the cached pages if they were probed, nil otherwise
 + (BOOL) extractZipArchiveAtPath:(NSString*)inPath toPath:(NSString*)outPath;
 + (BOOL) extractZipArchiveData:(NSData*)inData toPath:(NSString*)outPath;
 - (id) initWithArchiveAtPath:(NSString*)path;
+- (id) initWithArchiveAtPath:(NSString*)path directoryCache:(NSString*)directory readerCache:(BOOL)readerCache;  // Does not read the entries of the archive at all if the cache is valid for this exact file, the reader cache keeps them in memory for the next opening
 - (id) initWithArchiveData:(NSData*)data;
 - (NSArray*) retrieveFileList;
+- (NSString*) retrieveCover;  // Named like a cover or otherwise the first page in natural order, in a single pass without listing the files
+- (NSDictionary*) retrieveImageDimensions;  // Maps file paths to NSValue-wrapped CGSizes, only decodes the beginning of each file
 - (BOOL) extractToPath:(NSString*)outPath;
 - (BOOL) extractFile:(NSString*)inPath toPath:(NSString*)outPath;  // Destination path must include file name
+- (NSData*) dataForFile:(NSString*)inPath;  // Stored files of archives opened from a path are returned without copying, can be called from any thread
+- (void) prefetchFiles:(NSArray*)files;  // Hints the files about to be read with -dataForFile: so they are fetched from storage in the background
+- (BOOL) writeDirectoryCacheWithPages:(NSArray*)pages;  // Archive must have been opened with a directory cache
+- (NSDictionary*) importPages:(NSArray*)pages readingFiles:(NSArray*)files;  // Single pass reading the files entirely and the beginning of the pages to also store their format and dimensions in the directory cache if any, returns the data of the files read
+@end
+
+struct DirectoryCacheKey;
+struct DirectoryCacheContents;
+
+@interface MiniZip (Subclassing)
++ (int) archiveFormat;  // ArchiveReaderFormat of the readers accepted, others are rejected
+- (id) initWithUnopenedArchiveAtPath:(NSString*)path;  // The archive is only opened once a file is read
+- (id) initWithArchiveAtPath:(NSString*)path key:(const struct DirectoryCacheKey*)key directoryContents:(const struct DirectoryCacheContents*)contents;  // From a valid directory cache
 @end
@@ -13,11 +13,11 @@
 // limitations under the License.
 
 #import "MiniZip.h"
-#import "unzip.h"
+#import "ImageHeader.h"
+#import "DirectoryCache.h"
+#import "ArchiveReader.h"
 
-#define kZipExtractionBufferSize 4096
-
-static NSString* _PathFromFileName(const char* filename) {
+NSString* PathFromArchiveFileName(const char* filename) {
   NSString* path = [NSString stringWithCString:filename encoding:NSUTF8StringEncoding];
   if (path == nil) {
     path = [NSString stringWithCString:filename encoding:NSISOLatin1StringEncoding];
@@ -26,9 +26,62 @@ static NSString* _PathFromFileName(const char* filename) {
   return path;
 }
 
+typedef struct {
+  DirectoryCachePage* pages;
+  const long* pageForEntry;  // -1 for entries that are not pages
+  NSString** fileForEntry;  // nil for entries not read entirely
+  NSMutableDictionary* files;
+} ImportContext;
+
+static void _ImportEntry(void* context, size_t index, const void* bytes, size_t length) {
+  ImportContext* import = (ImportContext*)context;
+  if (import->pageForEntry[index] >= 0) {
+    DirectoryCachePage* page = &import->pages[import->pageForEntry[index]];
+    ImageHeaderFormat format;
+    if (!GetImageInfoFromHeader(bytes, length, &format, &page->width, &page->height)) {
+      page->width = 0;
+      page->height = 0;
+    }
+    page->imageFormat = format;
+  }
+  if (import->fileForEntry[index]) {
+    [import->files setObject:[NSData dataWithBytes:bytes length:length] forKey:import->fileForEntry[index]];
+  }
+}
+
+// Reads the header of every page and the whole files in a single pass over the archive
+static BOOL _ImportEntries(ArchiveReader* reader, ImportContext* context) {
+  size_t count = ArchiveReaderGetEntryCount(reader);
+  size_t* limits = malloc(count * sizeof(size_t) + 1);
+  for (size_t i = 0; i < count; ++i) {
+    limits[i] = context->fileForEntry[i] ? SIZE_MAX : (context->pageForEntry[i] >= 0 ? kImageHeaderProbeSize : 0);
+  }
+  BOOL success = ArchiveReaderReadEntries(reader, limits, _ImportEntry, context);
+  free(limits);
+  return success;
+}
+
+// Directory caches of uncompressed archives hold the same entry list with the offsets of the data
+static ArchiveReader* _OpenWithEntryList(int format, const char* path, const unz_entry_list* list) {
+  switch (format) {
+    
+    case kDirectoryCacheFormat_ZIP:
+      return ArchiveReaderOpenZIPWithEntryList(path, list);
+    
+    case kDirectoryCacheFormat_TAR:
+      return ArchiveReaderOpenTARWithEntryList(path, list);
+    
+  }
+  return NULL;
+}
+
 @implementation MiniZip
 
-@synthesize skipInvisibleFiles=_skipInvisible;
+@synthesize skipInvisibleFiles=_skipInvisible, cachedCover=_cachedCover;
+
++ (int) archiveFormat {
+  return kArchiveReaderFormat_ZIP;
+}
 
 + (BOOL) extractZipArchiveAtPath:(NSString*)inPath toPath:(NSString*)outPath {
   BOOL success = NO;
@@ -50,335 +103,465 @@ static NSString* _PathFromFileName(const char* filename) {
   return success;
 }
 
-- (id) initWithUnzFile:(unzFile)file {
-  if (file == NULL) {
+- (id) initWithArchiveReader:(ArchiveReader*)reader {
+  if ((reader == NULL) || (ArchiveReaderGetFormat(reader) != [[self class] archiveFormat])) {
+    if (reader) {
+      ArchiveReaderClose(reader);  // This is an archive of another format
+    }
     [self release];
     return nil;
   }
   if ((self = [super init])) {
-    _unzFile = file;
+    _reader = reader;
+  } else {
+    ArchiveReaderClose(reader);
+  }
+  return self;
+}
+
+- (id) initWithUnopenedArchiveAtPath:(NSString*)path {
+  if ((self = [super init])) {
+    _path = [path copy];
   }
   return self;
 }
 
 - (void) dealloc {
-  if (_unzFile) {
-    unzClose(_unzFile);
+  if (_reader) {
+    ArchiveReaderClose(_reader);
+  }
+  [_path release];
+  free(_directoryKey);
+  [_directoryCachePath release];
+  if (_directoryContents) {
+    DirectoryCacheFreeContents(_directoryContents);
+    free(_directoryContents);
   }
+  [_cachedCover release];
+  [_cachedPages release];
+  [_cachedDimensions release];
   [_data release];
   
   [super dealloc];
 }
 
 - (id) initWithArchiveAtPath:(NSString*)path {
-  return [self initWithUnzFile:unzOpen([path fileSystemRepresentation])];
+  const char* fileSystemPath = [path fileSystemRepresentation];
+  ArchiveReader* reader = _readerCache ? ArchiveReaderCacheOpen(fileSystemPath) : ArchiveReaderOpen(fileSystemPath);
+  if ((reader == NULL) && ([[self class] archiveFormat] == kArchiveReaderFormat_ZIP) && (ArchiveReaderDetectFormat(fileSystemPath) == kArchiveReaderFormat_ZIP)) {
+    reader = ArchiveReaderOpenZIPSalvage(fileSystemPath);  // Most likely a truncated upload so read what is there
+    if (reader) {
+      XLOG_WARNING(@"Salvaged %lu entries from damaged ZIP archive \"%@\"", (unsigned long)ArchiveReaderGetEntryCount(reader), path);
+    }
+  }
+  if ((self = [self initWithArchiveReader:reader])) {
+    _path = [path copy];
+  }
+  return self;
 }
 
-static voidpf _OpenFunction(voidpf opaque, const char* filename, int mode) {
-  return opaque;  // This becomes the "stream" argument for the other callbacks
+- (id) initWithArchiveAtPath:(NSString*)path directoryCache:(NSString*)directory readerCache:(BOOL)readerCache {
+  _readerCache = readerCache;  // Set before calling the initializers below which open the reader
+  DirectoryCacheKey key;
+  if (!DirectoryCacheGetKey([path fileSystemRepresentation], &key)) {
+    return [self initWithArchiveAtPath:path];
+  }
+  char name[64];
+  DirectoryCacheGetFileName(&key, name, sizeof(name));
+  NSString* cachePath = [directory stringByAppendingPathComponent:[NSString stringWithUTF8String:name]];
+  
+  DirectoryCacheContents contents;
+  if (DirectoryCacheRead([cachePath fileSystemRepresentation], &key, &contents)) {
+    if ((self = [self initWithArchiveAtPath:path key:&key directoryContents:&contents])) {
+      if (contents.pageCount) {
+        const unz_entry* entry = &contents.list.entries[contents.pages[contents.coverPage].entry];
+        _cachedCover = [PathFromArchiveFileName(contents.list.names + entry->name_offset) retain];
+      }
+      if (_reader) {
+        free(contents.list.entries);  // Now held by the reader
+        contents.list.entries = NULL;
+      }
+      _directoryContents = malloc(sizeof(DirectoryCacheContents));
+      memcpy(_directoryContents, &contents, sizeof(DirectoryCacheContents));
+    } else {
+      DirectoryCacheFreeContents(&contents);
+    }
+    return self;
+  }
+  
+  if ((self = [self initWithArchiveAtPath:path])) {
+    _directoryKey = malloc(sizeof(DirectoryCacheKey));
+    memcpy(_directoryKey, &key, sizeof(DirectoryCacheKey));  // Captured before parsing so a concurrent modification makes the cache stale
+    _directoryCachePath = [cachePath copy];
+  }
+  return self;
 }
 
-static uLong _ReadFunction(voidpf opaque, voidpf stream, void* buf, uLong size) {
-  MiniZip* zip = (MiniZip*)opaque;
-  const void* bytes = zip->_data.bytes;
-  long length = zip->_data.length;
-  size = MIN(size, length - zip->_offset);
-  if (size) {
-    bcopy((char*)bytes + zip->_offset, buf, size);
-    zip->_offset += size;
+// Recreates the reader from the cached entries without parsing the central directory or headers unless it is still open
+- (id) initWithArchiveAtPath:(NSString*)path key:(const DirectoryCacheKey*)key directoryContents:(const DirectoryCacheContents*)contents {
+  ArchiveReader* reader = NULL;
+  if (contents->format != kDirectoryCacheFormat_RAR) {
+    reader = _readerCache ? ArchiveReaderCacheLookup([path fileSystemRepresentation], key) : NULL;
+    if (reader == NULL) {
+      reader = _OpenWithEntryList(contents->format, [path fileSystemRepresentation], &contents->list);
+      if (reader && _readerCache) {
+        ArchiveReaderCacheInsert([path fileSystemRepresentation], key, reader);
+      }
+    }
   }
-  return size;
+  if ((self = [self initWithArchiveReader:reader])) {
+    _path = [path copy];
+  }
+  return self;
 }
 
-static long _TellFuntion(voidpf opaque, voidpf stream) {
-  MiniZip* zip = (MiniZip*)opaque;
-  return zip->_offset;
+// Archives opened from a directory cache without their entries are only scanned once a file is actually read
+- (ArchiveReader*) _reader {
+  @synchronized(self) {
+    if ((_reader == NULL) && _path && !_openFailed) {
+      _reader = _readerCache ? ArchiveReaderCacheOpen([_path fileSystemRepresentation]) : ArchiveReaderOpen([_path fileSystemRepresentation]);
+      if (_reader && (ArchiveReaderGetFormat(_reader) != [[self class] archiveFormat])) {
+        ArchiveReaderClose(_reader);
+        _reader = NULL;
+      }
+      if (_reader == NULL) {
+        XLOG_ERROR(@"Failed opening archive \"%@\"", _path);
+        _openFailed = YES;
+      }
+    }
+  }
+  return _reader;
 }
 
-static long _SeekFunction(voidpf opaque, voidpf stream, uLong offset, int origin) {
-  MiniZip* zip = (MiniZip*)opaque;
-  long length = zip->_data.length;
-  switch (origin) {
-    
-    case ZLIB_FILEFUNC_SEEK_CUR:
-      zip->_offset += offset;
-      break;
-    
-    case ZLIB_FILEFUNC_SEEK_END:
-      zip->_offset = length + offset;
-      break;
-    
-    case ZLIB_FILEFUNC_SEEK_SET:
-      zip->_offset = offset;
-      break;
-    
+// The page manifest is only turned into strings once the pages are needed so getting the cover does not depend on the page count
+// The names come from the reader when it holds the cached entries, otherwise from the cached list (only the pages for RAR)
+- (void) _loadCachedPages {
+  @synchronized(self) {
+    DirectoryCacheContents* contents = _directoryContents;
+    if (contents) {
+      NSMutableArray* pages = [[NSMutableArray alloc] initWithCapacity:contents->pageCount];
+      NSMutableDictionary* dimensions = [[NSMutableDictionary alloc] init];
+      for (unsigned long i = 0; i < contents->pageCount; ++i) {
+        const DirectoryCachePage* item = &contents->pages[i];
+        const char* name = contents->list.entries ? contents->list.names + contents->list.entries[item->entry].name_offset : ArchiveReaderGetEntry(_reader, item->entry)->name;
+        NSString* page = PathFromArchiveFileName(name);
+        if (page) {
+          [pages addObject:page];
+          if (item->width && item->height) {
+            [dimensions setObject:[NSValue valueWithCGSize:CGSizeMake(item->width, item->height)] forKey:page];
+          }
+        }
+      }
+      _cachedPages = pages;
+      if (dimensions.count) {
+        _cachedDimensions = dimensions;
+      } else {
+        [dimensions release];
+      }
+      DirectoryCacheFreeContents(contents);
+      free(contents);
+      _directoryContents = NULL;
+    }
   }
-  return (zip->_offset >= 0) && (zip->_offset <= length) ? 0 : -1;
 }
 
-static int _CloseFunction(voidpf opaque, voidpf stream) {
-  return 0;
+- (NSArray*) cachedPages {
+  [self _loadCachedPages];
+  return _cachedPages;
 }
 
-static int _ErrorFunction(voidpf opaque, voidpf stream) {
-  return 0;
+- (NSDictionary*) cachedImageDimensions {
+  [self _loadCachedPages];
+  return _cachedDimensions;
 }
 
 - (id) initWithArchiveData:(NSData*)data {
-  _data = [data retain];  // -initWithUnzFile: will call -release on error
-  
-  zlib_filefunc_def functions;
-  functions.zopen_file = _OpenFunction;
-  functions.zread_file = _ReadFunction;
-  functions.zwrite_file = NULL;
-  functions.ztell_file = _TellFuntion;
-  functions.zseek_file = _SeekFunction;
-  functions.zclose_file = _CloseFunction;
-  functions.zerror_file = _ErrorFunction;
-  functions.opaque = self;
-  return [self initWithUnzFile:unzOpen2(NULL, &functions)];
+  _data = [data retain];  // -initWithArchiveReader: will call -release on error
+  return [self initWithArchiveReader:ArchiveReaderOpenZIPData(data.bytes, data.length)];
 }
 
-- (NSArray*) retrieveFileList {
-  NSMutableArray* array = [NSMutableArray array];
-  
-  // Set current file to first file in archive
-  int result = unzGoToFirstFile(_unzFile);
-  while (1) {
-    // Open current file
-    if (result == UNZ_OK) {
-      result = unzOpenCurrentFile(_unzFile);
-    }
-    if (result != UNZ_OK) {
-      if (result != UNZ_END_OF_LIST_OF_FILE) {
-        XLOG_ERROR(@"MiniZip returned error %i", result);
-        array = nil;
+// Returns nil for invisible files if skipping them
+- (NSString*) _pathForEntry:(const ArchiveReaderEntry*)entry {
+  NSString* path = PathFromArchiveFileName(entry->name);
+  if (_skipInvisible) {
+    for (NSString* string in [path pathComponents]) {
+      if ([string hasPrefix:@"."]) {
+        return nil;
       }
-      break;
     }
-    
-    // Retrieve current file path and convert path separators if needed
-    unz_file_info fileInfo = {0};
-    result = unzGetCurrentFileInfo(_unzFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0);
-    if (result != UNZ_OK) {
-      unzCloseCurrentFile(_unzFile);
-      XLOG_ERROR(@"MiniZip returned error %i", result);
-      array = nil;
-      break;
-    }
-    char* filename = (char*)malloc(fileInfo.size_filename + 1);
-    unzGetCurrentFileInfo(_unzFile, &fileInfo, filename, fileInfo.size_filename, NULL, 0, NULL, 0);
-    for (unsigned int i = 0; i < fileInfo.size_filename; ++i) {
-      if (filename[i] == '\\') {
-        filename[i] = '/';
-      }
-    }
-    filename[fileInfo.size_filename] = 0;
-    NSString* path = _PathFromFileName(filename);
-    free(filename);
-    
-    // Add current file to list if necessary
-    if (_skipInvisible) {
-      for (NSString* string in [path pathComponents]) {
-        if ([string hasPrefix:@"."]) {
-          path = nil;
-          break;
-        }
-      }
-    }
-    if (path && ![path hasSuffix:@"/"]) {
+  }
+  return path;
+}
+
+- (NSArray*) retrieveFileList {
+  ArchiveReader* reader = [self _reader];
+  if (reader == NULL) {
+    return nil;
+  }
+  size_t count = ArchiveReaderGetEntryCount(reader);
+  NSMutableArray* array = [NSMutableArray arrayWithCapacity:count];
+  for (size_t i = 0; i < count; ++i) {
+    const ArchiveReaderEntry* entry = ArchiveReaderGetEntry(reader, i);
+    NSString* path = [self _pathForEntry:entry];
+    if (path && !entry->isDirectory) {
       [array addObject:path];
     }
-    
-    // Close current file and go to next one
-    unzCloseCurrentFile(_unzFile);
-    result = unzGoToNextFile(_unzFile);
   }
-  
   return array;
 }
 
-// See do_extract_currentfile() from miniunz.c for reference
+- (NSString*) retrieveCover {
+  ArchiveReader* reader = [self _reader];
+  long index = reader ? ArchiveReaderFindCover(reader) : -1;
+  return index >= 0 ? PathFromArchiveFileName(ArchiveReaderGetEntry(reader, index)->name) : nil;
+}
+
+typedef struct {
+  NSMutableDictionary* dimensions;
+  NSArray* paths;  // Indexed like the entries
+} ImageDimensionsContext;
+
+static void _AddImageDimensions(void* context, size_t index, const void* bytes, size_t length) {
+  ImageDimensionsContext* dimensions = (ImageDimensionsContext*)context;
+  unsigned int width;
+  unsigned int height;
+  if (GetImageDimensionsFromHeader(bytes, length, &width, &height)) {
+    [dimensions->dimensions setObject:[NSValue valueWithCGSize:CGSizeMake(width, height)] forKey:[dimensions->paths objectAtIndex:index]];
+  }
+}
+
+// Decodes the beginning of every file in a single pass over the archive
+- (NSDictionary*) retrieveImageDimensions {
+  ArchiveReader* reader = [self _reader];
+  if (reader == NULL) {
+    return nil;
+  }
+  size_t count = ArchiveReaderGetEntryCount(reader);
+  NSMutableArray* paths = [NSMutableArray arrayWithCapacity:count];
+  bool* selection = malloc(count + 1);
+  for (size_t i = 0; i < count; ++i) {
+    NSString* path = [self _pathForEntry:ArchiveReaderGetEntry(reader, i)];
+    [paths addObject:(path ? path : (id)[NSNull null])];
+    selection[i] = path != nil;
+  }
+  ImageDimensionsContext context = {[NSMutableDictionary dictionary], paths};
+  unsigned char* buffer = malloc(kImageHeaderProbeSize);
+  if (!ArchiveReaderReadEntryPrefixes(reader, selection, buffer, kImageHeaderProbeSize, _AddImageDimensions, &context)) {
+    XLOG_ERROR(@"Failed reading image dimensions from archive");
+    context.dimensions = nil;
+  }
+  free(buffer);
+  free(selection);
+  return context.dimensions;
+}
+
 - (BOOL) extractToPath:(NSString*)outPath {
-  BOOL success = YES;
-  NSFileManager* manager = [NSFileManager defaultManager];
+  ArchiveReader* reader = [self _reader];
+  if (reader == NULL) {
+    return NO;
+  }
+  size_t count = ArchiveReaderGetEntryCount(reader);
+  bool* selection = malloc(count + 1);
+  for (size_t i = 0; i < count; ++i) {
+    selection[i] = [self _pathForEntry:ArchiveReaderGetEntry(reader, i)] != nil;
+  }
+  BOOL success = ArchiveReaderExtractEntries(reader, selection, [outPath fileSystemRepresentation]);
+  if (!success) {
+    XLOG_ERROR(@"Failed extracting archive to \"%@\"", outPath);
+  }
+  free(selection);
+  return success;
+}
+
+// Locates file using the hash table of the reader, trying both encodings accepted by PathFromArchiveFileName()
+- (long) _indexForFile:(NSString*)inPath reader:(ArchiveReader*)reader {
+  if (reader == NULL) {
+    return -1;
+  }
+  long index = ArchiveReaderFindEntry(reader, [inPath UTF8String]);
+  if (index < 0) {
+    index = ArchiveReaderFindEntry(reader, [inPath cStringUsingEncoding:NSISOLatin1StringEncoding]);
+  }
+  return index;
+}
+
+- (BOOL) extractFile:(NSString*)inPath toPath:(NSString*)outPath {
+  ArchiveReader* reader = [self _reader];
+  long index = [self _indexForFile:inPath reader:reader];
+  if (index < 0) {
+    return NO;
+  }
+  if (!ArchiveReaderExtractEntryToFile(reader, index, [outPath fileSystemRepresentation])) {
+    XLOG_ERROR(@"Failed extracting \"%@\" from archive", inPath);
+    return NO;
+  }
+  return YES;
+}
+
+// The archive is released by the allocator along with the data pointing inside it
+static void _DeallocateMappedData(void* ptr, void* info) {
+  [(MiniZip*)info release];
+}
+
+static NSData* _NewMappedData(MiniZip* archive, const void* bytes, size_t length) {
+  CFAllocatorContext context = {0, [archive retain], NULL, NULL, NULL, NULL, NULL, _DeallocateMappedData, NULL};
+  CFAllocatorRef allocator = CFAllocatorCreate(kCFAllocatorDefault, &context);
+  CFDataRef data = CFDataCreateWithBytesNoCopy(kCFAllocatorDefault, bytes, (CFIndex)length, allocator);
+  CFRelease(allocator);
+  return (NSData*)data;
+}
+
+- (NSData*) dataForFile:(NSString*)inPath {
+  ArchiveReader* reader = [self _reader];
+  long index = [self _indexForFile:inPath reader:reader];
+  if (index < 0) {
+    return nil;
+  }
+  
+  // Wrap stored file in place without checking its CRC
+  size_t length;
+  const void* bytes = ArchiveReaderGetEntryBytes(reader, index, &length);
+  if (bytes) {
+    return [_NewMappedData(self, bytes, length) autorelease];
+  }
   
-  // Set current file to first file in archive
-  int result = unzGoToFirstFile(_unzFile);
-  while (1) {
-    // Open current file
-    if (result == UNZ_OK) {
-      result = unzOpenCurrentFile(_unzFile);
+  // Otherwise decompress file straight into memory in a single pass
+  NSMutableData* data = [NSMutableData dataWithLength:(NSUInteger)ArchiveReaderGetEntry(reader, index)->size];
+  if (!ArchiveReaderReadEntry(reader, index, data.mutableBytes, data.length)) {
+    XLOG_ERROR(@"Failed reading \"%@\" from archive", inPath);
+    return nil;
+  }
+  return data;
+}
+
+- (void) prefetchFiles:(NSArray*)files {
+  ArchiveReader* reader = [self _reader];
+  if (reader == NULL) {
+    return;
+  }
+  size_t count = 0;
+  size_t* indexes = malloc(files.count * sizeof(size_t));
+  for (NSString* file in files) {
+    long index = [self _indexForFile:file reader:reader];
+    if (index >= 0) {
+      indexes[count++] = index;
     }
-    if (result != UNZ_OK) {
-      if (result != UNZ_END_OF_LIST_OF_FILE) {
-        XLOG_ERROR(@"MiniZip returned error %i", result);
-        success = NO;
-      }
+  }
+  ArchiveReaderPrefetchEntries(reader, indexes, count);
+  free(indexes);
+}
+
+// Only reads the archive when probing the pages or reading files, which happens in the same pass
+// RAR archives can only be scanned sequentially so their cache holds the names of the pages instead of all the entries
+- (BOOL) _writeDirectoryCacheWithPages:(NSArray*)pages probeImages:(BOOL)probe files:(NSArray*)files data:(NSMutableDictionary*)data {
+  ArchiveReader* reader = [self _reader];
+  if (reader == NULL) {
+    return NO;
+  }
+  size_t count = ArchiveReaderGetEntryCount(reader);
+  long* entryForPage = malloc(pages.count * sizeof(long) + 1);
+  NSUInteger pageCount = 0;
+  size_t namesSize = 0;
+  for (NSString* page in pages) {
+    long index = [self _indexForFile:page reader:reader];
+    if (index < 0) {
+      XLOG_DEBUG_UNREACHABLE();
       break;
     }
+    entryForPage[pageCount++] = index;
+    namesSize += strlen(ArchiveReaderGetEntry(reader, index)->name) + 1;
+  }
+  
+  BOOL success = NO;
+  BOOL namesOnly = NO;
+  DirectoryCacheContents contents = {0};
+  switch (ArchiveReaderGetFormat(reader)) {
     
-    // Retrieve current file path and convert path separators if needed
-    unz_file_info fileInfo = {0};
-    result = unzGetCurrentFileInfo(_unzFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0);
-    if (result != UNZ_OK) {
-      unzCloseCurrentFile(_unzFile);
-      XLOG_ERROR(@"MiniZip returned error %i", result);
-      success = NO;
+    case kArchiveReaderFormat_ZIP:
+      contents.format = kDirectoryCacheFormat_ZIP;
+      contents.list = *ArchiveReaderGetZIPEntryList(reader);
       break;
-    }
-    char* filename = (char*)malloc(fileInfo.size_filename + 1);
-    unzGetCurrentFileInfo(_unzFile, &fileInfo, filename, fileInfo.size_filename, NULL, 0, NULL, 0);
-    for (unsigned int i = 0; i < fileInfo.size_filename; ++i) {
-      if (filename[i] == '\\') {
-        filename[i] = '/';
-      }
-    }
-    filename[fileInfo.size_filename] = 0;
-    NSString* path = _PathFromFileName(filename);
-    free(filename);
     
-    // Extract current file
-    if (_skipInvisible) {
-      for (NSString* string in [path pathComponents]) {
-        if ([string hasPrefix:@"."]) {
-          path = nil;
-          break;
-        }
-      }
-    }
-    if (path) {
-      NSString* fullPath = [outPath stringByAppendingPathComponent:path];
-      
-      // If current file is actually a directory, create it
-      if ([path hasSuffix:@"/"]) {
-        NSError* error = nil;
-        if (![manager createDirectoryAtPath:fullPath withIntermediateDirectories:YES attributes:nil error:&error]) {
-          XLOG_ERROR(@"Failed creating directory \"%@\" from ZIP archive: %@", path, error);
-          success = NO;
-        }
-      }
-      // Otherwise extract file
-      else {
-        FILE* outFile = fopen([fullPath fileSystemRepresentation], "w+");
-        if (outFile == NULL) {
-          [manager createDirectoryAtPath:[fullPath stringByDeletingLastPathComponent]
-             withIntermediateDirectories:YES
-                              attributes:nil
-                                   error:nil];
-          outFile = fopen([fullPath fileSystemRepresentation], "w+");  // Some zip files don't contain directory alone before file
-        }
-        if (outFile) {
-          while (1) {
-            unsigned char buffer[kZipExtractionBufferSize];
-            int read = unzReadCurrentFile(_unzFile, buffer, kZipExtractionBufferSize);
-            if (read > 0) {
-              if (fwrite(buffer, read, 1, outFile) != 1) {
-                 XLOG_ERROR(@"Failed writing \"%@\" from ZIP archive", path);
-                 success = NO;
-                 break;
-              }
-            } else if (read < 0) {
-              XLOG_ERROR(@"Failed reading \"%@\" from ZIP archive", path);
-              success = NO;
-              break;
-            }
-            else {
-              break;
-            }
-          }
-          fclose(outFile);
-        } else {
-          XLOG_ERROR(@"Failed creating file \"%@\" from ZIP archive (%s)", fullPath, strerror(errno));
-          success = NO;
-        }
-      }
-    }
+    case kArchiveReaderFormat_TAR:
+      contents.format = kDirectoryCacheFormat_TAR;
+      contents.list = *ArchiveReaderGetTAREntryList(reader);
+      break;
     
-    // Close current file and go to next one
-    unzCloseCurrentFile(_unzFile);
-    if (!success) {
+    default:
+      namesOnly = YES;  // Entries and names share a single allocation like with unzGetEntryList()
+      contents.format = kDirectoryCacheFormat_RAR;
+      contents.list.entries = calloc(1, pageCount * sizeof(unz_entry) + namesSize + 1);
+      contents.list.names = (char*)(contents.list.entries + pageCount);
       break;
-    }
-    result = unzGoToNextFile(_unzFile);
+    
   }
-  
-  return success;
-}
-
-- (BOOL) extractFile:(NSString*)inPath toPath:(NSString*)outPath {
-  BOOL success = NO;
-  
-  // Set current file to first file in archive
-  int result = unzGoToFirstFile(_unzFile);
-  while (1) {
-    // Open current file
-    if (result == UNZ_OK) {
-      result = unzOpenCurrentFile(_unzFile);
+  contents.pages = calloc(pageCount + 1, sizeof(DirectoryCachePage));
+  long* pageForEntry = malloc(count * sizeof(long) + 1);
+  NSString** fileForEntry = calloc(count + 1, sizeof(NSString*));
+  for (size_t i = 0; i < count; ++i) {
+    pageForEntry[i] = -1;
+  }
+  long cover = ArchiveReaderFindCover(reader);
+  size_t offset = 0;
+  for (NSUInteger i = 0; i < pageCount; ++i) {
+    long index = entryForPage[i];
+    if (probe) {
+      pageForEntry[index] = contents.pageCount;
     }
-    if (result != UNZ_OK) {
-      if (result != UNZ_END_OF_LIST_OF_FILE) {
-        XLOG_ERROR(@"MiniZip returned error %i", result);
-      }
-      break;
+    if (index == cover) {
+      contents.coverPage = contents.pageCount;
     }
-    
-    // Retrieve current file path and convert path separators if needed
-    unz_file_info fileInfo = {0};
-    result = unzGetCurrentFileInfo(_unzFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0);
-    if (result != UNZ_OK) {
-      unzCloseCurrentFile(_unzFile);
-      XLOG_ERROR(@"MiniZip returned error %i", result);
-      break;
+    if (namesOnly) {
+      const char* name = ArchiveReaderGetEntry(reader, index)->name;
+      unz_entry* entry = &contents.list.entries[contents.list.number_entry];
+      entry->name_offset = offset;
+      entry->size_filename = strlen(name);
+      memcpy(contents.list.names + offset, name, entry->size_filename + 1);
+      offset += entry->size_filename + 1;
+      contents.pages[contents.pageCount++].entry = contents.list.number_entry++;
+    } else {
+      contents.pages[contents.pageCount++].entry = index;
     }
-    char* filename = (char*)malloc(fileInfo.size_filename + 1);
-    unzGetCurrentFileInfo(_unzFile, &fileInfo, filename, fileInfo.size_filename, NULL, 0, NULL, 0);
-    for (unsigned int i = 0; i < fileInfo.size_filename; ++i) {
-      if (filename[i] == '\\') {
-        filename[i] = '/';
-      }
+  }
+  for (NSString* file in files) {
+    long index = [self _indexForFile:file reader:reader];
+    if (index >= 0) {
+      fileForEntry[index] = file;
     }
-    filename[fileInfo.size_filename] = 0;
-    NSString* path = _PathFromFileName(filename);
-    free(filename);
-    
-    // If file is required one, extract it
-    if (![path hasSuffix:@"/"] && [path isEqualToString:inPath]) {
-      FILE* outFile = fopen([outPath fileSystemRepresentation], "w");
-      if (outFile) {
-        success = YES;
-        while (1) {
-          unsigned char buffer[kZipExtractionBufferSize];
-          int read = unzReadCurrentFile(_unzFile, buffer, kZipExtractionBufferSize);
-          if (read > 0) {
-            if (fwrite(buffer, read, 1, outFile) != 1) {
-               XLOG_ERROR(@"Failed writing \"%@\" from ZIP archive", path);
-               success = NO;
-               break;
-            }
-          } else if (read < 0) {
-            XLOG_ERROR(@"Failed reading \"%@\" from ZIP archive", path);
-            success = NO;
-            break;
-          }
-          else {
-            break;
-          }
-        }
-        fclose(outFile);
-      } else {
-        XLOG_ERROR(@"Failed creating \"%@\" from ZIP archive", path);
-      }
-      unzCloseCurrentFile(_unzFile);
-      break;
+  }
+  if (probe || files.count) {
+    ImportContext context = {contents.pages, pageForEntry, fileForEntry, data};
+    if (!_ImportEntries(reader, &context)) {
+      XLOG_WARNING(@"Failed importing pages of archive \"%@\"", _path);  // The cache is still useful without them
     }
-    
-    // Close current file and go to next one
-    unzCloseCurrentFile(_unzFile);
-    result = unzGoToNextFile(_unzFile);
   }
-  
+  if (_directoryKey && (contents.pageCount == pages.count)) {
+    success = DirectoryCacheWrite([_directoryCachePath fileSystemRepresentation], (DirectoryCacheKey*)_directoryKey, &contents);
+    if (!success) {
+      XLOG_ERROR(@"Failed writing directory cache for \"%@\"", _path);
+    }
+  }
+  free(fileForEntry);
+  free(pageForEntry);
+  free(entryForPage);
+  if (namesOnly) {
+    free(contents.list.entries);
+  }
+  free(contents.pages);
   return success;
 }
 
+- (BOOL) writeDirectoryCacheWithPages:(NSArray*)pages {
+  if (_directoryKey == NULL) {
+    return NO;
+  }
+  return [self _writeDirectoryCacheWithPages:pages probeImages:NO files:nil data:nil];
+}
+
+- (NSDictionary*) importPages:(NSArray*)pages readingFiles:(NSArray*)files {
+  NSMutableDictionary* data = [NSMutableDictionary dictionary];
+  [self _writeDirectoryCacheWithPages:pages probeImages:(_directoryKey != NULL) files:files data:data];
+  return data;
+}
+
 @end
@@ -0,0 +1,153 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SortKey.h"
+
+// Digit runs are encoded as the marker, their length without leading zeros then their digits, so numbers
+// compare by value: the marker is the "0" character itself as digits never appear otherwise in a key,
+// which keeps them after spaces and punctuation but before letters
+#define kNumberMarker '0'
+#define kMaxNumberLength 255  // Longer runs are split
+#define kTieSeparator 0  // Lower than any byte in the folded part so "a" < "a b"
+
+// Base letters for U+00C0 to U+00FF (NULL for "×" and "÷" which are kept)
+static const char* _latin1Folding[64] = {
+  "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+  "d", "n", "o", "o", "o", "o", "o", NULL, "o", "u", "u", "u", "u", "y", "th", "ss",
+  "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+  "d", "n", "o", "o", "o", "o", "o", NULL, "o", "u", "u", "u", "u", "y", "th", "y"
+};
+
+typedef struct {
+  unsigned char* bytes;
+  size_t size;
+  size_t length;
+} KeyWriter;
+
+static inline void _WriteByte(KeyWriter* writer, unsigned char byte) {
+  if (writer->length < writer->size) {
+    writer->bytes[writer->length] = byte;
+  }
+  writer->length += 1;
+}
+
+size_t SortKeyGenerate(const char* name, void* key, size_t size) {
+  const unsigned char* bytes = (const unsigned char*)name;
+  KeyWriter writer = {(unsigned char*)key, size, 0};
+  size_t i = 0;
+  while (bytes[i]) {
+    unsigned char c = bytes[i];
+    if ((c >= '0') && (c <= '9')) {
+      while (bytes[i] == '0') {
+        ++i;
+      }
+      size_t start = i;
+      while ((bytes[i] >= '0') && (bytes[i] <= '9')) {
+        ++i;
+      }
+      size_t length = i - start;
+      if (length == 0) {  // Only zeros
+        --start;
+        length = 1;
+      }
+      do {
+        size_t chunk = length < kMaxNumberLength ? length : kMaxNumberLength;
+        _WriteByte(&writer, kNumberMarker);
+        _WriteByte(&writer, (unsigned char)chunk);
+        for (size_t j = 0; j < chunk; ++j) {
+          _WriteByte(&writer, bytes[start + j]);
+        }
+        start += chunk;
+        length -= chunk;
+      } while (length);
+    } else if ((c >= 'A') && (c <= 'Z')) {
+      _WriteByte(&writer, c + ('a' - 'A'));
+      ++i;
+    } else if ((c == 0xC3) && (bytes[i + 1] >= 0x80) && (bytes[i + 1] <= 0xBF) && _latin1Folding[bytes[i + 1] - 0x80]) {
+      for (const char* folded = _latin1Folding[bytes[i + 1] - 0x80]; *folded; ++folded) {
+        _WriteByte(&writer, *folded);
+      }
+      i += 2;
+    } else {
+      _WriteByte(&writer, c);
+      ++i;
+    }
+  }
+  _WriteByte(&writer, kTieSeparator);
+  for (size_t j = 0; j < i; ++j) {
+    _WriteByte(&writer, bytes[j]);
+  }
+  return writer.length;
+}
+
+int SortKeyCompare(const void* key1, size_t length1, const void* key2, size_t length2) {
+  int result = memcmp(key1, key2, length1 < length2 ? length1 : length2);
+  if (result == 0) {
+    result = length1 < length2 ? -1 : length1 > length2 ? 1 : 0;
+  }
+  return result;
+}
+
+typedef struct {
+  const unsigned char* key;
+  size_t length;
+  size_t index;
+} KeyRecord;
+
+static int _CompareKeyRecords(const void* a, const void* b) {
+  const KeyRecord* record1 = (const KeyRecord*)a;
+  const KeyRecord* record2 = (const KeyRecord*)b;
+  int result = SortKeyCompare(record1->key, record1->length, record2->key, record2->length);
+  if (result == 0) {
+    result = record1->index < record2->index ? -1 : 1;  // Stable
+  }
+  return result;
+}
+
+// All keys share a single allocation sized by a first pass
+bool SortKeySortNames(const char* const* names, size_t count, size_t* order) {
+  KeyRecord* records = (KeyRecord*)malloc(count * sizeof(KeyRecord) + 1);
+  if (records == NULL) {
+    return false;
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < count; ++i) {
+    records[i].length = SortKeyGenerate(names[i], NULL, 0);
+    records[i].index = i;
+    total += records[i].length;
+  }
+  unsigned char* keys = (unsigned char*)malloc(total + 1);
+  if (keys == NULL) {
+    free(records);
+    return false;
+  }
+  size_t offset = 0;
+  for (size_t i = 0; i < count; ++i) {
+    records[i].key = keys + offset;
+    SortKeyGenerate(names[i], keys + offset, records[i].length);
+    offset += records[i].length;
+  }
+  qsort(records, count, sizeof(KeyRecord), _CompareKeyRecords);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = records[i].index;
+  }
+  free(keys);
+  free(records);
+  return true;
+}
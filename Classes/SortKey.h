@@ -0,0 +1,32 @@
+//  Copyright (C) 2010-2016 Pierre-Olivier Latour <info@pol-online.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A key is a byte string that compares with memcmp() (or SQLite BLOB ordering) like Finder sorts file names,
+// so "Page 9" comes before "Page 10", case and Latin-1 accents are ignored, and the original name breaks ties
+size_t SortKeyGenerate(const char* name, void* key, size_t size);  // Returns the key length which may exceed size like snprintf()
+bool SortKeySortNames(const char* const* names, size_t count, size_t* order);  // Fills order with indexes of names, generating each key once
+int SortKeyCompare(const void* key1, size_t length1, const void* key2, size_t length2);  // Like memcmp() with a prefix first
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,17 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#import <Foundation/Foundation.h>
+#import "MiniZip.h"
 
-@interface UnRAR : NSObject {
-@private
-  NSString* _archivePath;
-  BOOL _skipInvisible;
-}
-@property(nonatomic) BOOL skipInvisibleFiles;
+// RAR archives can only be scanned sequentially so their directory cache only holds the page names
+// and an archive opened from it is only scanned once a file is actually read
+@interface UnRAR : MiniZip
 + (BOOL) extractRARArchiveAtPath:(NSString*)inPath toPath:(NSString*)outPath;
-- (id) initWithArchiveAtPath:(NSString*)path;
-- (NSArray*) retrieveFileList;
-- (BOOL) extractToPath:(NSString*)outPath;
-- (BOOL) extractFile:(NSString*)inPath toPath:(NSString*)outPath;  // Destination path must include file name;
 @end
@@ -13,22 +13,11 @@
 // limitations under the License.
 
 #import "UnRAR.h"
-#import "raros.hpp"
-#import "dll.hpp"
-
-// http://www.rarlab.com/rar_add.htm
-// http://goahomepage.free.fr/article/2000_09_17_unrar_dll/UnRARDLL.html
-
-static NSString* _PathFromFileName(const char* filename) {
-  NSString* path = [NSString stringWithCString:filename encoding:NSASCIIStringEncoding];
-  XLOG_DEBUG_CHECK(path);
-  return path;
-}
+#import "DirectoryCache.h"
+#import "ArchiveReader.h"
 
 @implementation UnRAR
 
-@synthesize skipInvisibleFiles=_skipInvisible;
-
 + (BOOL) extractRARArchiveAtPath:(NSString*)inPath toPath:(NSString*)outPath {
   BOOL success = NO;
   UnRAR* archive = [[UnRAR alloc] initWithArchiveAtPath:inPath];
@@ -39,195 +28,16 @@ static NSString* _PathFromFileName(const char* filename) {
   return success;
 }
 
-- (id) initWithArchiveAtPath:(NSString*)path {
-  if ((self = [super init])) {
-    _archivePath = [path copy];
-    
-    struct RAROpenArchiveData archiveData;
-    bzero(&archiveData, sizeof(archiveData));
-    archiveData.ArcName = (char*)[_archivePath fileSystemRepresentation];
-    archiveData.OpenMode = RAR_OM_LIST;
-    HANDLE handle = RAROpenArchive(&archiveData);
-    if (handle) {
-      RARCloseArchive(handle);
-    } else {
-      [self release];
-      return nil;
-    }
-  }
-  return self;
++ (int) archiveFormat {
+  return kArchiveReaderFormat_RAR;
 }
 
-- (void) dealloc {
-  [_archivePath release];
-  
-  [super dealloc];
-}
-
-- (NSArray*) retrieveFileList {
-  NSMutableArray* array = nil;
-  
-  // Open archive
-  struct RAROpenArchiveData archiveData;
-  bzero(&archiveData, sizeof(archiveData));
-  archiveData.ArcName = (char*)[_archivePath fileSystemRepresentation];
-  archiveData.OpenMode = RAR_OM_LIST;
-  HANDLE handle = RAROpenArchive(&archiveData);
-  if (handle) {
-    array = [NSMutableArray array];
-    
-    // Scan archive
-    while (1) {
-      // Retrieve current file information
-      struct RARHeaderData headerData;
-      bzero(&headerData, sizeof(headerData));
-      int result = RARReadHeader(handle, &headerData);
-      if (result != 0) {
-        if (result != ERAR_END_ARCHIVE) {
-          XLOG_ERROR(@"UnRAR returned error %i", result);
-          array = nil;
-        }
-        break;
-      }
-      NSString* path = _PathFromFileName(headerData.FileName);
-      
-      // Add current file to list if necessary
-      if (_skipInvisible) {
-        for (NSString* string in [path pathComponents]) {
-          if ([string hasPrefix:@"."]) {
-            path = nil;
-            break;
-          }
-        }
-      }
-      if (path && headerData.FileCRC) {
-        [array addObject:path];
-      }
-      
-      // Find next file
-      result = RARProcessFile(handle, RAR_SKIP, NULL, NULL);
-      if (result != 0) {
-        XLOG_ERROR(@"UnRAR returned error %i", result);
-        array = nil;
-        break;
-      }
-    }
-    
-    // Close archive
-    RARCloseArchive(handle);
-  } else {
-    XLOG_ERROR(@"UnRAR failed opening archive");
+- (id) initWithArchiveAtPath:(NSString*)path key:(const DirectoryCacheKey*)key directoryContents:(const DirectoryCacheContents*)contents {
+  if (contents->format != kDirectoryCacheFormat_RAR) {
+    [self release];  // This is a ZIP or TAR archive
+    return nil;
   }
-  
-  return array;
-}
-
-- (BOOL) extractToPath:(NSString*)outPath {
-  BOOL success = NO;
-  
-  // Open archive
-  struct RAROpenArchiveData archiveData;
-  bzero(&archiveData, sizeof(archiveData));
-  archiveData.ArcName = (char*)[_archivePath fileSystemRepresentation];
-  archiveData.OpenMode = RAR_OM_EXTRACT;
-  HANDLE handle = RAROpenArchive(&archiveData);
-  if (handle) {
-    const char* destination = [outPath fileSystemRepresentation];
-    success = YES;
-    
-    // Scan archive
-    while (1) {
-      // Retrieve current file information
-      struct RARHeaderData headerData;
-      bzero(&headerData, sizeof(headerData));
-      int result = RARReadHeader(handle, &headerData);
-      if (result != 0) {
-        if (result != ERAR_END_ARCHIVE) {
-          XLOG_ERROR(@"UnRAR returned error %i", result);
-          success = NO;
-        }
-        break;
-      }
-      NSString* path = _PathFromFileName(headerData.FileName);
-      
-      // Add current file to list if necessary
-      if (_skipInvisible) {
-        for (NSString* string in [path pathComponents]) {
-          if ([string hasPrefix:@"."]) {
-            path = nil;
-            break;
-          }
-        }
-      }
-      
-      // Extract and find next file
-      result = RARProcessFile(handle, path && headerData.FileCRC ? RAR_EXTRACT : RAR_SKIP, (char*)destination, NULL);
-      if (result != 0) {
-        XLOG_ERROR(@"UnRAR returned error %i", result);
-        success = NO;
-        break;
-      }
-    }
-    
-    // Close archive
-    RARCloseArchive(handle);
-  } else {
-    XLOG_ERROR(@"UnRAR failed opening archive");
-  }
-  
-  return success;
-}
-
-- (BOOL) extractFile:(NSString*)inPath toPath:(NSString*)outPath {
-  BOOL success = NO;
-  
-  // Open archive
-  struct RAROpenArchiveData archiveData;
-  bzero(&archiveData, sizeof(archiveData));
-  archiveData.ArcName = (char*)[_archivePath fileSystemRepresentation];
-  archiveData.OpenMode = RAR_OM_EXTRACT;
-  HANDLE handle = RAROpenArchive(&archiveData);
-  if (handle) {
-    
-    // Scan archive
-    while (1) {
-      // Retrieve current file information
-      struct RARHeaderData headerData;
-      bzero(&headerData, sizeof(headerData));
-      int result = RARReadHeader(handle, &headerData);
-      if (result != 0) {
-        if (result != ERAR_END_ARCHIVE) {
-          XLOG_ERROR(@"UnRAR returned error %i", result);
-        }
-        break;
-      }
-      NSString* path = _PathFromFileName(headerData.FileName);
-      
-      // Extract if necessary and find next file
-      if (headerData.FileCRC && [path isEqualToString:inPath]) {
-        result = RARProcessFile(handle, RAR_EXTRACT, NULL, (char*)[outPath fileSystemRepresentation]);
-        if (result != 0) {
-          XLOG_ERROR(@"UnRAR returned error %i", result);
-        } else {
-          success = YES;
-        }
-        break;
-      } else {
-        result = RARProcessFile(handle, RAR_SKIP, NULL, NULL);
-        if (result != 0) {
-          XLOG_ERROR(@"UnRAR returned error %i", result);
-          break;
-        }
-      }
-    }
-    
-    // Close archive
-    RARCloseArchive(handle);
-  } else {
-    XLOG_ERROR(@"UnRAR failed opening archive");
-  }
-  
-  return success;
+  return [self initWithUnopenedArchiveAtPath:path];
 }
 
 @end
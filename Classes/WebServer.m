@@ -14,7 +14,13 @@
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #import "AppDelegate.h"
+#import "ArchiveReader.h"
+#import "CollectionArchive.h"
 #import "Defaults.h"
+#import "Library.h"
+
+#import "GCDWebServerErrorResponse.h"
+#import "GCDWebServerStreamedResponse.h"
 
 #define kDisconnectLatency 1.0
 
@@ -26,6 +32,38 @@
 
 @implementation WebsiteServer
 
+- (id) initWithUploadDirectory:(NSString*)path {
+  if ((self = [super initWithUploadDirectory:path])) {
+    __block WebsiteServer* server = self;  // Not retained by the block
+    [self addHandlerForMethod:@"GET" path:@"/download-collection" requestClass:[GCDWebServerRequest class] processBlock:^GCDWebServerResponse*(GCDWebServerRequest* request) {
+      return [server _responseForCollectionAtPath:[[request query] objectForKey:@"path"]];
+    }];
+  }
+  return self;
+}
+
+// Streams the whole collection as a single CBZ generated on the fly
+- (GCDWebServerResponse*) _responseForCollectionAtPath:(NSString*)relativePath {
+  NSString* rootPath = [self.uploadDirectory stringByStandardizingPath];
+  NSString* directoryPath = [[rootPath stringByAppendingPathComponent:relativePath] stringByStandardizingPath];
+  BOOL isDirectory = NO;
+  if (!relativePath || ![directoryPath hasPrefix:[rootPath stringByAppendingString:@"/"]] ||
+      ![[NSFileManager defaultManager] fileExistsAtPath:directoryPath isDirectory:&isDirectory] || !isDirectory) {
+    return [GCDWebServerErrorResponse responseWithClientError:kGCDWebServerHTTPStatusCode_NotFound message:@"\"%@\" is not a collection", relativePath];
+  }
+  CollectionArchive* archive = [[CollectionArchive alloc] initWithDirectoryPath:directoryPath];
+  if (archive == nil) {
+    return [GCDWebServerErrorResponse responseWithServerError:kGCDWebServerHTTPStatusCode_InternalServerError message:@"Failed creating archive"];
+  }
+  GCDWebServerStreamedResponse* response = [GCDWebServerStreamedResponse responseWithContentType:@"application/vnd.comicbook+zip" streamBlock:^NSData*(NSError** error) {
+    return [archive readData:error];
+  }];
+  [archive release];  // Retained by the block
+  [response setValue:[NSString stringWithFormat:@"attachment; filename=\"%@.cbz\"", [directoryPath lastPathComponent]] forAdditionalHeader:@"Content-Disposition"];
+  XLOG_VERBOSE(@"Streaming collection \"%@\"", [directoryPath lastPathComponent]);
+  return response;
+}
+
 - (BOOL) shouldUploadFileAtPath:(NSString*)path withTemporaryFile:(NSString*)tempPath {
   if ([[NSUserDefaults standardUserDefaults] integerForKey:kDefaultKey_ServerMode] == kServerMode_Limited) {
     XLOG_ERROR(@"Upload rejected: web server is in limited mode");
@@ -34,6 +72,11 @@
   return YES;
 }
 
+- (BOOL) shouldDeleteItemAtPath:(NSString*)path {
+  [LibraryConnection removeDirectoryCachesForPath:path];  // Cannot be found anymore once deleted
+  return YES;
+}
+
 @end
 
 @implementation WebDAVServer
@@ -46,6 +89,11 @@
   return YES;
 }
 
+- (BOOL) shouldDeleteItemAtPath:(NSString*)path {
+  [LibraryConnection removeDirectoryCachesForPath:path];  // Cannot be found anymore once deleted
+  return YES;
+}
+
 @end
 
 @implementation WebServer
@@ -79,7 +127,7 @@
     }
     if (type != kWebServerType_Off) {
       NSString* documentsPath = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) firstObject];
-      NSArray* fileExtensions = [NSArray arrayWithObjects:@"pdf", @"zip", @"cbz", @"rar", @"cbr", nil];
+      NSArray* fileExtensions = [NSArray arrayWithObjects:@"pdf", @"zip", @"cbz", @"rar", @"cbr", @"tar", @"cbt", nil];
       if (type == kWebServerType_Website) {
         _webServer = [[WebsiteServer alloc] initWithUploadDirectory:documentsPath];
         [(WebsiteServer*)_webServer setAllowedFileExtensions:fileExtensions];
@@ -176,14 +224,18 @@
 }
 
 - (void) webUploader:(GCDWebUploader*)uploader didUploadFileAtPath:(NSString*)path {
+  ArchiveReaderCacheInvalidate([path fileSystemRepresentation]);  // Might have replaced an open comic
   [_delegate webServerDidUploadComic:self];
 }
 
 - (void) webUploader:(GCDWebUploader*)uploader didMoveItemFromPath:(NSString*)fromPath toPath:(NSString*)toPath {
+  ArchiveReaderCacheInvalidate([fromPath fileSystemRepresentation]);
+  ArchiveReaderCacheInvalidate([toPath fileSystemRepresentation]);
   [_delegate webServerDidUpdate:self];
 }
 
 - (void) webUploader:(GCDWebUploader*)uploader didDeleteItemAtPath:(NSString*)path {
+  ArchiveReaderCacheInvalidate([path fileSystemRepresentation]);
   [_delegate webServerDidUpdate:self];
 }
 
@@ -196,10 +248,13 @@
 }
 
 - (void) davServer:(GCDWebDAVServer*)server didUploadFileAtPath:(NSString*)path {
+  ArchiveReaderCacheInvalidate([path fileSystemRepresentation]);  // Might have replaced an open comic
   [_delegate webServerDidUploadComic:self];
 }
 
 - (void) davServer:(GCDWebDAVServer*)server didMoveItemFromPath:(NSString*)fromPath toPath:(NSString*)toPath {
+  ArchiveReaderCacheInvalidate([fromPath fileSystemRepresentation]);
+  ArchiveReaderCacheInvalidate([toPath fileSystemRepresentation]);
   [_delegate webServerDidUpdate:self];
 }
 
@@ -208,6 +263,7 @@
 }
 
 - (void) davServer:(GCDWebDAVServer*)server didDeleteItemAtPath:(NSString*)path {
+  ArchiveReaderCacheInvalidate([path fileSystemRepresentation]);
   [_delegate webServerDidUpdate:self];
 }
 
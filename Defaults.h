@@ -14,7 +14,8 @@
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define kDefaultKey_LibraryVersion @"libraryVersion"
-#define kLibraryVersion 1
+#define kLibraryVersion 3  // Version 2 added the sort keys, 3 the ComicInfo.xml titles, both migrated in place by LibraryConnection
+#define kDefaultKey_MissingTitles @"missingTitles"  // Existing comics have not been checked for ComicInfo.xml titles yet
 
 #define kDefaultKey_ServerType @"serverType"
 #define kDefaultKey_ServerMode @"serverMode"
@@ -151,6 +151,9 @@ typedef ZPOS64_T (ZCALLBACK *tell64_file_func)    OF((voidpf opaque, voidpf stre
 typedef long     (ZCALLBACK *seek64_file_func)    OF((voidpf opaque, voidpf stream, ZPOS64_T offset, int origin));
 typedef voidpf   (ZCALLBACK *open64_file_func)    OF((voidpf opaque, const void* filename, int mode));
 
+/* optional, returns the whole file mapped in memory and its size or NULL */
+typedef const void* (ZCALLBACK *map64_file_func)  OF((voidpf opaque, voidpf stream, ZPOS64_T* size));
+
 typedef struct zlib_filefunc64_def_s
 {
     open64_file_func    zopen64_file;
@@ -161,6 +164,7 @@ typedef struct zlib_filefunc64_def_s
     close_file_func     zclose_file;
     testerror_file_func zerror_file;
     voidpf              opaque;
+    map64_file_func     zmap64_file;
 } zlib_filefunc64_def;
 
 void fill_fopen64_filefunc OF((zlib_filefunc64_def* pzlib_filefunc_def));
@@ -182,6 +186,7 @@ typedef struct zlib_filefunc64_32_def_s
 //#define ZSEEK64(filefunc,filestream,pos,mode)   ((*((filefunc).zseek64_file)) ((filefunc).opaque,filestream,pos,mode))
 #define ZCLOSE64(filefunc,filestream)             ((*((filefunc).zfile_func64.zclose_file))  ((filefunc).zfile_func64.opaque,filestream))
 #define ZERROR64(filefunc,filestream)             ((*((filefunc).zfile_func64.zerror_file))  ((filefunc).zfile_func64.opaque,filestream))
+#define ZMAP64(filefunc,filestream,size)          ((filefunc).zfile_func64.zmap64_file != NULL ? (*((filefunc).zfile_func64.zmap64_file)) ((filefunc).zfile_func64.opaque,filestream,size) : NULL)
 
 voidpf call_zopen64 OF((const zlib_filefunc64_32_def* pfilefunc,const void*filename,int mode));
 long    call_zseek64 OF((const zlib_filefunc64_32_def* pfilefunc,voidpf filestream, ZPOS64_T offset, int origin));
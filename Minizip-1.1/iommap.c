@@ -0,0 +1,189 @@
+/* iommap.c -- IO base function header for compress/uncompress .zip
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "iommap.h"
+
+typedef struct
+{
+    FILE* file;                 /* stdio fallback, NULL if mapped */
+    const unsigned char* base;
+    ZPOS64_T size;
+    ZPOS64_T pos;
+} mmap_file;
+
+static voidpf ZCALLBACK mmap_open64_file_func (voidpf opaque, const void* filename, int mode)
+{
+    mmap_file* mf;
+    const char* mode_fopen = NULL;
+    if (filename==NULL)
+        return NULL;
+
+    mf = (mmap_file*)malloc(sizeof(mmap_file));
+    if (mf==NULL)
+        return NULL;
+    memset(mf,0,sizeof(mmap_file));
+
+    if ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER)==ZLIB_FILEFUNC_MODE_READ)
+    {
+        int fd = open((const char*)filename, O_RDONLY);
+        struct stat info;
+        if (fd<0)
+        {
+            free(mf);
+            return NULL;
+        }
+        if ((fstat(fd,&info)==0) && (info.st_size>0) &&
+            ((ZPOS64_T)info.st_size<=MMAP_MAX_FILE_SIZE))
+        {
+            void* base = mmap(NULL,(size_t)info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+            if (base!=MAP_FAILED)
+            {
+                mf->base = (const unsigned char*)base;
+                mf->size = info.st_size;
+            }
+        }
+        close(fd);  /* the mapping stays valid */
+        if (mf->base!=NULL)
+            return mf;
+        mode_fopen = "rb";
+    }
+    else
+    if (mode & ZLIB_FILEFUNC_MODE_EXISTING)
+        mode_fopen = "r+b";
+    else
+    if (mode & ZLIB_FILEFUNC_MODE_CREATE)
+        mode_fopen = "wb";
+
+    if (mode_fopen!=NULL)
+        mf->file = fopen64((const char*)filename, mode_fopen);
+    if (mf->file==NULL)
+    {
+        free(mf);
+        return NULL;
+    }
+    return mf;
+}
+
+static uLong ZCALLBACK mmap_read_file_func (voidpf opaque, voidpf stream, void* buf, uLong size)
+{
+    mmap_file* mf = (mmap_file*)stream;
+    if (mf->file!=NULL)
+        return (uLong)fread(buf, 1, (size_t)size, mf->file);
+    if (size>mf->size-mf->pos)
+        size = (uLong)(mf->size-mf->pos);
+    memcpy(buf,mf->base+mf->pos,size);
+    mf->pos += size;
+    return size;
+}
+
+static uLong ZCALLBACK mmap_write_file_func (voidpf opaque, voidpf stream, const void* buf, uLong size)
+{
+    mmap_file* mf = (mmap_file*)stream;
+    if (mf->file!=NULL)
+        return (uLong)fwrite(buf, 1, (size_t)size, mf->file);
+    return 0;
+}
+
+static ZPOS64_T ZCALLBACK mmap_tell64_file_func (voidpf opaque, voidpf stream)
+{
+    mmap_file* mf = (mmap_file*)stream;
+    if (mf->file!=NULL)
+        return ftello64(mf->file);
+    return mf->pos;
+}
+
+static long ZCALLBACK mmap_seek64_file_func (voidpf opaque, voidpf stream, ZPOS64_T offset, int origin)
+{
+    mmap_file* mf = (mmap_file*)stream;
+    ZPOS64_T pos;
+    if (mf->file!=NULL)
+    {
+        int fseek_origin;
+        switch (origin)
+        {
+        case ZLIB_FILEFUNC_SEEK_CUR :
+            fseek_origin = SEEK_CUR;
+            break;
+        case ZLIB_FILEFUNC_SEEK_END :
+            fseek_origin = SEEK_END;
+            break;
+        case ZLIB_FILEFUNC_SEEK_SET :
+            fseek_origin = SEEK_SET;
+            break;
+        default: return -1;
+        }
+        return fseeko64(mf->file, offset, fseek_origin) != 0 ? -1 : 0;
+    }
+
+    /* offset is unsigned but callers pass negative values as two's complement */
+    switch (origin)
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR :
+        pos = mf->pos + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_END :
+        pos = mf->size + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET :
+        pos = offset;
+        break;
+    default: return -1;
+    }
+    if (pos>mf->size)
+        return -1;
+    mf->pos = pos;
+    return 0;
+}
+
+static int ZCALLBACK mmap_close_file_func (voidpf opaque, voidpf stream)
+{
+    mmap_file* mf = (mmap_file*)stream;
+    int ret = 0;
+    if (mf->file!=NULL)
+        ret = fclose(mf->file);
+    else
+        ret = munmap((void*)mf->base,(size_t)mf->size);
+    free(mf);
+    return ret;
+}
+
+static int ZCALLBACK mmap_error_file_func (voidpf opaque, voidpf stream)
+{
+    mmap_file* mf = (mmap_file*)stream;
+    if (mf->file!=NULL)
+        return ferror(mf->file);
+    return 0;
+}
+
+static const void* ZCALLBACK mmap_map64_file_func (voidpf opaque, voidpf stream, ZPOS64_T* size)
+{
+    mmap_file* mf = (mmap_file*)stream;
+    *size = mf->size;
+    return mf->base;  /* NULL if using stdio */
+}
+
+void fill_mmap_filefunc64 (zlib_filefunc64_def* pzlib_filefunc_def)
+{
+    pzlib_filefunc_def->zopen64_file = mmap_open64_file_func;
+    pzlib_filefunc_def->zread_file = mmap_read_file_func;
+    pzlib_filefunc_def->zwrite_file = mmap_write_file_func;
+    pzlib_filefunc_def->ztell64_file = mmap_tell64_file_func;
+    pzlib_filefunc_def->zseek64_file = mmap_seek64_file_func;
+    pzlib_filefunc_def->zclose_file = mmap_close_file_func;
+    pzlib_filefunc_def->zerror_file = mmap_error_file_func;
+    pzlib_filefunc_def->opaque = NULL;
+    pzlib_filefunc_def->zmap64_file = mmap_map64_file_func;
+}
@@ -0,0 +1,35 @@
+/* iommap.h -- IO base function header for compress/uncompress .zip
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+         Read-only backend serving reads and seeks from a memory mapping of
+         the whole file, so unzip makes no system call after opening. Files
+         which cannot be mapped and write modes fall back to stdio.
+         The mapping is also exposed through zmap64_file so stored entries
+         can be accessed in place with unzGetCurrentFileMappedData().
+*/
+
+#ifndef _ZLIBIOMMAP_H
+#define _ZLIBIOMMAP_H
+
+#include "ioapi.h"
+
+#ifndef MMAP_MAX_FILE_SIZE
+/* Keep the address space of 32 bits processes for the rest of the app */
+#define MMAP_MAX_FILE_SIZE (sizeof(void*)<8 ? (ZPOS64_T)256*1024*1024 : (ZPOS64_T)-1)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void fill_mmap_filefunc64 OF((zlib_filefunc64_def* pzlib_filefunc_def));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
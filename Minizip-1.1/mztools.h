@@ -28,4 +28,8 @@ extern int ZEXPORT unzRepair(const char* file,
                              uLong* nRecovered,
                              uLong* bytesRecovered);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
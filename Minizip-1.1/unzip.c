@@ -140,6 +140,10 @@ typedef struct
     bz_stream bstream;          /* bzLib stream structure for bziped */
 #endif
 
+#ifdef HAVE_ZSTD
+    ZSTD_DStream* zstream;      /* zstd stream for method 93 */
+#endif
+
     ZPOS64_T pos_in_zipfile;       /* position in byte on the zipfile, for fseek*/
     uLong stream_initialised;   /* flag set if stream structure is initialised*/
 
@@ -160,6 +164,26 @@ typedef struct
 } file_in_zip64_read_info_s;
 
 
+/* unz64_cd_index_s contain the central directory read at open time, with
+   two open addressing hash tables of the entries by name (case sensitive and
+   not case sensitive) used by unzLocateFileFast
+*/
+typedef struct unz64_cd_entry_s
+{
+    uLong offset;               /* offset of the entry in buffer */
+    uLong size_filename;
+} unz64_cd_entry;
+
+typedef struct unz64_cd_index_s
+{
+    unsigned char* buffer;      /* copy of the whole central directory */
+    uLong number_entry;
+    unz64_cd_entry* entries;
+    uLong table_mask;           /* tables have table_mask+1 slots */
+    uLong* table_cs;            /* entry number + 1 or 0 for empty slots */
+    uLong* table_ci;
+} unz64_cd_index;
+
 /* unz64_s contain internal information about the zipfile
 */
 typedef struct
@@ -186,6 +210,10 @@ typedef struct
 
     int isZip64;
 
+    unz64_cd_index* cd_index;      /* NULL if the central dir could not be indexed */
+    unz_buffer_inflater buffer_inflater;
+    voidpf buffer_inflater_opaque;
+
 #    ifndef NOUNCRYPT
     unsigned long keys[3];     /* keys defining the pseudo-random sequence */
     const unsigned long* pcrc_32_tab;
@@ -198,26 +226,22 @@ typedef struct
 #endif
 
 /* ===========================================================================
-     Read a byte from a gz_stream; update next_in and avail_in. Return EOF
-   for end of file.
+     Read size bytes from a gz_stream with a single read call, so headers
+   cost one call per field instead of one per byte.
    IN assertion: the stream s has been sucessfully opened for reading.
 */
 
 
-local int unz64local_getByte OF((
+local int unz64local_getBytes OF((
     const zlib_filefunc64_32_def* pzlib_filefunc_def,
     voidpf filestream,
-    int *pi));
+    unsigned char *buf,
+    uLong size));
 
-local int unz64local_getByte(const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, int *pi)
+local int unz64local_getBytes(const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, unsigned char *buf, uLong size)
 {
-    unsigned char c;
-    int err = (int)ZREAD64(*pzlib_filefunc_def,filestream,&c,1);
-    if (err==1)
-    {
-        *pi = (int)c;
+    if (ZREAD64(*pzlib_filefunc_def,filestream,buf,size)==size)
         return UNZ_OK;
-    }
     else
     {
         if (ZERROR64(*pzlib_filefunc_def,filestream))
@@ -240,19 +264,11 @@ local int unz64local_getShort (const zlib_filefunc64_32_def* pzlib_filefunc_def,
                              voidpf filestream,
                              uLong *pX)
 {
-    uLong x ;
-    int i = 0;
-    int err;
-
-    err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x = (uLong)i;
+    unsigned char c[2];
+    int err = unz64local_getBytes(pzlib_filefunc_def,filestream,c,2);
 
     if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((uLong)i)<<8;
-
-    if (err==UNZ_OK)
-        *pX = x;
+        *pX = (uLong)c[0] | ((uLong)c[1]<<8);
     else
         *pX = 0;
     return err;
@@ -267,27 +283,11 @@ local int unz64local_getLong (const zlib_filefunc64_32_def* pzlib_filefunc_def,
                             voidpf filestream,
                             uLong *pX)
 {
-    uLong x ;
-    int i = 0;
-    int err;
-
-    err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x = (uLong)i;
+    unsigned char c[4];
+    int err = unz64local_getBytes(pzlib_filefunc_def,filestream,c,4);
 
     if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((uLong)i)<<8;
-
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((uLong)i)<<16;
-
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x += ((uLong)i)<<24;
-
-    if (err==UNZ_OK)
-        *pX = x;
+        *pX = (uLong)c[0] | ((uLong)c[1]<<8) | ((uLong)c[2]<<16) | ((uLong)c[3]<<24);
     else
         *pX = 0;
     return err;
@@ -303,46 +303,150 @@ local int unz64local_getLong64 (const zlib_filefunc64_32_def* pzlib_filefunc_def
                             voidpf filestream,
                             ZPOS64_T *pX)
 {
-    ZPOS64_T x ;
-    int i = 0;
-    int err;
+    unsigned char c[8];
+    ZPOS64_T x = 0;
+    int i;
+    int err = unz64local_getBytes(pzlib_filefunc_def,filestream,c,8);
 
-    err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x = (ZPOS64_T)i;
+    for (i=7;i>=0;i--)
+        x = (x<<8) | (ZPOS64_T)c[i];
 
     if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((ZPOS64_T)i)<<8;
+        *pX = x;
+    else
+        *pX = 0;
+    return err;
+}
 
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((ZPOS64_T)i)<<16;
+/* ===========================================================================
+   unz64_window_s is a read only stream over a copy of part of the zipfile
+   (its tail at open time, the central directory or a local header), so the
+   headers it contains are decoded field by field without ioapi calls.
+   Reads not entirely inside the copy are done from the zipfile stream.
+*/
+typedef struct unz64_window_s
+{
+    const zlib_filefunc64_32_def* pfilefunc;
+    voidpf filestream;
+    const unsigned char* buffer;
+    ZPOS64_T start;             /* position of buffer[0] in the zipfile */
+    ZPOS64_T size;
+    ZPOS64_T size_file;         /* for ZLIB_FILEFUNC_SEEK_END */
+    ZPOS64_T pos;
+} unz64_window;
+
+local uLong ZCALLBACK unz64local_window_read (voidpf opaque, voidpf stream, void* buf, uLong size)
+{
+    unz64_window* window = (unz64_window*)stream;
+    uLong read;
+    (void)opaque;
+    if ((window->pos>=window->start) && (window->pos-window->start<=window->size) &&
+        (size<=window->size-(window->pos-window->start)))
+    {
+        memcpy(buf,window->buffer+(window->pos-window->start),size);
+        window->pos += size;
+        return size;
+    }
+    if (ZSEEK64(*window->pfilefunc,window->filestream,window->pos,ZLIB_FILEFUNC_SEEK_SET)!=0)
+        return 0;
+    read = ZREAD64(*window->pfilefunc,window->filestream,buf,size);
+    window->pos += read;
+    return read;
+}
 
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((ZPOS64_T)i)<<24;
+local ZPOS64_T ZCALLBACK unz64local_window_tell (voidpf opaque, voidpf stream)
+{
+    (void)opaque;
+    return ((unz64_window*)stream)->pos;
+}
 
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((ZPOS64_T)i)<<32;
+local long ZCALLBACK unz64local_window_seek (voidpf opaque, voidpf stream, ZPOS64_T offset, int origin)
+{
+    unz64_window* window = (unz64_window*)stream;
+    (void)opaque;
+    switch (origin)
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR :
+        window->pos += offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_END :
+        window->pos = window->size_file + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET :
+        window->pos = offset;
+        break;
+    default: return -1;
+    }
+    return 0;
+}
 
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((ZPOS64_T)i)<<40;
+local int ZCALLBACK unz64local_window_error (voidpf opaque, voidpf stream)
+{
+    unz64_window* window = (unz64_window*)stream;
+    (void)opaque;
+    return ZERROR64(*window->pfilefunc,window->filestream);
+}
 
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((ZPOS64_T)i)<<48;
+local const zlib_filefunc64_32_def unz64local_window_filefunc =
+{
+    { NULL, unz64local_window_read, NULL, unz64local_window_tell,
+      unz64local_window_seek, NULL, unz64local_window_error, NULL, NULL },
+    NULL, NULL, NULL
+};
+
+local void unz64local_InitWindow (unz64_window* window,
+                                  const zlib_filefunc64_32_def* pzlib_filefunc_def,
+                                  voidpf filestream,
+                                  const unsigned char* buffer,
+                                  ZPOS64_T start,
+                                  ZPOS64_T size)
+{
+    window->pfilefunc = pzlib_filefunc_def;
+    window->filestream = filestream;
+    window->buffer = buffer;
+    window->start = start;
+    window->size = (buffer!=NULL) ? size : 0;
+    window->size_file = start + size;
+    window->pos = start;
+}
 
-    if (err==UNZ_OK)
-        err = unz64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x |= ((ZPOS64_T)i)<<56;
+#ifndef UNZ_BUFREADTAIL
+/* global comment, end of central dir, zip64 locator and zip64 end of central dir */
+#define UNZ_BUFREADTAIL (0xffff+22+20+56)
+#endif
 
-    if (err==UNZ_OK)
-        *pX = x;
-    else
-        *pX = 0;
-    return err;
+/*
+  Read the end of the zipfile with a single call into a window: the end of
+    central dir records and, for most comics, the whole central directory
+    are then parsed from memory. The window still works (without a copy)
+    if the tail cannot be read.
+  return the buffer to free after the window is not used anymore
+*/
+local unsigned char* unz64local_ReadTail (const zlib_filefunc64_32_def* pzlib_filefunc_def,
+                                          voidpf filestream,
+                                          unz64_window* window)
+{
+    unsigned char* buf = NULL;
+    ZPOS64_T uSizeFile = 0;
+    uLong uReadSize;
+
+    if (ZSEEK64(*pzlib_filefunc_def,filestream,0,ZLIB_FILEFUNC_SEEK_END) == 0)
+        uSizeFile = ZTELL64(*pzlib_filefunc_def,filestream);
+    if (uSizeFile == (ZPOS64_T)-1)
+        uSizeFile = 0;
+    uReadSize = (uSizeFile < UNZ_BUFREADTAIL) ? (uLong)uSizeFile : UNZ_BUFREADTAIL;
+
+    if (uReadSize>0)
+        buf = (unsigned char*)ALLOC(uReadSize);
+    if ((buf!=NULL) &&
+        ((ZSEEK64(*pzlib_filefunc_def,filestream,uSizeFile-uReadSize,ZLIB_FILEFUNC_SEEK_SET)!=0) ||
+         (ZREAD64(*pzlib_filefunc_def,filestream,buf,uReadSize)!=uReadSize)))
+    {
+        TRYFREE(buf);
+        buf = NULL;
+    }
+    unz64local_InitWindow(window,pzlib_filefunc_def,filestream,buf,uSizeFile-uReadSize,uReadSize);
+    return buf;
 }
 
 /* My own strcmpi / strcasecmp */
@@ -572,6 +676,151 @@ local ZPOS64_T unz64local_SearchCentralDir64(const zlib_filefunc64_32_def* pzlib
     return relativeOffset;
 }
 
+#ifndef UNZ_MAXCDINDEXSIZE
+#define UNZ_MAXCDINDEXSIZE (64*1024*1024) /* larger central dirs are not indexed */
+#endif
+
+/*
+  Hash of a file name where '\\' and '/' are the same separator and, if
+  fold is not 0, letters are compared like strcmpcasenosensitive_internal
+*/
+local uLong unz64local_HashName (const char* name, uLong size_name, int fold)
+{
+    uLong hash = 2166136261UL;  /* FNV-1a */
+    uLong i;
+    for (i=0;i<size_name;i++)
+    {
+        unsigned char c = (unsigned char)name[i];
+        if (c=='\\')
+            c = '/';
+        else if (fold && (c>='a') && (c<='z'))
+            c -= 0x20;
+        hash = ((hash ^ c) * 16777619UL) & 0xffffffffUL;
+    }
+    return hash;
+}
+
+local int unz64local_NameEqual (const char* name, uLong size_name, const char* szFileName, int fold)
+{
+    uLong i;
+    for (i=0;i<size_name;i++)
+    {
+        char c1=name[i];
+        char c2=szFileName[i];
+        if (c2=='\0')
+            return 0;
+        if (c1=='\\')
+            c1 = '/';
+        if (c2=='\\')
+            c2 = '/';
+        if (fold)
+        {
+            if ((c1>='a') && (c1<='z'))
+                c1 -= 0x20;
+            if ((c2>='a') && (c2<='z'))
+                c2 -= 0x20;
+        }
+        if (c1!=c2)
+            return 0;
+    }
+    return szFileName[size_name]=='\0';
+}
+
+local void unz64local_FreeCentralDirIndex (unz64_cd_index* index)
+{
+    if (index==NULL)
+        return;
+    TRYFREE(index->buffer);
+    TRYFREE(index->entries);
+    TRYFREE(index->table_cs);
+    TRYFREE(index->table_ci);
+    TRYFREE(index);
+}
+
+/*
+  Read the whole central directory in one pass (usually from the tail read
+  at open time) and index its entries.
+  Entries are inserted in central directory order and with linear probing,
+  so for duplicated names the first one is found like with unzLocateFile.
+  return NULL if the central directory is too large, malformed or if
+    memory is missing: lookups then scan the central directory instead.
+*/
+local unz64_cd_index* unz64local_BuildCentralDirIndex (unz64_s* s,
+                                                      const zlib_filefunc64_32_def* pzlib_filefunc_def,
+                                                      voidpf filestream)
+{
+    unz64_cd_index* index;
+    uLong size_central_dir;
+    uLong offset=0;
+    uLong table_size=1;
+    uLong i;
+
+    if ((s->size_central_dir>UNZ_MAXCDINDEXSIZE) || (s->gi.number_entry==0) ||
+        (s->gi.number_entry>s->size_central_dir/SIZECENTRALDIRITEM))
+        return NULL;
+    size_central_dir = (uLong)s->size_central_dir;
+
+    index = (unz64_cd_index*)ALLOC(sizeof(unz64_cd_index));
+    if (index==NULL)
+        return NULL;
+    memset(index,0,sizeof(unz64_cd_index));
+    index->number_entry = (uLong)s->gi.number_entry;
+    while (table_size<2*index->number_entry)
+        table_size <<= 1;
+    index->table_mask = table_size-1;
+    index->buffer = (unsigned char*)ALLOC(size_central_dir);
+    index->entries = (unz64_cd_entry*)ALLOC(index->number_entry*sizeof(unz64_cd_entry));
+    index->table_cs = (uLong*)ALLOC(table_size*sizeof(uLong));
+    index->table_ci = (uLong*)ALLOC(table_size*sizeof(uLong));
+    if ((index->buffer==NULL) || (index->entries==NULL) ||
+        (index->table_cs==NULL) || (index->table_ci==NULL) ||
+        (ZSEEK64(*pzlib_filefunc_def, filestream,
+                 s->offset_central_dir+s->byte_before_the_zipfile,
+                 ZLIB_FILEFUNC_SEEK_SET)!=0) ||
+        (ZREAD64(*pzlib_filefunc_def, filestream,index->buffer,size_central_dir)!=size_central_dir))
+    {
+        unz64local_FreeCentralDirIndex(index);
+        return NULL;
+    }
+    memset(index->table_cs,0,table_size*sizeof(uLong));
+    memset(index->table_ci,0,table_size*sizeof(uLong));
+
+    for (i=0;i<index->number_entry;i++)
+    {
+        const unsigned char* p = index->buffer+offset;
+        const char* name;
+        uLong size_filename, size_record, slot;
+
+        if ((size_central_dir-offset<SIZECENTRALDIRITEM) ||
+            (p[0]!=0x50) || (p[1]!=0x4b) || (p[2]!=0x01) || (p[3]!=0x02))
+            break;
+        size_filename = p[28] | (p[29]<<8);
+        size_record = SIZECENTRALDIRITEM + size_filename + (p[30] | (p[31]<<8)) + (p[32] | (p[33]<<8));
+        if (size_central_dir-offset<size_record)
+            break;
+        name = (const char*)p+SIZECENTRALDIRITEM;
+        index->entries[i].offset = offset;
+        index->entries[i].size_filename = size_filename;
+
+        slot = unz64local_HashName(name,size_filename,0) & index->table_mask;
+        while (index->table_cs[slot]!=0)
+            slot = (slot+1) & index->table_mask;
+        index->table_cs[slot] = i+1;
+        slot = unz64local_HashName(name,size_filename,1) & index->table_mask;
+        while (index->table_ci[slot]!=0)
+            slot = (slot+1) & index->table_mask;
+        index->table_ci[slot] = i+1;
+
+        offset += size_record;
+    }
+    if (i!=index->number_entry)
+    {
+        unz64local_FreeCentralDirIndex(index);
+        return NULL;
+    }
+    return index;
+}
+
 /*
   Open a Zip file. path contain the full pathname (by example,
      on a Windows NT computer "c:\\test\\zlib114.zip" or on an Unix computer
@@ -589,6 +838,8 @@ local unzFile unzOpenInternal (const void *path,
     unz64_s *s;
     ZPOS64_T central_pos;
     uLong   uL;
+    unz64_window window;
+    unsigned char* tail;
 
     uLong number_disk;          /* number of the current dist, used for
                                    spaning ZIP, unsupported, always 0*/
@@ -620,7 +871,10 @@ local unzFile unzOpenInternal (const void *path,
     if (us.filestream==NULL)
         return NULL;
 
-    central_pos = unz64local_SearchCentralDir64(&us.z_filefunc,us.filestream);
+    /* all the records below are usually parsed from the tail in memory */
+    tail = unz64local_ReadTail(&us.z_filefunc,us.filestream,&window);
+
+    central_pos = unz64local_SearchCentralDir64(&unz64local_window_filefunc,&window);
     if (central_pos)
     {
         uLong uS;
@@ -628,40 +882,40 @@ local unzFile unzOpenInternal (const void *path,
 
         us.isZip64 = 1;
 
-        if (ZSEEK64(us.z_filefunc, us.filestream,
+        if (ZSEEK64(unz64local_window_filefunc,&window,
                                       central_pos,ZLIB_FILEFUNC_SEEK_SET)!=0)
         err=UNZ_ERRNO;
 
         /* the signature, already checked */
-        if (unz64local_getLong(&us.z_filefunc, us.filestream,&uL)!=UNZ_OK)
+        if (unz64local_getLong(&unz64local_window_filefunc,&window,&uL)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* size of zip64 end of central directory record */
-        if (unz64local_getLong64(&us.z_filefunc, us.filestream,&uL64)!=UNZ_OK)
+        if (unz64local_getLong64(&unz64local_window_filefunc,&window,&uL64)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* version made by */
-        if (unz64local_getShort(&us.z_filefunc, us.filestream,&uS)!=UNZ_OK)
+        if (unz64local_getShort(&unz64local_window_filefunc,&window,&uS)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* version needed to extract */
-        if (unz64local_getShort(&us.z_filefunc, us.filestream,&uS)!=UNZ_OK)
+        if (unz64local_getShort(&unz64local_window_filefunc,&window,&uS)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* number of this disk */
-        if (unz64local_getLong(&us.z_filefunc, us.filestream,&number_disk)!=UNZ_OK)
+        if (unz64local_getLong(&unz64local_window_filefunc,&window,&number_disk)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* number of the disk with the start of the central directory */
-        if (unz64local_getLong(&us.z_filefunc, us.filestream,&number_disk_with_CD)!=UNZ_OK)
+        if (unz64local_getLong(&unz64local_window_filefunc,&window,&number_disk_with_CD)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* total number of entries in the central directory on this disk */
-        if (unz64local_getLong64(&us.z_filefunc, us.filestream,&us.gi.number_entry)!=UNZ_OK)
+        if (unz64local_getLong64(&unz64local_window_filefunc,&window,&us.gi.number_entry)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* total number of entries in the central directory */
-        if (unz64local_getLong64(&us.z_filefunc, us.filestream,&number_entry_CD)!=UNZ_OK)
+        if (unz64local_getLong64(&unz64local_window_filefunc,&window,&number_entry_CD)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         if ((number_entry_CD!=us.gi.number_entry) ||
@@ -670,47 +924,47 @@ local unzFile unzOpenInternal (const void *path,
             err=UNZ_BADZIPFILE;
 
         /* size of the central directory */
-        if (unz64local_getLong64(&us.z_filefunc, us.filestream,&us.size_central_dir)!=UNZ_OK)
+        if (unz64local_getLong64(&unz64local_window_filefunc,&window,&us.size_central_dir)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* offset of start of central directory with respect to the
           starting disk number */
-        if (unz64local_getLong64(&us.z_filefunc, us.filestream,&us.offset_central_dir)!=UNZ_OK)
+        if (unz64local_getLong64(&unz64local_window_filefunc,&window,&us.offset_central_dir)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         us.gi.size_comment = 0;
     }
     else
     {
-        central_pos = unz64local_SearchCentralDir(&us.z_filefunc,us.filestream);
+        central_pos = unz64local_SearchCentralDir(&unz64local_window_filefunc,&window);
         if (central_pos==0)
             err=UNZ_ERRNO;
 
         us.isZip64 = 0;
 
-        if (ZSEEK64(us.z_filefunc, us.filestream,
+        if (ZSEEK64(unz64local_window_filefunc,&window,
                                         central_pos,ZLIB_FILEFUNC_SEEK_SET)!=0)
             err=UNZ_ERRNO;
 
         /* the signature, already checked */
-        if (unz64local_getLong(&us.z_filefunc, us.filestream,&uL)!=UNZ_OK)
+        if (unz64local_getLong(&unz64local_window_filefunc,&window,&uL)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* number of this disk */
-        if (unz64local_getShort(&us.z_filefunc, us.filestream,&number_disk)!=UNZ_OK)
+        if (unz64local_getShort(&unz64local_window_filefunc,&window,&number_disk)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* number of the disk with the start of the central directory */
-        if (unz64local_getShort(&us.z_filefunc, us.filestream,&number_disk_with_CD)!=UNZ_OK)
+        if (unz64local_getShort(&unz64local_window_filefunc,&window,&number_disk_with_CD)!=UNZ_OK)
             err=UNZ_ERRNO;
 
         /* total number of entries in the central dir on this disk */
-        if (unz64local_getShort(&us.z_filefunc, us.filestream,&uL)!=UNZ_OK)
+        if (unz64local_getShort(&unz64local_window_filefunc,&window,&uL)!=UNZ_OK)
             err=UNZ_ERRNO;
         us.gi.number_entry = uL;
 
         /* total number of entries in the central dir */
-        if (unz64local_getShort(&us.z_filefunc, us.filestream,&uL)!=UNZ_OK)
+        if (unz64local_getShort(&unz64local_window_filefunc,&window,&uL)!=UNZ_OK)
             err=UNZ_ERRNO;
         number_entry_CD = uL;
 
@@ -720,18 +974,18 @@ local unzFile unzOpenInternal (const void *path,
             err=UNZ_BADZIPFILE;
 
         /* size of the central directory */
-        if (unz64local_getLong(&us.z_filefunc, us.filestream,&uL)!=UNZ_OK)
+        if (unz64local_getLong(&unz64local_window_filefunc,&window,&uL)!=UNZ_OK)
             err=UNZ_ERRNO;
         us.size_central_dir = uL;
 
         /* offset of start of central directory with respect to the
             starting disk number */
-        if (unz64local_getLong(&us.z_filefunc, us.filestream,&uL)!=UNZ_OK)
+        if (unz64local_getLong(&unz64local_window_filefunc,&window,&uL)!=UNZ_OK)
             err=UNZ_ERRNO;
         us.offset_central_dir = uL;
 
         /* zipfile comment length */
-        if (unz64local_getShort(&us.z_filefunc, us.filestream,&us.gi.size_comment)!=UNZ_OK)
+        if (unz64local_getShort(&unz64local_window_filefunc,&window,&us.gi.size_comment)!=UNZ_OK)
             err=UNZ_ERRNO;
     }
 
@@ -741,6 +995,7 @@ local unzFile unzOpenInternal (const void *path,
 
     if (err!=UNZ_OK)
     {
+        TRYFREE(tail);
         ZCLOSE64(us.z_filefunc, us.filestream);
         return NULL;
     }
@@ -750,14 +1005,19 @@ local unzFile unzOpenInternal (const void *path,
     us.central_pos = central_pos;
     us.pfile_in_zip_read = NULL;
     us.encrypted = 0;
+    us.cd_index = NULL;
+    us.buffer_inflater = NULL;
+    us.buffer_inflater_opaque = NULL;
 
 
     s=(unz64_s*)ALLOC(sizeof(unz64_s));
     if( s != NULL)
     {
         *s=us;
+        s->cd_index = unz64local_BuildCentralDirIndex(s,&unz64local_window_filefunc,&window);
         unzGoToFirstFile((unzFile)s);
     }
+    TRYFREE(tail);
     return (unzFile)s;
 }
 
@@ -816,6 +1076,7 @@ extern int ZEXPORT unzClose (unzFile file)
         unzCloseCurrentFile(file);
 
     ZCLOSE64(s->z_filefunc, s->filestream);
+    unz64local_FreeCentralDirIndex(s->cd_index);
     TRYFREE(s);
     return UNZ_OK;
 }
@@ -894,11 +1155,25 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
     uLong uMagic;
     long lSeek=0;
     uLong uL;
+    const zlib_filefunc64_32_def* pfilefunc;
+    voidpf filestream;
+    unz64_window window;
 
     if (file==NULL)
         return UNZ_PARAMERROR;
     s=(unz64_s*)file;
-    if (ZSEEK64(s->z_filefunc, s->filestream,
+    pfilefunc = &s->z_filefunc;
+    filestream = s->filestream;
+    if (s->cd_index!=NULL)
+    {
+        /* parse the entry from the copy of the central directory */
+        unz64local_InitWindow(&window,&s->z_filefunc,s->filestream,s->cd_index->buffer,
+                              s->offset_central_dir+s->byte_before_the_zipfile,
+                              s->size_central_dir);
+        pfilefunc = &unz64local_window_filefunc;
+        filestream = &window;
+    }
+    if (ZSEEK64(*pfilefunc,filestream,
               s->pos_in_central_dir+s->byte_before_the_zipfile,
               ZLIB_FILEFUNC_SEEK_SET)!=0)
         err=UNZ_ERRNO;
@@ -907,60 +1182,60 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
     /* we check the magic */
     if (err==UNZ_OK)
     {
-        if (unz64local_getLong(&s->z_filefunc, s->filestream,&uMagic) != UNZ_OK)
+        if (unz64local_getLong(pfilefunc,filestream,&uMagic) != UNZ_OK)
             err=UNZ_ERRNO;
         else if (uMagic!=0x02014b50)
             err=UNZ_BADZIPFILE;
     }
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.version) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.version) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.version_needed) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.version_needed) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.flag) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.flag) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.compression_method) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.compression_method) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.dosDate) != UNZ_OK)
+    if (unz64local_getLong(pfilefunc,filestream,&file_info.dosDate) != UNZ_OK)
         err=UNZ_ERRNO;
 
     unz64local_DosDateToTmuDate(file_info.dosDate,&file_info.tmu_date);
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.crc) != UNZ_OK)
+    if (unz64local_getLong(pfilefunc,filestream,&file_info.crc) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
+    if (unz64local_getLong(pfilefunc,filestream,&uL) != UNZ_OK)
         err=UNZ_ERRNO;
     file_info.compressed_size = uL;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
+    if (unz64local_getLong(pfilefunc,filestream,&uL) != UNZ_OK)
         err=UNZ_ERRNO;
     file_info.uncompressed_size = uL;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_filename) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.size_filename) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_file_extra) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.size_file_extra) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_file_comment) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.size_file_comment) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.disk_num_start) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.disk_num_start) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.internal_fa) != UNZ_OK)
+    if (unz64local_getShort(pfilefunc,filestream,&file_info.internal_fa) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.external_fa) != UNZ_OK)
+    if (unz64local_getLong(pfilefunc,filestream,&file_info.external_fa) != UNZ_OK)
         err=UNZ_ERRNO;
 
                 // relative offset of local header
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
+    if (unz64local_getLong(pfilefunc,filestream,&uL) != UNZ_OK)
         err=UNZ_ERRNO;
     file_info_internal.offset_curfile = uL;
 
@@ -977,7 +1252,7 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
             uSizeRead = fileNameBufferSize;
 
         if ((file_info.size_filename>0) && (fileNameBufferSize>0))
-            if (ZREAD64(s->z_filefunc, s->filestream,szFileName,uSizeRead)!=uSizeRead)
+            if (ZREAD64(*pfilefunc,filestream,szFileName,uSizeRead)!=uSizeRead)
                 err=UNZ_ERRNO;
         lSeek -= uSizeRead;
     }
@@ -993,14 +1268,14 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
 
         if (lSeek!=0)
         {
-            if (ZSEEK64(s->z_filefunc, s->filestream,lSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
+            if (ZSEEK64(*pfilefunc,filestream,lSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
                 lSeek=0;
             else
                 err=UNZ_ERRNO;
         }
 
         if ((file_info.size_file_extra>0) && (extraFieldBufferSize>0))
-            if (ZREAD64(s->z_filefunc, s->filestream,extraField,(uLong)uSizeRead)!=uSizeRead)
+            if (ZREAD64(*pfilefunc,filestream,extraField,(uLong)uSizeRead)!=uSizeRead)
                 err=UNZ_ERRNO;
 
         lSeek += file_info.size_file_extra - (uLong)uSizeRead;
@@ -1018,7 +1293,7 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
 
         if (lSeek!=0)
         {
-            if (ZSEEK64(s->z_filefunc, s->filestream,lSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
+            if (ZSEEK64(*pfilefunc,filestream,lSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
                 lSeek=0;
             else
                 err=UNZ_ERRNO;
@@ -1029,10 +1304,10 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
             uLong headerId;
                                                 uLong dataSize;
 
-            if (unz64local_getShort(&s->z_filefunc, s->filestream,&headerId) != UNZ_OK)
+            if (unz64local_getShort(pfilefunc,filestream,&headerId) != UNZ_OK)
                 err=UNZ_ERRNO;
 
-            if (unz64local_getShort(&s->z_filefunc, s->filestream,&dataSize) != UNZ_OK)
+            if (unz64local_getShort(pfilefunc,filestream,&dataSize) != UNZ_OK)
                 err=UNZ_ERRNO;
 
             /* ZIP64 extra fields */
@@ -1040,36 +1315,36 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
             {
                                                         uLong uL;
 
-                                                                if(file_info.uncompressed_size == (ZPOS64_T)(unsigned long)-1)
+                                                                if(file_info.uncompressed_size == 0xffffffff)
                                                                 {
-                                                                        if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info.uncompressed_size) != UNZ_OK)
+                                                                        if (unz64local_getLong64(pfilefunc,filestream,&file_info.uncompressed_size) != UNZ_OK)
                                                                                         err=UNZ_ERRNO;
                                                                 }
 
-                                                                if(file_info.compressed_size == (ZPOS64_T)(unsigned long)-1)
+                                                                if(file_info.compressed_size == 0xffffffff)
                                                                 {
-                                                                        if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info.compressed_size) != UNZ_OK)
+                                                                        if (unz64local_getLong64(pfilefunc,filestream,&file_info.compressed_size) != UNZ_OK)
                                                                                   err=UNZ_ERRNO;
                                                                 }
 
-                                                                if(file_info_internal.offset_curfile == (ZPOS64_T)(unsigned long)-1)
+                                                                if(file_info_internal.offset_curfile == 0xffffffff)
                                                                 {
                                                                         /* Relative Header offset */
-                                                                        if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info_internal.offset_curfile) != UNZ_OK)
+                                                                        if (unz64local_getLong64(pfilefunc,filestream,&file_info_internal.offset_curfile) != UNZ_OK)
                                                                                 err=UNZ_ERRNO;
                                                                 }
 
-                                                                if(file_info.disk_num_start == (unsigned long)-1)
+                                                                if(file_info.disk_num_start == 0xffff)
                                                                 {
                                                                         /* Disk Start Number */
-                                                                        if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
+                                                                        if (unz64local_getLong(pfilefunc,filestream,&uL) != UNZ_OK)
                                                                                 err=UNZ_ERRNO;
                                                                 }
 
             }
             else
             {
-                if (ZSEEK64(s->z_filefunc, s->filestream,dataSize,ZLIB_FILEFUNC_SEEK_CUR)!=0)
+                if (ZSEEK64(*pfilefunc,filestream,dataSize,ZLIB_FILEFUNC_SEEK_CUR)!=0)
                     err=UNZ_ERRNO;
             }
 
@@ -1090,14 +1365,14 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
 
         if (lSeek!=0)
         {
-            if (ZSEEK64(s->z_filefunc, s->filestream,lSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
+            if (ZSEEK64(*pfilefunc,filestream,lSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
                 lSeek=0;
             else
                 err=UNZ_ERRNO;
         }
 
         if ((file_info.size_file_comment>0) && (commentBufferSize>0))
-            if (ZREAD64(s->z_filefunc, s->filestream,szComment,uSizeRead)!=uSizeRead)
+            if (ZREAD64(*pfilefunc,filestream,szComment,uSizeRead)!=uSizeRead)
                 err=UNZ_ERRNO;
         lSeek+=file_info.size_file_comment - uSizeRead;
     }
@@ -1287,6 +1562,74 @@ extern int ZEXPORT unzLocateFile (unzFile file, const char *szFileName, int iCas
 }
 
 
+extern int ZEXPORT unzLocateFileFast (unzFile file, const char *szFileName, int iCaseSensitivity)
+{
+    unz64_s* s;
+    unz64_cd_index* index;
+    const uLong* table;
+    uLong slot;
+    int fold;
+    int err;
+
+    if ((file==NULL) || (szFileName==NULL))
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if (!s->current_file_ok)
+        return UNZ_END_OF_LIST_OF_FILE;
+    if (iCaseSensitivity==0)
+        iCaseSensitivity=CASESENSITIVITYDEFAULTVALUE;
+    fold = iCaseSensitivity!=1;
+
+    index = s->cd_index;
+    if (index==NULL)
+    {
+        /* Same scan as unzLocateFile, with separators compared alike */
+        ZPOS64_T num_fileSaved = s->num_file;
+        ZPOS64_T pos_in_central_dirSaved = s->pos_in_central_dir;
+        unz_file_info64 cur_file_infoSaved = s->cur_file_info;
+        unz_file_info64_internal cur_file_info_internalSaved = s->cur_file_info_internal;
+
+        err = unzGoToFirstFile(file);
+        while (err == UNZ_OK)
+        {
+            char szCurrentFileName[UNZ_MAXFILENAMEINZIP+1];
+            err = unzGetCurrentFileInfo64(file,NULL,
+                                        szCurrentFileName,sizeof(szCurrentFileName)-1,
+                                        NULL,0,NULL,0);
+            if (err == UNZ_OK)
+            {
+                if (unz64local_NameEqual(szCurrentFileName,strlen(szCurrentFileName),szFileName,fold))
+                    return UNZ_OK;
+                err = unzGoToNextFile(file);
+            }
+        }
+        s->num_file = num_fileSaved ;
+        s->pos_in_central_dir = pos_in_central_dirSaved ;
+        s->cur_file_info = cur_file_infoSaved;
+        s->cur_file_info_internal = cur_file_info_internalSaved;
+        return err;
+    }
+
+    table = fold ? index->table_ci : index->table_cs;
+    slot = unz64local_HashName(szFileName,strlen(szFileName),fold) & index->table_mask;
+    while (table[slot]!=0)
+    {
+        uLong i = table[slot]-1;
+        const unz64_cd_entry* entry = &index->entries[i];
+        if (unz64local_NameEqual((const char*)index->buffer+entry->offset+SIZECENTRALDIRITEM,
+                                 entry->size_filename,szFileName,fold))
+        {
+            unz64_file_pos file_pos;
+            file_pos.pos_in_zip_directory = s->offset_central_dir+entry->offset;
+            file_pos.num_of_file = i;
+            return unzGoToFilePos64(file,&file_pos);
+        }
+        slot = (slot+1) & index->table_mask;
+    }
+    return UNZ_END_OF_LIST_OF_FILE;
+}
+
+
 /*
 ///////////////////////////////////////////
 // Contributed by Ryan Haksi (mailto://cryogen@infoserve.net)
@@ -1370,6 +1713,167 @@ extern int ZEXPORT unzGoToFilePos(
     return unzGoToFilePos64(file,&file_pos64);
 }
 
+/*
+///////////////////////////////////////////
+// Bulk listing of the central directory
+///////////////////////////////////////////
+*/
+
+#define unz64local_bufShort(p) ((uLong)(p)[0] | ((uLong)(p)[1]<<8))
+#define unz64local_bufLong(p) (unz64local_bufShort(p) | (unz64local_bufShort((p)+2)<<16))
+#define unz64local_bufLong64(p) ((ZPOS64_T)unz64local_bufLong(p) | ((ZPOS64_T)unz64local_bufLong((p)+4)<<32))
+
+/*
+  Walk the central directory records in buffer. If list->entries is NULL,
+  only count the entries and the bytes their names need in the arena.
+*/
+local int unz64local_WalkCentralDir (const unsigned char* buffer, uLong size,
+                                     ZPOS64_T number_entry, ZPOS64_T offset_central_dir,
+                                     unz_entry_list* list, ZPOS64_T* pnumber, uLong* psize_names)
+{
+    uLong offset=0;
+    uLong size_names=0;
+    ZPOS64_T i;
+
+    for (i=0;(number_entry==0xffff) ? (offset<size) : (i<number_entry);i++)
+    {
+        const unsigned char* p = buffer+offset;
+        uLong size_filename, size_file_extra, size_record;
+        const unsigned char* extra;
+        const unsigned char* extra_end;
+
+        if ((size-offset<SIZECENTRALDIRITEM) || (unz64local_bufLong(p)!=0x02014b50))
+            return UNZ_BADZIPFILE;
+        size_filename = unz64local_bufShort(p+28);
+        size_file_extra = unz64local_bufShort(p+30);
+        size_record = SIZECENTRALDIRITEM + size_filename + size_file_extra + unz64local_bufShort(p+32);
+        if (size-offset<size_record)
+            return UNZ_BADZIPFILE;
+
+        if (list->entries!=NULL)
+        {
+            unz_entry* entry = &list->entries[i];
+            entry->name_offset = size_names;
+            entry->size_filename = size_filename;
+            entry->flag = unz64local_bufShort(p+8);
+            entry->compression_method = unz64local_bufShort(p+10);
+            entry->dosDate = unz64local_bufLong(p+12);
+            entry->crc = unz64local_bufLong(p+16);
+            entry->compressed_size = unz64local_bufLong(p+20);
+            entry->uncompressed_size = unz64local_bufLong(p+24);
+            entry->offset_curfile = unz64local_bufLong(p+42);
+            entry->file_pos.pos_in_zip_directory = offset_central_dir+offset;
+            entry->file_pos.num_of_file = i;
+            memcpy(list->names+size_names,p+SIZECENTRALDIRITEM,size_filename);
+            list->names[size_names+size_filename] = '\0';
+
+            /* ZIP64 extra field, same order as in unz64local_GetCurrentFileInfoInternal */
+            extra = p+SIZECENTRALDIRITEM+size_filename;
+            extra_end = extra+size_file_extra;
+            while (extra_end-extra>=4)
+            {
+                const unsigned char* data = extra+4;
+                const unsigned char* data_end = data+unz64local_bufShort(extra+2);
+                if (data_end>extra_end)
+                    break;
+                if (unz64local_bufShort(extra)==0x0001)
+                {
+                    if ((entry->uncompressed_size==0xffffffff) && (data_end-data>=8))
+                    {
+                        entry->uncompressed_size = unz64local_bufLong64(data);
+                        data += 8;
+                    }
+                    if ((entry->compressed_size==0xffffffff) && (data_end-data>=8))
+                    {
+                        entry->compressed_size = unz64local_bufLong64(data);
+                        data += 8;
+                    }
+                    if ((entry->offset_curfile==0xffffffff) && (data_end-data>=8))
+                        entry->offset_curfile = unz64local_bufLong64(data);
+                }
+                extra = data_end;
+            }
+        }
+
+        size_names += size_filename+1;
+        offset += size_record;
+    }
+
+    *pnumber = i;
+    *psize_names = size_names;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzGetEntryList (unzFile file, unz_entry_list* list)
+{
+    unz64_s* s;
+    unsigned char* buffer;
+    uLong size_central_dir;
+    uLong size_names;
+    ZPOS64_T number;
+    int err;
+
+    if ((file==NULL) || (list==NULL))
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    memset(list,0,sizeof(unz_entry_list));
+    list->byte_before_the_zipfile = s->byte_before_the_zipfile;
+    if (s->gi.number_entry==0)
+        return UNZ_OK;
+    if (s->size_central_dir!=(uLong)s->size_central_dir)
+        return UNZ_INTERNALERROR;
+    size_central_dir = (uLong)s->size_central_dir;
+
+    /* Reuse the copy made for the index or read the directory at once */
+    if (s->cd_index!=NULL)
+        buffer = s->cd_index->buffer;
+    else
+    {
+        buffer = (unsigned char*)ALLOC(size_central_dir);
+        if (buffer==NULL)
+            return UNZ_INTERNALERROR;
+        if ((ZSEEK64(s->z_filefunc, s->filestream,
+                     s->offset_central_dir+s->byte_before_the_zipfile,
+                     ZLIB_FILEFUNC_SEEK_SET)!=0) ||
+            (ZREAD64(s->z_filefunc, s->filestream,buffer,size_central_dir)!=size_central_dir))
+        {
+            TRYFREE(buffer);
+            return UNZ_ERRNO;
+        }
+    }
+
+    err = unz64local_WalkCentralDir(buffer,size_central_dir,s->gi.number_entry,
+                                    s->offset_central_dir,list,&number,&size_names);
+    if (err==UNZ_OK)
+    {
+        /* Entries and names share a single allocation */
+        list->entries = (unz_entry*)ALLOC(number*sizeof(unz_entry)+size_names);
+        if (list->entries==NULL)
+            err = UNZ_INTERNALERROR;
+        else
+        {
+            list->number_entry = number;
+            list->names = (char*)(list->entries+number);
+            err = unz64local_WalkCentralDir(buffer,size_central_dir,s->gi.number_entry,
+                                            s->offset_central_dir,list,&number,&size_names);
+        }
+    }
+
+    if (s->cd_index==NULL)
+        TRYFREE(buffer);
+    if (err!=UNZ_OK)
+        unzFreeEntryList(list);
+    return err;
+}
+
+extern void ZEXPORT unzFreeEntryList (unz_entry_list* list)
+{
+    if (list==NULL)
+        return;
+    TRYFREE(list->entries);
+    memset(list,0,sizeof(unz_entry_list));
+}
+
 /*
 // Unzip Helper Functions - should be here?
 ///////////////////////////////////////////
@@ -1390,6 +1894,8 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
     uLong size_filename;
     uLong size_extra_field;
     int err=UNZ_OK;
+    unsigned char header[SIZEZIPLOCALHEADER];
+    unz64_window window;
 
     *piSizeVar = 0;
     *poffset_local_extrafield = 0;
@@ -1399,25 +1905,31 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
                                 s->byte_before_the_zipfile,ZLIB_FILEFUNC_SEEK_SET)!=0)
         return UNZ_ERRNO;
 
+    /* read the fixed size part of the local header at once */
+    if (ZREAD64(s->z_filefunc, s->filestream,header,SIZEZIPLOCALHEADER)!=SIZEZIPLOCALHEADER)
+        return UNZ_ERRNO;
+    unz64local_InitWindow(&window,&s->z_filefunc,s->filestream,header,
+                          s->cur_file_info_internal.offset_curfile+s->byte_before_the_zipfile,
+                          SIZEZIPLOCALHEADER);
 
     if (err==UNZ_OK)
     {
-        if (unz64local_getLong(&s->z_filefunc, s->filestream,&uMagic) != UNZ_OK)
+        if (unz64local_getLong(&unz64local_window_filefunc,&window,&uMagic) != UNZ_OK)
             err=UNZ_ERRNO;
         else if (uMagic!=0x04034b50)
             err=UNZ_BADZIPFILE;
     }
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&uData) != UNZ_OK)
+    if (unz64local_getShort(&unz64local_window_filefunc,&window,&uData) != UNZ_OK)
         err=UNZ_ERRNO;
 /*
     else if ((err==UNZ_OK) && (uData!=s->cur_file_info.wVersion))
         err=UNZ_BADZIPFILE;
 */
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&uFlags) != UNZ_OK)
+    if (unz64local_getShort(&unz64local_window_filefunc,&window,&uFlags) != UNZ_OK)
         err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&uData) != UNZ_OK)
+    if (unz64local_getShort(&unz64local_window_filefunc,&window,&uData) != UNZ_OK)
         err=UNZ_ERRNO;
     else if ((err==UNZ_OK) && (uData!=s->cur_file_info.compression_method))
         err=UNZ_BADZIPFILE;
@@ -1426,35 +1938,38 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
 /* #ifdef HAVE_BZIP2 */
                          (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
 /* #endif */
+#ifdef HAVE_ZSTD
+                         (s->cur_file_info.compression_method!=Z_ZSTD) &&
+#endif
                          (s->cur_file_info.compression_method!=Z_DEFLATED))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* date/time */
+    if (unz64local_getLong(&unz64local_window_filefunc,&window,&uData) != UNZ_OK) /* date/time */
         err=UNZ_ERRNO;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* crc */
+    if (unz64local_getLong(&unz64local_window_filefunc,&window,&uData) != UNZ_OK) /* crc */
         err=UNZ_ERRNO;
     else if ((err==UNZ_OK) && (uData!=s->cur_file_info.crc) && ((uFlags & 8)==0))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* size compr */
+    if (unz64local_getLong(&unz64local_window_filefunc,&window,&uData) != UNZ_OK) /* size compr */
         err=UNZ_ERRNO;
     else if (uData != 0xFFFFFFFF && (err==UNZ_OK) && (uData!=s->cur_file_info.compressed_size) && ((uFlags & 8)==0))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* size uncompr */
+    if (unz64local_getLong(&unz64local_window_filefunc,&window,&uData) != UNZ_OK) /* size uncompr */
         err=UNZ_ERRNO;
     else if (uData != 0xFFFFFFFF && (err==UNZ_OK) && (uData!=s->cur_file_info.uncompressed_size) && ((uFlags & 8)==0))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&size_filename) != UNZ_OK)
+    if (unz64local_getShort(&unz64local_window_filefunc,&window,&size_filename) != UNZ_OK)
         err=UNZ_ERRNO;
     else if ((err==UNZ_OK) && (size_filename!=s->cur_file_info.size_filename))
         err=UNZ_BADZIPFILE;
 
     *piSizeVar += (uInt)size_filename;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&size_extra_field) != UNZ_OK)
+    if (unz64local_getShort(&unz64local_window_filefunc,&window,&size_extra_field) != UNZ_OK)
         err=UNZ_ERRNO;
     *poffset_local_extrafield= s->cur_file_info_internal.offset_curfile +
                                     SIZEZIPLOCALHEADER + size_filename;
@@ -1533,6 +2048,9 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
 /* #ifdef HAVE_BZIP2 */
         (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
 /* #endif */
+#ifdef HAVE_ZSTD
+        (s->cur_file_info.compression_method!=Z_ZSTD) &&
+#endif
         (s->cur_file_info.compression_method!=Z_DEFLATED))
 
         err=UNZ_BADZIPFILE;
@@ -1573,6 +2091,24 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
       pfile_in_zip_read_info->raw=1;
 #endif
     }
+#ifdef HAVE_ZSTD
+    else if ((s->cur_file_info.compression_method==Z_ZSTD) && (!raw))
+    {
+      pfile_in_zip_read_info->stream.next_in = 0;
+      pfile_in_zip_read_info->stream.avail_in = 0;
+      pfile_in_zip_read_info->stream.total_in = 0;
+
+      pfile_in_zip_read_info->zstream = ZSTD_createDStream();
+      if (pfile_in_zip_read_info->zstream != NULL)
+        pfile_in_zip_read_info->stream_initialised=Z_ZSTD;
+      else
+      {
+        TRYFREE(pfile_in_zip_read_info->read_buffer);
+        TRYFREE(pfile_in_zip_read_info);
+        return UNZ_INTERNALERROR;
+      }
+    }
+#endif
     else if ((s->cur_file_info.compression_method==Z_DEFLATED) && (!raw))
     {
       pfile_in_zip_read_info->stream.zalloc = (alloc_func)0;
@@ -1835,6 +2371,52 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
               break;
 #endif
         } // end Z_BZIP2ED
+#ifdef HAVE_ZSTD
+        else if (pfile_in_zip_read_info->compression_method==Z_ZSTD)
+        {
+            ZSTD_inBuffer input;
+            ZSTD_outBuffer output;
+            size_t ret;
+
+            input.src = pfile_in_zip_read_info->stream.next_in;
+            input.size = pfile_in_zip_read_info->stream.avail_in;
+            input.pos = 0;
+            output.dst = pfile_in_zip_read_info->stream.next_out;
+            output.size = pfile_in_zip_read_info->stream.avail_out;
+            output.pos = 0;
+
+            ret = ZSTD_decompressStream(pfile_in_zip_read_info->zstream, &output, &input);
+            if (ZSTD_isError(ret))
+            {
+                err = Z_DATA_ERROR;
+                break;
+            }
+
+            pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + output.pos;
+            pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,
+                                pfile_in_zip_read_info->stream.next_out, (uInt)output.pos);
+            pfile_in_zip_read_info->rest_read_uncompressed -= output.pos;
+            pfile_in_zip_read_info->stream.next_in += input.pos;
+            pfile_in_zip_read_info->stream.avail_in -= (uInt)input.pos;
+            pfile_in_zip_read_info->stream.total_in += (uLong)input.pos;
+            pfile_in_zip_read_info->stream.next_out += output.pos;
+            pfile_in_zip_read_info->stream.avail_out -= (uInt)output.pos;
+            pfile_in_zip_read_info->stream.total_out += (uLong)output.pos;
+            iRead += (uInt)output.pos;
+
+            /* the frame is complete once everything is flushed, or truncated if nothing moves without input left */
+            if ((pfile_in_zip_read_info->stream.avail_in==0) && (pfile_in_zip_read_info->rest_read_compressed==0) &&
+                ((ret==0) || (output.pos==0)))
+            {
+                if (ret!=0)
+                {
+                    err = Z_DATA_ERROR;
+                    break;
+                }
+                return (iRead==0) ? UNZ_EOF : iRead;
+            }
+        }
+#endif
         else
         {
             ZPOS64_T uTotalOutBefore,uTotalOutAfter;
@@ -2032,6 +2614,10 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
     else if (pfile_in_zip_read_info->stream_initialised == Z_BZIP2ED)
         BZ2_bzDecompressEnd(&pfile_in_zip_read_info->bstream);
 #endif
+#ifdef HAVE_ZSTD
+    else if (pfile_in_zip_read_info->stream_initialised == Z_ZSTD)
+        ZSTD_freeDStream(pfile_in_zip_read_info->zstream);
+#endif
 
 
     pfile_in_zip_read_info->stream_initialised = 0;
@@ -2042,6 +2628,241 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
     return err;
 }
 
+extern int ZEXPORT unzReadCurrentFilePrefix (unzFile file, voidp buf, unsigned len)
+{
+    int err;
+    unsigned read=0;
+
+    err = unzOpenCurrentFile(file);
+    if (err!=UNZ_OK)
+        return err;
+
+    while (read<len)
+    {
+        err = unzReadCurrentFile(file,(char*)buf+read,len-read);
+        if (err<=0)
+            break;
+        read+=err;
+    }
+
+    if (err<0)
+    {
+        unzCloseCurrentFile(file);
+        return err;
+    }
+    err = unzCloseCurrentFile(file);
+    if (err!=UNZ_OK)
+        return err;
+    return (int)read;
+}
+
+/* crc32() only takes a uInt length */
+local uLong unz64local_crc32Buffer (const unsigned char* data, ZPOS64_T len)
+{
+    uLong crc = crc32(0L, Z_NULL, 0);
+    while (len>0)
+    {
+        uInt chunk = len>0x40000000 ? 0x40000000 : (uInt)len;
+        crc = crc32(crc, data, chunk);
+        data += chunk;
+        len -= chunk;
+    }
+    return crc;
+}
+
+/*
+  Get the position in the archive of the data of the current file, after
+    its local header
+*/
+local int unz64local_GetCurrentFileDataPos (unz64_s* s, ZPOS64_T* ppos)
+{
+    ZPOS64_T offset_local_extrafield;
+    uInt size_local_extrafield;
+    uInt iSizeVar;
+
+    if (unz64local_CheckCurrentFileCoherencyHeader(s,&iSizeVar, &offset_local_extrafield,&size_local_extrafield)!=UNZ_OK)
+        return UNZ_BADZIPFILE;
+    *ppos = s->cur_file_info_internal.offset_curfile + SIZEZIPLOCALHEADER + iSizeVar +
+            s->byte_before_the_zipfile;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzGetCurrentFileMappedData (unzFile file, const void** buf, ZPOS64_T* len, int check_crc)
+{
+    unz64_s* s;
+    const unsigned char* base;
+    ZPOS64_T size_mapped;
+    ZPOS64_T pos_data;
+
+    if ((file==NULL) || (buf==NULL) || (len==NULL))
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if (!s->current_file_ok)
+        return UNZ_PARAMERROR;
+
+    if ((s->cur_file_info.compression_method!=0) || (s->cur_file_info.flag & 1))
+        return UNZ_NOTMAPPABLE;
+    base = (const unsigned char*)ZMAP64(s->z_filefunc, s->filestream, &size_mapped);
+    if (base==NULL)
+        return UNZ_NOTMAPPABLE;
+
+    if (s->cur_file_info.compressed_size!=s->cur_file_info.uncompressed_size)
+        return UNZ_BADZIPFILE;
+    if (unz64local_GetCurrentFileDataPos(s,&pos_data)!=UNZ_OK)
+        return UNZ_BADZIPFILE;
+    if ((pos_data>size_mapped) || (s->cur_file_info.compressed_size>size_mapped-pos_data))
+        return UNZ_BADZIPFILE;
+
+    if (check_crc && (unz64local_crc32Buffer(base + pos_data,s->cur_file_info.compressed_size)!=s->cur_file_info.crc))
+        return UNZ_CRCERROR;
+
+    *buf = base + pos_data;
+    *len = s->cur_file_info.compressed_size;
+    return UNZ_OK;
+}
+
+/* avail_in and avail_out are only a uInt */
+extern int ZEXPORT unzInflateBuffer (voidpf opaque, const void* in, ZPOS64_T in_len,
+                                     void* out, ZPOS64_T out_len)
+{
+    z_stream stream;
+    ZPOS64_T rest_in = in_len;
+    ZPOS64_T rest_out = out_len;
+    int err;
+
+    memset(&stream,0,sizeof(stream));
+    err = inflateInit2(&stream, -MAX_WBITS);
+    if (err!=Z_OK)
+        return err;
+    stream.next_in = (Bytef*)in;
+    stream.next_out = (Bytef*)out;
+    for (;;)
+    {
+        uInt avail_in = rest_in>0x40000000 ? 0x40000000 : (uInt)rest_in;
+        uInt avail_out = rest_out>0x40000000 ? 0x40000000 : (uInt)rest_out;
+        stream.avail_in = avail_in;
+        stream.avail_out = avail_out;
+        err = inflate(&stream, Z_FINISH);
+        rest_in -= avail_in - stream.avail_in;
+        rest_out -= avail_out - stream.avail_out;
+        if ((err!=Z_OK) && (err!=Z_BUF_ERROR))
+            break;
+        if ((rest_out==0) || ((stream.avail_in==avail_in) && (stream.avail_out==avail_out)))
+            break;
+    }
+    inflateEnd(&stream);
+
+    /* like unzReadCurrentFile, the deflate stream may end without
+       Z_STREAM_END as the sizes are known */
+    if (rest_out!=0)
+        return err==Z_OK || err==Z_STREAM_END ? Z_DATA_ERROR : err;
+    return (err==Z_OK) || (err==Z_STREAM_END) || (err==Z_BUF_ERROR) ? Z_OK : err;
+}
+
+/*
+  Read the current file with unzReadCurrentFile into buf
+*/
+local int unz64local_ReadCurrentFileToBuffer (unzFile file, voidp buf, ZPOS64_T len)
+{
+    ZPOS64_T read = 0;
+    int err = unzOpenCurrentFile(file);
+    if (err!=UNZ_OK)
+        return err;
+
+    do
+    {
+        ZPOS64_T rest = len - read;
+        err = unzReadCurrentFile(file,(char*)buf+read,rest>0x40000000 ? 0x40000000 : (unsigned)rest);
+        if (err>0)
+            read+=err;
+    } while ((err>0) && (read<len));
+
+    if (err<0)
+    {
+        unzCloseCurrentFile(file);
+        return err;
+    }
+    err = unzCloseCurrentFile(file);  /* checks the CRC */
+    if ((err==UNZ_OK) && (read!=((unz64_s*)file)->cur_file_info.uncompressed_size))
+        err = UNZ_BADZIPFILE;
+    return err;
+}
+
+extern int ZEXPORT unzExtractCurrentFileToBuffer (unzFile file, voidp buf, ZPOS64_T len)
+{
+    unz64_s* s;
+    const unsigned char* base;
+    unsigned char* compressed = NULL;
+    ZPOS64_T size_mapped;
+    ZPOS64_T pos_data;
+    ZPOS64_T compressed_size;
+    ZPOS64_T uncompressed_size;
+    unz_buffer_inflater inflater;
+    int err;
+
+    if ((file==NULL) || ((buf==NULL) && (len>0)))
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if (!s->current_file_ok)
+        return UNZ_PARAMERROR;
+    uncompressed_size = s->cur_file_info.uncompressed_size;
+    compressed_size = s->cur_file_info.compressed_size;
+    if (len<uncompressed_size)
+        return UNZ_PARAMERROR;
+
+    if ((s->cur_file_info.compression_method!=Z_DEFLATED) || (s->cur_file_info.flag & 1))
+        return unz64local_ReadCurrentFileToBuffer(file,buf,len);
+
+    if (s->pfile_in_zip_read != NULL)
+        unzCloseCurrentFile(file);
+    if (unz64local_GetCurrentFileDataPos(s,&pos_data)!=UNZ_OK)
+        return UNZ_BADZIPFILE;
+
+    base = (const unsigned char*)ZMAP64(s->z_filefunc, s->filestream, &size_mapped);
+    if (base!=NULL)
+    {
+        if ((pos_data>size_mapped) || (compressed_size>size_mapped-pos_data))
+            return UNZ_BADZIPFILE;
+        base += pos_data;
+    }
+    else
+    {
+        /* one read for the whole compressed data instead of UNZ_BUFSIZE ones */
+        if ((uLong)compressed_size!=compressed_size)
+            return unz64local_ReadCurrentFileToBuffer(file,buf,len);
+        compressed = (unsigned char*)ALLOC(compressed_size>0 ? (uLong)compressed_size : 1);
+        if (compressed==NULL)
+            return unz64local_ReadCurrentFileToBuffer(file,buf,len);
+        if ((ZSEEK64(s->z_filefunc, s->filestream, pos_data, ZLIB_FILEFUNC_SEEK_SET)!=0) ||
+            (ZREAD64(s->z_filefunc, s->filestream, compressed, (uLong)compressed_size)!=compressed_size))
+        {
+            TRYFREE(compressed);
+            return UNZ_ERRNO;
+        }
+        base = compressed;
+    }
+
+    inflater = s->buffer_inflater!=NULL ? s->buffer_inflater : unzInflateBuffer;
+    err = (*inflater)(s->buffer_inflater_opaque, base, compressed_size, buf, uncompressed_size);
+    TRYFREE(compressed);
+    if (err!=Z_OK)
+        return unz64local_ReadCurrentFileToBuffer(file,buf,len);
+
+    if (unz64local_crc32Buffer((const unsigned char*)buf,uncompressed_size)!=s->cur_file_info.crc)
+        return UNZ_CRCERROR;
+    return UNZ_OK;
+}
+
+extern void ZEXPORT unzSetBufferInflater (unzFile file, unz_buffer_inflater inflater, voidpf opaque)
+{
+    unz64_s* s;
+    if (file==NULL)
+        return;
+    s=(unz64_s*)file;
+    s->buffer_inflater = inflater;
+    s->buffer_inflater_opaque = opaque;
+}
+
 
 /*
   Get the global comment string of the ZipFile, in the szComment buffer.
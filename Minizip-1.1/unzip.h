@@ -59,7 +59,12 @@ extern "C" {
 #include "bzlib.h"
 #endif
 
+#ifdef HAVE_ZSTD
+#include "zstd.h"
+#endif
+
 #define Z_BZIP2ED 12
+#define Z_ZSTD 93   /* APPNOTE 6.3.8, a single zstd frame per entry */
 
 #if defined(STRICTUNZIP) || defined(STRICTZIPUNZIP)
 /* like the STRICT of WIN32, we define a pointer that cannot be converted
@@ -79,6 +84,7 @@ typedef voidp unzFile;
 #define UNZ_BADZIPFILE                  (-103)
 #define UNZ_INTERNALERROR               (-104)
 #define UNZ_CRCERROR                    (-105)
+#define UNZ_NOTMAPPABLE                 (-106)
 
 /* tm_unz contain date/time info */
 typedef struct tm_unz_s
@@ -150,6 +156,13 @@ typedef struct unz_file_info_s
     tm_unz tmu_date;
 } unz_file_info;
 
+/* whole buffer decompressor used by unzExtractCurrentFileToBuffer, must
+   return Z_OK only if in_len bytes of raw deflate data produced exactly
+   out_len bytes */
+typedef int (*unz_buffer_inflater) OF((voidpf opaque,
+                                       const void* in, ZPOS64_T in_len,
+                                       void* out, ZPOS64_T out_len));
+
 extern int ZEXPORT unzStringFileNameCompare OF ((const char* fileName1,
                                                  const char* fileName2,
                                                  int iCaseSensitivity));
@@ -251,6 +264,18 @@ extern int ZEXPORT unzLocateFile OF((unzFile file,
   UNZ_END_OF_LIST_OF_FILE if the file is not found
 */
 
+extern int ZEXPORT unzLocateFileFast OF((unzFile file,
+                     const char *szFileName,
+                     int iCaseSensitivity));
+/*
+  Same as unzLocateFile but using a hash table of the central directory
+    built by unzOpen, so the lookup does not depend on the number of files.
+  '\\' and '/' are considered the same separator, so names can be looked up
+    as listed by tools converting them, and when indexed, names are not
+    limited to UNZ_MAXFILENAMEINZIP characters.
+  If the central directory could not be indexed, it is scanned instead.
+*/
+
 
 /* ****************************************** */
 /* Ryan supplied functions */
@@ -283,6 +308,42 @@ extern int ZEXPORT unzGoToFilePos64(
     unzFile file,
     const unz64_file_pos* file_pos);
 
+/* unz_entry contain the information listed by unzGetEntryList */
+typedef struct unz_entry_s
+{
+    uLong name_offset;            /* offset of the name in the names arena */
+    uLong size_filename;          /* length of the name without the final 0 */
+    uLong flag;                   /* general purpose bit flag */
+    uLong compression_method;     /* compression method */
+    uLong crc;                    /* crc-32 */
+    uLong dosDate;                /* last mod file date in Dos fmt */
+    ZPOS64_T compressed_size;     /* compressed size */
+    ZPOS64_T uncompressed_size;   /* uncompressed size */
+    ZPOS64_T offset_curfile;      /* relative offset of the local header */
+    unz64_file_pos file_pos;      /* for unzGoToFilePos64 */
+} unz_entry;
+
+typedef struct unz_entry_list_s
+{
+    ZPOS64_T number_entry;        /* number of entries */
+    unz_entry* entries;
+    char* names;                  /* arena of the 0 terminated file names */
+    ZPOS64_T byte_before_the_zipfile; /* to add to offset_curfile, >0 for sfx */
+} unz_entry_list;
+
+extern int ZEXPORT unzGetEntryList OF((unzFile file,
+                     unz_entry_list* list));
+/*
+  List all the files in the zipfile from a single read of the central
+    directory (none if it was already read by unzOpen), without seeking to
+    the local headers or changing the current file.
+  The name of an entry is at list->names + entry->name_offset.
+  Free the list with unzFreeEntryList.
+  return UNZ_OK if there is no problem
+*/
+
+extern void ZEXPORT unzFreeEntryList OF((unz_entry_list* list));
+
 /* ****************************************** */
 
 extern int ZEXPORT unzGetCurrentFileInfo64 OF((unzFile file,
@@ -390,6 +451,64 @@ extern int ZEXPORT unzReadCurrentFile OF((unzFile file,
     (UNZ_ERRNO for IO error, or zLib error for uncompress error)
 */
 
+extern int ZEXPORT unzReadCurrentFilePrefix OF((unzFile file,
+                      voidp buf,
+                      unsigned len));
+/*
+  Open the current file, decompress only its first len bytes into buf
+    then close it, without inflating the rest of the file.
+  The CRC is only checked if the whole file fits in buf.
+
+  return the number of byte copied (less than len only for shorter files)
+  return <0 with error code if there is an error
+*/
+
+extern int ZEXPORT unzGetCurrentFileMappedData OF((unzFile file,
+                      const void** buf,
+                      ZPOS64_T* len,
+                      int check_crc));
+/*
+  Get a pointer to the data of the current file directly inside the archive,
+    without opening it or copying anything. This only works for stored and
+    not encrypted files of archives opened with an ioapi providing zmap64_file
+    (like fill_mmap_filefunc64). The pointer stays valid until unzClose.
+  If check_crc is not 0, the CRC of the data is verified first.
+
+  return UNZ_OK if *buf and *len were set
+  return UNZ_NOTMAPPABLE if the file must be read with unzReadCurrentFile
+  return <0 with another error code if there is an error
+*/
+
+extern int ZEXPORT unzExtractCurrentFileToBuffer OF((unzFile file,
+                      voidp buf,
+                      ZPOS64_T len));
+/*
+  Decompress the whole current file into buf, which must be at least as
+    large as its uncompressed_size, then check its CRC.
+  Deflated files are inflated in a single pass from the mapped archive (or
+    from their compressed data read at once) with the inflater set by
+    unzSetBufferInflater, falling back to the unzReadCurrentFile path for
+    other methods, encrypted files or if the inflater fails.
+
+  return UNZ_OK if the whole file was extracted
+  return <0 with error code if there is an error
+*/
+
+extern void ZEXPORT unzSetBufferInflater OF((unzFile file,
+                      unz_buffer_inflater inflater,
+                      voidpf opaque));
+/*
+  Set the decompressor used by unzExtractCurrentFileToBuffer for deflated
+    files, or restore the default one based on zlib inflate() if NULL.
+*/
+
+extern int ZEXPORT unzInflateBuffer OF((voidpf opaque,
+                      const void* in, ZPOS64_T in_len,
+                      void* out, ZPOS64_T out_len));
+/*
+  The default unz_buffer_inflater, based on zlib inflate(), opaque is unused
+*/
+
 extern z_off_t ZEXPORT unztell OF((unzFile file));
 
 extern ZPOS64_T ZEXPORT unztell64 OF((unzFile file));
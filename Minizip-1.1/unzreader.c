@@ -0,0 +1,938 @@
+/* unzreader.c -- Concurrent reader for .zip files
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "iommap.h"
+#include "unzreader.h"
+
+#define SIZEZIPLOCALHEADER (0x1e)
+#define UNZ_READER_CHUNKSIZE (64*1024)
+#define UNZ_READER_EXTRASLACK (1024)  /* local extra field is not in the entry, usually far smaller */
+
+/* Nothing in this structure changes after unzReaderOpen returns */
+typedef struct
+{
+    int fd;                     /* -1 if mapped */
+    const unsigned char* base;  /* whole file mapped, or NULL to use pread */
+    int unmap;                  /* base is a mapping owned by the reader */
+    ZPOS64_T size;
+    unz_entry_list list;
+    ZPOS64_T table_mask;        /* table has table_mask+1 slots */
+    ZPOS64_T* table;            /* entry number + 1 or 0 for empty slots */
+} unz64_reader;
+
+/* ioapi stream only used while unzip parses the central directory */
+typedef struct
+{
+    unz64_reader* reader;
+    ZPOS64_T pos;
+} unz64_reader_stream;
+
+/* Read up to len bytes at pos, return the number of bytes read */
+static ZPOS64_T unz64reader_ReadAt (const unz64_reader* r, void* buf, ZPOS64_T len, ZPOS64_T pos)
+{
+    ZPOS64_T done = 0;
+    if (pos>=r->size)
+        return 0;
+    if (len>r->size-pos)
+        len = r->size-pos;
+    if (r->base!=NULL)
+    {
+        memcpy(buf,r->base+pos,(size_t)len);
+        return len;
+    }
+    while (done<len)
+    {
+        ZPOS64_T rest = len-done;
+        ssize_t count = pread(r->fd,(char*)buf+done,rest>0x40000000 ? 0x40000000 : (size_t)rest,(off_t)(pos+done));
+        if (count<0)
+        {
+            if (errno==EINTR)
+                continue;
+            break;
+        }
+        if (count==0)
+            break;
+        done += count;
+    }
+    return done;
+}
+
+static voidpf ZCALLBACK reader_open64_file_func (voidpf opaque, const void* filename, int mode)
+{
+    unz64_reader_stream* stream;
+    if ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER)!=ZLIB_FILEFUNC_MODE_READ)
+        return NULL;
+    stream = (unz64_reader_stream*)malloc(sizeof(unz64_reader_stream));
+    if (stream!=NULL)
+    {
+        stream->reader = (unz64_reader*)opaque;
+        stream->pos = 0;
+    }
+    return stream;
+}
+
+static uLong ZCALLBACK reader_read_file_func (voidpf opaque, voidpf stream, void* buf, uLong size)
+{
+    unz64_reader_stream* rs = (unz64_reader_stream*)stream;
+    ZPOS64_T read = unz64reader_ReadAt(rs->reader,buf,size,rs->pos);
+    rs->pos += read;
+    return (uLong)read;
+}
+
+static uLong ZCALLBACK reader_write_file_func (voidpf opaque, voidpf stream, const void* buf, uLong size)
+{
+    return 0;
+}
+
+static ZPOS64_T ZCALLBACK reader_tell64_file_func (voidpf opaque, voidpf stream)
+{
+    return ((unz64_reader_stream*)stream)->pos;
+}
+
+static long ZCALLBACK reader_seek64_file_func (voidpf opaque, voidpf stream, ZPOS64_T offset, int origin)
+{
+    unz64_reader_stream* rs = (unz64_reader_stream*)stream;
+    ZPOS64_T pos;
+    switch (origin)  /* negative offsets arrive as two's complement */
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR :
+        pos = rs->pos + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_END :
+        pos = rs->reader->size + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET :
+        pos = offset;
+        break;
+    default: return -1;
+    }
+    if (pos>rs->reader->size)
+        return -1;
+    rs->pos = pos;
+    return 0;
+}
+
+static int ZCALLBACK reader_close_file_func (voidpf opaque, voidpf stream)
+{
+    free(stream);
+    return 0;
+}
+
+static int ZCALLBACK reader_error_file_func (voidpf opaque, voidpf stream)
+{
+    return 0;
+}
+
+static const void* ZCALLBACK reader_map64_file_func (voidpf opaque, voidpf stream, ZPOS64_T* size)
+{
+    unz64_reader_stream* rs = (unz64_reader_stream*)stream;
+    *size = rs->reader->size;
+    return rs->reader->base;
+}
+
+/* Same hash and comparison as unzLocateFileFast in case sensitive mode */
+static ZPOS64_T unz64reader_HashName (const char* name)
+{
+    uLong hash = 2166136261UL;  /* FNV-1a */
+    for (;*name!='\0';name++)
+    {
+        unsigned char c = (unsigned char)*name;
+        if (c=='\\')
+            c = '/';
+        hash = ((hash ^ c) * 16777619UL) & 0xffffffffUL;
+    }
+    return hash;
+}
+
+static int unz64reader_NameEqual (const char* name1, const char* name2)
+{
+    for (;;name1++,name2++)
+    {
+        char c1 = *name1=='\\' ? '/' : *name1;
+        char c2 = *name2=='\\' ? '/' : *name2;
+        if (c1!=c2)
+            return 0;
+        if (c1=='\0')
+            return 1;
+    }
+}
+
+/* Open and if possible map the file, the entry list is left empty */
+static unz64_reader* unz64reader_OpenFile (const char *path)
+{
+    unz64_reader* r;
+    struct stat info;
+
+    if (path==NULL)
+        return NULL;
+    r = (unz64_reader*)malloc(sizeof(unz64_reader));
+    if (r==NULL)
+        return NULL;
+    memset(r,0,sizeof(unz64_reader));
+    r->fd = open(path, O_RDONLY);
+    if ((r->fd<0) || (fstat(r->fd,&info)!=0))
+    {
+        unzReaderClose(r);
+        return NULL;
+    }
+    r->size = info.st_size;
+    if ((r->size>0) && (r->size<=MMAP_MAX_FILE_SIZE))
+    {
+        void* base = mmap(NULL,(size_t)r->size,PROT_READ,MAP_PRIVATE,r->fd,0);
+        if (base!=MAP_FAILED)
+        {
+            r->base = (const unsigned char*)base;
+            r->unmap = 1;
+            close(r->fd);  /* the mapping stays valid */
+            r->fd = -1;
+        }
+    }
+    return r;
+}
+
+/* Hash the names of the entry list, close the reader on failure */
+static unz64_reader* unz64reader_BuildTable (unz64_reader* r)
+{
+    ZPOS64_T table_size = 1;
+    ZPOS64_T i;
+
+    while (table_size<2*r->list.number_entry)
+        table_size <<= 1;
+    r->table_mask = table_size-1;
+    r->table = (ZPOS64_T*)malloc((size_t)table_size*sizeof(ZPOS64_T));
+    if (r->table==NULL)
+    {
+        unzReaderClose(r);
+        return NULL;
+    }
+    memset(r->table,0,(size_t)table_size*sizeof(ZPOS64_T));
+    for (i=0;i<r->list.number_entry;i++)
+    {
+        ZPOS64_T slot = unz64reader_HashName(r->list.names+r->list.entries[i].name_offset) & r->table_mask;
+        while (r->table[slot]!=0)
+            slot = (slot+1) & r->table_mask;
+        r->table[slot] = i+1;
+    }
+    return r;
+}
+
+/* Parse the central directory, close the reader on failure */
+static unz64_reader* unz64reader_ReadEntryList (unz64_reader* r, const char *path)
+{
+    zlib_filefunc64_def functions;
+    unzFile file;
+
+    functions.zopen64_file = reader_open64_file_func;
+    functions.zread_file = reader_read_file_func;
+    functions.zwrite_file = reader_write_file_func;
+    functions.ztell64_file = reader_tell64_file_func;
+    functions.zseek64_file = reader_seek64_file_func;
+    functions.zclose_file = reader_close_file_func;
+    functions.zerror_file = reader_error_file_func;
+    functions.opaque = r;
+    functions.zmap64_file = reader_map64_file_func;
+    file = unzOpen2_64(path,&functions);
+    if ((file==NULL) || (unzGetEntryList(file,&r->list)!=UNZ_OK))
+    {
+        if (file!=NULL)
+            unzClose(file);
+        unzReaderClose(r);
+        return NULL;
+    }
+    unzClose(file);
+
+    return unz64reader_BuildTable(r);
+}
+
+extern unzReader ZEXPORT unzReaderOpen (const char *path)
+{
+    unz64_reader* r = unz64reader_OpenFile(path);
+    if (r==NULL)
+        return NULL;
+    return unz64reader_ReadEntryList(r,path);
+}
+
+extern unzReader ZEXPORT unzReaderOpenMemory (const void* buf, ZPOS64_T len)
+{
+    unz64_reader* r;
+    if ((buf==NULL) && (len>0))
+        return NULL;
+    r = (unz64_reader*)malloc(sizeof(unz64_reader));
+    if (r==NULL)
+        return NULL;
+    memset(r,0,sizeof(unz64_reader));
+    r->fd = -1;
+    r->base = (const unsigned char*)buf;
+    r->size = len;
+    return unz64reader_ReadEntryList(r,NULL);
+}
+
+extern unzReader ZEXPORT unzReaderOpenWithEntryList (const char *path, const unz_entry_list* list)
+{
+    unz64_reader* r;
+    ZPOS64_T size_names = 0;
+    ZPOS64_T size_entries;
+    ZPOS64_T i;
+
+    if (list==NULL)
+        return NULL;
+    for (i=0;i<list->number_entry;i++)
+    {
+        ZPOS64_T end = (ZPOS64_T)list->entries[i].name_offset + list->entries[i].size_filename + 1;
+        if (end>size_names)
+            size_names = end;
+    }
+    size_entries = list->number_entry*sizeof(unz_entry);
+    if ((size_t)(size_entries+size_names)!=size_entries+size_names)
+        return NULL;
+
+    r = unz64reader_OpenFile(path);
+    if (r==NULL)
+        return NULL;
+    /* same single allocation as unzGetEntryList so unzFreeEntryList works */
+    r->list.entries = (unz_entry*)malloc((size_t)(size_entries+size_names)+1);
+    if (r->list.entries==NULL)
+    {
+        unzReaderClose(r);
+        return NULL;
+    }
+    r->list.names = (char*)(r->list.entries+list->number_entry);
+    memcpy(r->list.entries,list->entries,(size_t)size_entries);
+    memcpy(r->list.names,list->names,(size_t)size_names);
+    r->list.number_entry = list->number_entry;
+    r->list.byte_before_the_zipfile = list->byte_before_the_zipfile;
+
+    return unz64reader_BuildTable(r);
+}
+
+#define UNZ_SALVAGE_WINDOW (1024*1024)
+
+/* Find the next 4 bytes signature at or after pos, return r->size if none */
+static ZPOS64_T unz64reader_FindSignature (const unz64_reader* r, unsigned char* window, ZPOS64_T pos, const unsigned char* signature)
+{
+    while (pos+4<=r->size)
+    {
+        const unsigned char* bytes;
+        const unsigned char* found;
+        ZPOS64_T len = r->size-pos;
+        ZPOS64_T i;
+        if (r->base!=NULL)
+        {
+            if (len>0x40000000)
+                len = 0x40000000;
+            bytes = r->base+pos;
+        }
+        else
+        {
+            if (len>UNZ_SALVAGE_WINDOW)
+                len = UNZ_SALVAGE_WINDOW;
+            if (unz64reader_ReadAt(r,window,len,pos)!=len)
+                break;
+            bytes = window;
+        }
+        for (i=0;i+4<=len;i++)
+        {
+            found = (const unsigned char*)memchr(bytes+i,signature[0],(size_t)(len-3-i));
+            if (found==NULL)
+                break;
+            i = found-bytes;
+            if ((found[1]==signature[1]) && (found[2]==signature[2]) && (found[3]==signature[3]))
+                return pos+i;
+        }
+        pos += len-3;  /* the signature may straddle two windows */
+    }
+    return r->size;
+}
+
+static uLong unz64reader_Get16 (const unsigned char* bytes)
+{
+    return (uLong)bytes[0] | ((uLong)bytes[1]<<8);
+}
+
+static uLong unz64reader_Get32 (const unsigned char* bytes)
+{
+    return (uLong)bytes[0] | ((uLong)bytes[1]<<8) | ((uLong)bytes[2]<<16) | ((uLong)bytes[3]<<24);
+}
+
+static ZPOS64_T unz64reader_Get64 (const unsigned char* bytes)
+{
+    return (ZPOS64_T)unz64reader_Get32(bytes) | ((ZPOS64_T)unz64reader_Get32(bytes+4)<<32);
+}
+
+/* A descriptor is followed by another record or the end of the file */
+static int unz64reader_IsRecordStart (const unz64_reader* r, ZPOS64_T pos)
+{
+    unsigned char bytes[2];
+    if (pos==r->size)
+        return 1;
+    return (unz64reader_ReadAt(r,bytes,2,pos)==2) && (bytes[0]==0x50) && (bytes[1]==0x4b);
+}
+
+/* Find the data descriptor ending an entry written with bit 3 set: the first
+   signature whose compressed size matches its distance from the data, in the
+   32 or 64 bits form whichever is followed by another record */
+static int unz64reader_FindDescriptor (const unz64_reader* r, unsigned char* window, ZPOS64_T data, unz_entry* entry, ZPOS64_T* pnext)
+{
+    static const unsigned char signature[4] = {0x50, 0x4b, 0x07, 0x08};
+    ZPOS64_T pos = data;
+    for (;;)
+    {
+        unsigned char descriptor[24];
+        ZPOS64_T len;
+        int short_form;
+        int long_form;
+        pos = unz64reader_FindSignature(r,window,pos,signature);
+        if (pos>=r->size)
+            return UNZ_BADZIPFILE;
+        len = unz64reader_ReadAt(r,descriptor,sizeof(descriptor),pos);
+        short_form = (len>=16) && (unz64reader_Get32(descriptor+8)==pos-data);
+        long_form = (len>=24) && (unz64reader_Get64(descriptor+8)==pos-data);
+        if (short_form && long_form && !unz64reader_IsRecordStart(r,pos+16))
+            short_form = 0;
+        if (short_form || long_form)
+        {
+            entry->crc = unz64reader_Get32(descriptor+4);
+            entry->compressed_size = pos-data;
+            entry->uncompressed_size = short_form ? unz64reader_Get32(descriptor+12) : unz64reader_Get64(descriptor+16);
+            *pnext = pos+(short_form ? 16 : 24);
+            return UNZ_OK;
+        }
+        pos++;
+    }
+}
+
+/* Build the entry list from the local headers, without the central directory */
+static int unz64reader_ScanLocalHeaders (unz64_reader* r)
+{
+    static const unsigned char signature[4] = {0x50, 0x4b, 0x03, 0x04};
+    unsigned char* window = NULL;
+    unsigned char* names = NULL;
+    ZPOS64_T size_names = 0;
+    ZPOS64_T capacity_names = 0;
+    unz_entry* entries = NULL;
+    ZPOS64_T count = 0;
+    ZPOS64_T capacity = 0;
+    unsigned char* variable;    /* name and extra field of the current header */
+    ZPOS64_T pos = 0;
+
+    variable = (unsigned char*)malloc(0xffff+0xffff);
+    if (r->base==NULL)
+        window = (unsigned char*)malloc(UNZ_SALVAGE_WINDOW);
+    if ((variable==NULL) || ((r->base==NULL) && (window==NULL)))
+    {
+        free(variable);
+        free(window);
+        return UNZ_INTERNALERROR;
+    }
+    while (pos+SIZEZIPLOCALHEADER<=r->size)
+    {
+        unsigned char header[SIZEZIPLOCALHEADER];
+        unz_entry entry;
+        uLong size_filename;
+        uLong size_extra;
+        ZPOS64_T data;
+        ZPOS64_T next;
+
+        if (unz64reader_ReadAt(r,header,SIZEZIPLOCALHEADER,pos)!=SIZEZIPLOCALHEADER)
+            break;
+        if ((header[0]==0x50) && (header[1]==0x4b) && (((header[2]==1) && (header[3]==2)) || ((header[2]==5) && (header[3]==6)) || ((header[2]==6) && (header[3]==6))))
+            break;  /* reached the central directory */
+        if ((header[0]!=0x50) || (header[1]!=0x4b) || (header[2]!=0x03) || (header[3]!=0x04))
+        {
+            pos = unz64reader_FindSignature(r,window,pos+1,signature);  /* skip damaged bytes */
+            continue;
+        }
+
+        memset(&entry,0,sizeof(entry));
+        entry.flag = unz64reader_Get16(header+6);
+        entry.compression_method = unz64reader_Get16(header+8);
+        entry.dosDate = unz64reader_Get32(header+10);
+        entry.crc = unz64reader_Get32(header+14);
+        entry.compressed_size = unz64reader_Get32(header+18);
+        entry.uncompressed_size = unz64reader_Get32(header+22);
+        entry.offset_curfile = pos;
+        size_filename = unz64reader_Get16(header+26);
+        size_extra = unz64reader_Get16(header+28);
+        data = pos+SIZEZIPLOCALHEADER+size_filename+size_extra;
+        if ((size_filename==0) || (data>r->size) ||
+            (unz64reader_ReadAt(r,variable,size_filename+size_extra,pos+SIZEZIPLOCALHEADER)!=size_filename+size_extra))
+        {
+            pos = unz64reader_FindSignature(r,window,pos+1,signature);
+            continue;
+        }
+
+        if ((entry.compressed_size==0xffffffff) || (entry.uncompressed_size==0xffffffff))
+        {
+            const unsigned char* extra = variable+size_filename;
+            while (extra+4<=variable+size_filename+size_extra)
+            {
+                uLong id = unz64reader_Get16(extra);
+                uLong len = unz64reader_Get16(extra+2);
+                if ((id==0x0001) && (len>=16) && (extra+4+16<=variable+size_filename+size_extra))
+                {
+                    entry.uncompressed_size = unz64reader_Get64(extra+4);
+                    entry.compressed_size = unz64reader_Get64(extra+12);
+                    break;
+                }
+                extra += 4+len;
+            }
+        }
+
+        if (entry.flag & 8)
+        {
+            if (unz64reader_FindDescriptor(r,window,data,&entry,&next)!=UNZ_OK)
+                break;  /* truncated in the last entry */
+        }
+        else
+        {
+            if (entry.compressed_size>r->size-data)
+                break;  /* truncated in the last entry */
+            next = data+entry.compressed_size;
+        }
+
+        if (count==capacity)
+        {
+            unz_entry* grown;
+            capacity = capacity ? 2*capacity : 64;
+            grown = (unz_entry*)realloc(entries,(size_t)capacity*sizeof(unz_entry));
+            if (grown==NULL)
+                break;
+            entries = grown;
+        }
+        if (size_names+size_filename+1>capacity_names)
+        {
+            unsigned char* grown;
+            capacity_names = 2*capacity_names>size_names+size_filename+1 ? 2*capacity_names : size_names+size_filename+1+4096;
+            grown = (unsigned char*)realloc(names,(size_t)capacity_names);
+            if (grown==NULL)
+                break;
+            names = grown;
+        }
+        entry.name_offset = (uLong)size_names;
+        entry.size_filename = size_filename;
+        entry.file_pos.num_of_file = count;
+        memcpy(names+size_names,variable,size_filename);
+        names[size_names+size_filename] = 0;
+        size_names += size_filename+1;
+        entries[count++] = entry;
+        pos = next;
+    }
+    free(variable);
+    free(window);
+
+    /* same single allocation as unzGetEntryList so unzFreeEntryList works */
+    if (count>0)
+    {
+        r->list.entries = (unz_entry*)malloc((size_t)(count*sizeof(unz_entry)+size_names));
+        if (r->list.entries!=NULL)
+        {
+            r->list.names = (char*)(r->list.entries+count);
+            memcpy(r->list.entries,entries,(size_t)(count*sizeof(unz_entry)));
+            memcpy(r->list.names,names,(size_t)size_names);
+            r->list.number_entry = count;
+        }
+    }
+    free(entries);
+    free(names);
+    return r->list.number_entry>0 ? UNZ_OK : UNZ_BADZIPFILE;
+}
+
+extern unzReader ZEXPORT unzReaderOpenSalvage (const char *path)
+{
+    unz64_reader* r = unz64reader_OpenFile(path);
+    if (r==NULL)
+        return NULL;
+    if (unz64reader_ScanLocalHeaders(r)!=UNZ_OK)
+    {
+        unzReaderClose(r);
+        return NULL;
+    }
+    return unz64reader_BuildTable(r);
+}
+
+extern void ZEXPORT unzReaderClose (unzReader reader)
+{
+    unz64_reader* r = (unz64_reader*)reader;
+    if (r==NULL)
+        return;
+    if (r->unmap)
+        munmap((void*)r->base,(size_t)r->size);
+    if (r->fd>=0)
+        close(r->fd);
+    unzFreeEntryList(&r->list);
+    free(r->table);
+    free(r);
+}
+
+extern const unz_entry_list* ZEXPORT unzReaderGetEntryList (unzReader reader)
+{
+    unz64_reader* r = (unz64_reader*)reader;
+    return r!=NULL ? &r->list : NULL;
+}
+
+extern const unz_entry* ZEXPORT unzReaderLocateEntry (unzReader reader, const char *szFileName)
+{
+    unz64_reader* r = (unz64_reader*)reader;
+    ZPOS64_T slot;
+    if ((r==NULL) || (szFileName==NULL) || (r->list.number_entry==0))
+        return NULL;
+    slot = unz64reader_HashName(szFileName) & r->table_mask;
+    while (r->table[slot]!=0)
+    {
+        const unz_entry* entry = &r->list.entries[r->table[slot]-1];
+        if (unz64reader_NameEqual(r->list.names+entry->name_offset,szFileName))
+            return entry;
+        slot = (slot+1) & r->table_mask;
+    }
+    return NULL;
+}
+
+/* Read the local header of an entry to find where its data starts */
+static int unz64reader_GetDataPos (const unz64_reader* r, const unz_entry* entry, ZPOS64_T* ppos)
+{
+    unsigned char header[SIZEZIPLOCALHEADER];
+    ZPOS64_T offset = entry->offset_curfile + r->list.byte_before_the_zipfile;
+    ZPOS64_T pos;
+    if (unz64reader_ReadAt(r,header,SIZEZIPLOCALHEADER,offset)!=SIZEZIPLOCALHEADER)
+        return UNZ_ERRNO;
+    if ((header[0]!=0x50) || (header[1]!=0x4b) || (header[2]!=0x03) || (header[3]!=0x04))
+        return UNZ_BADZIPFILE;
+    pos = offset + SIZEZIPLOCALHEADER + (header[26] | (header[27]<<8)) + (header[28] | (header[29]<<8));
+    if ((pos>r->size) || (entry->compressed_size>r->size-pos))
+        return UNZ_BADZIPFILE;
+    *ppos = pos;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzReaderGetEntryData (unzReader reader, const unz_entry* entry, const void** buf, ZPOS64_T* len)
+{
+    unz64_reader* r = (unz64_reader*)reader;
+    ZPOS64_T pos;
+    int err;
+    if ((r==NULL) || (entry==NULL) || (buf==NULL) || (len==NULL))
+        return UNZ_PARAMERROR;
+    if ((r->base==NULL) || (entry->compression_method!=0) || (entry->flag & 1))
+        return UNZ_NOTMAPPABLE;
+    if (entry->compressed_size!=entry->uncompressed_size)
+        return UNZ_BADZIPFILE;
+    err = unz64reader_GetDataPos(r,entry,&pos);
+    if (err!=UNZ_OK)
+        return err;
+    *buf = r->base+pos;
+    *len = entry->compressed_size;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzReaderExtractEntry (unzReader reader, const unz_entry* entry, voidp buf, ZPOS64_T len)
+{
+    unz64_reader* r = (unz64_reader*)reader;
+    const unsigned char* data;
+    ZPOS64_T rest;
+    ZPOS64_T pos;
+    uLong crc;
+    int err;
+    if ((r==NULL) || (entry==NULL) || ((buf==NULL) && (len>0)) || (len<entry->uncompressed_size))
+        return UNZ_PARAMERROR;
+    if (entry->flag & 1)
+        return UNZ_PARAMERROR;  /* encrypted entries need an unzFile and a password */
+    err = unz64reader_GetDataPos(r,entry,&pos);
+    if (err!=UNZ_OK)
+        return err;
+
+    if (entry->compression_method==0)
+    {
+        if (entry->compressed_size!=entry->uncompressed_size)
+            return UNZ_BADZIPFILE;
+        if (unz64reader_ReadAt(r,buf,entry->compressed_size,pos)!=entry->compressed_size)
+            return UNZ_ERRNO;
+    }
+#ifdef HAVE_ZSTD
+    else if ((entry->compression_method==Z_DEFLATED) || (entry->compression_method==Z_ZSTD))
+#else
+    else if (entry->compression_method==Z_DEFLATED)
+#endif
+    {
+        unsigned char* compressed = NULL;
+        if (r->base!=NULL)
+            data = r->base+pos;
+        else
+        {
+            if ((size_t)entry->compressed_size!=entry->compressed_size)
+                return UNZ_INTERNALERROR;
+            compressed = (unsigned char*)malloc(entry->compressed_size>0 ? (size_t)entry->compressed_size : 1);
+            if (compressed==NULL)
+                return UNZ_INTERNALERROR;
+            if (unz64reader_ReadAt(r,compressed,entry->compressed_size,pos)!=entry->compressed_size)
+            {
+                free(compressed);
+                return UNZ_ERRNO;
+            }
+            data = compressed;
+        }
+#ifdef HAVE_ZSTD
+        if (entry->compression_method==Z_ZSTD)
+        {
+            size_t size = ZSTD_decompress(buf,(size_t)entry->uncompressed_size,data,(size_t)entry->compressed_size);
+            err = (ZSTD_isError(size) || (size!=entry->uncompressed_size)) ? UNZ_BADZIPFILE : Z_OK;
+        }
+        else
+#endif
+        err = unzInflateBuffer(NULL,data,entry->compressed_size,buf,entry->uncompressed_size);
+        free(compressed);
+        if (err!=Z_OK)
+            return err;
+    }
+    else
+        return UNZ_BADZIPFILE;
+
+    crc = crc32(0L, Z_NULL, 0);
+    data = (const unsigned char*)buf;
+    rest = entry->uncompressed_size;
+    while (rest>0)  /* crc32() takes a uInt */
+    {
+        uInt chunk = rest>0x40000000 ? 0x40000000 : (uInt)rest;
+        crc = crc32(crc, data, chunk);
+        data += chunk;
+        rest -= chunk;
+    }
+    if (crc!=entry->crc)
+        return UNZ_CRCERROR;
+    return UNZ_OK;
+}
+
+extern void ZEXPORT unzReaderPrefetchEntry (unzReader reader, const unz_entry* entry)
+{
+    unz64_reader* r = (unz64_reader*)reader;
+    ZPOS64_T offset;
+    ZPOS64_T len;
+    if ((r==NULL) || (entry==NULL))
+        return;
+    offset = entry->offset_curfile + r->list.byte_before_the_zipfile;
+    if (offset>=r->size)
+        return;
+    len = SIZEZIPLOCALHEADER + entry->size_filename + UNZ_READER_EXTRASLACK + entry->compressed_size;
+    if (len>r->size-offset)
+        len = r->size-offset;
+    if (r->unmap)
+    {
+        uintptr_t page = (uintptr_t)getpagesize();
+        uintptr_t start = (uintptr_t)(r->base+offset) & ~(page-1);
+        madvise((void*)start,(size_t)((uintptr_t)(r->base+offset+len)-start),MADV_WILLNEED);
+    }
+    else if (r->fd>=0)
+    {
+#if defined(F_RDADVISE)
+        struct radvisory advisory;
+        advisory.ra_offset = (off_t)offset;
+        advisory.ra_count = len>INT_MAX ? INT_MAX : (int)len;
+        fcntl(r->fd,F_RDADVISE,&advisory);
+#elif defined(POSIX_FADV_WILLNEED)
+        posix_fadvise(r->fd,(off_t)offset,(off_t)len,POSIX_FADV_WILLNEED);
+#endif
+    }
+}
+
+/* Send up to len bytes to the sink, return UNZ_ERRNO if it gives up */
+static int unz64reader_Send (unz_reader_sink sink, voidpf opaque, const unsigned char* data, ZPOS64_T len, uLong* crc)
+{
+    while (len>0)
+    {
+        uLong chunk = len>UNZ_READER_CHUNKSIZE ? UNZ_READER_CHUNKSIZE : (uLong)len;
+        *crc = crc32(*crc,data,(uInt)chunk);
+        if (sink(opaque,data,chunk)!=0)
+            return UNZ_ERRNO;
+        data += chunk;
+        len -= chunk;
+    }
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzReaderReadEntry (unzReader reader, const unz_entry* entry, unz_reader_sink sink, voidpf opaque, ZPOS64_T max_len)
+{
+    unz64_reader* r = (unz64_reader*)reader;
+    unsigned char* in = NULL;
+    unsigned char* out = NULL;
+    ZPOS64_T want;
+    ZPOS64_T pos;
+    ZPOS64_T sent = 0;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    int err;
+    if ((r==NULL) || (entry==NULL) || (sink==NULL))
+        return UNZ_PARAMERROR;
+    if (entry->flag & 1)
+        return UNZ_PARAMERROR;
+    err = unz64reader_GetDataPos(r,entry,&pos);
+    if (err!=UNZ_OK)
+        return err;
+    want = entry->uncompressed_size<max_len ? entry->uncompressed_size : max_len;
+
+    if ((entry->compression_method!=0) && (entry->compression_method!=Z_DEFLATED)
+#ifdef HAVE_ZSTD
+        && (entry->compression_method!=Z_ZSTD)
+#endif
+        )
+        return UNZ_BADZIPFILE;
+    if ((entry->compression_method==0) && (entry->compressed_size!=entry->uncompressed_size))
+        return UNZ_BADZIPFILE;
+    if ((entry->compression_method==0) && (r->base!=NULL))
+        err = unz64reader_Send(sink,opaque,r->base+pos,want,&crc);  /* straight from the mapping */
+    else if (entry->compression_method==0)
+    {
+        in = (unsigned char*)malloc(UNZ_READER_CHUNKSIZE);
+        if (in==NULL)
+            return UNZ_INTERNALERROR;
+        while ((err==UNZ_OK) && (sent<want))
+        {
+            ZPOS64_T chunk = want-sent>UNZ_READER_CHUNKSIZE ? UNZ_READER_CHUNKSIZE : want-sent;
+            if (unz64reader_ReadAt(r,in,chunk,pos+sent)!=chunk)
+                err = UNZ_ERRNO;
+            else
+                err = unz64reader_Send(sink,opaque,in,chunk,&crc);
+            sent += chunk;
+        }
+    }
+#ifdef HAVE_ZSTD
+    else if (entry->compression_method==Z_ZSTD)
+    {
+        ZSTD_DStream* stream = ZSTD_createDStream();
+        ZSTD_inBuffer input = {NULL, 0, 0};
+        ZPOS64_T read = 0;
+        out = (unsigned char*)malloc(UNZ_READER_CHUNKSIZE);
+        if (r->base==NULL)
+            in = (unsigned char*)malloc(UNZ_READER_CHUNKSIZE);
+        if ((stream==NULL) || (out==NULL) || ((r->base==NULL) && (in==NULL)))
+            err = UNZ_INTERNALERROR;
+        while ((err==UNZ_OK) && (sent<want))
+        {
+            ZSTD_outBuffer output;
+            size_t zerr;
+            if ((input.pos==input.size) && (read<entry->compressed_size))
+            {
+                ZPOS64_T chunk = entry->compressed_size-read;
+                if (r->base!=NULL)
+                {
+                    if (chunk>0x40000000)
+                        chunk = 0x40000000;
+                    input.src = r->base+pos+read;
+                }
+                else
+                {
+                    if (chunk>UNZ_READER_CHUNKSIZE)
+                        chunk = UNZ_READER_CHUNKSIZE;
+                    if (unz64reader_ReadAt(r,in,chunk,pos+read)!=chunk)
+                    {
+                        err = UNZ_ERRNO;
+                        break;
+                    }
+                    input.src = in;
+                }
+                input.size = (size_t)chunk;
+                input.pos = 0;
+                read += chunk;
+            }
+            output.dst = out;
+            output.size = want-sent>UNZ_READER_CHUNKSIZE ? UNZ_READER_CHUNKSIZE : (size_t)(want-sent);
+            output.pos = 0;
+            zerr = ZSTD_decompressStream(stream,&output,&input);
+            if (ZSTD_isError(zerr))
+            {
+                err = UNZ_BADZIPFILE;
+                break;
+            }
+            if (output.pos==0)
+            {
+                if ((zerr==0) || ((input.pos==input.size) && (read==entry->compressed_size)))
+                {
+                    err = UNZ_BADZIPFILE;  /* truncated or shorter than announced */
+                    break;
+                }
+                continue;
+            }
+            err = unz64reader_Send(sink,opaque,out,(ZPOS64_T)output.pos,&crc);
+            sent += output.pos;
+        }
+        ZSTD_freeDStream(stream);
+    }
+#endif
+    else
+    {
+        z_stream stream;
+        ZPOS64_T read = 0;
+        memset(&stream,0,sizeof(z_stream));
+        if (inflateInit2(&stream,-MAX_WBITS)!=Z_OK)
+            return UNZ_INTERNALERROR;
+        out = (unsigned char*)malloc(UNZ_READER_CHUNKSIZE);
+        if (r->base==NULL)
+            in = (unsigned char*)malloc(UNZ_READER_CHUNKSIZE);
+        if ((out==NULL) || ((r->base==NULL) && (in==NULL)))
+            err = UNZ_INTERNALERROR;
+        while ((err==UNZ_OK) && (sent<want))
+        {
+            int zerr;
+            if ((stream.avail_in==0) && (read<entry->compressed_size))
+            {
+                ZPOS64_T chunk = entry->compressed_size-read;
+                if (r->base!=NULL)
+                {
+                    if (chunk>0x40000000)
+                        chunk = 0x40000000;
+                    stream.next_in = (Bytef*)(r->base+pos+read);
+                }
+                else
+                {
+                    if (chunk>UNZ_READER_CHUNKSIZE)
+                        chunk = UNZ_READER_CHUNKSIZE;
+                    if (unz64reader_ReadAt(r,in,chunk,pos+read)!=chunk)
+                    {
+                        err = UNZ_ERRNO;
+                        break;
+                    }
+                    stream.next_in = in;
+                }
+                stream.avail_in = (uInt)chunk;
+                read += chunk;
+            }
+            stream.next_out = out;
+            stream.avail_out = want-sent>UNZ_READER_CHUNKSIZE ? UNZ_READER_CHUNKSIZE : (uInt)(want-sent);
+            zerr = inflate(&stream,Z_SYNC_FLUSH);
+            if ((zerr!=Z_OK) && (zerr!=Z_STREAM_END))
+            {
+                err = zerr==Z_MEM_ERROR ? UNZ_INTERNALERROR : UNZ_BADZIPFILE;
+                break;
+            }
+            if (stream.next_out==out)
+            {
+                if ((zerr==Z_STREAM_END) || ((stream.avail_in==0) && (read==entry->compressed_size)))
+                {
+                    err = UNZ_BADZIPFILE;  /* truncated or shorter than announced */
+                    break;
+                }
+                continue;  /* only consumed block headers */
+            }
+            err = unz64reader_Send(sink,opaque,out,(ZPOS64_T)(stream.next_out-out),&crc);
+            sent += stream.next_out-out;
+        }
+        inflateEnd(&stream);
+    }
+    free(in);
+    free(out);
+    if ((err==UNZ_OK) && (want==entry->uncompressed_size) && (crc!=entry->crc))
+        return UNZ_CRCERROR;
+    return err;
+}
@@ -0,0 +1,133 @@
+/* unzreader.h -- Concurrent reader for .zip files
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+         An unzFile has a single current file and stream position, so it
+         cannot be used by two threads at once. An unzReader parses the
+         central directory once and then only reads the archive at explicit
+         offsets, with pread() from a single file descriptor or from a read
+         only mapping of the whole file, so any number of threads can
+         extract different (or the same) entries concurrently.
+*/
+
+#ifndef _unzreader_H
+#define _unzreader_H
+
+#include "unzip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef voidp unzReader;
+
+extern unzReader ZEXPORT unzReaderOpen OF((const char *path));
+/*
+  Open a zipfile for concurrent reads.
+  return NULL if the file cannot be opened or is not a valid zipfile
+*/
+
+extern unzReader ZEXPORT unzReaderOpenWithEntryList OF((const char *path,
+                      const unz_entry_list* list));
+/*
+  Same as unzReaderOpen but with the entries of a previous unzGetEntryList
+    or unzReaderGetEntryList on the same file, which are copied, so the
+    central directory is not read at all.
+  The list is trusted: the caller must make sure the file did not change.
+*/
+
+extern unzReader ZEXPORT unzReaderOpenSalvage OF((const char *path));
+/*
+  Same as unzReaderOpen for a zipfile without a usable central directory,
+    like an interrupted upload: the local headers are scanned forward with
+    the mapping or large reads, damaged bytes are skipped and the entries
+    are listed up to the first truncated one. Nothing is written.
+  The file_pos of the entries are not valid for unzGoToFilePos64.
+  return NULL if no complete entry was found
+*/
+
+extern unzReader ZEXPORT unzReaderOpenMemory OF((const void* buf,
+                      ZPOS64_T len));
+/*
+  Same as unzReaderOpen for a zipfile already in memory, which must stay
+    valid and unchanged until unzReaderClose.
+*/
+
+extern void ZEXPORT unzReaderClose OF((unzReader reader));
+/*
+  Close the reader, no other call may be in progress.
+  Pointers returned by unzReaderGetEntryData become invalid.
+*/
+
+extern const unz_entry_list* ZEXPORT unzReaderGetEntryList OF((unzReader reader));
+/*
+  Get the entries of the zipfile, owned by the reader and never modified.
+*/
+
+extern const unz_entry* ZEXPORT unzReaderLocateEntry OF((unzReader reader,
+                      const char *szFileName));
+/*
+  Find an entry by name (case sensitive, '\\' and '/' being the same
+    separator) with a hash table built at open time.
+  return NULL if there is no such entry
+*/
+
+extern int ZEXPORT unzReaderGetEntryData OF((unzReader reader,
+                      const unz_entry* entry,
+                      const void** buf,
+                      ZPOS64_T* len));
+/*
+  Same as unzGetCurrentFileMappedData without CRC check: only stored and not
+    encrypted entries of mapped zipfiles can be accessed in place.
+  return UNZ_NOTMAPPABLE if the entry must be read with unzReaderExtractEntry
+*/
+
+extern int ZEXPORT unzReaderExtractEntry OF((unzReader reader,
+                      const unz_entry* entry,
+                      voidp buf,
+                      ZPOS64_T len));
+/*
+  Decompress a whole stored, deflated or zstd (HAVE_ZSTD) entry into buf, which must be at
+    least as large as its uncompressed_size, and check its CRC.
+  return UNZ_OK if the whole entry was extracted
+  return <0 with error code if there is an error
+*/
+
+extern void ZEXPORT unzReaderPrefetchEntry OF((unzReader reader,
+                      const unz_entry* entry));
+/*
+  Hint that an entry is about to be read so the system fetches its local
+    header and compressed data in the background, with madvise() on the
+    mapping or posix_fadvise() (F_RDADVISE on Darwin) on the file.
+  Never blocks on the storage nor fails, only an advice to the page cache.
+*/
+
+typedef int (ZCALLBACK *unz_reader_sink) OF((voidpf opaque, const void* buf, uLong size));
+/*
+  Receive size bytes of uncompressed data, return 0 to get the rest.
+  Any other value stops unzReaderReadEntry, which returns UNZ_ERRNO.
+*/
+
+extern int ZEXPORT unzReaderReadEntry OF((unzReader reader,
+                      const unz_entry* entry,
+                      unz_reader_sink sink,
+                      voidpf opaque,
+                      ZPOS64_T max_len));
+/*
+  Decompress the first max_len bytes of a stored, deflated or zstd entry, or all
+    of it if it is shorter, and send them in order to sink in chunks of at
+    most 64KB, without a buffer for the whole entry. Stored entries of a
+    mapped zipfile are sent straight from the mapping. The CRC is only
+    checked if the whole entry was read.
+  return UNZ_OK if the requested bytes were sent
+  return <0 with error code if there is an error
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
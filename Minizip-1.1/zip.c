@@ -133,6 +133,9 @@ typedef struct
 #ifdef HAVE_BZIP2
     bz_stream bstream;          /* bzLib stream structure for bziped */
 #endif
+#ifdef HAVE_ZSTD_COMPRESS
+    ZSTD_CStream* zstream;      /* zstd stream for method 93 */
+#endif
 
     int  stream_initialised;    /* 1 is stream is initialised */
     uInt pos_in_buffered_data;  /* last written byte in buffered_data */
@@ -968,6 +971,8 @@ int Write_LocalFileHeader(zip64_internal* zi, const char* filename, uInt size_ex
   {
     if(zi->ci.zip64)
       err = zip64local_putValue(&zi->z_filefunc,zi->filestream,(uLong)45,2);/* version needed to extract */
+    else if(zi->ci.method == Z_ZSTD)
+      err = zip64local_putValue(&zi->z_filefunc,zi->filestream,(uLong)63,2);/* version needed to extract */
     else
       err = zip64local_putValue(&zi->z_filefunc,zi->filestream,(uLong)20,2);/* version needed to extract */
   }
@@ -1074,13 +1079,23 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     if (file == NULL)
         return ZIP_PARAMERROR;
 
-#ifdef HAVE_BZIP2
+#if defined(HAVE_BZIP2) && defined(HAVE_ZSTD)
+    if ((method!=0) && (method!=Z_DEFLATED) && (method!=Z_BZIP2ED) && (method!=Z_ZSTD))
+      return ZIP_PARAMERROR;
+#elif defined(HAVE_BZIP2)
     if ((method!=0) && (method!=Z_DEFLATED) && (method!=Z_BZIP2ED))
       return ZIP_PARAMERROR;
+#elif defined(HAVE_ZSTD)
+    if ((method!=0) && (method!=Z_DEFLATED) && (method!=Z_ZSTD))
+      return ZIP_PARAMERROR;
 #else
     if ((method!=0) && (method!=Z_DEFLATED))
       return ZIP_PARAMERROR;
 #endif
+#if defined(HAVE_ZSTD) && !defined(HAVE_ZSTD_COMPRESS)
+    if ((method==Z_ZSTD) && (!raw))
+      return ZIP_PARAMERROR; /* zstd entries can only be copied raw without the compressor */
+#endif
 
     zi = (zip64_internal*)file;
 
@@ -1138,7 +1153,7 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     zip64local_putValue_inmemory(zi->ci.central_header,(uLong)CENTRALHEADERMAGIC,4);
     /* version info */
     zip64local_putValue_inmemory(zi->ci.central_header+4,(uLong)versionMadeBy,2);
-    zip64local_putValue_inmemory(zi->ci.central_header+6,(uLong)20,2);
+    zip64local_putValue_inmemory(zi->ci.central_header+6,(uLong)(method == Z_ZSTD ? 63 : 20),2);
     zip64local_putValue_inmemory(zi->ci.central_header+8,(uLong)zi->ci.flag,2);
     zip64local_putValue_inmemory(zi->ci.central_header+10,(uLong)zi->ci.method,2);
     zip64local_putValue_inmemory(zi->ci.central_header+12,(uLong)zi->ci.dosDate,4);
@@ -1237,6 +1252,17 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
         }
 
     }
+#ifdef HAVE_ZSTD_COMPRESS
+    else if ((err==ZIP_OK) && (zi->ci.method == Z_ZSTD) && (!zi->ci.raw))
+    {
+        /* the zlib stream fields keep the buffer positions and totals so the flushing stays shared */
+        zi->ci.zstream = ZSTD_createCStream();
+        if ((zi->ci.zstream == NULL) || ZSTD_isError(ZSTD_initCStream(zi->ci.zstream, level == Z_DEFAULT_COMPRESSION ? ZSTD_CLEVEL_DEFAULT : level)))
+            err = ZIP_INTERNALERROR;
+        else
+            zi->ci.stream_initialised = Z_ZSTD;
+    }
+#endif
 
 #    ifndef NOCRYPT
     zi->ci.crypt_header_size = 0;
@@ -1410,7 +1436,8 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
     if (zi->in_opened_file_inzip == 0)
         return ZIP_PARAMERROR;
 
-    zi->ci.crc32 = crc32(zi->ci.crc32,buf,(uInt)len);
+    if (!zi->ci.raw)  /* the caller passes the CRC to zipCloseFileInZipRaw */
+        zi->ci.crc32 = crc32(zi->ci.crc32,buf,(uInt)len);
 
 #ifdef HAVE_BZIP2
     if(zi->ci.method == Z_BZIP2ED && (!zi->ci.raw))
@@ -1466,6 +1493,30 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
           if(err != ZIP_OK)
               break;
 
+#ifdef HAVE_ZSTD_COMPRESS
+          if ((zi->ci.method == Z_ZSTD) && (!zi->ci.raw))
+          {
+              ZSTD_inBuffer input;
+              ZSTD_outBuffer output;
+              input.src = zi->ci.stream.next_in;
+              input.size = zi->ci.stream.avail_in;
+              input.pos = 0;
+              output.dst = zi->ci.stream.next_out;
+              output.size = zi->ci.stream.avail_out;
+              output.pos = 0;
+              if (ZSTD_isError(ZSTD_compressStream(zi->ci.zstream, &output, &input)))
+                  err = ZIP_INTERNALERROR;
+
+              zi->ci.stream.next_in += input.pos;
+              zi->ci.stream.avail_in -= (uInt)input.pos;
+              zi->ci.stream.total_in += (uLong)input.pos;
+              zi->ci.stream.next_out += output.pos;
+              zi->ci.stream.avail_out -= (uInt)output.pos;
+              zi->ci.stream.total_out += (uLong)output.pos;
+              zi->ci.pos_in_buffered_data += (uInt)output.pos;
+          }
+          else
+#endif
           if ((zi->ci.method == Z_DEFLATED) && (!zi->ci.raw))
           {
               uLong uTotalOutBefore = zi->ci.stream.total_out;
@@ -1480,15 +1531,13 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
           }
           else
           {
-              uInt copy_this,i;
+              uInt copy_this;
               if (zi->ci.stream.avail_in < zi->ci.stream.avail_out)
                   copy_this = zi->ci.stream.avail_in;
               else
                   copy_this = zi->ci.stream.avail_out;
 
-              for (i = 0; i < copy_this; i++)
-                  *(((char*)zi->ci.stream.next_out)+i) =
-                      *(((const char*)zi->ci.stream.next_in)+i);
+              memcpy(zi->ci.stream.next_out,zi->ci.stream.next_in,copy_this);
               {
                   zi->ci.stream.avail_in -= copy_this;
                   zi->ci.stream.avail_out-= copy_this;
@@ -1569,6 +1618,34 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
         err = ZIP_OK;
 #endif
     }
+#ifdef HAVE_ZSTD_COMPRESS
+    else if ((zi->ci.method == Z_ZSTD) && (!zi->ci.raw))
+    {
+        size_t remaining = 1;
+        while ((err==ZIP_OK) && (remaining != 0))
+        {
+            ZSTD_outBuffer output;
+            if (zi->ci.stream.avail_out == 0)
+            {
+                if (zip64FlushWriteBuffer(zi) == ZIP_ERRNO)
+                    err = ZIP_ERRNO;
+                zi->ci.stream.avail_out = (uInt)Z_BUFSIZE;
+                zi->ci.stream.next_out = zi->ci.buffered_data;
+            }
+            output.dst = zi->ci.stream.next_out;
+            output.size = zi->ci.stream.avail_out;
+            output.pos = 0;
+            remaining = ZSTD_endStream(zi->ci.zstream, &output);
+            if (ZSTD_isError(remaining))
+                err = ZIP_INTERNALERROR;
+
+            zi->ci.stream.next_out += output.pos;
+            zi->ci.stream.avail_out -= (uInt)output.pos;
+            zi->ci.stream.total_out += (uLong)output.pos;
+            zi->ci.pos_in_buffered_data += (uInt)output.pos;
+        }
+    }
+#endif
 
     if (err==Z_STREAM_END)
         err=ZIP_OK; /* this is normal */
@@ -1595,6 +1672,13 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
                         zi->ci.stream_initialised = 0;
     }
 #endif
+#ifdef HAVE_ZSTD_COMPRESS
+    else if((zi->ci.method == Z_ZSTD) && (!zi->ci.raw))
+    {
+        ZSTD_freeCStream(zi->ci.zstream);
+        zi->ci.stream_initialised = 0;
+    }
+#endif
 
     if (!zi->ci.raw)
     {
@@ -58,7 +58,12 @@ extern "C" {
 #include "bzlib.h"
 #endif
 
+#ifdef HAVE_ZSTD
+#include "zstd.h"
+#endif
+
 #define Z_BZIP2ED 12
+#define Z_ZSTD 93   /* APPNOTE 6.3.8, a single zstd frame per entry, compressing needs HAVE_ZSTD_COMPRESS */
 
 #if defined(STRICTZIP) || defined(STRICTZIPUNZIP)
 /* like the STRICT of WIN32, we define a pointer that cannot be converted
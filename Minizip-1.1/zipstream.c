@@ -0,0 +1,487 @@
+/* zipstream.c -- Seek-free streaming writer for .zip files
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "zipstream.h"
+
+#ifndef Z_BUFSIZE
+#define Z_BUFSIZE (64*1024)
+#endif
+
+#ifndef VERSIONMADEBY
+# define VERSIONMADEBY   (0x0) /* platform depedent */
+#endif
+
+#define LOCALHEADERMAGIC    (0x04034b50)
+#define CENTRALHEADERMAGIC  (0x02014b50)
+#define DESCRIPTORMAGIC     (0x08074b50)
+#define ENDHEADERMAGIC      (0x06054b50)
+#define ZIP64ENDHEADERMAGIC      (0x6064b50)
+#define ZIP64ENDLOCHEADERMAGIC   (0x7064b50)
+
+#define SIZEZIPLOCALHEADER (0x1e)
+#define SIZECENTRALHEADER (0x2e)
+#define SIZEZIP64EXTRA (4+8+8+8)
+#define MAXUINT32 (0xffffffff)
+
+typedef struct
+{
+    zip_stream_func sink;
+    voidpf opaque;
+    int err;                    /* sticky, set once the sink failed */
+    ZPOS64_T offset;            /* bytes sent to the sink */
+    Bytef buffered_data[Z_BUFSIZE];
+    uInt pos_in_buffered_data;
+
+    Bytef* central_dir;         /* central directory records so far */
+    ZPOS64_T size_central_dir;
+    ZPOS64_T alloc_central_dir;
+    ZPOS64_T number_entry;
+
+    int in_opened_file;
+    int raw;
+    int method;
+    int flag;
+    uLong dosDate;
+    uLong internal_fa;
+    uLong external_fa;
+    char* filename;
+    ZPOS64_T pos_local_header;
+    uLong crc32;
+    ZPOS64_T compressed_size;
+    ZPOS64_T uncompressed_size;
+    ZPOS64_T raw_size;          /* compressed size announced for raw entries */
+    z_stream stream;
+    int stream_initialised;
+} zip64_stream;
+
+static void zip64stream_PutValue (Bytef* dest, ZPOS64_T x, int nbByte)
+{
+    int n;
+    for (n = 0; n < nbByte; n++)
+    {
+        dest[n] = (Bytef)(x & 0xff);
+        x >>= 8;
+    }
+}
+
+static uLong zip64stream_TmzDateToDosDate (const tm_zip* ptm)
+{
+    uLong year = (uLong)ptm->tm_year;
+    if (year>=1980)
+        year-=1980;
+    else if (year>=80)
+        year-=80;
+    return
+      (uLong) (((ptm->tm_mday) + (32 * (ptm->tm_mon+1)) + (512 * year)) << 16) |
+        ((ptm->tm_sec/2) + (32* ptm->tm_min) + (2048 * (uLong)ptm->tm_hour));
+}
+
+static int zip64stream_Flush (zip64_stream* zs)
+{
+    if ((zs->err==ZIP_OK) && (zs->pos_in_buffered_data>0) &&
+        (zs->sink(zs->opaque,zs->buffered_data,zs->pos_in_buffered_data)!=0))
+        zs->err = ZIP_ERRNO;
+    zs->offset += zs->pos_in_buffered_data;
+    zs->pos_in_buffered_data = 0;
+    return zs->err;
+}
+
+/* Large writes skip the buffer once it is empty */
+static int zip64stream_Write (zip64_stream* zs, const void* buf, uLong len)
+{
+    const Bytef* data = (const Bytef*)buf;
+    while ((zs->err==ZIP_OK) && (len>0))
+    {
+        uLong copy;
+        if ((zs->pos_in_buffered_data==0) && (len>=Z_BUFSIZE))
+        {
+            if (zs->sink(zs->opaque,data,len)!=0)
+                zs->err = ZIP_ERRNO;
+            zs->offset += len;
+            break;
+        }
+        copy = Z_BUFSIZE - zs->pos_in_buffered_data;
+        if (copy>len)
+            copy = len;
+        memcpy(zs->buffered_data + zs->pos_in_buffered_data,data,copy);
+        zs->pos_in_buffered_data += (uInt)copy;
+        data += copy;
+        len -= copy;
+        if (zs->pos_in_buffered_data==Z_BUFSIZE)
+            zip64stream_Flush(zs);
+    }
+    return zs->err;
+}
+
+static Bytef* zip64stream_AddCentralRecord (zip64_stream* zs, ZPOS64_T size)
+{
+    Bytef* record;
+    if (zs->size_central_dir + size > zs->alloc_central_dir)
+    {
+        ZPOS64_T alloc = zs->alloc_central_dir ? zs->alloc_central_dir * 2 : 4096;
+        Bytef* central_dir;
+        while (alloc < zs->size_central_dir + size)
+            alloc *= 2;
+        central_dir = (Bytef*)realloc(zs->central_dir,(size_t)alloc);
+        if (central_dir==NULL)
+            return NULL;
+        zs->central_dir = central_dir;
+        zs->alloc_central_dir = alloc;
+    }
+    record = zs->central_dir + zs->size_central_dir;
+    zs->size_central_dir += size;
+    return record;
+}
+
+static int zip64stream_OpenNewFile (zip64_stream* zs, const char* filename, const zip_fileinfo* zipfi,
+                                    int method, int level, int raw)
+{
+    if (zs->in_opened_file)
+    {
+        int err = zipStreamCloseFile(zs);
+        if (err!=ZIP_OK)
+            return err;
+    }
+    if (zs->err!=ZIP_OK)
+        return zs->err;
+    if ((method!=0) && (method!=Z_DEFLATED) && !raw)
+        return ZIP_PARAMERROR;
+    if (filename==NULL)
+        filename = "-";
+    if (strlen(filename)>0xffff)
+        return ZIP_PARAMERROR;
+
+    zs->filename = (char*)malloc(strlen(filename)+1);
+    if (zs->filename==NULL)
+        return ZIP_INTERNALERROR;
+    strcpy(zs->filename,filename);
+    if (zipfi==NULL)
+    {
+        zs->dosDate = 0;
+        zs->internal_fa = 0;
+        zs->external_fa = 0;
+    }
+    else
+    {
+        zs->dosDate = zipfi->dosDate!=0 ? zipfi->dosDate : zip64stream_TmzDateToDosDate(&zipfi->tmz_date);
+        zs->internal_fa = zipfi->internal_fa;
+        zs->external_fa = zipfi->external_fa;
+    }
+    zs->flag = raw ? 0 : 8;  /* sizes and CRC come in the data descriptor */
+    if (method==Z_DEFLATED)
+    {
+        if ((level==8) || (level==9))
+          zs->flag |= 2;
+        if ((level==2))
+          zs->flag |= 4;
+        if ((level==1))
+          zs->flag |= 6;
+    }
+    zs->method = method;
+    zs->raw = raw;
+    zs->crc32 = 0;
+    zs->compressed_size = 0;
+    zs->uncompressed_size = 0;
+    zs->pos_local_header = zs->offset + zs->pos_in_buffered_data;
+    zs->in_opened_file = 1;
+
+    if ((method==Z_DEFLATED) && !raw)
+    {
+        memset(&zs->stream,0,sizeof(z_stream));
+        if (deflateInit2(&zs->stream,level,Z_DEFLATED,-MAX_WBITS,8,Z_DEFAULT_STRATEGY)!=Z_OK)
+            return ZIP_INTERNALERROR;
+        zs->stream_initialised = 1;
+    }
+    return ZIP_OK;
+}
+
+static int zip64stream_WriteLocalHeader (zip64_stream* zs, uLong crc, ZPOS64_T compressed_size, ZPOS64_T uncompressed_size)
+{
+    Bytef header[SIZEZIPLOCALHEADER + SIZEZIP64EXTRA];
+    uInt size_filename = (uInt)strlen(zs->filename);
+    int zip64 = (compressed_size>=MAXUINT32) || (uncompressed_size>=MAXUINT32);
+    uInt size_extra = zip64 ? 4+8+8 : 0;
+
+    zip64stream_PutValue(header,LOCALHEADERMAGIC,4);
+    zip64stream_PutValue(header+4,zip64 ? 45 : 20,2);
+    zip64stream_PutValue(header+6,zs->flag,2);
+    zip64stream_PutValue(header+8,zs->method,2);
+    zip64stream_PutValue(header+10,zs->dosDate,4);
+    zip64stream_PutValue(header+14,crc,4);
+    zip64stream_PutValue(header+18,zip64 ? MAXUINT32 : compressed_size,4);
+    zip64stream_PutValue(header+22,zip64 ? MAXUINT32 : uncompressed_size,4);
+    zip64stream_PutValue(header+26,size_filename,2);
+    zip64stream_PutValue(header+28,size_extra,2);
+    zip64stream_Write(zs,header,SIZEZIPLOCALHEADER);
+    zip64stream_Write(zs,zs->filename,size_filename);
+    if (zip64)
+    {
+        zip64stream_PutValue(header,0x0001,2);
+        zip64stream_PutValue(header+2,8+8,2);
+        zip64stream_PutValue(header+4,uncompressed_size,8);
+        zip64stream_PutValue(header+12,compressed_size,8);
+        zip64stream_Write(zs,header,size_extra);
+    }
+    return zs->err;
+}
+
+extern zipStream ZEXPORT zipStreamOpen (zip_stream_func sink, voidpf opaque)
+{
+    zip64_stream* zs;
+    if (sink==NULL)
+        return NULL;
+    zs = (zip64_stream*)malloc(sizeof(zip64_stream));
+    if (zs==NULL)
+        return NULL;
+    memset(zs,0,sizeof(zip64_stream));
+    zs->sink = sink;
+    zs->opaque = opaque;
+    return zs;
+}
+
+extern int ZEXPORT zipStreamOpenNewFile (zipStream stream, const char* filename, const zip_fileinfo* zipfi, int method, int level)
+{
+    zip64_stream* zs = (zip64_stream*)stream;
+    int err;
+    if (zs==NULL)
+        return ZIP_PARAMERROR;
+    err = zip64stream_OpenNewFile(zs,filename,zipfi,method,level,0);
+    if (err==ZIP_OK)
+        err = zip64stream_WriteLocalHeader(zs,0,0,0);
+    return err;
+}
+
+extern int ZEXPORT zipStreamOpenNewFileRaw (zipStream stream, const char* filename, const zip_fileinfo* zipfi, int method, int level,
+                                             uLong crc, ZPOS64_T compressed_size, ZPOS64_T uncompressed_size)
+{
+    zip64_stream* zs = (zip64_stream*)stream;
+    int err;
+    if (zs==NULL)
+        return ZIP_PARAMERROR;
+    err = zip64stream_OpenNewFile(zs,filename,zipfi,method,level,1);
+    if (err==ZIP_OK)
+    {
+        zs->crc32 = crc;
+        zs->uncompressed_size = uncompressed_size;
+        zs->raw_size = compressed_size;
+        err = zip64stream_WriteLocalHeader(zs,crc,compressed_size,uncompressed_size);
+    }
+    return err;
+}
+
+/* Deflate what is in the stream, until it is finished if flush is Z_FINISH */
+static int zip64stream_Deflate (zip64_stream* zs, int flush)
+{
+    for (;;)
+    {
+        Bytef out[Z_BUFSIZE];
+        int err;
+        zs->stream.next_out = out;
+        zs->stream.avail_out = sizeof(out);
+        err = deflate(&zs->stream,flush);
+        if ((err!=Z_OK) && (err!=Z_STREAM_END) && (err!=Z_BUF_ERROR))
+            return ZIP_INTERNALERROR;
+        zs->compressed_size += sizeof(out) - zs->stream.avail_out;
+        if (zip64stream_Write(zs,out,sizeof(out) - zs->stream.avail_out)!=ZIP_OK)
+            return zs->err;
+        if ((flush==Z_FINISH) ? (err==Z_STREAM_END) : (zs->stream.avail_in==0 && zs->stream.avail_out!=0))
+            return ZIP_OK;
+    }
+}
+
+extern int ZEXPORT zipStreamWriteInFile (zipStream stream, const void* buf, unsigned len)
+{
+    zip64_stream* zs = (zip64_stream*)stream;
+    if ((zs==NULL) || !zs->in_opened_file)
+        return ZIP_PARAMERROR;
+    if (zs->err!=ZIP_OK)
+        return zs->err;
+    if (zs->raw)
+    {
+        zs->compressed_size += len;
+        return zip64stream_Write(zs,buf,len);
+    }
+    if (zs->uncompressed_size + len >= MAXUINT32)
+        return ZIP_PARAMERROR;  /* the local header has no zip64 extra field */
+    zs->crc32 = crc32(zs->crc32,(const Bytef*)buf,len);
+    zs->uncompressed_size += len;
+    if (zs->method!=Z_DEFLATED)
+    {
+        zs->compressed_size += len;
+        return zip64stream_Write(zs,buf,len);
+    }
+    zs->stream.next_in = (Bytef*)buf;
+    zs->stream.avail_in = len;
+    return zip64stream_Deflate(zs,Z_NO_FLUSH);
+}
+
+extern ZPOS64_T ZEXPORT zipStreamGetOffset (zipStream stream)
+{
+    zip64_stream* zs = (zip64_stream*)stream;
+    if (zs==NULL)
+        return 0;
+    return zs->offset + zs->pos_in_buffered_data;
+}
+
+extern int ZEXPORT zipStreamCloseFile (zipStream stream)
+{
+    zip64_stream* zs = (zip64_stream*)stream;
+    int err = ZIP_OK;
+    Bytef* record;
+    uInt size_filename;
+    uInt size_extra = 0;
+
+    if ((zs==NULL) || !zs->in_opened_file)
+        return ZIP_PARAMERROR;
+    if (zs->stream_initialised)
+    {
+        zs->stream.next_in = NULL;
+        zs->stream.avail_in = 0;
+        err = zip64stream_Deflate(zs,Z_FINISH);
+        deflateEnd(&zs->stream);
+        zs->stream_initialised = 0;
+    }
+    if ((err==ZIP_OK) && zs->raw && (zs->compressed_size!=zs->raw_size))
+        err = ZIP_PARAMERROR;  /* the local header would be wrong */
+
+    /* Readers only expect a zip64 data descriptor after a local header with a
+       zip64 extra field, which entries of unknown size do not have */
+    if ((err==ZIP_OK) && !zs->raw && (zs->compressed_size>=MAXUINT32))
+        err = zs->err = ZIP_PARAMERROR;  /* deflate expanded the data past 4 GB */
+    if ((err==ZIP_OK) && !zs->raw)
+    {
+        Bytef descriptor[4+4+4+4];
+        zip64stream_PutValue(descriptor,DESCRIPTORMAGIC,4);
+        zip64stream_PutValue(descriptor+4,zs->crc32,4);
+        zip64stream_PutValue(descriptor+8,zs->compressed_size,4);
+        zip64stream_PutValue(descriptor+12,zs->uncompressed_size,4);
+        err = zip64stream_Write(zs,descriptor,16);
+    }
+
+    /* Only the fields that overflow go in the zip64 extra field, in this order */
+    if (zs->uncompressed_size>=MAXUINT32)
+        size_extra += 8;
+    if (zs->compressed_size>=MAXUINT32)
+        size_extra += 8;
+    if (zs->pos_local_header>=MAXUINT32)
+        size_extra += 8;
+    if (size_extra>0)
+        size_extra += 4;
+    size_filename = (uInt)strlen(zs->filename);
+    record = err==ZIP_OK ? zip64stream_AddCentralRecord(zs,SIZECENTRALHEADER + size_filename + size_extra) : NULL;
+    if (record!=NULL)
+    {
+        Bytef* extra = record + SIZECENTRALHEADER + size_filename;
+        zip64stream_PutValue(record,CENTRALHEADERMAGIC,4);
+        zip64stream_PutValue(record+4,VERSIONMADEBY | (size_extra ? 45 : 20),2);
+        zip64stream_PutValue(record+6,size_extra ? 45 : 20,2);
+        zip64stream_PutValue(record+8,zs->flag,2);
+        zip64stream_PutValue(record+10,zs->method,2);
+        zip64stream_PutValue(record+12,zs->dosDate,4);
+        zip64stream_PutValue(record+16,zs->crc32,4);
+        zip64stream_PutValue(record+20,zs->compressed_size>=MAXUINT32 ? MAXUINT32 : zs->compressed_size,4);
+        zip64stream_PutValue(record+24,zs->uncompressed_size>=MAXUINT32 ? MAXUINT32 : zs->uncompressed_size,4);
+        zip64stream_PutValue(record+28,size_filename,2);
+        zip64stream_PutValue(record+30,size_extra,2);
+        zip64stream_PutValue(record+32,0,2); /* comment */
+        zip64stream_PutValue(record+34,0,2); /* disk nm start */
+        zip64stream_PutValue(record+36,zs->internal_fa,2);
+        zip64stream_PutValue(record+38,zs->external_fa,4);
+        zip64stream_PutValue(record+42,zs->pos_local_header>=MAXUINT32 ? MAXUINT32 : zs->pos_local_header,4);
+        memcpy(record+SIZECENTRALHEADER,zs->filename,size_filename);
+        if (size_extra>0)
+        {
+            zip64stream_PutValue(extra,0x0001,2);
+            zip64stream_PutValue(extra+2,size_extra-4,2);
+            extra += 4;
+            if (zs->uncompressed_size>=MAXUINT32)
+            {
+                zip64stream_PutValue(extra,zs->uncompressed_size,8);
+                extra += 8;
+            }
+            if (zs->compressed_size>=MAXUINT32)
+            {
+                zip64stream_PutValue(extra,zs->compressed_size,8);
+                extra += 8;
+            }
+            if (zs->pos_local_header>=MAXUINT32)
+                zip64stream_PutValue(extra,zs->pos_local_header,8);
+        }
+        zs->number_entry++;
+    }
+    else if (err==ZIP_OK)
+        err = ZIP_INTERNALERROR;
+
+    free(zs->filename);
+    zs->filename = NULL;
+    zs->in_opened_file = 0;
+    return err;
+}
+
+extern int ZEXPORT zipStreamClose (zipStream stream, const char* global_comment)
+{
+    zip64_stream* zs = (zip64_stream*)stream;
+    int err = ZIP_OK;
+    ZPOS64_T pos_central_dir;
+    uInt size_comment = global_comment!=NULL ? (uInt)strlen(global_comment) : 0;
+    Bytef end[56+20+22];
+    uInt size_end = 0;
+
+    if (zs==NULL)
+        return ZIP_PARAMERROR;
+    if (zs->in_opened_file)
+        err = zipStreamCloseFile(zs);
+    if (size_comment>0xffff)
+        size_comment = 0xffff;
+
+    pos_central_dir = zs->offset + zs->pos_in_buffered_data;
+    if (err==ZIP_OK)
+        err = zip64stream_Write(zs,zs->central_dir,(uLong)zs->size_central_dir);
+    if ((zs->number_entry>=0xffff) || (pos_central_dir>=MAXUINT32) || (zs->size_central_dir>=MAXUINT32))
+    {
+        ZPOS64_T pos_zip64_end = pos_central_dir + zs->size_central_dir;
+        zip64stream_PutValue(end,ZIP64ENDHEADERMAGIC,4);
+        zip64stream_PutValue(end+4,56-12,8); /* size of the rest of the record */
+        zip64stream_PutValue(end+12,45,2);   /* version made by */
+        zip64stream_PutValue(end+14,45,2);   /* version needed */
+        zip64stream_PutValue(end+16,0,4);    /* number of this disk */
+        zip64stream_PutValue(end+20,0,4);    /* disk with the central directory */
+        zip64stream_PutValue(end+24,zs->number_entry,8);
+        zip64stream_PutValue(end+32,zs->number_entry,8);
+        zip64stream_PutValue(end+40,zs->size_central_dir,8);
+        zip64stream_PutValue(end+48,pos_central_dir,8);
+        zip64stream_PutValue(end+56,ZIP64ENDLOCHEADERMAGIC,4);
+        zip64stream_PutValue(end+60,0,4);
+        zip64stream_PutValue(end+64,pos_zip64_end,8);
+        zip64stream_PutValue(end+72,1,4);    /* total number of disks */
+        size_end = 56+20;
+    }
+    zip64stream_PutValue(end+size_end,ENDHEADERMAGIC,4);
+    zip64stream_PutValue(end+size_end+4,0,2);
+    zip64stream_PutValue(end+size_end+6,0,2);
+    zip64stream_PutValue(end+size_end+8,zs->number_entry>=0xffff ? 0xffff : zs->number_entry,2);
+    zip64stream_PutValue(end+size_end+10,zs->number_entry>=0xffff ? 0xffff : zs->number_entry,2);
+    zip64stream_PutValue(end+size_end+12,zs->size_central_dir>=MAXUINT32 ? MAXUINT32 : zs->size_central_dir,4);
+    zip64stream_PutValue(end+size_end+16,pos_central_dir>=MAXUINT32 ? MAXUINT32 : pos_central_dir,4);
+    zip64stream_PutValue(end+size_end+20,size_comment,2);
+    size_end += 22;
+    if (err==ZIP_OK)
+        err = zip64stream_Write(zs,end,size_end);
+    if (err==ZIP_OK)
+        err = zip64stream_Write(zs,global_comment,size_comment);
+    if (err==ZIP_OK)
+        err = zip64stream_Flush(zs);
+
+    free(zs->central_dir);
+    free(zs);
+    return err;
+}
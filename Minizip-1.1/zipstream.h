@@ -0,0 +1,98 @@
+/* zipstream.h -- Seek-free streaming writer for .zip files
+     part of the MiniZip project - ( http://www.winimage.com/zLibDll/minizip.html )
+
+         Copyright (C) 1998-2010 Gilles Vollant (minizip) ( http://www.winimage.com/zLibDll/minizip.html )
+
+         For more info read MiniZip_info.txt
+
+         zip.c seeks back into the local header to write the CRC and sizes
+         of an entry once it is closed, so it needs a seekable file. A
+         zipStream never goes back: entries of unknown size have general
+         purpose bit 3 set and are followed by a data descriptor, and the
+         output is sent in order to a callback, like a socket, with at most
+         Z_BUFSIZE bytes buffered. Only the central directory records
+         (about 50 bytes plus the name per entry) are kept until the end.
+         Entries copied from another zipfile with unzOpenCurrentFile2 in raw
+         mode pass through without being recompressed.
+*/
+
+#ifndef _zipstream_H
+#define _zipstream_H
+
+#include "zip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef voidp zipStream;
+
+typedef int (ZCALLBACK *zip_stream_func) OF((voidpf opaque, const void* buf, uLong size));
+/*
+  Send size bytes of output, return 0 if they were all written.
+  Any other value aborts the stream: every later call returns ZIP_ERRNO.
+*/
+
+extern zipStream ZEXPORT zipStreamOpen OF((zip_stream_func sink, voidpf opaque));
+/*
+  Create a zipfile written to sink.
+  return NULL if there is not enough memory
+*/
+
+extern int ZEXPORT zipStreamOpenNewFile OF((zipStream stream,
+                      const char* filename,
+                      const zip_fileinfo* zipfi,
+                      int method,
+                      int level));
+/*
+  Open an entry of unknown size to write with zipStreamWriteInFile.
+  method is Z_DEFLATED or 0 to store, zipfi may be NULL.
+  The entry must stay under 4 GB: its local header is written before its
+    size is known, without a zip64 extra field.
+*/
+
+extern int ZEXPORT zipStreamOpenNewFileRaw OF((zipStream stream,
+                      const char* filename,
+                      const zip_fileinfo* zipfi,
+                      int method,
+                      int level,
+                      uLong crc,
+                      ZPOS64_T compressed_size,
+                      ZPOS64_T uncompressed_size));
+/*
+  Open an entry whose data are already compressed with method, like the
+    raw data of an unzip.c entry, so its CRC and sizes go in the local
+    header. Exactly compressed_size bytes must then be written.
+*/
+
+extern int ZEXPORT zipStreamWriteInFile OF((zipStream stream,
+                      const void* buf,
+                      unsigned len));
+/*
+  Write data in the current entry, compressed unless it is raw.
+  return ZIP_PARAMERROR if an entry of unknown size would reach 4 GB
+*/
+
+extern ZPOS64_T ZEXPORT zipStreamGetOffset OF((zipStream stream));
+/*
+  Get the number of bytes of output so far, including buffered bytes.
+*/
+
+extern int ZEXPORT zipStreamCloseFile OF((zipStream stream));
+/*
+  Close the current entry, writing its data descriptor if needed.
+*/
+
+extern int ZEXPORT zipStreamClose OF((zipStream stream,
+                      const char* global_comment));
+/*
+  Close the current entry if any, write the central directory, flush the
+    output and free the stream, even if there is an error.
+  return ZIP_OK if the whole zipfile was written
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,23 +1,12 @@
 #include "rar.hpp"
 
-uint CRCTab[256];
-
-void InitCRC()
-{
-  for (int I=0;I<256;I++)
-  {
-    uint C=I;
-    for (int J=0;J<8;J++)
-      C=(C & 1) ? (C>>1)^0xEDB88320L : (C>>1);
-    CRCTab[I]=C;
-  }
-}
+// Constant initialized, so the table is placed in read-only data and
+// there is nothing left to compute on the first CRC call.
+const CRCTable CRCTab;
 
 
 uint CRC(uint StartCRC,const void *Addr,size_t Size)
 {
-  if (CRCTab[1]==0)
-    InitCRC();
   byte *Data=(byte *)Addr;
 
 #if defined(LITTLE_ENDIAN) && defined(PRESENT_INT32) && defined(ALLOW_NOT_ALIGNED_INT)
@@ -1,9 +1,25 @@
 #ifndef _RAR_CRC_
 #define _RAR_CRC_
 
-extern uint CRCTab[256];
+struct CRCTable
+{
+  uint Data[256];
+
+  constexpr CRCTable() : Data()
+  {
+    for (int I=0;I<256;I++)
+    {
+      uint C=I;
+      for (int J=0;J<8;J++)
+        C=(C & 1) ? (C>>1)^0xEDB88320L : (C>>1);
+      Data[I]=C;
+    }
+  }
+  uint operator [](size_t I) const {return(Data[I]);}
+};
+
+extern const CRCTable CRCTab;
 
-void InitCRC();
 uint CRC(uint StartCRC,const void *Addr,size_t Size);
 ushort OldCRC(ushort StartCRC,const void *Addr,size_t Size);
 
@@ -1,9 +1,5 @@
 #include "rar.hpp"
 
-#ifndef SFX_MODULE
-extern uint CRCTab[256];
-#endif
-
 #define NROUNDS 32
 
 #define  rol(x,n,xsize)  (((x)<<(n)) | ((x)>>(xsize-(n))))
@@ -19,7 +15,7 @@ int CryptData::CachePos=0;
 
 
 #ifndef SFX_MODULE
-static byte InitSubstTable[256]={
+static const byte InitSubstTable[256]={
   215, 19,149, 35, 73,197,192,205,249, 28, 16,119, 48,221,  2, 42,
   232,  1,177,233, 14, 88,219, 25,223,195,244, 90, 87,239,153,137,
   255,199,147, 70, 92, 66,246, 13,216, 40, 62, 29,217,230, 86,  6,
@@ -192,8 +188,6 @@ void CryptData::SetCryptKeys(const char *Password,const byte *Salt,bool Encrypt,
   if (OldOnly)
   {
 #ifndef SFX_MODULE
-    if (CRCTab[1]==0)
-      InitCRC();
     byte Psw[MAXPASSWORD];
     SetOldKeys(Password);
     Key[0]=0xD3A3B879L;
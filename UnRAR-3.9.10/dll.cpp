@@ -6,15 +6,30 @@ static int RarErrorToDll(int ErrCode);
 struct DataSet
 {
   CommandData Cmd;
-  CmdExtract Extract;
+  CmdExtract *Extract; // Created on first RAR_EXTRACT or RAR_TEST only.
   Archive Arc;
   int OpenMode;
   int HeaderSize;
 
-  DataSet():Arc(&Cmd) {};
+  DataSet():Arc(&Cmd) {Extract=NULL;};
+  ~DataSet() {delete Extract;}
+  CmdExtract* GetExtract();
 };
 
 
+// CmdExtract owns the unpack window and the PPM and VM memory, so it is
+// not allocated for handles which only list files.
+CmdExtract* DataSet::GetExtract()
+{
+  if (Extract==NULL)
+  {
+    Extract=new CmdExtract;
+    Extract->ExtractArchiveInit(&Cmd,Arc);
+  }
+  return(Extract);
+}
+
+
 HANDLE PASCAL RAROpenArchive(struct RAROpenArchiveData *r)
 {
   RAROpenArchiveDataEx rx;
@@ -79,7 +94,6 @@ HANDLE PASCAL RAROpenArchiveEx(struct RAROpenArchiveDataEx *r)
       r->CmtState=r->CmtSize=0;
     if (Data->Arc.Signed)
       r->Flags|=0x20;
-    Data->Extract.ExtractArchiveInit(&Data->Cmd,Data->Arc);
     return((HANDLE)Data);
   }
   catch (int ErrCode)
@@ -110,7 +124,8 @@ int PASCAL RARReadHeader(HANDLE hArcData,struct RARHeaderData *D)
           (Data->Arc.EndArcHead.Flags & EARC_NEXT_VOLUME))
         if (MergeArchive(Data->Arc,NULL,false,'L'))
         {
-          Data->Extract.SignatureFound=false;
+          if (Data->Extract!=NULL)
+            Data->Extract->SignatureFound=false;
           Data->Arc.Seek(Data->Arc.CurBlockPos,SEEK_SET);
           return(RARReadHeader(hArcData,D));
         }
@@ -159,7 +174,8 @@ int PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *D)
           (Data->Arc.EndArcHead.Flags & EARC_NEXT_VOLUME))
         if (MergeArchive(Data->Arc,NULL,false,'L'))
         {
-          Data->Extract.SignatureFound=false;
+          if (Data->Extract!=NULL)
+            Data->Extract->SignatureFound=false;
           Data->Arc.Seek(Data->Arc.CurBlockPos,SEEK_SET);
           return(RARReadHeaderEx(hArcData,D));
         }
@@ -231,7 +247,8 @@ int PASCAL ProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestNa
           (Data->Arc.NewLhd.Flags & LHD_SPLIT_AFTER)!=0)
         if (MergeArchive(Data->Arc,NULL,false,'L'))
         {
-          Data->Extract.SignatureFound=false;
+          if (Data->Extract!=NULL)
+            Data->Extract->SignatureFound=false;
           Data->Arc.Seek(Data->Arc.CurBlockPos,SEEK_SET);
           return(0);
         }
@@ -281,11 +298,12 @@ int PASCAL ProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestNa
       strcpy(Data->Cmd.Command,Operation==RAR_EXTRACT ? "X":"T");
       Data->Cmd.Test=Operation!=RAR_EXTRACT;
       bool Repeat=false;
-      Data->Extract.ExtractCurrentFile(&Data->Cmd,Data->Arc,Data->HeaderSize,Repeat);
+      CmdExtract *Extract=Data->GetExtract();
+      Extract->ExtractCurrentFile(&Data->Cmd,Data->Arc,Data->HeaderSize,Repeat);
 
       while (Data->Arc.ReadHeader()!=0 && Data->Arc.GetHeaderType()==NEWSUB_HEAD)
       {
-        Data->Extract.ExtractCurrentFile(&Data->Cmd,Data->Arc,Data->HeaderSize,Repeat);
+        Extract->ExtractCurrentFile(&Data->Cmd,Data->Arc,Data->HeaderSize,Repeat);
         Data->Arc.SeekToNext();
       }
       Data->Arc.Seek(Data->Arc.CurBlockPos,SEEK_SET);
@@ -311,6 +329,24 @@ int PASCAL RARProcessFileW(HANDLE hArcData,int Operation,wchar *DestPath,wchar *
 }
 
 
+// Decodes only the first BufferSize bytes of the current file and moves
+// to the next one. Files in solid archives are still decoded entirely.
+// CRC is not verified unless the entire file fits in Buffer.
+int PASCAL RARProcessFilePrefix(HANDLE hArcData,unsigned char *Buffer,unsigned int BufferSize,unsigned int *DataSize)
+{
+  DataSet *Data=(DataSet *)hArcData;
+  Data->Cmd.DllPrefixBuf=Buffer;
+  Data->Cmd.DllPrefixSize=BufferSize;
+  Data->Cmd.DllPrefixRead=0;
+  int Code=ProcessFile(hArcData,RAR_TEST,NULL,NULL,NULL,NULL);
+  if (DataSize!=NULL)
+    *DataSize=(unsigned int)Data->Cmd.DllPrefixRead;
+  Data->Cmd.DllPrefixBuf=NULL;
+  Data->Cmd.DllPrefixSize=0;
+  return(Code);
+}
+
+
 void PASCAL RARSetChangeVolProc(HANDLE hArcData,CHANGEVOLPROC ChangeVolProc)
 {
   DataSet *Data=(DataSet *)hArcData;
@@ -347,6 +383,55 @@ int PASCAL RARGetDllVersion()
 }
 
 
+int PASCAL RARGetStatistics(HANDLE hArcData,struct RARStats *S)
+{
+  DataSet *Data=(DataSet *)hArcData;
+  if (Data==NULL || S==NULL)
+    return(ERAR_UNKNOWN);
+  memset(S,0,sizeof(*S));
+  if (Data->Extract==NULL)
+    return(0);
+  DecodeStats *Stats=Data->Extract->GetStats();
+  S->PackedRead=Stats->PackedRead;
+  S->UnpackedWritten=Stats->UnpackedWritten;
+  S->ReadCalls=Stats->ReadCalls;
+  S->WriteCalls=Stats->WriteCalls;
+  S->TableReads=Stats->TableReads;
+  S->LZBytes=Stats->LZBytes;
+  S->PPMBytes=Stats->PPMBytes;
+  for (int I=0;I<RAR_FILTER_TYPES && I<STAT_FILTER_TYPES;I++)
+  {
+    S->FilterCalls[I]=Stats->FilterCalls[I];
+    S->FilterBytes[I]=Stats->FilterBytes[I];
+  }
+  S->CRCBytes=Stats->CRCBytes;
+#ifdef RAR_STAT_TIMING
+  uint64 Time[STAT_STAGES];
+  memcpy(Time,Stats->StageTime,sizeof(Time));
+#ifdef STAT_CLOCK_TICKS
+  S->Timing=RAR_TIMING_TICKS;
+#else
+#ifdef _WIN_32
+  // Convert QueryPerformanceCounter units to nanoseconds.
+  LARGE_INTEGER Frequency;
+  QueryPerformanceFrequency(&Frequency);
+  for (int I=0;I<STAT_STAGES;I++)
+    Time[I]=Time[I]*1000000000/(uint64)Frequency.QuadPart;
+#endif
+  S->Timing=RAR_TIMING_NSEC;
+#endif
+  S->ReadTime=Time[STAT_READ];
+  S->UnpackTime=Time[STAT_UNPACK];
+  S->FilterTime=Time[STAT_FILTER];
+  S->WriteTime=Time[STAT_WRITE];
+  S->CRCTime=Time[STAT_CRC];
+#else
+  S->Timing=RAR_TIMING_NONE;
+#endif
+  return(0);
+}
+
+
 static int RarErrorToDll(int ErrCode)
 {
   switch(ErrCode)
@@ -28,6 +28,20 @@
 
 #define RAR_DLL_VERSION       4
 
+#define RAR_FILTER_VM         0
+#define RAR_FILTER_E8         1
+#define RAR_FILTER_E8E9       2
+#define RAR_FILTER_ITANIUM    3
+#define RAR_FILTER_RGB        4
+#define RAR_FILTER_AUDIO      5
+#define RAR_FILTER_DELTA      6
+#define RAR_FILTER_UPCASE     7
+#define RAR_FILTER_TYPES      8
+
+#define RAR_TIMING_NONE       0
+#define RAR_TIMING_NSEC       1
+#define RAR_TIMING_TICKS      2
+
 #ifdef _UNIX
 #define CALLBACK
 #define PASCAL
@@ -107,6 +121,27 @@ struct RAROpenArchiveDataEx
   unsigned int Reserved[32];
 };
 
+struct RARStats
+{
+  unsigned long long PackedRead;
+  unsigned long long UnpackedWritten;
+  unsigned int       ReadCalls;
+  unsigned int       WriteCalls;
+  unsigned int       TableReads;
+  unsigned long long LZBytes;
+  unsigned long long PPMBytes;
+  unsigned int       FilterCalls[RAR_FILTER_TYPES];
+  unsigned long long FilterBytes[RAR_FILTER_TYPES];
+  unsigned long long CRCBytes;
+  unsigned int       Timing;
+  unsigned long long ReadTime;
+  unsigned long long UnpackTime;
+  unsigned long long FilterTime;
+  unsigned long long WriteTime;
+  unsigned long long CRCTime;
+  unsigned int       Reserved[32];
+};
+
 enum UNRARCALLBACK_MESSAGES {
   UCM_CHANGEVOLUME,UCM_PROCESSDATA,UCM_NEEDPASSWORD
 };
@@ -127,11 +162,13 @@ int    PASCAL RARReadHeader(HANDLE hArcData,struct RARHeaderData *HeaderData);
 int    PASCAL RARReadHeaderEx(HANDLE hArcData,struct RARHeaderDataEx *HeaderData);
 int    PASCAL RARProcessFile(HANDLE hArcData,int Operation,char *DestPath,char *DestName);
 int    PASCAL RARProcessFileW(HANDLE hArcData,int Operation,wchar_t *DestPath,wchar_t *DestName);
+int    PASCAL RARProcessFilePrefix(HANDLE hArcData,unsigned char *Buffer,unsigned int BufferSize,unsigned int *DataSize);
 void   PASCAL RARSetCallback(HANDLE hArcData,UNRARCALLBACK Callback,LPARAM UserData);
 void   PASCAL RARSetChangeVolProc(HANDLE hArcData,CHANGEVOLPROC ChangeVolProc);
 void   PASCAL RARSetProcessDataProc(HANDLE hArcData,PROCESSDATAPROC ProcessDataProc);
 void   PASCAL RARSetPassword(HANDLE hArcData,char *Password);
 int    PASCAL RARGetDllVersion();
+int    PASCAL RARGetStatistics(HANDLE hArcData,struct RARStats *Stats);
 
 #ifdef __cplusplus
 }
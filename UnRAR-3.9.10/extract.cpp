@@ -806,16 +806,27 @@ bool CmdExtract::ExtractCurrentFile(CommandData *Cmd,Archive &Arc,size_t HeaderS
 
       CurFile.SetAllowDelete(!Cmd->KeepBroken);
 
+      // Only the beginning of the file is requested. In solid archives
+      // following files depend on the entire file, so it is decoded anyway.
+      int64 StopSize=-1;
+#ifdef RARDLL
+      if (Cmd->DllPrefixBuf!=NULL && !Arc.Solid &&
+          (Arc.NewLhd.Flags & (LHD_SPLIT_BEFORE|LHD_SPLIT_AFTER))==0 &&
+          (int64)Cmd->DllPrefixSize<Arc.NewLhd.FullUnpSize)
+        StopSize=Cmd->DllPrefixSize;
+#endif
+
       bool LinkCreateMode=!Cmd->Test && !SkipSolid;
       if (ExtractLink(DataIO,Arc,DestFileName,DataIO.UnpFileCRC,LinkCreateMode))
         PrevExtracted=LinkCreateMode;
       else
         if ((Arc.NewLhd.Flags & LHD_SPLIT_BEFORE)==0)
           if (Arc.NewLhd.Method==0x30)
-            UnstoreFile(DataIO,Arc.NewLhd.FullUnpSize);
+            UnstoreFile(DataIO,StopSize>=0 ? StopSize:Arc.NewLhd.FullUnpSize);
           else
           {
             Unp->SetDestSize(Arc.NewLhd.FullUnpSize);
+            Unp->SetStopSize(StopSize);
 #ifndef SFX_MODULE
             if (Arc.NewLhd.UnpVer<=15)
               Unp->DoUnpack(15,FileCount>1 && Arc.Solid);
@@ -828,7 +839,8 @@ bool CmdExtract::ExtractCurrentFile(CommandData *Cmd,Archive &Arc,size_t HeaderS
         Arc.SeekToNext();
 
       bool BrokenFile=false;
-      if (!SkipSolid)
+      bool PartialFile=StopSize>=0 && DataIO.CurUnpWrite<Arc.NewLhd.FullUnpSize;
+      if (!SkipSolid && !PartialFile)
       {
         if (Arc.OldFormat && UINT32(DataIO.UnpFileCRC)==UINT32(Arc.NewLhd.FileCRC) ||
             !Arc.OldFormat && UINT32(DataIO.UnpFileCRC)==UINT32(Arc.NewLhd.FileCRC^0xffffffff))
@@ -923,6 +935,8 @@ void CmdExtract::UnstoreFile(ComprDataIO &DataIO,int64 DestUnpSize)
     DataIO.UnpWrite(&Buffer[0],Code);
     if (DestUnpSize>=0)
       DestUnpSize-=Code;
+    if (DestUnpSize==0)
+      break;
   }
 }
 
@@ -36,6 +36,7 @@ class CmdExtract
     bool ExtractCurrentFile(CommandData *Cmd,Archive &Arc,size_t HeaderSize,
                             bool &Repeat);
     static void UnstoreFile(ComprDataIO &DataIO,int64 DestUnpSize);
+    DecodeStats* GetStats() {return(&DataIO.Stats);}
 
     bool SignatureFound;
 };
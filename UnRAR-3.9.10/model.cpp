@@ -5,6 +5,40 @@
  *  Contents: model description and encoding/decoding routines              *
  ****************************************************************************/
 
+// Mappings which do not depend on the model state, they used to be
+// filled in StartModelRare for every PPM block and are now constant.
+struct ModelTables
+{
+  byte NS2Indx[256], NS2BSIndx[256], HB2Flag[256];
+
+  constexpr ModelTables() : NS2Indx(), NS2BSIndx(), HB2Flag()
+  {
+    int i=0, k=0, m=0, Step=0;
+    NS2BSIndx[0]=2*0;
+    NS2BSIndx[1]=2*1;
+    for (i=2;i < 11;i++)
+      NS2BSIndx[i]=2*2;
+    for (i=11;i < 256;i++)
+      NS2BSIndx[i]=2*3;
+    for (i=0;i < 3;i++)
+      NS2Indx[i]=i;
+    for (m=i, k=Step=1;i < 256;i++) 
+    {
+      NS2Indx[i]=m;
+      if ( !--k ) 
+      { 
+        k = ++Step;
+        m++; 
+      }
+    }
+    for (i=0x40;i < 0x100;i++)
+      HB2Flag[i]=0x08;
+  }
+};
+
+static constexpr ModelTables PPMTables;
+
+
 inline PPM_CONTEXT* PPM_CONTEXT::createChild(ModelPPM *Model,STATE* pStats,
                                              STATE& FirstState)
 {
@@ -62,7 +96,6 @@ void ModelPPM::RestartModelRare()
 
 void ModelPPM::StartModelRare(int MaxOrder)
 {
-  int i, k, m ,Step;
   EscCount=1;
 /*
   if (MaxOrder < 2) 
@@ -83,23 +116,6 @@ void ModelPPM::StartModelRare(int MaxOrder)
   {
     ModelPPM::MaxOrder=MaxOrder;
     RestartModelRare();
-    NS2BSIndx[0]=2*0;
-    NS2BSIndx[1]=2*1;
-    memset(NS2BSIndx+2,2*2,9);
-    memset(NS2BSIndx+11,2*3,256-11);
-    for (i=0;i < 3;i++)
-      NS2Indx[i]=i;
-    for (m=i, k=Step=1;i < 256;i++) 
-    {
-      NS2Indx[i]=m;
-      if ( !--k ) 
-      { 
-        k = ++Step;
-        m++; 
-      }
-    }
-    memset(HB2Flag,0,0x40);
-    memset(HB2Flag+0x40,0x08,0x100-0x40);
     DummySEE2Cont.Shift=PERIOD_BITS;
   }
 }
@@ -349,10 +365,10 @@ static const byte ExpEscape[16]={ 25,14, 9, 7, 5, 5, 4, 4, 4, 3, 3, 3, 2, 2, 2,
 inline void PPM_CONTEXT::decodeBinSymbol(ModelPPM *Model)
 {
   STATE& rs=OneState;
-  Model->HiBitsFlag=Model->HB2Flag[Model->FoundState->Symbol];
+  Model->HiBitsFlag=PPMTables.HB2Flag[Model->FoundState->Symbol];
   ushort& bs=Model->BinSumm[rs.Freq-1][Model->PrevSuccess+
-           Model->NS2BSIndx[Suffix->NumStats-1]+
-           Model->HiBitsFlag+2*Model->HB2Flag[rs.Symbol]+
+           PPMTables.NS2BSIndx[Suffix->NumStats-1]+
+           Model->HiBitsFlag+2*PPMTables.HB2Flag[rs.Symbol]+
            ((Model->RunLength >> 26) & 0x20)];
   if (Model->Coder.GetCurrentShiftCount(TOT_BITS) < bs) 
   {
@@ -421,7 +437,7 @@ inline bool PPM_CONTEXT::decodeSymbol1(ModelPPM *Model)
   while ((HiCnt += (++p)->Freq) <= count)
     if (--i == 0) 
     {
-      Model->HiBitsFlag=Model->HB2Flag[Model->FoundState->Symbol];
+      Model->HiBitsFlag=PPMTables.HB2Flag[Model->FoundState->Symbol];
       Model->Coder.SubRange.LowCount=HiCnt;
       Model->CharMask[p->Symbol]=Model->EscCount;
       i=(Model->NumMasked=NumStats)-1;
@@ -455,7 +471,7 @@ inline SEE2_CONTEXT* PPM_CONTEXT::makeEscFreq2(ModelPPM *Model,int Diff)
   SEE2_CONTEXT* psee2c;
   if (NumStats != 256) 
   {
-    psee2c=Model->SEE2Cont[Model->NS2Indx[Diff-1]]+
+    psee2c=Model->SEE2Cont[PPMTables.NS2Indx[Diff-1]]+
            (Diff < Suffix->NumStats-NumStats)+
            2*(U.SummFreq < 11*NumStats)+4*(Model->NumMasked > Diff)+
            Model->HiBitsFlag;
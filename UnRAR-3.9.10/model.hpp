@@ -109,7 +109,7 @@ class ModelPPM
     struct PPM_CONTEXT *MinContext, *MedContext, *MaxContext;
     STATE* FoundState;      // found next state transition
     int NumMasked, InitEsc, OrderFall, MaxOrder, RunLength, InitRL;
-    byte CharMask[256], NS2Indx[256], NS2BSIndx[256], HB2Flag[256];
+    byte CharMask[256];
     byte EscCount, PrevSuccess, HiBitsFlag;
     ushort BinSumm[128][64];               // binary SEE-contexts
 
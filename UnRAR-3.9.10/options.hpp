@@ -157,6 +157,12 @@ class RAROptions
     UNRARCALLBACK Callback;
     CHANGEVOLPROC ChangeVolProc;
     PROCESSDATAPROC ProcessDataProc;
+
+    // Buffer receiving the beginning of the current file
+    // for RARProcessFilePrefix.
+    byte *DllPrefixBuf;
+    size_t DllPrefixSize;
+    size_t DllPrefixRead;
 #endif
 };
 #endif
@@ -35,6 +35,7 @@
 #include "scantree.hpp"
 #include "savepos.hpp"
 #include "getbits.hpp"
+#include "stats.hpp"
 #include "rdwrfn.hpp"
 #include "archive.hpp"
 #include "match.hpp"
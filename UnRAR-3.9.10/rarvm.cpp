@@ -5,6 +5,7 @@
 RarVM::RarVM()
 {
   Mem=NULL;
+  Stats=NULL;
 }
 
 
@@ -138,11 +139,24 @@ void RarVM::Execute(VM_PreparedProgram *Prg)
   Flags=0;
 
   VM_PreparedCommand *PreparedCode=Prg->AltCmd ? Prg->AltCmd:&Prg->Cmd[0];
+  STAT_TIMER_START(FilterStart);
   if (Prg->CmdCount>0 && !ExecuteCode(PreparedCode,Prg->CmdCount))
   {
     // Invalid VM program. Let's replace it with 'return' command.
     PreparedCode[0].OpCode=VM_RET;
   }
+  if (Stats!=NULL)
+  {
+    uint FilterType=0;
+#ifdef VM_STANDARDFILTERS
+    if (Prg->CmdCount>0 && PreparedCode[0].OpCode==VM_STANDARD &&
+        PreparedCode[0].Op1.Data<STAT_FILTER_TYPES)
+      FilterType=PreparedCode[0].Op1.Data;
+#endif
+    Stats->FilterCalls[FilterType]++;
+    Stats->FilterBytes[FilterType]+=Prg->InitR[4];
+    STAT_TIMER_STOP(*Stats,STAT_FILTER,FilterStart);
+  }
   uint NewBlockPos=GET_VALUE(false,&Mem[VM_GLOBALMEMADDR+0x20])&VM_MEMMASK;
   uint NewBlockSize=GET_VALUE(false,&Mem[VM_GLOBALMEMADDR+0x1c])&VM_MEMMASK;
   if (NewBlockPos+NewBlockSize>=VM_MEMSIZE)
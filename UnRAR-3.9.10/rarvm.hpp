@@ -99,6 +99,7 @@ class RarVM:private BitInput
     byte *Mem;
     uint R[8];
     uint Flags;
+    DecodeStats *Stats;
   public:
     RarVM();
     ~RarVM();
@@ -108,6 +109,7 @@ class RarVM:private BitInput
     void SetLowEndianValue(uint *Addr,uint Value);
     void SetMemory(uint Pos,byte *Data,uint DataSize);
     static uint ReadData(BitInput &Inp);
+    void SetStats(DecodeStats *Stats) {RarVM::Stats=Stats;}
 };
 
 #endif
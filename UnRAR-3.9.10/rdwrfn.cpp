@@ -31,6 +31,7 @@ void ComprDataIO::Init()
   SubHeadPos=NULL;
   CurrentCommand=0;
   ProcessedArcSize=TotalArcSize=0;
+  Stats.Reset();
 }
 
 
@@ -56,7 +57,12 @@ int ComprDataIO::UnpRead(byte *Addr,size_t Count)
     {
       if (!SrcFile->IsOpened())
         return(-1);
+      STAT_TIMER_START(ReadStart);
       RetCode=SrcFile->Read(ReadAddr,ReadSize);
+      STAT_TIMER_STOP(Stats,STAT_READ,ReadStart);
+      Stats.ReadCalls++;
+      if (RetCode>0)
+        Stats.PackedRead+=RetCode;
       FileHeader *hd=SubHead!=NULL ? SubHead:&SrcArc->NewLhd;
       if (hd->Flags & LHD_SPLIT_AFTER)
         PackedCRC=CRC(PackedCRC,ReadAddr,RetCode);
@@ -120,6 +126,9 @@ int ComprDataIO::UnpRead(byte *Addr,size_t Count)
 
 void ComprDataIO::UnpWrite(byte *Addr,size_t Count)
 {
+  Stats.WriteCalls++;
+  Stats.UnpackedWritten+=Count;
+  STAT_TIMER_START(WriteStart);
 
 #ifdef RARDLL
   RAROptions *Cmd=((Archive *)SrcFile)->GetRAROptions();
@@ -155,6 +164,12 @@ void ComprDataIO::UnpWrite(byte *Addr,size_t Count)
       if (RetCode==0)
         ErrHandler.Exit(USER_BREAK);
     }
+    if (Cmd->DllPrefixBuf!=NULL && CurUnpWrite<(int64)Cmd->DllPrefixSize)
+    {
+      size_t CopySize=Min(Count,Cmd->DllPrefixSize-(size_t)CurUnpWrite);
+      memcpy(Cmd->DllPrefixBuf+CurUnpWrite,Addr,CopySize);
+      Cmd->DllPrefixRead=(size_t)CurUnpWrite+CopySize;
+    }
   }
 #endif // RARDLL
 
@@ -173,13 +188,19 @@ void ComprDataIO::UnpWrite(byte *Addr,size_t Count)
     if (!TestMode)
       DestFile->Write(Addr,Count);
   CurUnpWrite+=Count;
+  STAT_TIMER_STOP(Stats,STAT_WRITE,WriteStart);
   if (!SkipUnpCRC)
+  {
+    STAT_TIMER_START(CRCStart);
 #ifndef SFX_MODULE
     if (((Archive *)SrcFile)->OldFormat)
       UnpFileCRC=OldCRC((ushort)UnpFileCRC,Addr,Count);
     else
 #endif
       UnpFileCRC=CRC(UnpFileCRC,Addr,Count);
+    STAT_TIMER_STOP(Stats,STAT_CRC,CRCStart);
+    Stats.CRCBytes+=Count;
+  }
   ShowUnpWrite();
   Wait();
 }
@@ -81,6 +81,8 @@ class ComprDataIO
 
     uint PackFileCRC,UnpFileCRC,PackedCRC;
 
+    DecodeStats Stats;
+
     int Encryption;
     int Decryption;
 };
@@ -2,17 +2,73 @@
  * This code is based on Szymon Stefanek AES implementation:              *
  * http://www.esat.kuleuven.ac.be/~rijmen/rijndael/rijndael-cpplib.tar.gz *
  *                                                                        *
- * Dynamic tables generation is based on the Brian Gladman work:          *
+ * Tables generation is based on the Brian Gladman work:                  *
  * http://fp.gladman.plus.com/cryptography_technology/rijndael            *
  **************************************************************************/
 #include "rar.hpp"
 
 const int uKeyLenInBytes=16, m_uRounds=10;
 
-static byte S[256],S5[256],rcon[30];
-static byte T1[256][4],T2[256][4],T3[256][4],T4[256][4];
-static byte T5[256][4],T6[256][4],T7[256][4],T8[256][4];
-static byte U1[256][4],U2[256][4],U3[256][4],U4[256][4];
+#define ff_poly 0x011b
+#define ff_hi   0x80
+
+#define FFinv(x)    ((x) ? pow[255 - log[x]]: 0)
+
+#define FFmul09(x) (x ? pow[log[x] + 0xc7] : 0)
+#define FFmul0b(x) (x ? pow[log[x] + 0x68] : 0)
+#define FFmul0d(x) (x ? pow[log[x] + 0xee] : 0)
+#define FFmul0e(x) (x ? pow[log[x] + 0xdf] : 0)
+#define fwd_affine(x) \
+    (w = (uint)x, w ^= (w<<1)^(w<<2)^(w<<3)^(w<<4), (byte)(0x63^(w^(w>>8))))
+
+#define inv_affine(x) \
+    (w = (uint)x, w = (w<<1)^(w<<3)^(w<<6), (byte)(0x05^(w^(w>>8))))
+
+// Tables are computed by the compiler and end up in read-only data.
+// Only decryption is implemented, so encryption T1-T4 are not generated.
+struct RijndaelTables
+{
+  byte S[256],S5[256],rcon[30];
+  byte T5[256][4],T6[256][4],T7[256][4],T8[256][4];
+  byte U1[256][4],U2[256][4],U3[256][4],U4[256][4];
+
+  constexpr RijndaelTables() : S(),S5(),rcon(),T5(),T6(),T7(),T8(),U1(),U2(),U3(),U4()
+  {
+    byte pow[512]={},log[256]={};
+    int i = 0, w = 1; 
+    do
+    {   
+      pow[i] = (byte)w;
+      pow[i + 255] = (byte)w;
+      log[w] = (byte)i++;
+      w ^=  (w << 1) ^ (w & ff_hi ? ff_poly : 0);
+    } while (w != 1);
+ 
+    w = 1;
+    for (i = 0; i < sizeof(rcon)/sizeof(rcon[0]); i++)
+    {
+      rcon[i] = w;
+      w = (w << 1) ^ (w & ff_hi ? ff_poly : 0);
+    }
+    for(i = 0; i < 256; ++i)
+    {   
+      S[i]=fwd_affine(FFinv((byte)i));
+      byte b = S5[i] = FFinv(inv_affine((byte)i));
+      U1[b][3]=U2[b][0]=U3[b][1]=U4[b][2]=T5[i][3]=T6[i][0]=T7[i][1]=T8[i][2]=FFmul0b(b);
+      U1[b][1]=U2[b][2]=U3[b][3]=U4[b][0]=T5[i][1]=T6[i][2]=T7[i][3]=T8[i][0]=FFmul09(b);
+      U1[b][2]=U2[b][3]=U3[b][0]=U4[b][1]=T5[i][2]=T6[i][3]=T7[i][0]=T8[i][1]=FFmul0d(b);
+      U1[b][0]=U2[b][1]=U3[b][2]=U4[b][3]=T5[i][0]=T6[i][1]=T7[i][2]=T8[i][3]=FFmul0e(b);
+    }
+  }
+};
+
+static constexpr RijndaelTables Tables;
+
+static constexpr const byte (&S)[256]=Tables.S,(&S5)[256]=Tables.S5,(&rcon)[30]=Tables.rcon;
+static constexpr const byte (&T5)[256][4]=Tables.T5,(&T6)[256][4]=Tables.T6;
+static constexpr const byte (&T7)[256][4]=Tables.T7,(&T8)[256][4]=Tables.T8;
+static constexpr const byte (&U1)[256][4]=Tables.U1,(&U2)[256][4]=Tables.U2;
+static constexpr const byte (&U3)[256][4]=Tables.U3,(&U4)[256][4]=Tables.U4;
 
 
 inline void Xor128(byte *dest,const byte *arg1,const byte *arg2)
@@ -61,8 +117,6 @@ inline void Copy128(byte *dest,const byte *src)
 
 Rijndael::Rijndael()
 {
-  if (S[0]==0)
-    GenerateTables();
 }
 
 
@@ -248,51 +302,3 @@ void Rijndael::decrypt(const byte a[16], byte b[16])
   b[15] = S5[temp[0][3]];
   Xor128((byte*)b,(byte*)b,(byte*)m_expandedKey[0]);
 }
-
-#define ff_poly 0x011b
-#define ff_hi   0x80
-
-#define FFinv(x)    ((x) ? pow[255 - log[x]]: 0)
-
-#define FFmul02(x) (x ? pow[log[x] + 0x19] : 0)
-#define FFmul03(x) (x ? pow[log[x] + 0x01] : 0)
-#define FFmul09(x) (x ? pow[log[x] + 0xc7] : 0)
-#define FFmul0b(x) (x ? pow[log[x] + 0x68] : 0)
-#define FFmul0d(x) (x ? pow[log[x] + 0xee] : 0)
-#define FFmul0e(x) (x ? pow[log[x] + 0xdf] : 0)
-#define fwd_affine(x) \
-    (w = (uint)x, w ^= (w<<1)^(w<<2)^(w<<3)^(w<<4), (byte)(0x63^(w^(w>>8))))
-
-#define inv_affine(x) \
-    (w = (uint)x, w = (w<<1)^(w<<3)^(w<<6), (byte)(0x05^(w^(w>>8))))
-
-void Rijndael::GenerateTables()
-{
-  unsigned char pow[512],log[256];
-  int i = 0, w = 1; 
-  do
-  {   
-    pow[i] = (byte)w;
-    pow[i + 255] = (byte)w;
-    log[w] = (byte)i++;
-    w ^=  (w << 1) ^ (w & ff_hi ? ff_poly : 0);
-  } while (w != 1);
- 
-  for (int i = 0,w = 1; i < sizeof(rcon)/sizeof(rcon[0]); i++)
-  {
-    rcon[i] = w;
-    w = (w << 1) ^ (w & ff_hi ? ff_poly : 0);
-  }
-  for(int i = 0; i < 256; ++i)
-  {   
-    unsigned char b=S[i]=fwd_affine(FFinv((byte)i));
-    T1[i][1]=T1[i][2]=T2[i][2]=T2[i][3]=T3[i][0]=T3[i][3]=T4[i][0]=T4[i][1]=b;
-    T1[i][0]=T2[i][1]=T3[i][2]=T4[i][3]=FFmul02(b);
-    T1[i][3]=T2[i][0]=T3[i][1]=T4[i][2]=FFmul03(b);
-    S5[i] = b = FFinv(inv_affine((byte)i));
-    U1[b][3]=U2[b][0]=U3[b][1]=U4[b][2]=T5[i][3]=T6[i][0]=T7[i][1]=T8[i][2]=FFmul0b(b);
-    U1[b][1]=U2[b][2]=U3[b][3]=U4[b][0]=T5[i][1]=T6[i][2]=T7[i][3]=T8[i][0]=FFmul09(b);
-    U1[b][2]=U2[b][3]=U3[b][0]=U4[b][1]=T5[i][2]=T6[i][3]=T7[i][0]=T8[i][1]=FFmul0d(b);
-    U1[b][0]=U2[b][1]=U3[b][2]=U4[b][3]=T5[i][0]=T6[i][1]=T7[i][2]=T8[i][3]=FFmul0e(b);
-  }
-}
@@ -5,7 +5,7 @@
  * This code is based on Szymon Stefanek AES implementation:              *
  * http://www.esat.kuleuven.ac.be/~rijmen/rijndael/rijndael-cpplib.tar.gz *
  *                                                                        *
- * Dynamic tables generation is based on the Brian Gladman's work:        *
+ * Tables generation is based on the Brian Gladman's work:                *
  * http://fp.gladman.plus.com/cryptography_technology/rijndael            *
  **************************************************************************/
 
@@ -22,7 +22,6 @@ class Rijndael
     void keyEncToDec();
     void encrypt(const byte a[16], byte b[16]);
     void decrypt(const byte a[16], byte b[16]);
-    void GenerateTables();
 
     Direction m_direction;
     byte     m_initVector[MAX_IV_SIZE];
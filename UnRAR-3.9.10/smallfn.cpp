@@ -18,7 +18,6 @@ int ToPercentUnlim(int64 N1,int64 N2)
 
 void RARInitData()
 {
-  InitCRC();
   ErrHandler.Clean();
 }
 
@@ -0,0 +1,60 @@
+#ifndef _RAR_STATS_
+#define _RAR_STATS_
+
+// Decode counters shared by ComprDataIO, Unpack and RarVM. Counters are
+// always on, they are only a few additions per buffer. Stage times are
+// sampled only if RAR_STAT_TIMING is defined, using CPU ticks instead of
+// clock_gettime if RAR_STAT_RDTSC is also defined on x86.
+
+// Same order as VM_StandardFilters, 0 is used for generic VM code.
+#define STAT_FILTER_TYPES 8
+
+enum STAT_STAGE {STAT_READ,STAT_UNPACK,STAT_FILTER,STAT_WRITE,STAT_CRC,STAT_STAGES};
+
+struct DecodeStats
+{
+  int64 PackedRead;
+  int64 UnpackedWritten;
+  uint ReadCalls;
+  uint WriteCalls;
+  uint TableReads;
+  int64 LZBytes;
+  int64 PPMBytes;
+  uint FilterCalls[STAT_FILTER_TYPES];
+  int64 FilterBytes[STAT_FILTER_TYPES];
+  int64 CRCBytes;
+  uint64 StageTime[STAT_STAGES];
+
+  void Reset() {memset(this,0,sizeof(*this));}
+};
+
+#ifdef RAR_STAT_TIMING
+#if defined(RAR_STAT_RDTSC) && (defined(__i386__) || defined(__x86_64__))
+#define STAT_CLOCK_TICKS
+#endif
+
+inline uint64 StatClock()
+{
+#if defined(STAT_CLOCK_TICKS)
+  uint Low,High;
+  __asm__ __volatile__("rdtsc" : "=a"(Low),"=d"(High));
+  return(INT32TO64(High,Low));
+#elif defined(_WIN_32)
+  LARGE_INTEGER Counter;
+  QueryPerformanceCounter(&Counter);
+  return((uint64)Counter.QuadPart);
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return((uint64)ts.tv_sec*1000000000+ts.tv_nsec);
+#endif
+}
+
+#define STAT_TIMER_START(Var) uint64 Var=StatClock()
+#define STAT_TIMER_STOP(Stats,Stage,Var) (Stats).StageTime[Stage]+=StatClock()-(Var)
+#else
+#define STAT_TIMER_START(Var)
+#define STAT_TIMER_STOP(Stats,Stage,Var)
+#endif
+
+#endif
@@ -11,9 +11,11 @@
 Unpack::Unpack(ComprDataIO *DataIO)
 {
   UnpIO=DataIO;
+  VM.SetStats(&DataIO->Stats);
   Window=NULL;
   ExternalWindow=false;
   Suspended=false;
+  StopSize=-1;
   UnpAllBuf=false;
   UnpSomeRead=false;
 }
@@ -54,6 +56,7 @@ void Unpack::Init(byte *Window)
 
 void Unpack::DoUnpack(int Method,bool Solid)
 {
+  STAT_TIMER_START(UnpackStart);
   switch(Method)
   {
 #ifndef SFX_MODULE
@@ -70,6 +73,7 @@ void Unpack::DoUnpack(int Method,bool Solid)
       Unpack29(Solid);
       break;
   }
+  STAT_TIMER_STOP(UnpIO->Stats,STAT_UNPACK,UnpackStart);
 }
 
 
@@ -217,6 +221,13 @@ void Unpack::Unpack29(bool Solid)
 
     if (InAddr>ReadBorder)
     {
+      // Checked only when refilling the input buffer to keep it out
+      // of the symbol loop.
+      if (StopSize>=0 && WrittenFileSize+((UnpPtr-WrPtr)&MAXWINMASK)>=StopSize)
+      {
+        FileExtracted=false;
+        break;
+      }
       if (!UnpReadBuf())
         break;
     }
@@ -684,6 +695,7 @@ bool Unpack::UnpReadBuf()
 
 void Unpack::UnpWriteBuf()
 {
+  CountBlockBytes();
   unsigned int WrittenBorder=WrPtr;
   unsigned int WriteSize=(UnpPtr-WrittenBorder)&MAXWINMASK;
   for (size_t I=0;I<PrgStack.Size();I++)
@@ -815,6 +827,19 @@ void Unpack::UnpWriteBuf()
 }
 
 
+// Called at least once per window, so the distance to StatBlockPtr
+// cannot wrap around.
+void Unpack::CountBlockBytes()
+{
+  unsigned int Size=(UnpPtr-StatBlockPtr)&MAXWINMASK;
+  if (UnpBlockType==BLOCK_PPM)
+    UnpIO->Stats.PPMBytes+=Size;
+  else
+    UnpIO->Stats.LZBytes+=Size;
+  StatBlockPtr=UnpPtr;
+}
+
+
 void Unpack::ExecuteCode(VM_PreparedProgram *Prg)
 {
   if (Prg->GlobalData.Size()>0)
@@ -859,6 +884,8 @@ bool Unpack::ReadTables()
 {
   byte BitLength[BC];
   unsigned char Table[HUFF_TABLE_SIZE];
+  UnpIO->Stats.TableReads++;
+  CountBlockBytes();
   if (InAddr>ReadTop-25)
     if (!UnpReadBuf())
       return(false);
@@ -977,7 +1004,7 @@ void Unpack::UnpInitData(int Solid)
     memset(&LDD,0,sizeof(LDD));
     memset(&RD,0,sizeof(RD));
     memset(&BD,0,sizeof(BD));
-    UnpPtr=WrPtr=0;
+    UnpPtr=WrPtr=StatBlockPtr=0;
     PPMEscChar=2;
     UnpBlockType=BLOCK_LZ;
 
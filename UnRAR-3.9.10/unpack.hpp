@@ -111,6 +111,7 @@ class Unpack:private BitInput
     bool ReadVMCodePPM();
     bool AddVMCode(unsigned int FirstByte,byte *Code,int CodeSize);
     void InitFilters();
+    void CountBlockBytes();
 
     ComprDataIO *UnpIO;
     ModelPPM PPM;
@@ -154,12 +155,20 @@ class Unpack:private BitInput
 
     int UnpBlockType;
 
+    // Window position up to which decoded bytes are already added
+    // to LZBytes or PPMBytes statistics.
+    unsigned int StatBlockPtr;
+
     byte *Window;
     bool ExternalWindow;
 
 
     int64 DestUnpSize;
 
+    // Decoding stops as soon as this many bytes are available,
+    // -1 to decode the entire file.
+    int64 StopSize;
+
     bool Suspended;
     bool UnpAllBuf;
     bool UnpSomeRead;
@@ -210,6 +219,7 @@ class Unpack:private BitInput
     bool IsFileExtracted() {return(FileExtracted);}
     void SetDestSize(int64 DestSize) {DestUnpSize=DestSize;FileExtracted=false;}
     void SetSuspended(bool Suspended) {Unpack::Suspended=Suspended;}
+    void SetStopSize(int64 StopSize) {Unpack::StopSize=StopSize;}
 
     unsigned int GetChar()
     {
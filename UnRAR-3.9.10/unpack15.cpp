@@ -122,6 +122,7 @@ void Unpack::Unpack15(bool Solid)
 
 void Unpack::OldUnpWriteBuf()
 {
+  CountBlockBytes();
   if (UnpPtr!=WrPtr)
     UnpSomeRead=true;
   if (UnpPtr<WrPtr)
@@ -168,6 +168,7 @@ bool Unpack::ReadTables20()
 {
   byte BitLength[BC20];
   unsigned char Table[MC20*4];
+  UnpIO->Stats.TableReads++;
   int TableSize,N,I;
   if (InAddr>ReadTop-25)
     if (!UnpReadBuf())